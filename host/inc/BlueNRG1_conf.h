@@ -0,0 +1,242 @@
+/**
+  ******************************************************************************
+  * @file    BlueNRG1_conf.h
+  * @brief   Host stand-in for inc/BlueNRG1_conf.h: the CMSIS core intrinsics
+  *          and the peripheral driver API used by the application.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef BlueNRG1_CONF_H
+#define BlueNRG1_CONF_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "sim.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {RESET = 0, SET = !RESET} FlagStatus, ITStatus;
+typedef enum {DISABLE = 0, ENABLE = !DISABLE} FunctionalState;
+typedef enum {Bit_RESET = 0, Bit_SET} BitAction;
+
+typedef enum {
+  UART_IRQn = 4,
+  WDG_IRQn = 7,
+  GPIO_IRQn = 15,
+} IRQn_Type;
+
+typedef struct {
+  uint32_t GPIO_Pin;
+  uint8_t GPIO_Mode;
+  FunctionalState GPIO_Pull;
+  FunctionalState GPIO_HighPwr;
+} GPIO_InitType;
+
+typedef struct {
+  uint32_t GPIO_Pin;
+  uint8_t GPIO_IrqSense;
+  uint8_t GPIO_Event;
+} GPIO_EXTIConfigType;
+
+typedef struct {
+  uint8_t MFT_Mode;
+  uint8_t MFT_Prescaler;
+  uint8_t MFT_Clock1;
+  uint8_t MFT_Clock2;
+  uint16_t MFT_CRA;
+  uint16_t MFT_CRB;
+} MFT_InitType;
+
+/* Simulated MFT instance, see host/src/sim_mft.c */
+typedef struct {
+  uint8_t  enabled;
+  uint8_t  clock1;
+  uint8_t  prescaler;
+  uint16_t cra;
+  uint16_t start_cnt;      /* Counter 1 at start_us */
+  uint64_t start_us;
+} MFT_Type;
+
+typedef struct {
+  uint8_t NVIC_IRQChannel;
+  uint8_t NVIC_IRQChannelPreemptionPriority;
+  FunctionalState NVIC_IRQChannelCmd;
+} NVIC_InitType;
+
+/* Exported constants --------------------------------------------------------*/
+#define GPIO_Pin_0              (0x0001)
+#define GPIO_Pin_1              (0x0002)
+#define GPIO_Pin_2              (0x0004)
+#define GPIO_Pin_3              (0x0008)
+#define GPIO_Pin_4              (0x0010)
+#define GPIO_Pin_5              (0x0020)
+#define GPIO_Pin_6              (0x0040)
+#define GPIO_Pin_7              (0x0080)
+#define GPIO_Pin_8              (0x0100)
+#define GPIO_Pin_9              (0x0200)
+#define GPIO_Pin_10             (0x0400)
+#define GPIO_Pin_11             (0x0800)
+#define GPIO_Pin_12             (0x1000)
+#define GPIO_Pin_13             (0x2000)
+#define GPIO_Pin_14             (0x4000)
+
+#define GPIO_Input              ((uint8_t)0)
+#define GPIO_Output             ((uint8_t)1)
+
+#define GPIO_IrqSense_Edge      ((uint8_t)0)
+#define GPIO_IrqSense_Level     ((uint8_t)1)
+
+#define GPIO_Event_Low          ((uint8_t)0)
+#define GPIO_Event_High         ((uint8_t)1)
+#define GPIO_Event_Both         ((uint8_t)2)
+
+#define CRITICAL_PRIORITY       (0)
+#define HIGH_PRIORITY           (1)
+#define MED_PRIORITY            (2)
+#define LOW_PRIORITY            (3)
+
+#define CLOCK_PERIPH_GPIO       (0x0001)
+#define CLOCK_PERIPH_MTFX1      (0x0008)
+#define CLOCK_PERIPH_MTFX2      (0x0010)
+#define CLOCK_PERIPH_WDG        (0x0080)
+
+#define MFT_MODE_1              ((uint8_t)0x00)
+#define MFT_MODE_2              ((uint8_t)0x01)
+#define MFT_MODE_3              ((uint8_t)0x02)
+#define MFT_MODE_4              ((uint8_t)0x03)
+#define MFT_MODE_1a             ((uint8_t)0x04)
+
+#define MFT_NO_CLK              ((uint8_t)0x00)
+#define MFT_PRESCALED_CLK       ((uint8_t)0x01)
+#define MFT_EXTERNAL_EVENT      ((uint8_t)0x02)
+#define MFT_PULSE_ACCUMULATE    ((uint8_t)0x03)
+#define MFT_LOW_SPEED_CLK       ((uint8_t)0x04)
+
+/* System clock of the MFT prescaler, MHz */
+#define SIM_MFT_CLOCK_MHZ       16
+
+extern MFT_Type sim_mft[2];
+#define MFT1                    (&sim_mft[0])
+#define MFT2                    (&sim_mft[1])
+
+/* SysCtrl_GetWakeupResetReason() */
+#define RESET_NONE              (0x00)
+#define RESET_SYSREQ            (0x01)
+#define RESET_WDG               (0x02)
+#define RESET_LOCKUP            (0x03)
+#define RESET_BLE_BOR           (0x04)
+#define RESET_BLE_POR           (0x05)
+
+/* system_bluenrg1.h clock sources, selected by the Makefile DEFINES */
+#define LS_SOURCE_EXTERNAL_32kHZ    (0)
+#define LS_SOURCE_INTERNAL_RO       (1)
+#define HS_SPEED_XTAL_32MHZ         (0)
+#define HS_SPEED_XTAL_16MHZ         (1)
+
+#define UART_FLAG_BUSY          ((uint16_t)0x0008)
+#define UART_FLAG_RXFE          ((uint16_t)0x0010)
+#define UART_FLAG_TXFF          ((uint16_t)0x0020)
+#define UART_FLAG_TXFE          ((uint16_t)0x0080)
+
+#define UART_IT_RX              ((uint16_t)0x0010)
+#define UART_IT_TX              ((uint16_t)0x0020)
+
+#define FIFO_LEV_1_64           ((uint8_t)0x00)
+#define FIFO_LEV_1_32           ((uint8_t)0x01)
+#define FIFO_LEV_1_16           ((uint8_t)0x02)
+#define FIFO_LEV_1_8            ((uint8_t)0x03)
+#define FIFO_LEV_1_4            ((uint8_t)0x04)
+#define FIFO_LEV_1_2            ((uint8_t)0x05)
+#define FIFO_LEV_3_4            ((uint8_t)0x06)
+
+/* Flash: 80 pages of 2 KB, programmed 4 words at a time by
+   FLASH_ProgramWordBurst() */
+#define _MEMORY_FLASH_BEGIN_    (0x10040000UL)
+#define _MEMORY_FLASH_SIZE_     (0x28000UL)
+#define N_BYTES_PAGE            (2048)
+#define N_BYTES_BURST           (16)
+
+/* Exported macro ------------------------------------------------------------*/
+/* CMSIS core intrinsics, PRIMASK masks the simulated interrupts */
+static inline void __disable_irq(void) { Sim_SetIrqMask(1); }
+static inline void __enable_irq(void) { Sim_SetIrqMask(0); }
+static inline uint32_t __get_PRIMASK(void) { return Sim_IrqMasked(); }
+static inline void __set_PRIMASK(uint32_t primask) { Sim_SetIrqMask((uint8_t)(primask & 1)); }
+static inline void __DMB(void) { __sync_synchronize(); }
+
+/* Exported functions ------------------------------------------------------- */
+void SystemInit(void);
+void NVIC_SystemReset(void);
+
+void GPIO_Init(GPIO_InitType* GPIO_InitStruct);
+BitAction GPIO_ReadBit(uint32_t GPIO_Pins);
+void GPIO_WriteBit(uint32_t GPIO_Pins, BitAction BitVal);
+void GPIO_ToggleBits(uint32_t GPIO_Pins);
+void GPIO_EXTIConfig(GPIO_EXTIConfigType* EXTIConfig);
+void GPIO_EXTICmd(uint32_t GPIO_Pins, FunctionalState NewState);
+ITStatus GPIO_GetITPendingBit(uint32_t GPIO_Pins);
+void GPIO_ClearITPendingBit(uint32_t GPIO_Pins);
+void NVIC_Init(NVIC_InitType* NVIC_InitStruct);
+void SysCtrl_PeripheralClockCmd(uint32_t PeriphClock, FunctionalState NewState);
+uint8_t SysCtrl_GetWakeupResetReason(void);
+
+void MFT_StructInit(MFT_InitType* MFT_InitStruct);
+void MFT_Init(MFT_Type* MFTx, MFT_InitType* MFT_InitStruct);
+void MFT_Cmd(MFT_Type* MFTx, FunctionalState NewState);
+void MFT_SetCounter1(MFT_Type* MFTx, uint16_t MFT_Cnt1);
+uint16_t MFT_GetCounter1(MFT_Type* MFTx);
+
+void UART_SendData(uint16_t Data);
+FlagStatus UART_GetFlagStatus(uint16_t UART_FLAG);
+void UART_ITConfig(uint16_t UART_IT, FunctionalState NewState);
+ITStatus UART_GetITStatus(uint16_t UART_IT);
+void UART_ClearITPendingBit(uint16_t UART_IT);
+void UART_TxFifoIrqLevelConfig(uint8_t UART_TxFifo);
+
+void WDG_SetReload(uint32_t WDG_Reload);
+uint32_t WDG_GetCounter(void);
+void WDG_Enable(void);
+void WDG_ITConfig(FunctionalState NewState);
+ITStatus WDG_GetITStatus(void);
+void WDG_ClearITPendingBit(void);
+
+void FLASH_ErasePage(uint16_t PageNumber);
+void FLASH_ProgramWordBurst(uint32_t Address, uint32_t *Data);
+void FLASH_ProgramWord(uint32_t Address, uint32_t Data);
+
+/* Simulation side of the GPIO block: drive an input pin at a given time */
+void Sim_GpioDrive(uint32_t GPIO_Pins, uint8_t level, uint64_t at_us);
+uint32_t Sim_GpioReads(void);
+uint32_t Sim_GpioWrites(void);
+uint8_t Sim_GpioLevel(uint32_t GPIO_Pins);
+void Sim_GpioStall(uint32_t GPIO_Pins, uint64_t at_us, uint32_t stall_us);
+/* Edges that wake the core from deep sleep raise no GPIO interrupt, as on
+   the device where the GPIO block is powered down: off after Sim_Init() */
+void Sim_GpioSleepLoss(uint8_t enable);
+
+/* Simulation side of the UART: where the transmitted characters go */
+void Sim_UartCapture(FILE *out);
+uint32_t Sim_UartTxBytes(void);
+void Sim_UartNvicCmd(FunctionalState NewState);
+void Sim_UartStall(uint64_t at_us);
+
+/* Simulation side of the watchdog: reloads seen, expiries */
+void Sim_WdgNvicCmd(FunctionalState NewState);
+uint32_t Sim_WdgReloads(void);
+uint32_t Sim_WdgExpiries(void);
+
+/* Simulation side of the flash: operations since the reset, contents,
+   contents loaded as by a debugger (no cost, not counted), the running
+   image (none by default) and the CRC32 of flash contents, chained as
+   Crc32_Update(), at its CPU cost */
+uint32_t Sim_FlashErases(void);
+uint32_t Sim_FlashBursts(void);
+uint32_t Sim_FlashWords(void);
+uint32_t Sim_FlashErrors(void);
+const uint8_t *Sim_FlashData(uint32_t Address);
+void Sim_FlashLoad(uint32_t Address, const uint8_t *data, uint32_t len);
+void Sim_FlashSetImage(uint32_t Address, uint32_t Size);
+void Sim_FlashImage(uint32_t *Address, uint32_t *Size);
+uint32_t Sim_FlashCrc32(uint32_t crc, uint32_t Address, uint32_t len);
+
+#endif /* BlueNRG1_CONF_H */
@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file    OTA_btl.h
+  * @brief   Host stand-in for the BlueNRG-1 DK BLE_Application/OTA/inc/OTA_btl.h:
+  *          the constants of the 2-app scheme and the jump to the service
+  *          manager (host/src/sim_stack.c). The OTA service itself is the
+  *          one of the application, src/ota_service.c.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef OTA_BTL_H
+#define OTA_BTL_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* OTA client and server ATT_MTU, used with data length extension */
+#define OTA_ATT_MTU_SIZE            (220)
+
+/* Extended OTA packets (ATT_MTU of OTA_ATT_MTU_SIZE): set by the ota_fast
+   build profile */
+#ifndef OTA_EXTENDED_PACKET_LEN
+#define OTA_EXTENDED_PACKET_LEN     (0)
+#endif
+
+/* OTA tag of the 2-app scheme: vector table entry read by the reset
+   manager, which boots the bank whose image has the valid tag */
+#define OTA_TAG_VECTOR_TABLE_ENTRY_INDEX   (4)
+#define OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET  (OTA_TAG_VECTOR_TABLE_ENTRY_INDEX * 4)
+#define OTA_VALID_TAG               (0xAA5555AA)
+#define OTA_SERVICE_MANAGER_TAG     (0xAABBCCDD)
+#define OTA_IN_PROGRESS_TAG         (0xFFFFFFFF)
+#define OTA_INVALID_OLD_TAG         (0x00000000)
+
+/* Exported functions ------------------------------------------------------- */
+void OTA_Jump_To_Service_Manager_Application(void);
+
+#endif /* OTA_BTL_H */
@@ -0,0 +1,27 @@
+/**
+  ******************************************************************************
+  * @file    SDK_EVAL_Config.h
+  * @brief   Host stand-in for the BlueNRG-1 DK SDK_Eval_BlueNRG1/inc/SDK_EVAL_Config.h.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SDK_EVAL_CONFIG_H
+#define __SDK_EVAL_CONFIG_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "BlueNRG1_conf.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define UART_BAUDRATE       (115200)
+
+/* LED pin levels */
+#define LED_ON              Bit_SET
+#define LED_OFF             Bit_RESET
+
+/* Exported functions ------------------------------------------------------- */
+void SdkEvalIdentification(void);
+void SdkEvalComUartInit(uint32_t baudrate);
+
+#endif /* __SDK_EVAL_CONFIG_H */
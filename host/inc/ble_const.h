@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @file    ble_const.h
+  * @brief   Host stand-in for the BlueNRG-1 DK Bluetooth_LE/inc/ble_const.h.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _BLE_CONST_H_
+#define _BLE_CONST_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef uint8_t tBleStatus;
+
+/* Exported constants --------------------------------------------------------*/
+#define BLE_STATUS_SUCCESS                  (0x00)
+#define BLE_STATUS_UNKNOWN_HCI_COMMAND      (0x01)
+#define BLE_STATUS_INVALID_PARAMS           (0x12)
+#define BLE_STATUS_COMMAND_DISALLOWED       (0x0C)
+#define BLE_STATUS_INSUFFICIENT_RESOURCES   (0x64)
+
+/* Advertising types */
+#define ADV_IND                             (0x00)
+#define ADV_DIRECT_IND                      (0x01)
+#define ADV_SCAN_IND                        (0x02)
+#define ADV_NONCONN_IND                     (0x03)
+
+/* Own address types */
+#define PUBLIC_ADDR                         (0x00)
+#define RANDOM_ADDR                         (0x01)
+#define STATIC_RANDOM_ADDR                  (0x01)
+
+/* Advertising filter policies */
+#define NO_WHITE_LIST_USE                   (0x00)
+
+/* AD types */
+#define AD_TYPE_FLAGS                       (0x01)
+#define AD_TYPE_16_BIT_SERV_UUID            (0x02)
+#define AD_TYPE_16_BIT_SERV_UUID_CMPLT_LIST (0x03)
+#define AD_TYPE_SHORTENED_LOCAL_NAME        (0x08)
+#define AD_TYPE_COMPLETE_LOCAL_NAME         (0x09)
+#define AD_TYPE_TX_POWER_LEVEL              (0x0A)
+#define AD_TYPE_SERVICE_DATA                (0x16)
+#define AD_TYPE_MANUFACTURER_SPECIFIC_DATA  (0xFF)
+
+/* Flags AD type values */
+#define FLAG_BIT_LE_GENERAL_DISCOVERABLE_MODE   (0x02)
+#define FLAG_BIT_BR_EDR_NOT_SUPPORTED           (0x04)
+
+/* UUID types and service type of aci_gatt_add_service() and
+   aci_gatt_add_char() */
+#define UUID_TYPE_16                        (0x01)
+#define UUID_TYPE_128                       (0x02)
+#define PRIMARY_SERVICE                     (0x01)
+#define SECONDARY_SERVICE                   (0x02)
+
+/* Characteristic properties */
+#define CHAR_PROP_BROADCAST                 (0x01)
+#define CHAR_PROP_READ                      (0x02)
+#define CHAR_PROP_WRITE_WITHOUT_RESP        (0x04)
+#define CHAR_PROP_WRITE                     (0x08)
+#define CHAR_PROP_NOTIFY                    (0x10)
+#define CHAR_PROP_INDICATE                  (0x20)
+
+/* Security permissions and GATT events of a characteristic */
+#define ATTR_PERMISSION_NONE                (0x00)
+#define GATT_DONT_NOTIFY_EVENTS             (0x00)
+#define GATT_NOTIFY_ATTRIBUTE_WRITE         (0x01)
+
+/* Characteristic value length */
+#define CHAR_VALUE_LEN_CONSTANT             (0x00)
+#define CHAR_VALUE_LEN_VARIABLE             (0x01)
+
+/* Longest advertising or scan response payload */
+#define ADV_DATA_MAX_LEN                    (31)
+
+/* Master sleep clock accuracy */
+#define MASTER_SCA_500ppm                   (0)
+#define MASTER_SCA_250ppm                   (1)
+#define MASTER_SCA_150ppm                   (2)
+#define MASTER_SCA_100ppm                   (3)
+#define MASTER_SCA_75ppm                    (4)
+#define MASTER_SCA_50ppm                    (5)
+#define MASTER_SCA_30ppm                    (6)
+#define MASTER_SCA_20ppm                    (7)
+
+#endif /* _BLE_CONST_H_ */
@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file    bluenrg1_api.h
+  * @brief   Host stand-in for the BlueNRG-1 DK Bluetooth_LE/inc/bluenrg1_api.h:
+  *          the ACI/HCI commands called by the application. The recording
+  *          stub in host/src/sim_stack.c counts each call and keeps the
+  *          advertising state they set.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef BLUENRG1_API_H
+#define BLUENRG1_API_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "ble_const.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef union {
+  uint16_t Service_UUID_16;
+  uint8_t  Service_UUID_128[16];
+} Service_UUID_t;
+
+typedef union {
+  uint16_t Char_UUID_16;
+  uint8_t  Char_UUID_128[16];
+} Char_UUID_t;
+
+/* Exported functions ------------------------------------------------------- */
+tBleStatus aci_hal_write_config_data(uint8_t Offset, uint8_t Length, uint8_t Value[]);
+tBleStatus aci_hal_set_tx_power_level(uint8_t En_High_Power, uint8_t PA_Level);
+tBleStatus aci_hal_set_radio_activity_mask(uint16_t Radio_Activity_Mask);
+
+tBleStatus aci_gatt_init(void);
+tBleStatus aci_gatt_add_service(uint8_t Service_UUID_Type, Service_UUID_t *Service_UUID, uint8_t Service_Type,
+                                uint8_t Max_Attribute_Records, uint16_t *Service_Handle);
+tBleStatus aci_gatt_add_char(uint16_t Service_Handle, uint8_t Char_UUID_Type, Char_UUID_t *Char_UUID,
+                             uint16_t Char_Value_Length, uint8_t Char_Properties, uint8_t Security_Permissions,
+                             uint8_t GATT_Evt_Mask, uint8_t Enc_Key_Size, uint8_t Is_Variable,
+                             uint16_t *Char_Handle);
+tBleStatus aci_gatt_update_char_value_ext(uint16_t Conn_Handle_To_Notify, uint16_t Service_Handle,
+                                          uint16_t Char_Handle, uint8_t Update_Type,
+                                          uint16_t Char_Length, uint16_t Value_Offset,
+                                          uint8_t Value_Length, uint8_t Value[]);
+
+tBleStatus aci_gap_init(uint8_t Role, uint8_t privacy_enabled, uint8_t device_name_char_len,
+                        uint16_t *Service_Handle, uint16_t *Dev_Name_Char_Handle,
+                        uint16_t *Appearance_Char_Handle);
+tBleStatus aci_gap_set_discoverable(uint8_t Advertising_Type, uint16_t Advertising_Interval_Min,
+                                    uint16_t Advertising_Interval_Max, uint8_t Own_Address_Type,
+                                    uint8_t Advertising_Filter_Policy, uint8_t Local_Name_Length,
+                                    uint8_t Local_Name[], uint8_t Service_Uuid_length,
+                                    uint8_t Service_Uuid_List[], uint16_t Slave_Conn_Interval_Min,
+                                    uint16_t Slave_Conn_Interval_Max);
+tBleStatus aci_gap_set_non_discoverable(void);
+tBleStatus aci_gap_delete_ad_type(uint8_t ADType);
+tBleStatus aci_gap_update_adv_data(uint8_t AdvDataLen, uint8_t AdvData[]);
+
+tBleStatus hci_le_set_advertising_data(uint8_t Advertising_Data_Length, uint8_t Advertising_Data[]);
+tBleStatus hci_le_set_scan_response_data(uint8_t Scan_Response_Data_Length,
+                                         uint8_t Scan_Response_Data[]);
+tBleStatus hci_le_set_data_length(uint16_t Connection_Handle, uint16_t TxOctets, uint16_t TxTime);
+
+/* Events, implemented by the application */
+void hci_hardware_error_event(uint8_t Hardware_Code);
+void aci_hal_end_of_radio_activity_event(uint8_t Last_State, uint8_t Next_State, uint32_t Next_State_SysTime);
+void hci_le_connection_complete_event(uint8_t Status, uint16_t Connection_Handle, uint8_t Role,
+                                      uint8_t Peer_Address_Type, uint8_t Peer_Address[6],
+                                      uint16_t Conn_Interval, uint16_t Conn_Latency,
+                                      uint16_t Supervision_Timeout, uint8_t Master_Clock_Accuracy);
+void hci_disconnection_complete_event(uint8_t Status, uint16_t Connection_Handle, uint8_t Reason);
+void aci_gatt_attribute_modified_event(uint16_t Connection_Handle, uint16_t Attr_Handle, uint16_t Offset,
+                                       uint16_t Attr_Data_Length, uint8_t Attr_Data[]);
+
+#endif /* BLUENRG1_API_H */
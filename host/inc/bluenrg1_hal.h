@@ -0,0 +1,27 @@
+/**
+  ******************************************************************************
+  * @file    bluenrg1_hal.h
+  * @brief   Host stand-in for the BlueNRG-1 DK Bluetooth_LE/inc/bluenrg1_hal.h.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BLUENRG1_HAL_H__
+#define __BLUENRG1_HAL_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* aci_hal_write_config_data() offsets and lengths */
+#define CONFIG_DATA_PUBADDR_OFFSET          (0x00)
+#define CONFIG_DATA_ER_OFFSET               (0x08)
+#define CONFIG_DATA_IR_OFFSET               (0x18)
+#define CONFIG_DATA_RANDOM_ADDRESS_OFFSET   (0x80)
+
+#define CONFIG_DATA_PUBADDR_LEN             (6)
+#define CONFIG_DATA_ER_LEN                  (16)
+#define CONFIG_DATA_IR_LEN                  (16)
+#define CONFIG_DATA_RANDOM_ADDRESS_LEN      (6)
+
+#endif /* __BLUENRG1_HAL_H__ */
@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file    bluenrg1_stack.h
+  * @brief   Host stand-in for the BlueNRG-1 stack API used by the application.
+  *          The implementation in host/src charges each call to the
+  *          simulated CPU.
+  *
+  *          The RAM sizing macros follow the shape of the DK ones but not
+  *          their exact per-item costs: on the host they only size the
+  *          arrays declared by Beacon_config.h.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef BLUENRG1_STACK_H
+#define BLUENRG1_STACK_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "bluenrg1_api.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+  uint32_t *hot_table;
+  uint32_t max_conn_event_length;
+  uint16_t slave_sca;
+  uint8_t  master_sca;
+  uint8_t  ls_source;
+  uint16_t hs_startup_time;
+} hardware_config_table_t;
+
+typedef struct {
+  uint8_t  *bleStartFlashAddress;
+  uint32_t secDbSize;
+  uint32_t serverDbSize;
+  uint8_t  *stored_device_id_data_p;
+  uint8_t  *bleStartRamAddress;
+  uint32_t total_buffer_size;
+  uint16_t numAttrRecord;
+  uint16_t numAttrServ;
+  uint16_t attrValueArrSize;
+  uint8_t  numOfLinks;
+  uint8_t  extended_packet_length_enable;
+  uint8_t  prWriteListSize;
+  uint8_t  mblockCount;
+  uint16_t attMtu;
+  hardware_config_table_t hardware_config;
+} BlueNRG_Stack_Initialization_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define DEFAULT_ATT_MTU             (23)
+#define MEM_BLOCK_SIZE              (32)
+#define FLASH_PAGE_SIZE             (2048)
+
+/* Exported macro ------------------------------------------------------------*/
+/* Zero-initialized by the C runtime on the host */
+#define NO_INIT(var)                        var
+#define NO_INIT_SECTION(var, sect)          var
+
+#define DIV_CEIL(x, y)                      (((x) + (y) - 1) / (y))
+
+/* Prepare write requests needed by an attribute of max_att_size bytes */
+#define PREP_WRITE_X_ATT(max_att_size)      (DIV_CEIL(max_att_size, DEFAULT_ATT_MTU - 5) * 2)
+
+/* Memory blocks for the TX and RX of one ATT_MTU on each link */
+#define MBLOCKS_CALC(pw, mtu, n_link) \
+  ((pw) + (n_link) * 2 * (DIV_CEIL((mtu) + 4, MEM_BLOCK_SIZE) + 1))
+
+#define TOTAL_BUFFER_SIZE(n_link, n_attr, n_serv, att_value_array_size, n_mblocks, d_len_ext_en) \
+  ((6200 + (n_link) * 600 + (n_attr) * 12 + (n_serv) * 8 + (att_value_array_size) +           \
+    (n_mblocks) * (MEM_BLOCK_SIZE + 4) + (d_len_ext_en) * 800 + 3) & ~3)
+
+#define TOTAL_FLASH_BUFFER_SIZE(sec_db_size, server_db_size) \
+  (DIV_CEIL((sec_db_size) + (server_db_size), FLASH_PAGE_SIZE) * FLASH_PAGE_SIZE)
+
+/* Exported functions ------------------------------------------------------- */
+tBleStatus BlueNRG_Stack_Initialization(const BlueNRG_Stack_Initialization_t *BlueNRG_Stack_Init_params_p);
+void BTLE_StackTick(void);
+void RAL_Isr(void);
+
+int HAL_VTimerStart_ms(uint8_t timerNum, int32_t msRelTimeout);
+void HAL_VTimer_Stop(uint8_t timerNum);
+uint32_t HAL_VTimerGetCurrentTime_sysT32(void);
+int32_t HAL_VTimerDiff_ms_sysT32(uint32_t sysTime1, uint32_t sysTime2);
+uint32_t HAL_VTimerAcc_sysT32_ms(uint32_t sysTime, int32_t msTime);
+void HAL_VTimerTimeoutCallback(uint8_t timerNum);
+
+#endif /* BLUENRG1_STACK_H */
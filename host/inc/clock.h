@@ -0,0 +1,29 @@
+/**
+  ******************************************************************************
+  * @file    clock.h
+  * @brief   Host stand-in for the BlueNRG-1 DK hal/inc/clock.h.
+  *          Clock_Time() counts the simulated SysTick interrupts, so like on
+  *          the device it does not advance while the core is in deep sleep.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef uint32_t tClockTime;
+
+/* Exported constants --------------------------------------------------------*/
+#define CLOCK_SECOND 1000
+
+/* Exported functions ------------------------------------------------------- */
+void Clock_Init(void);
+tClockTime Clock_Time(void);
+void Clock_Wait(uint32_t i);
+void SysCount_Handler(void);
+
+#endif /* __CLOCK_H__ */
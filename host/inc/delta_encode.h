@@ -0,0 +1,30 @@
+/**
+  ******************************************************************************
+  * @file    delta_encode.h
+  * @brief   Encoder of the delta OTA images of inc/ota_delta.h, for the host
+  *          tool (delta_tool.c) and the benches.
+  *
+  *          Greedy parse with one step of lazy matching: at each position
+  *          the longest saving among a fill, a copy from the old image (hash
+  *          chains, the old cursor first) and a copy from the new image
+  *          already produced.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DELTA_ENCODE_H
+#define DELTA_ENCODE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "ota_delta.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Largest delta image: the header and the new image as one literal run */
+#define DELTA_ENCODE_MAX(new_size)  ((new_size) + OTA_DELTA_HEADER_LEN + 8)
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t Delta_Encode(const uint8_t *old_image, uint32_t old_size, const uint8_t *new_image,
+                      uint32_t new_size, uint8_t *out_data, uint32_t out_max);
+
+#endif /* DELTA_ENCODE_H */
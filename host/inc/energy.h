@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file    energy.h
+  * @brief   Parametric energy model of the beacon: average supply current
+  *          and coin cell life from the time the simulation spent in each
+  *          CPU state and the advertising events of the stack stub.
+  *
+  *          The currents are BlueNRG-1 datasheet typical values at 3 V with
+  *          the SMPS on; they are model parameters, to be calibrated with a
+  *          measurement of the real board.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef ENERGY_H
+#define ENERGY_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+/* Radio settings evaluated by the model */
+typedef struct {
+  uint8_t tx_high_power;    /* aci_hal_set_tx_power_level() parameters */
+  uint8_t pa_level;
+  uint8_t payload_bytes;    /* AdvData length, 0-31 */
+} Energy_Radio_t;
+
+typedef struct {
+  double avg_ua;            /* Average supply current */
+  double cpu_ua;            /* Share of the CPU running and halted */
+  double radio_ua;          /* Share of the advertising events */
+  double sleep_ua;          /* Share of deep sleep */
+  double event_uc;          /* Charge of one advertising event, radio only */
+  double battery_days;
+} Energy_Result_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* Supply currents */
+#define ENERGY_CPU_RUN_UA           1900.0  /* Core at 32 MHz, from flash */
+#define ENERGY_CPU_HALT_UA          1100.0  /* WFI, clocks and UART running */
+#define ENERGY_SLEEP_UA             0.9     /* Deep sleep, sleep timer on RO */
+#define ENERGY_XO_STARTUP_UA        1200.0  /* 16 MHz crystal start */
+#define ENERGY_RADIO_IDLE_UA        3000.0  /* Synthesizer settling between channels */
+
+/* Advertising event timing */
+#define ENERGY_XO_STARTUP_US        800.0   /* HS_STARTUP_TIME of Beacon_config.h */
+#define ENERGY_TX_RAMP_US           80.0    /* Per channel, at TX current */
+#define ENERGY_CHANNEL_GAP_US       150.0   /* Between two channels */
+#define ENERGY_ADV_CHANNELS         3
+#define ENERGY_PDU_OVERHEAD_BYTES   16      /* Preamble, access address, header, AdvA, CRC */
+#define ENERGY_US_PER_BYTE          8.0     /* 1 Mbps */
+
+/* CR2032 usable capacity */
+#define ENERGY_BATTERY_MAH          225.0
+
+/* Exported functions ------------------------------------------------------- */
+double Energy_TxDbm(uint8_t tx_high_power, uint8_t pa_level);
+double Energy_TxCurrentUa(uint8_t tx_high_power, uint8_t pa_level);
+void Energy_Estimate(const Energy_Radio_t *radio, Energy_Result_t *res);
+
+#endif /* ENERGY_H */
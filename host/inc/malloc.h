@@ -0,0 +1,33 @@
+/**
+  ******************************************************************************
+  * @file    malloc.h
+  * @brief   Host stand-in for the newlib-nano malloc.h: mallinfo() of the
+  *          device heap, set by the simulation (Sim_HeapSet()).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef SIM_MALLOC_H
+#define SIM_MALLOC_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+
+/* Exported types ------------------------------------------------------------*/
+struct mallinfo {
+  size_t arena;       /* Bytes taken from _sbrk() */
+  size_t ordblks;     /* Free chunks */
+  size_t smblks;
+  size_t hblks;
+  size_t hblkhd;
+  size_t usmblks;
+  size_t fsmblks;
+  size_t uordblks;    /* Bytes allocated */
+  size_t fordblks;    /* Bytes free in the arena */
+  size_t keepcost;
+};
+
+/* Exported functions ------------------------------------------------------- */
+struct mallinfo mallinfo(void);
+
+#endif /* SIM_MALLOC_H */
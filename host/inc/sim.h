@@ -0,0 +1,306 @@
+/**
+  ******************************************************************************
+  * @file    sim.h
+  * @brief   Host simulation core: simulated time, CPU cost accounting and
+  *          interrupt (event) delivery for the native Linux build.
+  *
+  *          Firmware code never calls this API directly: the stand-ins of the
+  *          BlueNRG-1 HAL/stack in host/src charge the cost of each call with
+  *          Sim_Consume() and BlueNRG_Sleep() moves the simulated time to the
+  *          next wakeup source with Sim_Sleep().
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef SIM_H
+#define SIM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdio.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*Sim_Callback)(void *arg);
+
+/* Wakeup source classes of a simulated interrupt */
+typedef enum {
+  SIM_SRC_TIMER = 0,   /* Virtual timer, sleep timer based */
+  SIM_SRC_IO,          /* Wakeup IO / GPIO edge */
+  SIM_SRC_RADIO,       /* Radio event (BLE_IRQn) */
+  SIM_SRC_PERIPH,      /* Other peripheral, only while the core is not in deep sleep */
+  SIM_SRC_SYSTEM,      /* Hardware beside the CPU (watchdog counter): runs even with
+                          interrupts masked or inside an interrupt, while awake */
+} Sim_Source;
+
+/* Sleep depth seen by the simulation core */
+typedef enum {
+  SIM_SLEEP_HALT = 0,  /* WFI: SysTick keeps running and wakes the core every ms */
+  SIM_SLEEP_DEEP,      /* Core off: only timer, IO and radio sources wake it up */
+  SIM_SLEEP_IO_ONLY,   /* Core and sleep timer off: only IO sources wake it up */
+} Sim_SleepDepth;
+
+/* Stack API entry points counted by the recording stub of sim_stack.c */
+typedef enum {
+  SIM_API_STACK_INIT = 0,       /* BlueNRG_Stack_Initialization() */
+  SIM_API_STACK_TICK,           /* BTLE_StackTick() */
+  SIM_API_RAL_ISR,              /* RAL_Isr() */
+  SIM_API_HAL_WRITE_CONFIG,     /* aci_hal_write_config_data() */
+  SIM_API_HAL_TX_POWER,         /* aci_hal_set_tx_power_level() */
+  SIM_API_HAL_RADIO_MASK,       /* aci_hal_set_radio_activity_mask() */
+  SIM_API_GATT_INIT,            /* aci_gatt_init() */
+  SIM_API_GATT_UPDATE_CHAR,     /* aci_gatt_update_char_value_ext() */
+  SIM_API_GATT_ADD_SERVICE,     /* aci_gatt_add_service() */
+  SIM_API_GATT_ADD_CHAR,        /* aci_gatt_add_char() */
+  SIM_API_GAP_INIT,             /* aci_gap_init() */
+  SIM_API_GAP_DISCOVERABLE,     /* aci_gap_set_discoverable() */
+  SIM_API_GAP_NON_DISCOVERABLE, /* aci_gap_set_non_discoverable() */
+  SIM_API_GAP_DELETE_AD_TYPE,   /* aci_gap_delete_ad_type() */
+  SIM_API_GAP_UPDATE_ADV_DATA,  /* aci_gap_update_adv_data() */
+  SIM_API_HCI_ADV_DATA,         /* hci_le_set_advertising_data() */
+  SIM_API_HCI_SCAN_RESP_DATA,   /* hci_le_set_scan_response_data() */
+  SIM_API_HCI_DATA_LENGTH,      /* hci_le_set_data_length() */
+  SIM_API_COUNT
+} Sim_StackApi;
+
+/* GATT client at the other end of a connection (Sim_StackConnect()): the
+   writes without response it sends and the notifications it receives */
+typedef struct {
+  uint16_t att_mtu;             /* Client ATT_MTU, exchanged at connection */
+  uint16_t ll_octets;           /* Client LL payload, 27 without data length extension */
+  uint8_t  max_per_event;       /* Packets the client sends per connection event */
+  /* Next write, its length or 0 if none is ready */
+  uint16_t (*next_write)(uint16_t *handle, uint8_t *value, uint16_t max_len);
+  void     (*notified)(uint16_t handle, const uint8_t *value, uint16_t len);
+} Sim_GattClient_t;
+
+/* Connection counters */
+typedef struct {
+  uint16_t att_mtu;             /* Exchanged ATT_MTU */
+  uint16_t ll_octets;           /* LL payload in use */
+  uint16_t rx_blocks;           /* Memory blocks for received packets */
+  uint32_t events;              /* Connection events */
+  uint32_t missed_events;       /* Anchors passed with the radio interrupt held */
+  uint32_t packets;             /* LL data packets from the client, NAKed ones included */
+  uint32_t naks;                /* Packets refused for lack of memory blocks */
+  uint32_t writes;              /* Writes given to the application */
+  uint32_t notifications;       /* Notifications sent */
+  uint32_t notify_refused;      /* aci_gatt_update_char_value_ext() without a TX buffer */
+  uint64_t air_us;              /* Radio time of the connection events */
+  uint64_t notify_air_us;       /* Part of it carrying the notifications */
+} Sim_ConnStats_t;
+
+/* OTA client of a phone (sim_ota_client.c) */
+typedef struct {
+  uint32_t size;                /* Bytes sent as image content */
+  uint16_t last_seq;            /* Sequence number of the last packet */
+  uint32_t errors;              /* Notifications with an error */
+  uint8_t  aborted;             /* Transfer given up on a flash error */
+  uint64_t start_us;            /* First connection event */
+  uint64_t wait_us;             /* Time waiting for acks */
+  uint64_t done_us;             /* Last packet acknowledged, 0 before */
+} Sim_OtaClientStats_t;
+
+/* Advertising events of the stack stub against the CPU activity */
+typedef struct {
+  uint32_t events;              /* Advertising events */
+  uint32_t reports;             /* aci_hal_end_of_radio_activity_event() delivered */
+  uint32_t peak_windows;        /* Events with the CPU running during the radio activity */
+  uint64_t radio_us;            /* Radio activity, crystal startup to the last channel */
+  uint64_t overlap_us;          /* CPU running inside it */
+  uint32_t isr_late_max_us;     /* Radio interrupt after the end of the event, worst */
+} Sim_RadioStats_t;
+
+typedef struct {
+  uint64_t active_us;       /* CPU running */
+  uint64_t halt_us;         /* CPU halted (WFI) */
+  uint64_t deep_us;         /* Deep sleep */
+  uint32_t wakeups;         /* Exits from Sim_Sleep() */
+  uint32_t irqs;            /* Simulated interrupts delivered */
+  uint32_t systicks;        /* SysTick interrupts */
+} Sim_Stats_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* Maximum number of simultaneously scheduled simulation events */
+#define SIM_MAX_EVENTS          64
+
+/* Check of a simulation driver: a failed one is reported by Sim_Fail() */
+#define SIM_CHECK(cond, ...)    do { if (!(cond)) Sim_Fail(__VA_ARGS__); } while (0)
+
+/* CPU cost model in microseconds at 32 MHz */
+#define SIM_COST_LOOP_US            2     /* Loop/dispatch overhead */
+#define SIM_COST_STACK_TICK_US      25    /* BTLE_StackTick() with nothing to do */
+#define SIM_COST_GPIO_US            1     /* GPIO register access */
+#define SIM_COST_SYSTICK_US         1     /* SysTick_Handler() */
+#define SIM_COST_SLEEP_CHECK_US     4     /* BlueNRG_Sleep() refusing to sleep */
+#define SIM_COST_HALT_US            2     /* WFI entry + exit */
+#define SIM_COST_DEEP_ENTRY_US      40    /* Context save */
+#define SIM_COST_DEEP_EXIT_US       150   /* Wakeup + context restore */
+#define SIM_COST_UART_CHAR_US       87    /* One character at 115200 baud, 8N1 */
+#define SIM_COST_FORMAT_BASE_US     10    /* vsnprintf() call, newlib-nano */
+#define SIM_COST_FORMAT_CHAR_US     2     /* vsnprintf() per output character */
+#define SIM_COST_DCC_BYTE_US        20    /* Debugger poll of DCRDR over SWD, per byte */
+#define SIM_COST_STACK_INIT_US      3000  /* BlueNRG_Stack_Initialization() */
+#define SIM_COST_STACK_CMD_US       60    /* One ACI/HCI command */
+#define SIM_COST_RAL_ISR_US         30    /* Radio interrupt, RAL_Isr() */
+#define SIM_COST_ADV_TICK_US        120   /* BTLE_StackTick() after an advertising event */
+#define SIM_COST_GATT_EVENT_US      40    /* BTLE_StackTick() giving one write to the application */
+#define SIM_COST_RADIO_EVENT_US     10    /* BTLE_StackTick() giving the end of radio activity event */
+#define SIM_COST_FLASH_ERASE_US     21000 /* FLASH_ErasePage(), CPU stalled */
+#define SIM_COST_FLASH_BURST_US     50    /* FLASH_ProgramWordBurst(), 4 words */
+#define SIM_COST_FLASH_WORD_US      20    /* FLASH_ProgramWord() */
+#define SIM_COST_OTA_BYTE_CYCLES    8     /* OTA service checksum and copy, per byte */
+#define SIM_COST_DELTA_OP_CYCLES    40    /* Delta decoder: op byte, varints, dispatch */
+#define SIM_COST_DELTA_BYTE_CYCLES  12    /* Delta decoder: new image byte into the burst */
+#define SIM_COST_CRC_BYTE_CYCLES    10    /* Crc32_Update(), table driven, per byte */
+#define SIM_COST_CRC_BIT_BYTE_CYCLES 56   /* CRC32 bit by bit, per byte (crc_bench reference) */
+
+/* CSTACK of BlueNRG1.ld (_Min_Stack_Size), sim_cstack on the host */
+#define SIM_CSTACK_SIZE             0xC00
+
+/* Core clock, to express simulated time in CPU cycles */
+#define SIM_CPU_MHZ                 32
+
+/* sysT32 time unit of the BlueNRG-1 sleep timer: 2.4414 us */
+#define SIM_SYST_PER_MS             (409.6)
+
+/* Exported functions ------------------------------------------------------- */
+void Sim_Init(void);
+
+/* Reset of the peripheral and stack stand-ins, called by Sim_Init() */
+void Sim_HalReset(void);
+void Sim_GpioReset(void);
+void Sim_UartReset(void);
+void Sim_MftReset(void);
+void Sim_StackReset(void);
+void Sim_WdgReset(void);
+void Sim_FlashReset(void);
+
+void Sim_Run(void (*entry)(void), uint64_t duration_us);
+void Sim_Stop(void);
+
+uint64_t Sim_NowUs(void);
+void Sim_Consume(uint32_t us);
+
+int Sim_Schedule(uint64_t at_us, Sim_Source src, Sim_Callback cb, void *arg);
+void Sim_Cancel(int handle);
+
+void Sim_Sleep(Sim_SleepDepth depth);
+/* Non zero in the handlers of the events that ended a deep sleep, taken
+   on the way out of it */
+uint8_t Sim_DeepWakeup(void);
+/* Pins whose edge ended the last deep sleep, for BlueNRG_WakeupSource() */
+uint32_t Sim_GpioWakePins(void);
+void Sim_GpioWakeClear(void);
+void Sim_SetIrqMask(uint8_t masked);
+uint8_t Sim_IrqMasked(void);
+
+uint32_t Sim_SysTickCount(void);
+void Sim_SysTickEnable(void);
+
+/* Periodic observer of the simulated time, called each period_us without
+   touching the simulated CPU; NULL to remove it */
+void Sim_SetProbe(uint64_t period_us, void (*probe)(uint64_t now_us));
+
+/* Recording stub of the BLE stack */
+uint32_t Sim_StackCalls(Sim_StackApi api);
+uint32_t Sim_StackCallsTotal(void);
+uint32_t Sim_StackAdvEvents(void);
+uint64_t Sim_StackFirstAdvUs(void);
+uint8_t Sim_StackRadioActive(void);
+void Sim_StackForceAdvInterval(uint16_t interval);
+uint16_t Sim_StackAdvIntervalRequested(void);
+uint32_t Sim_StackAdvIntervalUs(void);
+void Sim_StackTxPower(uint8_t *high_power, uint8_t *pa_level);
+const uint8_t *Sim_StackAdvData(uint8_t *len);
+void Sim_StackSetAdvObserver(void (*observer)(const uint8_t *data, uint8_t len));
+void Sim_StackReport(FILE *out);
+void Sim_StackStall(uint64_t at_us, uint32_t stall_us);
+
+/* Radio activity of the advertising events: each event lasts as in the
+   energy model (host/inc/energy.h) and raises the radio interrupt at its
+   end; the next tick reports it if the firmware set the advertising bit of
+   aci_hal_set_radio_activity_mask(). Sim_StackRadioReports(0) keeps the
+   reports back, as a stack without the event would. Connection events are
+   not reported */
+void Sim_StackRadioReports(uint8_t enable);
+const Sim_RadioStats_t *Sim_StackRadioStats(void);
+/* Called by the core for each span of CPU activity */
+void Sim_StackCpuActive(uint64_t from_us, uint64_t to_us);
+
+/* Connection of a GATT client: it connects at the end of the next
+   connectable advertising event (ADV_IND) of the firmware, which stops
+   advertising and gets hci_le_connection_complete_event(), then connection
+   events every interval_us. The controller of the firmware has data length
+   extension if its BLE_STACK_CONFIGURATION links it in: dle, as the stack
+   stub is built once for all profiles. The link starts with 27 bytes LL
+   packets; the client's longer ones are used from the second event after
+   the firmware asks for them with hci_le_set_data_length().
+   Sim_StackDisconnect() closes the link at the end of the connection event,
+   the firmware getting hci_disconnection_complete_event() */
+void Sim_StackConnect(uint32_t interval_us, uint8_t dle, const Sim_GattClient_t *client);
+void Sim_StackDisconnect(void);
+uint8_t Sim_StackConnected(void);
+const Sim_ConnStats_t *Sim_StackConnStats(void);
+
+/* Memory blocks over MBLOCKS_CALC() of BlueNRG_Stack_Initialization():
+   OPT_MBLOCKS of the firmware, or opt instead when set to 0 or more
+   (Sim_StackForceOptMblocks(-1) to follow the firmware). Set before the run */
+void Sim_StackForceOptMblocks(int16_t opt);
+int16_t Sim_StackOptMblocks(void);
+
+/* Value handle of the characteristic of 128-bit UUID uuid (LSB first) the
+   firmware added with aci_gatt_add_char(), 0 if none: the discovery of the
+   client */
+uint16_t Sim_StackFindChar(const uint8_t uuid[16]);
+
+/* OTA client sending size bytes of image content to base, per_event
+   packets per connection event and an ack every ack_every packets, to
+   connect with Sim_StackConnect(). Disconnects when the last packet is
+   acknowledged, stops the simulation if the service reports a flash error */
+const Sim_GattClient_t *Sim_OtaClientStart(const uint8_t *image, uint32_t size, uint32_t base,
+                                           uint8_t per_event, uint8_t ack_every);
+const Sim_OtaClientStats_t *Sim_OtaClientGetStats(void);
+
+/* Device memory: CSTACK, linked as _sstack/_estack, and the heap of
+   mallinfo() */
+extern uint32_t sim_cstack[SIM_CSTACK_SIZE / 4];
+void Sim_CStackUse(uint32_t bytes);
+void Sim_HeapSet(uint32_t arena, uint32_t used);
+
+/* Hard fault of the firmware, with the exception frame r0-r3, r12, LR, PC,
+   xPSR; HardFault_Handler() records it and resets */
+void Sim_HardFault(uint64_t at_us, const uint32_t frame[8]);
+
+/* Reason returned by SysCtrl_GetWakeupResetReason() at the next boot:
+   RESET_BLE_POR at start, RESET_SYSREQ after NVIC_SystemReset(),
+   RESET_WDG after a watchdog reset. Kept across Sim_Init(), as the reset
+   reason register is. */
+void Sim_SetResetReason(uint8_t reason);
+
+/* Start values of the SysTick count (Clock_Time()) and of the sleep timer
+   (sysT32), as after a long uptime, e.g. just before their wraparound.
+   Both count from 0 again after Sim_Init() */
+void Sim_ClockPreset(uint32_t systick_ms, uint32_t sys_t32);
+
+/* Sleep timer (sysT32) value at a simulated time */
+uint32_t Sim_SysT32At(uint64_t at_us);
+
+/* Observer of the virtual timers programmed by the firmware; NULL to
+   remove it, removed by Sim_Init() */
+void Sim_VTimerSetObserver(void (*observer)(uint8_t timerNum, int32_t msRelTimeout));
+
+/* Mock debugger on the DCC channel of libdcc */
+void Sim_DccAttach(FILE *out);
+void Sim_DccDetach(void);
+uint32_t Sim_DccBytes(void);
+
+const Sim_Stats_t *Sim_GetStats(void);
+void Sim_Report(FILE *out);
+
+/* Failed check of a simulation driver (sim_check.c): "FAIL: " and the
+   message on stderr, counted for the run. Sim_Failures() is not reset by
+   Sim_Init(): the driver exits with 1 if it is not 0 */
+void Sim_Fail(const char *format, ...) __attribute__((format(printf, 1, 2)));
+uint32_t Sim_Failures(void);
+
+#endif /* SIM_H */
@@ -0,0 +1,41 @@
+/**
+  ******************************************************************************
+  * @file    sleep.h
+  * @brief   Host stand-in for the BlueNRG-1 DK hal/inc/sleep.h.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SLEEP_H__
+#define __SLEEP_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+  SLEEPMODE_RUNNING   = 0,
+  SLEEPMODE_CPU_HALT  = 1,
+  SLEEPMODE_WAKETIMER = 2,
+  SLEEPMODE_NOTIMER   = 3,
+} SleepModes;
+
+/* Exported constants --------------------------------------------------------*/
+#define WAKEUP_IO9    0x01
+#define WAKEUP_IO10   0x02
+#define WAKEUP_IO11   0x04
+#define WAKEUP_IO12   0x08
+#define WAKEUP_IO13   0x10
+#define WAKEUP_SLEEP_TIMER1   0x20
+#define WAKEUP_SLEEP_TIMER2   0x40
+#define WAKEUP_RESET          0x80
+
+#define WAKEUP_IOx_HIGH(IO)   (IO)
+#define WAKEUP_IOx_LOW(IO)    (0)
+
+/* Exported functions ------------------------------------------------------- */
+uint8_t BlueNRG_Sleep(SleepModes sleepMode, uint8_t gpioWakeBitMask, uint8_t gpioWakeLevelMask);
+SleepModes App_SleepMode_Check(SleepModes sleepMode);
+uint16_t BlueNRG_WakeupSource(void);
+
+#endif /* __SLEEP_H__ */
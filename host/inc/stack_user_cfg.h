@@ -0,0 +1,42 @@
+/**
+  ******************************************************************************
+  * @file    stack_user_cfg.h
+  * @brief   Host stand-in for the BlueNRG-1 DK Bluetooth_LE/inc/stack_user_cfg.h:
+  *          the stack features of the BLE_STACK_CONFIGURATION chosen by the
+  *          Makefile profile, full stack by default.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _STACK_USER_CFG_H_
+#define _STACK_USER_CFG_H_
+
+/* Exported constants --------------------------------------------------------*/
+#define BLE_STACK_FULL_CONFIGURATION                (0)
+#define BLE_STACK_BASIC_CONFIGURATION               (1)
+#define BLE_STACK_SLAVE_DLE_CONFIGURATION           (2)
+
+#ifndef BLE_STACK_CONFIGURATION
+#define BLE_STACK_CONFIGURATION                     BLE_STACK_FULL_CONFIGURATION
+#endif
+
+#if (BLE_STACK_CONFIGURATION == BLE_STACK_FULL_CONFIGURATION)
+#define CONTROLLER_PRIVACY_ENABLED                  (1U)
+#define SECURE_CONNECTIONS_ENABLED                  (1U)
+#define CONTROLLER_MASTER_ENABLED                   (1U)
+#define CONTROLLER_DATA_LENGTH_EXTENSION_ENABLED    (1U)
+#elif (BLE_STACK_CONFIGURATION == BLE_STACK_BASIC_CONFIGURATION)
+#define CONTROLLER_PRIVACY_ENABLED                  (0U)
+#define SECURE_CONNECTIONS_ENABLED                  (0U)
+#define CONTROLLER_MASTER_ENABLED                   (0U)
+#define CONTROLLER_DATA_LENGTH_EXTENSION_ENABLED    (0U)
+#elif (BLE_STACK_CONFIGURATION == BLE_STACK_SLAVE_DLE_CONFIGURATION)
+#define CONTROLLER_PRIVACY_ENABLED                  (0U)
+#define SECURE_CONNECTIONS_ENABLED                  (0U)
+#define CONTROLLER_MASTER_ENABLED                   (0U)
+#define CONTROLLER_DATA_LENGTH_EXTENSION_ENABLED    (1U)
+#else
+#error "Unknown BLE_STACK_CONFIGURATION"
+#endif
+
+#endif /* _STACK_USER_CFG_H_ */
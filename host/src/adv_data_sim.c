@@ -0,0 +1,159 @@
+/**
+  ******************************************************************************
+  * @file    adv_data_sim.c
+  * @brief   Host check of the advertising payload builder (inc/adv_data.h):
+  *          each macro expansion is compared byte for byte with the payload
+  *          written by hand, the iBeacon ones with the adv_data[] and
+  *          manuf_data[] arrays of the original src/main.c.
+  *
+  *          Prints one line per payload. The run fails (exit code 1) if a
+  *          payload differs.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "adv_data.h"
+
+/* Private define ------------------------------------------------------------*/
+#define N(a)                    (sizeof(a) / sizeof((a)[0]))
+
+/* Beacon of the original src/main.c: ST company identifier, major and minor
+   0, -56 dBm at 1 m */
+#define TEST_COMPANY_ID         0x0030
+#define TEST_POWER_1M           (-56)
+#define TEST_UUID               0xE2, 0x0A, 0x39, 0xF4, 0x73, 0xF5, 0x4B, 0xC4, \
+                                0xA1, 0x2F, 0x17, 0xD1, 0xAD, 0x07, 0xA9, 0x61
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  const char *name;
+  const uint8_t *built;
+  size_t built_len;
+  const uint8_t *expected;
+  size_t expected_len;
+} Test_Payload_t;
+
+/* Private variables ---------------------------------------------------------*/
+/* manuf_data[] of the original src/main.c */
+static const uint8_t old_manuf_data[] = {
+  26, 0xFF, 0x30, 0x00, 0x02, 0x15,
+  0xE2, 0x0A, 0x39, 0xF4, 0x73, 0xF5, 0x4B, 0xC4,
+  0xA1, 0x2F, 0x17, 0xD1, 0xAD, 0x07, 0xA9, 0x61,
+  0x00, 0x00, 0x00, 0x00, 0xC8,
+};
+
+/* adv_data[] of the original src/main.c, Flags then the iBeacon data */
+static const uint8_t old_adv_data[] = {
+  0x02, 0x01, 0x06,
+  26, 0xFF, 0x30, 0x00, 0x02, 0x15,
+  0xE2, 0x0A, 0x39, 0xF4, 0x73, 0xF5, 0x4B, 0xC4,
+  0xA1, 0x2F, 0x17, 0xD1, 0xAD, 0x07, 0xA9, 0x61,
+  0x00, 0x00, 0x00, 0x00, 0xC8,
+};
+
+/* iBeacon with major, minor and power other than 0: byte order */
+static const uint8_t ibeacon_ids[] = {
+  26, 0xFF, 0x4C, 0x00, 0x02, 0x15,
+  0xE2, 0x0A, 0x39, 0xF4, 0x73, 0xF5, 0x4B, 0xC4,
+  0xA1, 0x2F, 0x17, 0xD1, 0xAD, 0x07, 0xA9, 0x61,
+  0x12, 0x34, 0xAB, 0xCD, 0xC5,
+};
+
+/* Eddystone frames, as laid out by the Eddystone specification */
+static const uint8_t eddystone_uid[] = {
+  0x02, 0x01, 0x06, 0x03, 0x03, 0xAA, 0xFE,
+  0x17, 0x16, 0xAA, 0xFE, 0x00, 0xEB,
+  0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A,
+  0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x00, 0x00,
+};
+
+static const uint8_t eddystone_url[] = {
+  0x03, 0x03, 0xAA, 0xFE,
+  0x0C, 0x16, 0xAA, 0xFE, 0x10, 0xEB, 0x03, 's', 't', '.', 'c', 'o', 'm',
+};
+
+static const uint8_t eddystone_tlm[] = {
+  0x03, 0x03, 0xAA, 0xFE,
+  0x11, 0x16, 0xAA, 0xFE, 0x20, 0x00, 0x0B, 0xB8, 0x19, 0x80,
+  0x00, 0x01, 0x02, 0x03, 0x00, 0x00, 0x04, 0xD2,
+};
+
+static const uint8_t name_power[] = {
+  0x07, 0x09, 'B', 'l', 'u', 'e', 'N', 'R', 0x02, 0x0A, 0xF8,
+};
+
+/* The same payloads from the builder */
+ADV_DATA_DEFINE(built_manuf_data,
+  ADV_IBEACON(TEST_COMPANY_ID, 0, 0, TEST_POWER_1M, TEST_UUID));
+
+ADV_DATA_DEFINE(built_adv_data,
+  ADV_FLAGS(ADV_FLAGS_GENERAL_NO_BREDR),
+  ADV_IBEACON(TEST_COMPANY_ID, 0, 0, TEST_POWER_1M, TEST_UUID));
+
+ADV_DATA_DEFINE(built_ibeacon_ids,
+  ADV_IBEACON(0x004C, 0x1234, 0xABCD, -59, TEST_UUID));
+
+ADV_DATA_DEFINE(built_eddystone_uid,
+  ADV_FLAGS(ADV_FLAGS_GENERAL_NO_BREDR),
+  ADV_EDDYSTONE_UID(-21, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A,
+                    0x11, 0x12, 0x13, 0x14, 0x15, 0x16));
+
+ADV_DATA_DEFINE(built_eddystone_url,
+  ADV_EDDYSTONE_URL(-21, ADV_URL_HTTPS, 's', 't', '.', 'c', 'o', 'm'));
+
+ADV_DATA_DEFINE(built_eddystone_tlm,
+  ADV_EDDYSTONE_TLM(3000, 0x1980, 0x00010203, 1234));
+
+ADV_DATA_DEFINE(built_name_power,
+  ADV_NAME_COMPLETE('B', 'l', 'u', 'e', 'N', 'R'),
+  ADV_TX_POWER_LEVEL(-8));
+
+#define TEST_PAYLOAD(name, built, expected) \
+  { name, built, sizeof(built), expected, sizeof(expected) }
+
+static const Test_Payload_t tests[] = {
+  TEST_PAYLOAD("manuf_data (original)", built_manuf_data, old_manuf_data),
+  TEST_PAYLOAD("adv_data (original)", built_adv_data, old_adv_data),
+  TEST_PAYLOAD("ibeacon ids", built_ibeacon_ids, ibeacon_ids),
+  TEST_PAYLOAD("eddystone uid", built_eddystone_uid, eddystone_uid),
+  TEST_PAYLOAD("eddystone url", built_eddystone_url, eddystone_url),
+  TEST_PAYLOAD("eddystone tlm", built_eddystone_tlm, eddystone_tlm),
+  TEST_PAYLOAD("name and tx power", built_name_power, name_power),
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+int main(void)
+{
+  const Test_Payload_t *t;
+  uint32_t failures = 0;
+  size_t i, j;
+
+  for (i = 0; i < N(tests); i++) {
+    t = &tests[i];
+    if (t->built_len == t->expected_len && memcmp(t->built, t->expected, t->built_len) == 0) {
+      printf("%-24s %2u bytes ok\n", t->name, (unsigned)t->built_len);
+      continue;
+    }
+
+    failures++;
+    printf("%-24s %2u bytes, expected %u: FAIL\n", t->name, (unsigned)t->built_len,
+           (unsigned)t->expected_len);
+    for (j = 0; j < t->built_len || j < t->expected_len; j++) {
+      if (j < t->built_len && j < t->expected_len && t->built[j] == t->expected[j])
+        continue;
+      fprintf(stderr, "FAIL: %s byte %u: ", t->name, (unsigned)j);
+      if (j < t->built_len)
+        fprintf(stderr, "%02X", t->built[j]);
+      else
+        fprintf(stderr, "--");
+      if (j < t->expected_len)
+        fprintf(stderr, ", expected %02X\n", t->expected[j]);
+      else
+        fprintf(stderr, ", expected --\n");
+    }
+  }
+  return failures != 0;
+}
@@ -0,0 +1,216 @@
+/**
+  ******************************************************************************
+  * @file    adv_live_sim.c
+  * @brief   Host check of the live advertising fields of src/adv_live.c:
+  *          telemetry update patterns against an iBeacon and an
+  *          Eddystone-TLM frame rotating in 1 s slots, with the stack stub
+  *          counting the commands.
+  *
+  *          For each pattern, prints the setter calls, those that changed a
+  *          value, the hci_le_set_advertising_data() calls of a rebuild and
+  *          send on every update against the calls made by adv_live.c, and
+  *          the wakeups. The run fails (exit code 1) if a coalescing window
+  *          makes more than one stack call, if unchanged values cost any
+  *          call, or if the payload on air at the end is not the latest one.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "ble_const.h"
+#include "sleep.h"
+#include "scheduler.h"
+#include "adv_data.h"
+#include "adv_rotate.h"
+#include "adv_live.h"
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  const char *name;
+  uint16_t period_ms;       /* Between two updates */
+  uint8_t  fields;          /* Fields set per update, see Live_Update() */
+  uint8_t  constant;        /* Same values every time */
+} Live_Pattern_t;
+
+/* Private define ------------------------------------------------------------*/
+#define RUN_MS              10000
+#define UPDATES_END_MS      9000     /* Quiet tail: the last window closes */
+#define WINDOW_MS           100      /* Advertising interval */
+#define SLOT_MS             1000
+
+/* Live_Pattern_t.fields */
+#define F_IBEACON           0x01     /* Major, minor, measured power */
+#define F_TLM               0x02     /* Battery, temperature */
+#define F_COUNTER           0x04     /* TLM uptime */
+
+#define N(a)                (uint8_t)(sizeof(a) / sizeof((a)[0]))
+
+/* Private variables ---------------------------------------------------------*/
+static const Live_Pattern_t patterns[] = {
+  { "iBeacon ids every 20 ms",       20, F_IBEACON, 0 },
+  { "TLM sensors every 50 ms",       50, F_TLM, 0 },
+  { "all fields every 10 ms",        10, F_IBEACON | F_TLM | F_COUNTER, 0 },
+  { "uptime every 1 s",            1000, F_COUNTER, 0 },
+  { "unchanged sensors every 10 ms", 10, F_TLM, 1 },
+};
+
+/* Contents at the start of each pattern */
+ADV_DATA_DEFINE(ibeacon_init,
+  ADV_FLAGS(ADV_FLAGS_GENERAL_NO_BREDR),
+  ADV_IBEACON(0x0030, 0, 0, -56, 0xE2, 0x0A, 0x39, 0xF4, 0x73, 0xF5, 0x4B, 0xC4,
+              0xA1, 0x2F, 0x17, 0xD1, 0xAD, 0x07, 0xA9, 0x61));
+
+ADV_DATA_DEFINE(tlm_init,
+  ADV_FLAGS(ADV_FLAGS_GENERAL_NO_BREDR),
+  ADV_EDDYSTONE_TLM(3000, 0x1400, 0, 0));
+
+static uint8_t ibeacon_frame[sizeof(ibeacon_init)];
+static uint8_t tlm_frame[sizeof(tlm_init)];
+
+static const Adv_Frame_t frames[] = {
+  ADV_FRAME(ibeacon_frame, 1),
+  ADV_FRAME(tlm_frame, 1),
+};
+
+static const Adv_Rotation_t rotation = { frames, N(frames), SLOT_MS };
+
+/* Only checked for presence by the stack stub */
+static uint32_t stack_ram[64];
+static const Live_Pattern_t *pattern;
+static uint32_t update_count;
+static uint32_t changes;         /* Setter calls that changed a value */
+static uint32_t naive_calls;     /* Updates that changed a value: one rebuild and send each */
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Count a setter call as a change if it was not rejected as equal.
+  */
+#define LIVE_SET(call)                                             \
+  do {                                                             \
+    uint32_t unchanged = Adv_LiveGetStats()->unchanged;            \
+    call;                                                          \
+    changes += (Adv_LiveGetStats()->unchanged == unchanged);       \
+  } while (0)
+
+/**
+  * @brief  Telemetry timer job of the pattern.
+  */
+static void Live_Update(void)
+{
+  /* Constant: the initial contents */
+  uint32_t v = pattern->constant ? 0 : ++update_count;
+  uint32_t before = changes;
+
+  if (Sched_Now() >= UPDATES_END_MS)
+    return;
+
+  if (pattern->fields & F_IBEACON) {
+    LIVE_SET(Adv_LiveSetMajor((uint16_t)v));
+    LIVE_SET(Adv_LiveSetMinor((uint16_t)(v >> 1)));
+    LIVE_SET(Adv_LiveSetTxPower((int8_t)(-56 - (int8_t)(v & 3))));
+  }
+  if (pattern->fields & F_TLM) {
+    LIVE_SET(Adv_LiveSetBattery((uint16_t)(3000 - (v & 7))));
+    LIVE_SET(Adv_LiveSetTemperature((int16_t)(0x1400 + (v & 0xFF))));
+  }
+  if (pattern->fields & F_COUNTER)
+    LIVE_SET(Adv_LiveSetUptime(Sched_Now() / 100));
+  naive_calls += (changes != before);
+}
+
+static void Live_Loop(void)
+{
+  BlueNRG_Stack_Initialization_t params = {0};
+
+  params.bleStartRamAddress = (uint8_t *)stack_ram;
+  params.total_buffer_size = sizeof(stack_ram);
+  params.numOfLinks = 1;
+
+  Clock_Init();
+  Sched_Init();
+  BlueNRG_Stack_Initialization(&params);
+  aci_gap_set_discoverable(ADV_NONCONN_IND, 160, 160, PUBLIC_ADDR, NO_WHITE_LIST_USE,
+                           0, NULL, 0, NULL, 0, 0);
+  Adv_RotateStart(&rotation);
+
+  Adv_LiveInit(WINDOW_MS);
+  Adv_LiveBind(ADV_LIVE_MAJOR, ibeacon_frame, ADV_FLAGS_LEN + ADV_IBEACON_MAJOR_OFS);
+  Adv_LiveBind(ADV_LIVE_MINOR, ibeacon_frame, ADV_FLAGS_LEN + ADV_IBEACON_MINOR_OFS);
+  Adv_LiveBind(ADV_LIVE_TX_POWER, ibeacon_frame, ADV_FLAGS_LEN + ADV_IBEACON_POWER_OFS);
+  Adv_LiveBind(ADV_LIVE_BATTERY, tlm_frame, ADV_FLAGS_LEN + ADV_TLM_VBATT_OFS);
+  Adv_LiveBind(ADV_LIVE_TEMPERATURE, tlm_frame, ADV_FLAGS_LEN + ADV_TLM_TEMP_OFS);
+  Adv_LiveBind(ADV_LIVE_UPTIME, tlm_frame, ADV_FLAGS_LEN + ADV_TLM_SEC_COUNT_OFS);
+
+  Sched_TimerStart(Live_Update, pattern->period_ms, pattern->period_ms);
+  while (1) {
+    Sim_Consume(SIM_COST_LOOP_US);
+    Sched_RunOnce();
+  }
+}
+
+SleepModes App_SleepMode_Check(SleepModes sleepMode)
+{
+  if (Sched_EventsPending())
+    return SLEEPMODE_RUNNING;
+
+  return sleepMode;
+}
+
+/**
+  * @brief  Run one pattern and print its line of the report.
+  * @retval 1 if a check failed
+  */
+static uint8_t Live_Run(const Live_Pattern_t *p)
+{
+  const Adv_Live_Stats_t *live;
+  const Adv_Rotate_Stats_t *rot;
+  const uint8_t *on_air;
+  uint8_t len, current, fail;
+
+  Sim_Init();
+  memcpy(ibeacon_frame, ibeacon_init, sizeof(ibeacon_frame));
+  memcpy(tlm_frame, tlm_init, sizeof(tlm_frame));
+  pattern = p;
+  update_count = 0;
+  changes = 0;
+  naive_calls = 0;
+  Sim_Run(Live_Loop, (uint64_t)RUN_MS * 1000);
+
+  live = Adv_LiveGetStats();
+  rot = Adv_RotateGetStats();
+  on_air = Sim_StackAdvData(&len);
+  current = Adv_RotateCurrent();
+
+  /* One call per window at most; none without a change; latest contents on air */
+  fail = live->sent > live->flushes || rot->refreshes != live->sent ||
+         (p->constant && live->flushes != 0) || rot->errors != 0 ||
+         current >= N(frames) || len != frames[current].len ||
+         memcmp(on_air, frames[current].data, len) != 0;
+
+  printf("%-30s %7u %7u %7u %7u %7u %8u %8.1f  %s\n", p->name, (unsigned)live->writes,
+         (unsigned)changes, (unsigned)naive_calls, (unsigned)live->flushes,
+         (unsigned)live->sent, (unsigned)live->deferred,
+         (double)Sim_GetStats()->wakeups * 1000.0 / RUN_MS, fail ? "FAIL" : "ok");
+  return fail;
+}
+
+int main(void)
+{
+  uint8_t i, fail = 0;
+
+  printf("coalescing window %u ms, 2 frames in %u ms slots, %u s per pattern\n\n",
+         WINDOW_MS, SLOT_MS, RUN_MS / 1000);
+  printf("%-30s %7s %7s %7s %7s %7s %8s %8s\n", "pattern", "setters", "changes",
+         "naive", "windows", "sent", "deferred", "wakeup/s");
+  for (i = 0; i < N(patterns); i++)
+    fail |= Live_Run(&patterns[i]);
+
+  printf("\nnaive: one hci_le_set_advertising_data() per update that changed a value\n"
+         "sent: the calls made by adv_live.c, deferred: changes off air, sent by their slot\n");
+  return fail;
+}
@@ -0,0 +1,221 @@
+/**
+  ******************************************************************************
+  * @file    adv_sim.c
+  * @brief   Host run of the beacon firmware (src/main.c, as in beacon_sim)
+  *          checking the advertising frame rotation of adv_rotate.c.
+  *
+  *          The stack stub reports the payload of each advertising event;
+  *          the frame kind is decoded from the payload bytes, so the check
+  *          covers what is really on air. Prints each frame change of the
+  *          first rotations, the advertising events per frame and the stack
+  *          calls per rotation. The run fails (exit code 1) if the frame
+  *          sequence is not the expected one, if a rotation makes more
+  *          hci_le_set_advertising_data() calls than frame changes (the
+  *          live field refreshes of adv_live.c apart), or if any other
+  *          stack command is issued by the rotation.
+  *
+  *          Usage: adv_sim [seconds]
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "BlueNRG1_conf.h"
+#include "adv_data.h"
+#include "adv_rotate.h"
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum {
+  FRAME_IBEACON,
+  FRAME_UID,
+  FRAME_URL,
+  FRAME_TLM,
+  FRAME_CUSTOM,
+  FRAME_UNKNOWN,
+  FRAME_COUNT
+} Frame_Kind;
+
+/* Private define ------------------------------------------------------------*/
+/* Rotation of main.c, weights 3, 1, 1, 1, 1 over 7 slots:
+   iBeacon UID URL iBeacon TLM custom iBeacon. The last slot and the first
+   of the next rotation carry the same frame, so a rotation makes 6 frame
+   changes, one hci_le_set_advertising_data() call each */
+#define EXPECTED_SLOTS              7
+#define EXPECTED_UPDATES            6
+
+/* Frame changes printed */
+#define PRINT_CHANGES               (2 * EXPECTED_SLOTS)
+
+/* Private variables ---------------------------------------------------------*/
+static const char *const frame_names[FRAME_COUNT] = {
+  "iBeacon", "Eddystone-UID", "Eddystone-URL", "Eddystone-TLM", "custom", "unknown"
+};
+
+/* Frames on air, one entry per change, repeated each rotation */
+static const Frame_Kind expected_seq[EXPECTED_UPDATES] = {
+  FRAME_IBEACON, FRAME_UID, FRAME_URL, FRAME_IBEACON, FRAME_TLM, FRAME_CUSTOM
+};
+
+static uint32_t frame_events[FRAME_COUNT];
+static Frame_Kind on_air = FRAME_COUNT;
+static uint32_t changes;
+static uint32_t seq_errors;
+
+/* Next expected change, index in expected_seq */
+static uint8_t seq_pos;
+
+/* Stack calls at the start of the current rotation, the stack ticks and
+   radio interrupts apart */
+static uint32_t last_rotation;
+static uint32_t rot_adv_data_calls;
+static uint32_t rot_refreshes;
+static uint32_t rot_total_calls;
+static uint32_t rot_ticks;
+static uint32_t rot_count;
+static uint32_t rot_bad;
+static uint32_t rot_max_updates;
+
+/* main() of src/main.c */
+int Beacon_Main(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Adv_Entry(void)
+{
+  Beacon_Main();
+}
+
+/**
+  * @brief  Frame kind of a payload: Flags, then one frame.
+  */
+static Frame_Kind Adv_Classify(const uint8_t *data, uint8_t len)
+{
+  uint8_t i = 0;
+
+  while (i + 1 < len && data[i] != 0 && i + data[i] < len) {
+    if (data[i + 1] == ADV_TYPE_MANUFACTURER && data[i] >= 5)
+      return (data[i + 4] == ADV_IBEACON_TYPE && data[i + 5] == ADV_IBEACON_LEN) ?
+             FRAME_IBEACON : FRAME_CUSTOM;
+    if (data[i + 1] == ADV_TYPE_SERVICE_DATA16 && data[i] >= 4 &&
+        data[i + 2] == (ADV_EDDYSTONE_UUID & 0xFF) && data[i + 3] == (ADV_EDDYSTONE_UUID >> 8)) {
+      switch (data[i + 4]) {
+      case ADV_EDDYSTONE_FRAME_UID:
+        return FRAME_UID;
+      case ADV_EDDYSTONE_FRAME_URL:
+        return FRAME_URL;
+      case ADV_EDDYSTONE_FRAME_TLM:
+        return FRAME_TLM;
+      default:
+        return FRAME_UNKNOWN;
+      }
+    }
+    i += data[i] + 1;
+  }
+  return FRAME_UNKNOWN;
+}
+
+/**
+  * @brief  Rotation boundary: stack calls made during the rotation that ended.
+  */
+static void Adv_RotationEnd(void)
+{
+  uint32_t adv_data_calls = Sim_StackCalls(SIM_API_HCI_ADV_DATA);
+  uint32_t total = Sim_StackCallsTotal();
+  uint32_t ticks = Sim_StackCalls(SIM_API_STACK_TICK) + Sim_StackCalls(SIM_API_RAL_ISR);
+  uint32_t refreshes = Adv_RotateGetStats()->refreshes;
+  uint32_t sends = adv_data_calls - rot_adv_data_calls;
+  uint32_t updates = sends - (refreshes - rot_refreshes);
+  uint32_t others = (total - rot_total_calls) - (ticks - rot_ticks) - sends;
+
+  /* The first boundary only takes the reference */
+  if (last_rotation != 0) {
+    rot_count++;
+    if (updates > rot_max_updates)
+      rot_max_updates = updates;
+    if (updates != EXPECTED_UPDATES || others != 0)
+      rot_bad++;
+  }
+  rot_adv_data_calls = adv_data_calls;
+  rot_refreshes = refreshes;
+  rot_total_calls = total;
+  rot_ticks = ticks;
+}
+
+/**
+  * @brief  Stack stub observer: one call per advertising event.
+  */
+static void Adv_Observer(const uint8_t *data, uint8_t len)
+{
+  Frame_Kind kind = Adv_Classify(data, len);
+  uint32_t rotations = Adv_RotateGetStats()->rotations;
+
+  frame_events[kind]++;
+  if (rotations != last_rotation) {
+    Adv_RotationEnd();
+    last_rotation = rotations;
+  }
+  if (kind == on_air)
+    return;
+
+  if (changes++ < PRINT_CHANGES) {
+    printf("%10.3f %6u  %s", (double)Sim_NowUs() / 1e6,
+           (unsigned)Adv_RotateGetStats()->slots, frame_names[kind]);
+    if (kind != expected_seq[seq_pos])
+      printf("  (expected %s)", frame_names[expected_seq[seq_pos]]);
+    printf("\n");
+  }
+  if (kind != expected_seq[seq_pos])
+    seq_errors++;
+  seq_pos = (seq_pos + 1) % EXPECTED_UPDATES;
+  on_air = kind;
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t seconds = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 30;
+  const Adv_Rotate_Stats_t *stats;
+  uint32_t events = 0;
+  uint8_t i, fail = 0;
+
+  if (seconds < 3 * EXPECTED_SLOTS)
+    seconds = 3 * EXPECTED_SLOTS;
+
+  Sim_Init();
+  Sim_StackSetAdvObserver(Adv_Observer);
+  printf("%10s %6s  %s\n", "time (s)", "slot", "frame on air");
+  Sim_Run(Adv_Entry, (uint64_t)seconds * 1000000);
+
+  if (Sim_NowUs() < (uint64_t)seconds * 1000000) {
+    printf("run ended at %.3f s\n", (double)Sim_NowUs() / 1e6);
+    return 1;
+  }
+
+  stats = Adv_RotateGetStats();
+  for (i = 0; i < FRAME_COUNT; i++)
+    events += frame_events[i];
+
+  printf("\n%-14s %10s %8s\n", "frame", "adv events", "share");
+  for (i = 0; i < FRAME_COUNT; i++) {
+    if (frame_events[i] != 0)
+      printf("%-14s %10u %7.1f%%\n", frame_names[i], (unsigned)frame_events[i],
+             100.0 * frame_events[i] / (events ? events : 1));
+  }
+
+  printf("\nslots                : %u\n", (unsigned)stats->slots);
+  printf("rotations            : %u (%u slots each)\n", (unsigned)stats->rotations,
+         (unsigned)EXPECTED_SLOTS);
+  printf("frame changes        : %u (%u out of sequence)\n", (unsigned)changes,
+         (unsigned)seq_errors);
+  printf("adv data updates     : %u (%u refused), %u live field refreshes\n",
+         (unsigned)stats->updates, (unsigned)stats->errors, (unsigned)stats->refreshes);
+  printf("updates per rotation : %u max, expected %u, no other command (%u of %u rotations off)\n",
+         (unsigned)rot_max_updates, (unsigned)EXPECTED_UPDATES, (unsigned)rot_bad,
+         (unsigned)rot_count);
+
+  fail = seq_errors != 0 || rot_bad != 0 || rot_count == 0 || stats->errors != 0 ||
+         frame_events[FRAME_UNKNOWN] != 0;
+  printf("%s\n", fail ? "FAIL" : "ok");
+  return fail;
+}
@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * @file    beacon_sim.c
+  * @brief   Host run of the beacon firmware itself: src/main.c (built with
+  *          main renamed Beacon_Main), src/BlueNRG1_it.c and Beacon_config.h
+  *          against the recording stub of the BLE stack (sim_stack.c) and the
+  *          GPIO, clock and sleep stand-ins.
+  *
+  *          Prints, for each simulated second, the main loop passes, the
+  *          wakeups and the stack calls, then the totals. The run fails
+  *          (exit code 1) if a per second average after the boot second is
+  *          over its budget, so it can gate a CI job as a performance
+  *          regression test.
+  *
+  *          Usage: beacon_sim [seconds [UART output file]]
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "BlueNRG1_conf.h"
+#include "scheduler.h"
+#include "log.h"
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  uint32_t loops;
+  uint32_t wakeups;
+  uint32_t stack_calls;
+  uint32_t stack_ticks;
+  uint32_t adv_events;
+  uint32_t irqs;
+  uint64_t active_us;
+} Beacon_Sample_t;
+
+/* Private define ------------------------------------------------------------*/
+#define SAMPLE_PERIOD_US        1000000
+
+/* Steady state budgets, per simulated second: 10 advertising events and
+   2 LED edges */
+#define BUDGET_LOOPS_PER_S          30
+#define BUDGET_WAKEUPS_PER_S        30
+#define BUDGET_STACK_CALLS_PER_S    40
+
+/* Private variables ---------------------------------------------------------*/
+static Beacon_Sample_t last;
+static Beacon_Sample_t boot;      /* End of the first second */
+static uint32_t second;
+
+/* main() of src/main.c */
+int Beacon_Main(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Beacon_Entry(void)
+{
+  Beacon_Main();
+}
+
+static void Beacon_Snapshot(Beacon_Sample_t *s)
+{
+  const Sim_Stats_t *sim = Sim_GetStats();
+
+  s->loops = Sched_GetStats()->loops;
+  s->wakeups = sim->wakeups;
+  s->stack_calls = Sim_StackCallsTotal();
+  s->stack_ticks = Sim_StackCalls(SIM_API_STACK_TICK);
+  s->adv_events = Sim_StackAdvEvents();
+  s->irqs = sim->irqs;
+  s->active_us = sim->active_us;
+}
+
+/**
+  * @brief  Simulation probe: one line per simulated second.
+  */
+static void Beacon_Probe(uint64_t now_us)
+{
+  Beacon_Sample_t s;
+
+  (void)now_us;
+  Beacon_Snapshot(&s);
+  printf("%6u %7u %8u %11u %11u %10u %7u %9.4f\n", (unsigned)++second,
+         (unsigned)(s.loops - last.loops), (unsigned)(s.wakeups - last.wakeups),
+         (unsigned)(s.stack_calls - last.stack_calls),
+         (unsigned)(s.stack_ticks - last.stack_ticks),
+         (unsigned)(s.adv_events - last.adv_events), (unsigned)(s.irqs - last.irqs),
+         100.0 * (double)(s.active_us - last.active_us) / SAMPLE_PERIOD_US);
+  if (second == 1)
+    boot = s;
+  last = s;
+}
+
+/**
+  * @brief  Compare a per second average with its budget.
+  * @retval 1 if over budget
+  */
+static uint8_t Beacon_Check(const char *name, uint32_t total, uint32_t seconds, uint32_t budget)
+{
+  double rate = (double)total / seconds;
+
+  printf("%-20s : %8.2f /s (budget %u) %s\n", name, rate, (unsigned)budget,
+         rate > budget ? "OVER" : "ok");
+  return rate > budget;
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t seconds = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 10;
+  FILE *out = NULL;
+  uint8_t over = 0;
+
+  if (seconds < 2)
+    seconds = 2;
+  if (argc > 2 && (out = fopen(argv[2], "wb")) == NULL) {
+    perror(argv[2]);
+    return 1;
+  }
+
+  Sim_Init();
+  Sim_UartCapture(out);
+  last = (Beacon_Sample_t){0};
+  boot = last;
+  second = 0;
+  Sim_SetProbe(SAMPLE_PERIOD_US, Beacon_Probe);
+
+  printf("%6s %7s %8s %11s %11s %10s %7s %9s\n", "second", "loops", "wakeups",
+         "stack calls", "stack ticks", "adv events", "irqs", "active %");
+  Sim_Run(Beacon_Entry, (uint64_t)seconds * SAMPLE_PERIOD_US);
+  if (out != NULL)
+    fclose(out);
+
+  printf("\n");
+  Sim_Report(stdout);
+  printf("stack calls          : %u\n", (unsigned)Sim_StackCallsTotal());
+  Sim_StackReport(stdout);
+  printf("log messages         : %u (%u dropped)\n\n", (unsigned)Log_GetStats()->messages,
+         (unsigned)Log_GetStats()->dropped);
+
+  /* A reset or a jump to the OTA manager ends the run early */
+  if (Sim_NowUs() < (uint64_t)seconds * SAMPLE_PERIOD_US) {
+    printf("run ended at %.3f s\n", (double)Sim_NowUs() / 1e6);
+    return 1;
+  }
+
+  printf("after boot (%u s):\n", (unsigned)(seconds - 1));
+  over |= Beacon_Check("loop passes", last.loops - boot.loops, seconds - 1, BUDGET_LOOPS_PER_S);
+  over |= Beacon_Check("wakeups", last.wakeups - boot.wakeups, seconds - 1, BUDGET_WAKEUPS_PER_S);
+  over |= Beacon_Check("stack calls", last.stack_calls - boot.stack_calls, seconds - 1,
+                       BUDGET_STACK_CALLS_PER_S);
+
+  return over;
+}
@@ -0,0 +1,342 @@
+/**
+  ******************************************************************************
+  * @file    boot_bench.c
+  * @brief   Time to first advertisement of the beacon firmware (src/main.c,
+  *          as in beacon_sim) after a power on (full boot) and after warm
+  *          resets (fast boot path of boot.c), one CSV line per boot on
+  *          stdout, with the boot stages the firmware measured itself.
+  *
+  *          The run fails (exit code 1) if:
+  *          - a warm boot is not faster to advertise than the cold one, or
+  *            over BUDGET_WARM_TTFA_US;
+  *          - its first advertisement differs from the cold one;
+  *          - its deferred init is not done or its boot report is missing;
+  *          - the breakdown of the firmware disagrees with the simulated
+  *            time of the first advertising event.
+  *
+  *          Then the same firmware boots from an OTA bank holding a real
+  *          image (bin/blink.bin by default) through the life of the image
+  *          check of image_verify.c: loaded by the debugger, booted again,
+  *          updated over the air, programmed wrong with the image it
+  *          replaced to fall back to, then without. The run also fails if:
+  *          - a boot gets another check result than expected;
+  *          - a wrong image does not reset into the image it replaced, that
+  *            image tagged valid again and itself invalid, when there is one;
+  *          - the CRC32 runs on a boot with the check cached, or a full
+  *            check takes longer than its CRC32 and record write;
+  *          - a warm boot with the check cached is over BUDGET_WARM_TTFA_US;
+  *          - a wrong image is not reported.
+  *
+  *          Usage: boot_bench [image [header]], header 0 to omit the CSV
+  *          header line
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 200809L   /* open_memstream() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "ble_const.h"
+#include "boot.h"
+#include "crc32.h"
+#include "image_verify.h"
+#include "OTA_btl.h"
+#include "ota_delta.h"
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum {
+  BENCH_FLASH_KEEP = 0,         /* Flash as the boot before left it */
+  BENCH_FLASH_LOAD,             /* Image loaded by the debugger */
+  BENCH_FLASH_UPDATE,           /* New image written by the OTA service */
+  BENCH_FLASH_WRONG,            /* Same, one byte programmed wrong, the tag of the other
+                                   image invalidated by the update */
+  BENCH_FLASH_WRONG_ALONE,      /* Same, the other image erased */
+} Bench_Flash_t;
+
+typedef struct {
+  const char *name;
+  uint8_t  reset_reason;
+  uint32_t bank;                /* Image the firmware runs from, 0 for none */
+  uint8_t  flash;               /* Bench_Flash_t, before the boot */
+  uint8_t  expect;              /* ImageVerify_Result_t */
+  uint8_t  fallback;            /* Resets into the other bank before advertising */
+  uint64_t ttfa_us;             /* Simulated time of the first advertising event */
+  uint64_t cpu_us;              /* CPU active until then */
+  uint32_t stack_calls;         /* Stack API calls until then */
+  uint32_t log_bytes;           /* UART bytes sent until then */
+  uint8_t  adv[ADV_DATA_MAX_LEN];
+  uint8_t  adv_len;
+  uint32_t verify_us;           /* Boot check stage of the firmware */
+} Bench_Boot_t;
+
+/* Private define ------------------------------------------------------------*/
+#define BOOT_RUN_US             2000000
+
+#define BENCH_IMAGE_PATH        "bin/blink.bin"
+
+/* Byte changed by an update, byte programmed wrong */
+#define BENCH_UPDATE_OFFSET     0x100
+#define BENCH_WRONG_OFFSET      0x4000
+
+/* Time to first advertisement of a warm boot: stack init, a few commands
+   and the advDelay of the first event (up to 10 ms) */
+#define BUDGET_WARM_TTFA_US     14000
+
+/* The firmware timestamps the first event after RAL_Isr(), on the sleep
+   timer: sysT32 rounding */
+#define TTFA_TOLERANCE_US       10
+
+/* Boot check stage with the check cached: a scan of the record log */
+#define VERIFY_CACHED_US        10
+
+/* Private variables ---------------------------------------------------------*/
+static Bench_Boot_t *bench_current;
+static FILE *bench_uart;
+
+static uint8_t bench_image[OTA_DELTA_BANK_SIZE];
+static uint32_t bench_image_size;
+
+static Bench_Boot_t bench_boots[] = {
+  { "cold", RESET_BLE_POR },
+  { "warm", RESET_SYSREQ },
+  { "watchdog", RESET_WDG },
+};
+
+/* In sequence: each boot finds the flash as the one before left it */
+static Bench_Boot_t bench_image_boots[] = {
+  { "image_loaded", RESET_BLE_POR, OTA_DELTA_BANK_LOWER, BENCH_FLASH_LOAD, IMAGE_VERIFY_FIRST },
+  { "image_cold", RESET_BLE_POR, OTA_DELTA_BANK_LOWER, BENCH_FLASH_KEEP, IMAGE_VERIFY_CACHED },
+  { "image_warm", RESET_SYSREQ, OTA_DELTA_BANK_LOWER, BENCH_FLASH_KEEP, IMAGE_VERIFY_CACHED },
+  { "image_updated", RESET_SYSREQ, OTA_DELTA_BANK_HIGHER, BENCH_FLASH_UPDATE, IMAGE_VERIFY_UPDATED },
+  { "image_updated_warm", RESET_SYSREQ, OTA_DELTA_BANK_HIGHER, BENCH_FLASH_KEEP, IMAGE_VERIFY_CACHED },
+  { "image_wrong", RESET_SYSREQ, OTA_DELTA_BANK_LOWER, BENCH_FLASH_WRONG, IMAGE_VERIFY_FAILED, 1 },
+  { "image_fallback", RESET_SYSREQ, OTA_DELTA_BANK_HIGHER, BENCH_FLASH_KEEP, IMAGE_VERIFY_CACHED },
+  { "image_wrong_alone", RESET_SYSREQ, OTA_DELTA_BANK_LOWER, BENCH_FLASH_WRONG_ALONE, IMAGE_VERIFY_FAILED },
+  { "image_wrong_cold", RESET_BLE_POR, OTA_DELTA_BANK_LOWER, BENCH_FLASH_KEEP, IMAGE_VERIFY_FAILED },
+};
+
+/* main() of src/main.c */
+int Beacon_Main(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t Bench_Other(uint32_t bank)
+{
+  return (bank == OTA_DELTA_BANK_LOWER) ? OTA_DELTA_BANK_HIGHER : OTA_DELTA_BANK_LOWER;
+}
+
+static uint32_t Bench_Tag(uint32_t bank)
+{
+  uint32_t tag;
+
+  memcpy(&tag, Sim_FlashData(bank + OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET), sizeof(tag));
+  return tag;
+}
+
+static void Bench_Entry(void)
+{
+  Beacon_Main();
+}
+
+/**
+  * @brief  Advertising observer: snapshot of the CPU, stack and log figures
+  *         at the first event.
+  */
+static void Bench_AdvObserver(const uint8_t *data, uint8_t len)
+{
+  Bench_Boot_t *b = bench_current;
+
+  if (b == NULL || b->ttfa_us != 0)
+    return;
+  b->ttfa_us = Sim_NowUs();
+  b->cpu_us = Sim_GetStats()->active_us;
+  b->stack_calls = Sim_StackCallsTotal();
+  fflush(bench_uart);
+  b->log_bytes = (uint32_t)ftell(bench_uart);
+  memcpy(b->adv, data, len);
+  b->adv_len = len;
+}
+
+/**
+  * @brief  Flash before the boot: image loaded in the bank, or written by
+  *         the OTA service with its record (ImageVerify_Updated()) and the
+  *         tag of the image it replaces invalidated, then the bank the
+  *         firmware runs from. Flash operations cost simulated
+  *         time: on a simulation of their own, before the one of the boot.
+  */
+static void Bench_Flash(const Bench_Boot_t *b)
+{
+  static uint8_t image[OTA_DELTA_BANK_SIZE];
+  uint32_t size = bench_image_size;
+
+  Sim_Init();
+  memcpy(image, bench_image, size);
+  switch (b->flash) {
+  case BENCH_FLASH_LOAD:
+    Sim_FlashLoad(b->bank, image, size);
+    break;
+  case BENCH_FLASH_UPDATE:
+    image[BENCH_UPDATE_OFFSET] ^= 0x01;
+    Sim_FlashLoad(b->bank, image, size);
+    ImageVerify_Updated(b->bank, size, Crc32_Update(0, image, size));
+    break;
+  case BENCH_FLASH_WRONG:
+  case BENCH_FLASH_WRONG_ALONE:
+    ImageVerify_Updated(b->bank, size, Crc32_Update(0, image, size));
+    image[BENCH_WRONG_OFFSET] ^= 0x10;
+    Sim_FlashLoad(b->bank, image, size);
+    if (b->flash == BENCH_FLASH_WRONG)
+      FLASH_ProgramWord(Bench_Other(b->bank) + OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET, OTA_INVALID_OLD_TAG);
+    else
+      FLASH_ErasePage((uint16_t)((Bench_Other(b->bank) - _MEMORY_FLASH_BEGIN_) / N_BYTES_PAGE));
+    break;
+  default:
+    break;
+  }
+  Sim_FlashSetImage(b->bank, b->bank != 0 ? size : 0);
+}
+
+/**
+  * @brief  Result of the boot check, and the time its stage took: a scan of
+  *         the record log, or the CRC32 of the image and a record word.
+  */
+static void Bench_CheckVerify(const Bench_Boot_t *b, const char *uart)
+{
+  const ImageVerify_Stats_t *verify = ImageVerify_GetStats();
+  uint32_t crc_us = (uint32_t)((uint64_t)bench_image_size * SIM_COST_CRC_BYTE_CYCLES / SIM_CPU_MHZ);
+  uint32_t full = (b->expect == IMAGE_VERIFY_FIRST || b->expect == IMAGE_VERIFY_UPDATED ||
+                   b->flash == BENCH_FLASH_WRONG || b->flash == BENCH_FLASH_WRONG_ALONE);
+  uint32_t verify_us = b->verify_us;
+
+  SIM_CHECK(verify->result == b->expect, "%s: check %s, expected %s", b->name,
+            ImageVerify_ResultName((ImageVerify_Result_t)verify->result),
+            ImageVerify_ResultName((ImageVerify_Result_t)b->expect));
+  if (b->bank == 0)
+    return;
+  SIM_CHECK(verify->crc_bytes == (full ? bench_image_size : 0), "%s: %u bytes of CRC32", b->name,
+            (unsigned)verify->crc_bytes);
+  if (b->fallback)
+    return;
+  if (full)
+    SIM_CHECK(verify_us + TTFA_TOLERANCE_US >= crc_us &&
+              verify_us <= crc_us + 4 * SIM_COST_FLASH_WORD_US + TTFA_TOLERANCE_US,
+              "%s: check %u us, CRC32 %u us", b->name, (unsigned)verify_us, (unsigned)crc_us);
+  else
+    SIM_CHECK(verify_us <= VERIFY_CACHED_US, "%s: cached check %u us", b->name, (unsigned)verify_us);
+  if (b->expect == IMAGE_VERIFY_FAILED)
+    SIM_CHECK(uart != NULL && strstr(uart, "check failed") != NULL, "%s: wrong image not reported", b->name);
+}
+
+static void Bench_Run(Bench_Boot_t *b, uint8_t header)
+{
+  const Boot_Stats_t *stats = Boot_GetStats();
+  const ImageVerify_Stats_t *verify = ImageVerify_GetStats();
+  char *uart = NULL;
+  size_t uart_len = 0;
+  uint8_t s;
+
+  Bench_Flash(b);
+  bench_uart = open_memstream(&uart, &uart_len);
+  bench_current = b;
+  Sim_SetResetReason(b->reset_reason);
+  Sim_Init();
+  Sim_UartCapture(bench_uart);
+  Sim_StackSetAdvObserver(Bench_AdvObserver);
+  Sim_Run(Bench_Entry, BOOT_RUN_US);
+  Sim_UartCapture(NULL);
+  fclose(bench_uart);
+  bench_current = NULL;
+
+  if (header) {
+    printf("boot,reset_reason,fast,image_check,crc_bytes,ttfa_us,cpu_us,stack_calls,log_bytes");
+    for (s = 0; s < BOOT_STAGE_COUNT; s++)
+      printf(",%s_us", Boot_StageName(s));
+    printf("\n");
+  }
+  printf("%s,0x%02x,%u,%s,%u,%llu,%llu,%u,%u", b->name, (unsigned)b->reset_reason,
+         (unsigned)stats->fast, ImageVerify_ResultName((ImageVerify_Result_t)verify->result),
+         (unsigned)verify->crc_bytes, (unsigned long long)b->ttfa_us, (unsigned long long)b->cpu_us, (unsigned)b->stack_calls,
+         (unsigned)b->log_bytes);
+  for (s = 0; s < BOOT_STAGE_COUNT; s++)
+    printf(",%u", (stats->marked & (1U << s)) ? (unsigned)stats->at_us[s] : 0U);
+  printf("\n");
+
+  if (b->fallback) {
+    SIM_CHECK(b->ttfa_us == 0 && Bench_Tag(b->bank) == OTA_INVALID_OLD_TAG &&
+              Bench_Tag(Bench_Other(b->bank)) == OTA_VALID_TAG,
+              "%s: no fallback (advertised at %llu us, tags 0x%08X, 0x%08X)", b->name,
+              (unsigned long long)b->ttfa_us, (unsigned)Bench_Tag(b->bank),
+              (unsigned)Bench_Tag(Bench_Other(b->bank)));
+    Bench_CheckVerify(b, uart);
+    free(uart);
+    return;
+  }
+  SIM_CHECK(b->ttfa_us != 0, "%s: no advertisement", b->name);
+  SIM_CHECK(uart != NULL && strstr(uart, "boot late init") != NULL, "%s: no boot report", b->name);
+  SIM_CHECK(uart != NULL && strstr(uart, "BlueNRG-1 BLE Beacon Application") != NULL,
+            "%s: late init not done", b->name);
+  SIM_CHECK(Sim_StackCalls(SIM_API_GATT_UPDATE_CHAR) == 1, "%s: device name not set", b->name);
+  SIM_CHECK(stats->at_us[BOOT_STAGE_FIRST_ADV] + TTFA_TOLERANCE_US >= b->ttfa_us + SIM_COST_RAL_ISR_US &&
+            stats->at_us[BOOT_STAGE_FIRST_ADV] <= b->ttfa_us + SIM_COST_RAL_ISR_US + TTFA_TOLERANCE_US,
+            "%s: first advertisement at %u us for the firmware, %llu us simulated", b->name,
+            (unsigned)stats->at_us[BOOT_STAGE_FIRST_ADV], (unsigned long long)b->ttfa_us);
+  b->verify_us = stats->at_us[BOOT_STAGE_VERIFY];
+  Bench_CheckVerify(b, uart);
+  free(uart);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *path = (argc > 1) ? argv[1] : BENCH_IMAGE_PATH;
+  uint8_t header = (argc > 2) ? (uint8_t)strtoul(argv[2], NULL, 0) : 1;
+  const Bench_Boot_t *cold = &bench_boots[0];
+  const Bench_Boot_t *b;
+  uint8_t i;
+  FILE *f = fopen(path, "rb");
+
+  if (f == NULL) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return 1;
+  }
+  bench_image_size = (uint32_t)fread(bench_image, 1, sizeof(bench_image), f);
+  fclose(f);
+  if (bench_image_size <= BENCH_WRONG_OFFSET) {
+    fprintf(stderr, "%s: %u bytes, too small\n", path, (unsigned)bench_image_size);
+    return 1;
+  }
+
+  for (i = 0; i < sizeof(bench_boots) / sizeof(bench_boots[0]); i++)
+    Bench_Run(&bench_boots[i], header && i == 0);
+  for (i = 0; i < sizeof(bench_image_boots) / sizeof(bench_image_boots[0]); i++)
+    Bench_Run(&bench_image_boots[i], 0);
+
+  for (i = 1; i < sizeof(bench_boots) / sizeof(bench_boots[0]); i++) {
+    b = &bench_boots[i];
+    SIM_CHECK(b->ttfa_us < cold->ttfa_us, "%s: first advertisement at %llu us, cold boot %llu us", b->name,
+              (unsigned long long)b->ttfa_us, (unsigned long long)cold->ttfa_us);
+    SIM_CHECK(b->ttfa_us <= BUDGET_WARM_TTFA_US, "%s: first advertisement at %llu us, budget %u us",
+              b->name, (unsigned long long)b->ttfa_us, (unsigned)BUDGET_WARM_TTFA_US);
+    SIM_CHECK(b->adv_len == cold->adv_len && memcmp(b->adv, cold->adv, b->adv_len) == 0,
+              "%s: first advertisement differs from the cold boot", b->name);
+    fprintf(stderr, "%s boot: first advertisement at %.3f ms (cold %.3f ms), %llu us of CPU, "
+            "%u stack calls, %u log bytes before it\n", b->name, (double)b->ttfa_us / 1e3,
+            (double)cold->ttfa_us / 1e3, (unsigned long long)b->cpu_us, (unsigned)b->stack_calls,
+            (unsigned)b->log_bytes);
+  }
+
+  for (i = 0; i < sizeof(bench_image_boots) / sizeof(bench_image_boots[0]); i++) {
+    b = &bench_image_boots[i];
+    if (b->reset_reason != RESET_BLE_POR && b->expect == IMAGE_VERIFY_CACHED)
+      SIM_CHECK(b->ttfa_us <= BUDGET_WARM_TTFA_US, "%s: first advertisement at %llu us, budget %u us",
+                b->name, (unsigned long long)b->ttfa_us, (unsigned)BUDGET_WARM_TTFA_US);
+    fprintf(stderr, "%s boot: image check %s in %.3f ms, first advertisement at %.3f ms\n", b->name,
+            ImageVerify_ResultName((ImageVerify_Result_t)b->expect), (double)b->verify_us / 1e3,
+            (double)b->ttfa_us / 1e3);
+  }
+
+  fprintf(stderr, "%s\n", Sim_Failures() ? "FAIL" : "ok");
+  return Sim_Failures() != 0;
+}
@@ -0,0 +1,180 @@
+/**
+  ******************************************************************************
+  * @file    button_sim.c
+  * @brief   Host replay of button edge traces through GPIO_Handler(), the
+  *          debounce logic and the event queue of src/button.c. Reports, for
+  *          each trace, the events delivered to the main loop against the
+  *          intended presses/releases and how late they arrived.
+  *
+  *          The run fails (exit code 1) if an intended transition is lost or
+  *          doubled, if an event is later than the debounce window plus
+  *          BUTTON_LATENCY_SLACK_US, or if the pin is read more often than
+  *          once per edge interrupt and end of bounce check (plus the read at
+  *          init): nothing polls the button while it is idle.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include "BlueNRG1_conf.h"
+#include "sleep.h"
+#include "scheduler.h"
+#include "button.h"
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* A contact transition, times in us from the start of the trace */
+typedef struct {
+  uint32_t at_us;
+  uint8_t  level;
+} Trace_Edge_t;
+
+typedef struct {
+  const char *name;
+  const Trace_Edge_t *edges;    /* Raw contact transitions, bounce included */
+  uint8_t n_edges;
+  const Trace_Edge_t *intent;   /* Presses (level 0) and releases the user made */
+  uint8_t n_intent;
+} Trace_t;
+
+/* Private define ------------------------------------------------------------*/
+#define TRACE_START_US      100000
+#define TRACE_TAIL_US       1000000
+#define MAX_DELIVERED       32
+
+/* Latest event: the end of bounce check runs at the end of the window */
+#define BUTTON_LATENCY_SLACK_US     1000
+#define BUTTON_LATENCY_MAX_US       (BUTTON_DEBOUNCE_MS * 1000 + BUTTON_LATENCY_SLACK_US)
+
+#define N(a)                (uint8_t)(sizeof(a) / sizeof((a)[0]))
+
+/* Private variables ---------------------------------------------------------*/
+static const Trace_Edge_t clean_edges[] = { {0, 0}, {300000, 1} };
+
+static const Trace_Edge_t bounce_edges[] = {
+  {0, 0}, {400, 1}, {900, 0}, {1500, 1}, {2100, 0},                 /* press, 2.1 ms of bounce */
+  {300000, 1}, {300300, 0}, {300800, 1}, {301900, 0}, {303000, 1},  /* release, 3 ms of bounce */
+};
+static const Trace_Edge_t bounce_intent[] = { {0, 0}, {300000, 1} };
+
+/* Release within the debounce window: recovered by the end of window check */
+static const Trace_Edge_t short_edges[] = { {0, 0}, {400, 1}, {900, 0}, {8000, 1} };
+static const Trace_Edge_t short_intent[] = { {0, 0}, {8000, 1} };
+
+/* Bounce burst longer than the debounce window */
+static const Trace_Edge_t long_bounce_edges[] = {
+  {0, 0}, {5000, 1}, {10000, 0}, {15000, 1}, {22000, 0}, {27000, 1}, {30000, 0},
+  {400000, 1},
+};
+static const Trace_Edge_t long_bounce_intent[] = { {0, 0}, {400000, 1} };
+
+static const Trace_Edge_t rapid_edges[] = {
+  {0, 0}, {50000, 1}, {100000, 0}, {150000, 1}, {200000, 0}, {250000, 1},
+  {300000, 0}, {350000, 1}, {400000, 0}, {450000, 1},
+};
+
+static const Trace_t traces[] = {
+  { "clean press/release",   clean_edges,       N(clean_edges),       clean_edges,        N(clean_edges) },
+  { "bounce 2-3 ms",         bounce_edges,      N(bounce_edges),      bounce_intent,      N(bounce_intent) },
+  { "press shorter than window", short_edges,   N(short_edges),       short_intent,       N(short_intent) },
+  { "bounce 30 ms",          long_bounce_edges, N(long_bounce_edges), long_bounce_intent, N(long_bounce_intent) },
+  { "5 clicks at 10 Hz",     rapid_edges,       N(rapid_edges),       rapid_edges,        N(rapid_edges) },
+};
+
+static struct {
+  uint64_t at_us;
+  uint8_t  pressed;
+} delivered[MAX_DELIVERED];
+static uint8_t n_delivered;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Button_Delivered(const Button_Event_t *evt)
+{
+  if (n_delivered < MAX_DELIVERED) {
+    delivered[n_delivered].at_us = Sim_NowUs();
+    delivered[n_delivered].pressed = evt->pressed;
+    n_delivered++;
+  }
+}
+
+static void Button_Loop(void)
+{
+  Clock_Init();
+  Sched_Init();
+  Button_Init(Button_Delivered);
+  while (1) {
+    Sim_Consume(SIM_COST_LOOP_US);
+    Sched_RunOnce();
+  }
+}
+
+SleepModes App_SleepMode_Check(SleepModes sleepMode)
+{
+  if (Sched_EventsPending())
+    return SLEEPMODE_RUNNING;
+
+  return sleepMode;
+}
+
+/**
+  * @brief  Replay one trace and print its line of the report.
+  */
+static void Replay(const Trace_t *trace)
+{
+  const Button_Stats_t *stats;
+  uint64_t lat, lat_max = 0, lat_sum = 0;
+  uint8_t matched = 0;
+  uint8_t i, j;
+  uint32_t reads;
+
+  Sim_Init();
+  n_delivered = 0;
+  for (i = 0; i < trace->n_edges; i++)
+    Sim_GpioDrive(BUTTON_PIN, trace->edges[i].level, TRACE_START_US + trace->edges[i].at_us);
+
+  Sim_Run(Button_Loop, TRACE_START_US + trace->edges[trace->n_edges - 1].at_us + TRACE_TAIL_US);
+  stats = Button_GetStats();
+
+  /* Match delivered events with the intended transitions, in order */
+  for (i = 0, j = 0; i < trace->n_intent && j < n_delivered; j++) {
+    if (delivered[j].pressed != (trace->intent[i].level == 0) ||
+        delivered[j].at_us < TRACE_START_US + trace->intent[i].at_us)
+      continue;
+    lat = delivered[j].at_us - (TRACE_START_US + trace->intent[i].at_us);
+    lat_sum += lat;
+    if (lat > lat_max)
+      lat_max = lat;
+    matched++;
+    i++;
+  }
+
+  reads = Sim_GpioReads();
+  printf("%-27s %5u %6u %9u %7u %7u %8u %10.1f %10.1f %6u\n", trace->name,
+         (unsigned)stats->edges, (unsigned)trace->n_intent, (unsigned)n_delivered,
+         (unsigned)matched, (unsigned)stats->bounces, (unsigned)stats->settles,
+         matched ? (double)lat_sum / matched / 1000.0 : 0.0, (double)lat_max / 1000.0,
+         (unsigned)reads);
+
+  SIM_CHECK(n_delivered == trace->n_intent && matched == trace->n_intent,
+            "%s: %u events delivered, %u matched, expected %u", trace->name,
+            (unsigned)n_delivered, (unsigned)matched, (unsigned)trace->n_intent);
+  SIM_CHECK(lat_max <= BUTTON_LATENCY_MAX_US, "%s: event %.1f ms late, at most %.1f ms",
+            trace->name, (double)lat_max / 1000.0, BUTTON_LATENCY_MAX_US / 1000.0);
+  SIM_CHECK(reads <= stats->edges + stats->settles + 1, "%s: %u pin reads for %u edges and %u "
+            "end of bounce checks", trace->name, (unsigned)reads, (unsigned)stats->edges,
+            (unsigned)stats->settles);
+}
+
+int main(void)
+{
+  uint8_t i;
+
+  printf("debounce window %u ms, queue depth %u\n\n", BUTTON_DEBOUNCE_MS, BUTTON_QUEUE_SIZE);
+  printf("%-27s %5s %6s %9s %7s %7s %8s %10s %10s %6s\n", "trace", "edges", "intent",
+         "delivered", "matched", "bounces", "settles", "avg lat ms", "max lat ms", "reads");
+  for (i = 0; i < N(traces); i++)
+    Replay(&traces[i]);
+
+  return Sim_Failures() != 0;
+}
@@ -0,0 +1,164 @@
+/**
+  ******************************************************************************
+  * @file    crash_sim.c
+  * @brief   Host check of the crash record of src/crash.c, over successive
+  *          runs of the firmware: each NVIC_SystemReset() ends a run and the
+  *          next run is the next boot, with crash_record left as it was.
+  *
+  *          - power on: RAM garbage in crash_record is not reported;
+  *          - hard fault (Sim_HardFault()): the frame, SP and uptime are
+  *            recorded and the device resets at once;
+  *          - next boot: the record is logged once and advertising resumes;
+  *          - hci_hardware_error_event(): code and count reported.
+  *          The crash lines of the boots are written to the file given, for
+  *          tools/crash_decode.py. The run fails (exit code 1) if a check
+  *          fails.
+  *
+  *          Usage: crash_sim [crash log file]
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 200809L   /* open_memstream() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "scheduler.h"
+#include "adv_rotate.h"
+#include "crash.h"
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BOOT_RUN_US             2000000
+#define FAULT_AT_US             2500000
+#define HW_ERROR_AT_US          1000000
+#define HW_ERROR_CODE           0x02
+#define UPTIME_TOLERANCE_MS     50
+
+/* Offset of the faulting instruction in Adv_RotateRefresh() */
+#define FAULT_PC_OFS            0x10
+
+/* Private variables ---------------------------------------------------------*/
+static FILE *crash_log;
+
+/* main() of src/main.c */
+int Beacon_Main(void);
+void hci_hardware_error_event(uint8_t Hardware_Code);
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Crash_Entry(void)
+{
+  Beacon_Main();
+}
+
+static void Crash_HwErrorIrq(void *arg)
+{
+  (void)arg;
+  hci_hardware_error_event(HW_ERROR_CODE);
+}
+
+/**
+  * @brief  One boot of the firmware for at most duration_us.
+  * @param  uart: UART output (malloc'ed, to be freed), NULL to discard it
+  * @retval Simulated time at the end of the run: the reset, if any
+  */
+static uint64_t Crash_Boot(uint64_t duration_us, char **uart)
+{
+  size_t len = 0;
+  FILE *capture = NULL;
+  char *line, *end;
+
+  Sim_Init();
+  if (uart != NULL) {
+    *uart = NULL;
+    capture = open_memstream(uart, &len);
+    Sim_UartCapture(capture);
+  }
+  Sim_Run(Crash_Entry, duration_us);
+  if (capture == NULL)
+    return Sim_NowUs();
+
+  Sim_UartCapture(NULL);
+  fclose(capture);
+  /* Keep the crash lines for tools/crash_decode.py */
+  for (line = *uart; crash_log != NULL && (line = strstr(line, "crash ")) != NULL; line = end) {
+    end = line + strcspn(line, "\n");
+    fprintf(crash_log, "%.*s\n", (int)(end - line), line);
+  }
+  return Sim_NowUs();
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t frame[8] = {
+    0x11111111, 0x22222222, 0x33333333, 0x44444444, 0xCCCCCCCC,
+    ((uint32_t)(uintptr_t)Sched_RunOnce + 0x20) | 1,
+    (uint32_t)(uintptr_t)Adv_RotateRefresh + FAULT_PC_OFS,
+    0x01000000
+  };
+  char *uart, expect[96];
+  uint64_t end;
+
+  crash_log = (argc > 1) ? fopen(argv[1], "w") : NULL;
+  if (argc > 1 && crash_log == NULL) {
+    perror(argv[1]);
+    return 2;
+  }
+
+  /* Power on: RAM contents are random */
+  memset(&crash_record, 0x5A, sizeof(crash_record));
+  Crash_Boot(BOOT_RUN_US, &uart);
+  SIM_CHECK(uart != NULL && strstr(uart, "crash ") == NULL, "power on garbage reported");
+  free(uart);
+  printf("power on: RAM garbage not reported %s\n", Sim_Failures() ? "FAIL" : "ok");
+
+  /* Hard fault: reset at once */
+  Sim_Init();
+  Sim_HardFault(FAULT_AT_US, frame);
+  Sim_Run(Crash_Entry, 10 * FAULT_AT_US);
+  end = Sim_NowUs();
+  SIM_CHECK(end < FAULT_AT_US + 200000, "no reset after the fault (%.3f s)", (double)end / 1e6);
+  SIM_CHECK(crash_record.magic == CRASH_MAGIC && Crash_RecordValid(&crash_record) &&
+            crash_record.count == 1 && crash_record.code == CRASH_CODE_HARD_FAULT, "record not written");
+  SIM_CHECK(crash_record.pc == frame[6] && crash_record.lr == frame[5] && crash_record.r12 == frame[4] &&
+            crash_record.xpsr == frame[7], "frame not recorded");
+  /* Sched_Now() drifts from the simulated time by the sleep timer rounding */
+  SIM_CHECK(crash_record.uptime_ms + UPTIME_TOLERANCE_MS >= FAULT_AT_US / 1000 &&
+            crash_record.uptime_ms <= end / 1000 + UPTIME_TOLERANCE_MS,
+            "uptime %u ms", (unsigned)crash_record.uptime_ms);
+  printf("hard fault at %.3f s: record of pc 0x%08x, reset %u us later %s\n",
+         FAULT_AT_US / 1e6, (unsigned)crash_record.pc, (unsigned)(end - FAULT_AT_US),
+         Sim_Failures() ? "FAIL" : "ok");
+
+  /* Next boot: reported once, beaconing again */
+  Crash_Boot(BOOT_RUN_US, &uart);
+  snprintf(expect, sizeof(expect), "crash 1: hard fault, pc 0x%08x lr 0x%08x",
+           (unsigned)frame[6], (unsigned)frame[5]);
+  SIM_CHECK(uart != NULL && strstr(uart, expect) != NULL, "no \"%s\" on the UART", expect);
+  SIM_CHECK(crash_record.magic == CRASH_MAGIC_REPORTED, "record not marked reported");
+  SIM_CHECK(Sim_StackAdvEvents() > 0, "not advertising after the crash");
+  free(uart);
+  Crash_Boot(BOOT_RUN_US, &uart);
+  SIM_CHECK(uart != NULL && strstr(uart, "crash ") == NULL, "record reported twice");
+  free(uart);
+  printf("boot after the fault: record logged once, %u advertising events %s\n",
+         (unsigned)Sim_StackAdvEvents(), Sim_Failures() ? "FAIL" : "ok");
+
+  /* Hardware error of the stack */
+  Sim_Init();
+  Sim_Schedule(HW_ERROR_AT_US, SIM_SRC_RADIO, Crash_HwErrorIrq, NULL);
+  Sim_Run(Crash_Entry, 10 * HW_ERROR_AT_US);
+  Crash_Boot(BOOT_RUN_US, &uart);
+  snprintf(expect, sizeof(expect), "hw_error 0x%02x", HW_ERROR_CODE);
+  SIM_CHECK(uart != NULL && strstr(uart, "crash 2: hardware error") != NULL && strstr(uart, expect) != NULL,
+            "hardware error not reported");
+  free(uart);
+  printf("hardware error 0x%02x: reported as crash 2 %s\n", HW_ERROR_CODE, Sim_Failures() ? "FAIL" : "ok");
+
+  if (crash_log != NULL)
+    fclose(crash_log);
+  printf("%s\n", Sim_Failures() ? "FAIL" : "ok");
+  return Sim_Failures() != 0;
+}
@@ -0,0 +1,314 @@
+/**
+  ******************************************************************************
+  * @file    delta_bench.c
+  * @brief   Update time of delta and compressed OTA images against full
+  *          image OTA, through the OTA service of the firmware (src/main.c,
+  *          src/ota_service.c and src/ota_delta.c, built for the profile).
+  *          The running image is a real firmware (bin/blink.bin by default)
+  *          in the lower bank, the firmware booting from it; two new images
+  *          are made from it:
+  *
+  *          - fix: a few constants changed, as a bug fix release;
+  *          - feature: FEATURE_LEN bytes of code inserted in the middle, the
+  *            code after it moved and the pointers to it relocated.
+  *
+  *          Each one is sent to the higher bank by the OTA client of
+  *          sim_ota_client.c, at the connection settings of ota_bench (15 ms
+  *          interval, 6 packets per event, ack every 8 packets), as the full
+  *          image, as a compressed image and as a delta image against the
+  *          running one (host/src/delta_encode.c). One CSV line per update on
+  *          stdout: bytes sent over the air, update time from the first
+  *          connection event to the last ack (decoding and CRC32 checks
+  *          included) and its speedup over the full image, decoder cycles
+  *          per image byte and CRC32 time (cost model of sim.h), and the RAM
+  *          of the decoder.
+  *
+  *          The new image read back from the higher bank must be the one
+  *          sent and committed, with each page erased and each burst
+  *          programmed once, and the running image left as it was but its
+  *          OTA tag, then invalid. A delta sent to a device running another
+  *          image must be refused before any erase. The run fails (exit
+  *          code 1) otherwise.
+  *
+  *          Usage: delta_bench_<profile> [image.bin [header]], header 0 to
+  *          omit the CSV header line
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "stack_user_cfg.h"
+#include "OTA_btl.h"
+#include "ota_delta.h"
+#include "ota_service.h"
+#include "delta_encode.h"
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum {
+  BENCH_FULL = 0,
+  BENCH_COMPRESSED,
+  BENCH_DELTA,
+  BENCH_WRONG_BASE,             /* Delta sent to a device running another image */
+  BENCH_ENCODINGS
+} Bench_Encoding_t;
+
+/* Private define ------------------------------------------------------------*/
+#ifdef OTA_BENCH_PROFILE
+#define BENCH_PROFILE           OTA_BENCH_PROFILE
+#else
+#define BENCH_PROFILE           "default"
+#endif
+
+#define BENCH_IMAGE_PATH        "bin/blink.bin"
+
+/* Connection settings of the ota_bench baseline */
+#define BENCH_CONN_US           15000
+#define BENCH_PER_EVENT         6
+#define BENCH_ACK_EVERY         8
+#define BENCH_TIMEOUT_US        600000000ULL
+
+/* Bug fix: constants changed at these fractions of the image */
+#define FIX_EDITS               3
+
+/* Feature: code inserted at FEATURE_AT of the image, made of the code at
+   FEATURE_FROM with one byte in FEATURE_EDIT_EVERY changed */
+#define FEATURE_LEN             2048
+#define FEATURE_AT              0.45
+#define FEATURE_FROM            0.10
+#define FEATURE_EDIT_EVERY      8
+
+/* Address the image is linked at */
+#define BENCH_LINK_ADDRESS      _MEMORY_FLASH_BEGIN_
+
+/* Private variables ---------------------------------------------------------*/
+static const char *const bench_encoding_names[BENCH_ENCODINGS] = {
+  "full", "compressed", "delta", "delta_wrong_base",
+};
+
+static uint8_t old_image[OTA_DELTA_BANK_SIZE];
+static uint8_t fix_image[OTA_DELTA_BANK_SIZE];
+static uint8_t feature_image[OTA_DELTA_BANK_SIZE];
+static uint8_t stream[DELTA_ENCODE_MAX(OTA_DELTA_BANK_SIZE)];
+static uint8_t blank_bank[OTA_DELTA_BANK_SIZE];
+static uint32_t old_size;
+static uint32_t fix_size;
+static uint32_t feature_size;
+
+/* main() of src/main.c */
+int Beacon_Main(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t Bench_Le32(const uint8_t *p)
+{
+  return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void Bench_SetLe32(uint8_t *p, uint32_t v)
+{
+  uint8_t i;
+
+  for (i = 0; i < 4; i++)
+    p[i] = (uint8_t)(v >> (8 * i));
+}
+
+/**
+  * @brief  Bug fix release: a few word constants changed.
+  */
+static void Bench_MakeFix(void)
+{
+  uint32_t at;
+  uint8_t i;
+
+  memcpy(fix_image, old_image, old_size);
+  fix_size = old_size;
+  for (i = 1; i <= FIX_EDITS; i++) {
+    at = (uint32_t)((uint64_t)old_size * i / (FIX_EDITS + 1)) & ~3UL;
+    Bench_SetLe32(&fix_image[at], Bench_Le32(&fix_image[at]) ^ (0x00010203UL * i));
+  }
+}
+
+/**
+  * @brief  Feature release: new code in the middle, the rest moved up and
+  *         each word pointing into it relocated, as the linker would.
+  */
+static void Bench_MakeFeature(void)
+{
+  uint32_t at = (uint32_t)(old_size * FEATURE_AT) & ~3UL;
+  uint32_t from = (uint32_t)(old_size * FEATURE_FROM) & ~3UL;
+  uint32_t i, v;
+
+  feature_size = old_size + FEATURE_LEN;
+  memcpy(feature_image, old_image, at);
+  memcpy(&feature_image[at], &old_image[from], FEATURE_LEN);
+  for (i = 0; i < FEATURE_LEN; i += FEATURE_EDIT_EVERY)
+    feature_image[at + i] ^= 0x5A;
+  memcpy(&feature_image[at + FEATURE_LEN], &old_image[at], old_size - at);
+
+  for (i = 0; i + 4 <= feature_size; i += 4) {
+    if (i >= at && i < at + FEATURE_LEN)
+      continue;
+    v = Bench_Le32(&feature_image[i]);
+    if (v >= BENCH_LINK_ADDRESS + at && v < BENCH_LINK_ADDRESS + old_size)
+      Bench_SetLe32(&feature_image[i], v + FEATURE_LEN);
+  }
+}
+
+static void Bench_Entry(void)
+{
+  Beacon_Main();
+}
+
+/**
+  * @brief  Running image in the lower bank as it was, but its OTA tag.
+  */
+static uint8_t Bench_RunningKept(const uint8_t *running, uint32_t running_size)
+{
+  const uint8_t *flash = Sim_FlashData(OTA_DELTA_BANK_LOWER);
+  uint32_t tag_end = OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET + 4;
+
+  return memcmp(flash, running, OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET) == 0 &&
+         memcmp(&flash[tag_end], &running[tag_end], running_size - tag_end) == 0;
+}
+
+/**
+  * @brief  One update, checked and printed.
+  * @param  running: image in the lower bank
+  * @param  full_s: update time of the full image, 0 for the full image
+  * @retval Update time in s
+  */
+static double Bench_Line(const char *update, Bench_Encoding_t encoding, const uint8_t *image,
+                         uint32_t size, const uint8_t *running, uint32_t running_size, double full_s)
+{
+  const Sim_ConnStats_t *conn = Sim_StackConnStats();
+  const OtaService_Stats_t *ota = OtaService_GetStats();
+  const OtaDelta_Stats_t *decoder = OtaDelta_GetStats();
+  const Sim_OtaClientStats_t *client = Sim_OtaClientGetStats();
+  const Sim_Stats_t *stats = Sim_GetStats();
+  const uint8_t *sent = (encoding == BENCH_FULL) ? image : stream;
+  uint32_t before = Sim_Failures(), sent_size = size, running_tag;
+  uint64_t decode_cycles = 0, verify_cycles;
+  double seconds;
+
+  if (encoding != BENCH_FULL) {
+    sent_size = (encoding == BENCH_COMPRESSED)
+                  ? Delta_Encode(NULL, 0, image, size, stream, sizeof(stream))
+                  : Delta_Encode(old_image, old_size, image, size, stream, sizeof(stream));
+    if (sent_size == 0 || sent_size >= size) {
+      Sim_Fail("%s %s: %u bytes encoded for a %u bytes image", update,
+               bench_encoding_names[encoding], (unsigned)sent_size, (unsigned)size);
+      return 0.0;
+    }
+  }
+
+  /* The firmware in the lower bank, booted from power on */
+  Sim_Init();
+  Sim_SetResetReason(RESET_BLE_POR);
+  Sim_FlashLoad(OTA_DELTA_BANK_LOWER, running, running_size);
+  Sim_FlashSetImage(OTA_DELTA_BANK_LOWER, running_size);
+  /* Programmed all over: the update must erase what it writes */
+  Sim_FlashLoad(OTA_DELTA_BANK_HIGHER, blank_bank, sizeof(blank_bank));
+  Sim_StackConnect(BENCH_CONN_US, CONTROLLER_DATA_LENGTH_EXTENSION_ENABLED,
+                   Sim_OtaClientStart(sent, sent_size, OTA_DELTA_BANK_HIGHER, BENCH_PER_EVENT, BENCH_ACK_EVERY));
+  Sim_Run(Bench_Entry, BENCH_TIMEOUT_US);
+
+  /* CPU cycles of the decoder and of the CRC32 checks, cost model of sim.h:
+     the full image only has the CRC32 recorded for its boot check */
+  verify_cycles = (uint64_t)size * SIM_COST_CRC_BYTE_CYCLES;
+  if (ota->delta) {
+    decode_cycles = (uint64_t)decoder->ops * SIM_COST_DELTA_OP_CYCLES +
+                    (uint64_t)(decoder->literal_bytes + decoder->old_bytes + decoder->new_bytes +
+                               decoder->fill_bytes) * SIM_COST_DELTA_BYTE_CYCLES;
+    verify_cycles = (uint64_t)decoder->crc_bytes * SIM_COST_CRC_BYTE_CYCLES;
+  }
+
+  memcpy(&running_tag, Sim_FlashData(OTA_DELTA_BANK_LOWER + OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET),
+         sizeof(running_tag));
+  if (!Bench_RunningKept(running, running_size)) {
+    Sim_Fail("%s %s: running image changed", update, bench_encoding_names[encoding]);
+  }
+  if (encoding == BENCH_WRONG_BASE) {
+    if (!client->aborted || ota->delta_status != OTA_DELTA_ERR_BASE || Sim_FlashErases() != 0 ||
+        memcmp(&running_tag, &running[OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET], sizeof(running_tag)) != 0) {
+      Sim_Fail("%s %s: not refused (status %u, %u erases)", update,
+               bench_encoding_names[encoding], (unsigned)ota->delta_status, (unsigned)Sim_FlashErases());
+    }
+  } else if (client->done_us == 0) {
+    Sim_Fail("%s %s: update not done at %.3f s, %u of %u bytes, status %u", update,
+             bench_encoding_names[encoding], (double)Sim_NowUs() / 1e6, (unsigned)ota->written,
+             (unsigned)sent_size, (unsigned)ota->delta_status);
+  } else if (memcmp(Sim_FlashData(OTA_DELTA_BANK_HIGHER), image, size) != 0 || ota->errors != 0 ||
+             client->errors != 0 || Sim_FlashErrors() != 0) {
+    Sim_Fail("%s %s: new image differs, %u OTA errors, %u flash errors", update,
+             bench_encoding_names[encoding], (unsigned)(ota->errors + client->errors),
+             (unsigned)Sim_FlashErrors());
+  } else if (ota->state != OTA_SERVICE_COMMITTED || running_tag != OTA_INVALID_OLD_TAG) {
+    Sim_Fail("%s %s: image not committed (state %u, running tag 0x%08X)", update,
+             bench_encoding_names[encoding], (unsigned)ota->state, (unsigned)running_tag);
+  } else if (Sim_FlashErases() != DIV_CEIL(size, N_BYTES_PAGE) ||
+             Sim_FlashBursts() != DIV_CEIL(size, N_BYTES_BURST)) {
+    Sim_Fail("%s %s: %u erases, %u programs, %u and %u expected", update,
+             bench_encoding_names[encoding], (unsigned)Sim_FlashErases(), (unsigned)Sim_FlashBursts(),
+             (unsigned)DIV_CEIL(size, N_BYTES_PAGE), (unsigned)DIV_CEIL(size, N_BYTES_BURST));
+  }
+
+  seconds = (client->done_us > client->start_us) ? (double)(client->done_us - client->start_us) / 1e6 : 0.0;
+  printf("%s,%s,%s,%u,%u,%.1f,%u,%.3f,%.2f,%.1f,%.1f,%u,%u,%u,%u,%.1f,%s\n", BENCH_PROFILE, update,
+         bench_encoding_names[encoding], (unsigned)size, (unsigned)sent_size, 100.0 * sent_size / size,
+         (unsigned)conn->packets, seconds, (full_s > 0 && seconds > 0) ? full_s / seconds : 1.0,
+         (double)decode_cycles / size, (double)verify_cycles / SIM_CPU_MHZ / 1000.0,
+         (unsigned)(sizeof(OtaDelta_t) + sizeof(OtaDelta_Stats_t)), (unsigned)Sim_FlashErases(),
+         (unsigned)Sim_FlashBursts(), (unsigned)conn->missed_events, 100.0 * stats->active_us / Sim_NowUs(),
+         Sim_Failures() != before ? "FAIL" : "ok");
+  return seconds;
+}
+
+/**
+  * @brief  The update to image: full, compressed, delta.
+  */
+static void Bench_Update(const char *update, const uint8_t *image, uint32_t size)
+{
+  double full_s = Bench_Line(update, BENCH_FULL, image, size, old_image, old_size, 0.0);
+  uint8_t e;
+
+  for (e = BENCH_COMPRESSED; e <= BENCH_DELTA; e++)
+    Bench_Line(update, (Bench_Encoding_t)e, image, size, old_image, old_size, full_s);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *path = (argc > 1) ? argv[1] : BENCH_IMAGE_PATH;
+  uint8_t header = (argc > 2) ? (uint8_t)atoi(argv[2]) : 1;
+  FILE *f = fopen(path, "rb");
+
+  if (f == NULL) {
+    fprintf(stderr, "FAIL: cannot open %s\n", path);
+    return 1;
+  }
+  old_size = (uint32_t)fread(old_image, 1, sizeof(old_image), f);
+  fclose(f);
+  if (old_size < 1024 || old_size + FEATURE_LEN > OTA_DELTA_BANK_SIZE) {
+    fprintf(stderr, "FAIL: %s: %u bytes, 1 KB to %u bytes expected\n", path, (unsigned)old_size,
+            (unsigned)(OTA_DELTA_BANK_SIZE - FEATURE_LEN));
+    return 1;
+  }
+  Bench_MakeFix();
+  Bench_MakeFeature();
+
+  if (header)
+    printf("profile,update,encoding,image_bytes,sent_bytes,sent_pct,ll_packets,update_s,speedup,"
+           "decode_cycles_per_byte,verify_ms,decoder_ram_bytes,flash_erases,flash_programs,"
+           "missed_events,cpu_active_pct,result\n");
+
+  Bench_Update("fix", fix_image, fix_size);
+  Bench_Update("feature", feature_image, feature_size);
+  /* The feature delta, the device running the fix */
+  Bench_Line("feature", BENCH_WRONG_BASE, feature_image, feature_size, fix_image, fix_size, 0.0);
+
+  return Sim_Failures() != 0;
+}
@@ -0,0 +1,273 @@
+/**
+  ******************************************************************************
+  * @file    delta_encode.c
+  * @brief   Delta OTA image encoder (host side of src/ota_delta.c).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "crc32.h"
+#include "ota_delta.h"
+#include "delta_encode.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  uint8_t  kind;
+  uint32_t len;
+  uint32_t arg;                 /* Varint, or fill byte */
+  int32_t  gain;                /* Bytes saved over literals */
+} Delta_Match_t;
+
+typedef struct {
+  uint8_t  *data;
+  uint32_t len;
+  uint32_t max;
+} Delta_Out_t;
+
+/* Private define ------------------------------------------------------------*/
+#define DELTA_HASH_BITS         15
+#define DELTA_CHAIN_MAX         128
+#define DELTA_NONE              (-1)
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t *old_data;
+static const uint8_t *new_data;
+static uint32_t old_len;
+static uint32_t new_len;
+static uint32_t old_cursor;
+
+/* Hash chains of the 4-byte sequences of each image */
+static int32_t old_head[1 << DELTA_HASH_BITS];
+static int32_t new_head[1 << DELTA_HASH_BITS];
+static int32_t old_prev[OTA_DELTA_BANK_SIZE];
+static int32_t new_prev[OTA_DELTA_BANK_SIZE];
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t Delta_Hash(const uint8_t *p)
+{
+  uint32_t v = p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+
+  return (uint32_t)(v * 2654435761U) >> (32 - DELTA_HASH_BITS);
+}
+
+static uint8_t Delta_VarintLen(uint32_t v)
+{
+  uint8_t n = 1;
+
+  while (v >= 0x80) {
+    v >>= 7;
+    n++;
+  }
+  return n;
+}
+
+static void Delta_Byte(Delta_Out_t *out, uint8_t byte)
+{
+  if (out->len < out->max)
+    out->data[out->len] = byte;
+  out->len++;
+}
+
+static void Delta_Varint(Delta_Out_t *out, uint32_t v)
+{
+  while (v >= 0x80) {
+    Delta_Byte(out, (uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  Delta_Byte(out, (uint8_t)v);
+}
+
+static uint32_t Delta_Min(uint8_t kind)
+{
+  return (kind == OTA_DELTA_OP_LITERAL) ? 1 : OTA_DELTA_MATCH_MIN;
+}
+
+/**
+  * @brief  Op byte and length extension.
+  */
+static void Delta_Op(Delta_Out_t *out, uint8_t kind, uint32_t len)
+{
+  uint32_t code = len - Delta_Min(kind);
+
+  if (code < OTA_DELTA_LEN_EXT) {
+    Delta_Byte(out, (uint8_t)((kind << OTA_DELTA_OP_SHIFT) | code));
+  } else {
+    Delta_Byte(out, (uint8_t)((kind << OTA_DELTA_OP_SHIFT) | OTA_DELTA_LEN_EXT));
+    Delta_Varint(out, code - OTA_DELTA_LEN_EXT);
+  }
+}
+
+static uint32_t Delta_OpCost(uint8_t kind, uint32_t len, uint32_t arg)
+{
+  uint32_t code = len - Delta_Min(kind), cost = 1;
+
+  if (code >= OTA_DELTA_LEN_EXT)
+    cost += Delta_VarintLen(code - OTA_DELTA_LEN_EXT);
+  if (kind == OTA_DELTA_OP_FILL)
+    cost++;
+  else if (kind != OTA_DELTA_OP_LITERAL)
+    cost += Delta_VarintLen(arg);
+  return cost;
+}
+
+static uint32_t Delta_MatchLen(const uint8_t *a, const uint8_t *b, uint32_t max)
+{
+  uint32_t n = 0;
+
+  while (n < max && a[n] == b[n])
+    n++;
+  return n;
+}
+
+static void Delta_Consider(Delta_Match_t *best, uint8_t kind, uint32_t len, uint32_t arg)
+{
+  int32_t gain;
+
+  if (len < OTA_DELTA_MATCH_MIN)
+    return;
+  gain = (int32_t)len - (int32_t)Delta_OpCost(kind, len, arg);
+  if (gain > best->gain) {
+    best->kind = kind;
+    best->len = len;
+    best->arg = arg;
+    best->gain = gain;
+  }
+}
+
+/**
+  * @brief  Best operation at pos of the new image. The new image hash chains
+  *         hold the positions before pos.
+  */
+static Delta_Match_t Delta_Search(uint32_t pos)
+{
+  Delta_Match_t best = { OTA_DELTA_OP_LITERAL, 0, 0, 0 };
+  const uint8_t *p = &new_data[pos];
+  uint32_t left = new_len - pos, len, from, chain;
+  int32_t cand, rel;
+
+  len = 1;
+  while (len < left && p[len] == p[0])
+    len++;
+  Delta_Consider(&best, OTA_DELTA_OP_FILL, len, p[0]);
+
+  if (old_cursor < old_len) {
+    len = Delta_MatchLen(&old_data[old_cursor], p, old_len - old_cursor < left ? old_len - old_cursor : left);
+    Delta_Consider(&best, OTA_DELTA_OP_OLD, len, 0);
+  }
+  if (left < OTA_DELTA_MATCH_MIN)
+    return best;
+
+  for (cand = old_head[Delta_Hash(p)], chain = 0; cand != DELTA_NONE && chain < DELTA_CHAIN_MAX;
+       cand = old_prev[cand], chain++) {
+    from = (uint32_t)cand;
+    len = Delta_MatchLen(&old_data[from], p, old_len - from < left ? old_len - from : left);
+    rel = (int32_t)(from - old_cursor);
+    Delta_Consider(&best, OTA_DELTA_OP_OLD, len, ((uint32_t)rel << 1) ^ (uint32_t)(rel >> 31));
+  }
+  for (cand = new_head[Delta_Hash(p)], chain = 0; cand != DELTA_NONE && chain < DELTA_CHAIN_MAX;
+       cand = new_prev[cand], chain++) {
+    /* The decoder copies byte by byte: the source may run into the copy */
+    len = Delta_MatchLen(&new_data[cand], p, left);
+    Delta_Consider(&best, OTA_DELTA_OP_NEW, len, pos - (uint32_t)cand - 1);
+  }
+  return best;
+}
+
+static void Delta_InsertNew(uint32_t pos)
+{
+  uint32_t h;
+
+  if (pos + OTA_DELTA_MATCH_MIN > new_len)
+    return;
+  h = Delta_Hash(&new_data[pos]);
+  new_prev[pos] = new_head[h];
+  new_head[h] = (int32_t)pos;
+}
+
+static void Delta_Literals(Delta_Out_t *out, uint32_t from, uint32_t to)
+{
+  if (to == from)
+    return;
+  Delta_Op(out, OTA_DELTA_OP_LITERAL, to - from);
+  while (from < to)
+    Delta_Byte(out, new_data[from++]);
+}
+
+static void Delta_Le32(Delta_Out_t *out, uint32_t v)
+{
+  uint8_t i;
+
+  for (i = 0; i < 4; i++)
+    Delta_Byte(out, (uint8_t)(v >> (8 * i)));
+}
+
+/**
+  * @brief  Delta image of new_image against old_image, or compressed image
+  *         without base if old_size is 0.
+  * @retval Its length, 0 if an image is over a bank or out_max is short
+  */
+uint32_t Delta_Encode(const uint8_t *old_image, uint32_t old_size, const uint8_t *new_image,
+                      uint32_t new_size, uint8_t *out_data, uint32_t out_max)
+{
+  Delta_Out_t out = { out_data, 0, out_max };
+  Delta_Match_t match, next;
+  uint32_t pos = 0, literal = 0, inserted = 0, i, h;
+
+  if (new_size == 0 || new_size > OTA_DELTA_BANK_SIZE || old_size > OTA_DELTA_BANK_SIZE)
+    return 0;
+  old_data = old_image;
+  old_len = old_size;
+  new_data = new_image;
+  new_len = new_size;
+  old_cursor = 0;
+
+  memset(old_head, 0xFF, sizeof(old_head));
+  memset(new_head, 0xFF, sizeof(new_head));
+  for (i = old_size >= OTA_DELTA_MATCH_MIN ? old_size - OTA_DELTA_MATCH_MIN + 1 : 0; i-- > 0;) {
+    /* From the end: the chains give the first occurrences first */
+    h = Delta_Hash(&old_image[i]);
+    old_prev[i] = old_head[h];
+    old_head[h] = (int32_t)i;
+  }
+
+  Delta_Le32(&out, OTA_DELTA_MAGIC);
+  Delta_Le32(&out, new_size);
+  Delta_Le32(&out, Crc32_Update(0, new_image, new_size));
+  Delta_Le32(&out, old_size);
+  Delta_Le32(&out, Crc32_Update(0, old_image, old_size));
+
+  while (pos < new_size) {
+    while (inserted < pos)
+      Delta_InsertNew(inserted++);
+    match = Delta_Search(pos);
+    if (match.gain <= 0) {
+      pos++;
+      continue;
+    }
+    /* Lazy matching: a better operation one byte on */
+    if (pos + 1 < new_size) {
+      Delta_InsertNew(inserted++);
+      next = Delta_Search(pos + 1);
+      if (next.gain > match.gain + 1) {
+        pos++;
+        continue;
+      }
+    }
+
+    Delta_Literals(&out, literal, pos);
+    Delta_Op(&out, match.kind, match.len);
+    if (match.kind == OTA_DELTA_OP_FILL)
+      Delta_Byte(&out, (uint8_t)match.arg);
+    else
+      Delta_Varint(&out, match.arg);
+    if (match.kind == OTA_DELTA_OP_OLD)
+      old_cursor += ((match.arg >> 1) ^ (0 - (match.arg & 1))) + match.len;
+    pos += match.len;
+    literal = pos;
+  }
+  Delta_Literals(&out, literal, pos);
+
+  return (out.len <= out_max) ? out.len : 0;
+}
@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * @file    delta_tool.c
+  * @brief   Delta OTA image of a new firmware against the one the devices
+  *          run, or compressed image of it, for the OTA client to send in
+  *          place of the .bin (format in inc/ota_delta.h).
+  *
+  *          Usage: delta_tool [old.bin] new.bin out.dlt
+  *          Without old.bin, the image is only compressed and installs on
+  *          any device.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include "ota_delta.h"
+#include "delta_encode.h"
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t old_image[OTA_DELTA_BANK_SIZE];
+static uint8_t new_image[OTA_DELTA_BANK_SIZE];
+static uint8_t out[DELTA_ENCODE_MAX(OTA_DELTA_BANK_SIZE)];
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Read a .bin of at most one bank.
+  * @retval Its size, 0 on error
+  */
+static uint32_t Tool_Read(const char *path, uint8_t *image)
+{
+  FILE *f = fopen(path, "rb");
+  uint32_t size;
+
+  if (f == NULL) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return 0;
+  }
+  size = (uint32_t)fread(image, 1, OTA_DELTA_BANK_SIZE, f);
+  if (fgetc(f) != EOF) {
+    fprintf(stderr, "%s: over the %u bytes of a bank\n", path, (unsigned)OTA_DELTA_BANK_SIZE);
+    size = 0;
+  }
+  fclose(f);
+  return size;
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t old_size = 0, new_size, size;
+  FILE *f;
+
+  if (argc != 3 && argc != 4) {
+    fprintf(stderr, "usage: %s [old.bin] new.bin out.dlt\n", argv[0]);
+    return 2;
+  }
+  if (argc == 4 && (old_size = Tool_Read(argv[1], old_image)) == 0)
+    return 1;
+  if ((new_size = Tool_Read(argv[argc - 2], new_image)) == 0)
+    return 1;
+
+  size = Delta_Encode(old_image, old_size, new_image, new_size, out, sizeof(out));
+  f = fopen(argv[argc - 1], "wb");
+  if (size == 0 || f == NULL || fwrite(out, 1, size, f) != size) {
+    fprintf(stderr, "%s: cannot write\n", argv[argc - 1]);
+    if (f != NULL)
+      fclose(f);
+    return 1;
+  }
+  fclose(f);
+  printf("%s: %u bytes for a %u bytes image (%.1f%%), %s\n", argv[argc - 1], (unsigned)size,
+         (unsigned)new_size, 100.0 * size / new_size, old_size ? "delta" : "compressed");
+  return 0;
+}
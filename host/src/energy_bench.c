@@ -0,0 +1,147 @@
+/**
+  ******************************************************************************
+  * @file    energy_bench.c
+  * @brief   Energy budget of the advertising duty cycle: runs the beacon
+  *          firmware (src/main.c, as in beacon_sim) under the simulated clock
+  *          for each advertising interval, then evaluates the energy model
+  *          of energy.c for each TX power and payload size. One CSV line
+  *          per combination on stdout.
+  *
+  *          The logging mode is the one this program is built with:
+  *          energy_bench (text) or energy_bench_tok (LOG_TOKENIZED).
+  *          `make host-energy` concatenates both in bin/host/energy.csv.
+  *
+  *          The line of the firmware settings has baseline=1; the run
+  *          fails (exit code 1) if its average current is over budget.
+  *
+  *          Usage: energy_bench [seconds [header]], header 0 to omit the
+  *          CSV header line
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "BlueNRG1_conf.h"
+#include "ble_const.h"
+#include "energy.h"
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  uint8_t high_power;
+  uint8_t pa_level;
+} Bench_Tx_t;
+
+/* Private define ------------------------------------------------------------*/
+#ifdef LOG_TOKENIZED
+#define BENCH_LOG_MODE          "tokenized"
+#else
+#define BENCH_LOG_MODE          "text"
+#endif
+
+/* Average current of the firmware settings: 100 ms interval, -2 dBm,
+   30-byte payload */
+#define BUDGET_BASELINE_UA      135.0
+
+#define N(a)                    (sizeof(a) / sizeof((a)[0]))
+
+/* Private variables ---------------------------------------------------------*/
+/* Advertising intervals, 0.625 ms units: 20 ms to 2 s */
+static const uint16_t bench_intervals[] = { 32, 160, 400, 800, 1600, 3200 };
+
+static const Bench_Tx_t bench_tx[] = {
+  { 0, 0 },     /* -18 dBm */
+  { 0, 4 },     /* -6 dBm */
+  { 1, 4 },     /* -2 dBm */
+  { 0, 6 },     /* 0 dBm */
+  { 1, 7 },     /* +8 dBm */
+};
+
+/* AdvData lengths evaluated besides the one of the firmware */
+static const uint8_t bench_payloads[] = { 20, ADV_DATA_MAX_LEN };
+
+/* main() of src/main.c */
+int Beacon_Main(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Bench_Entry(void)
+{
+  Beacon_Main();
+}
+
+/**
+  * @brief  One CSV line.
+  * @retval Average current in uA
+  */
+static double Bench_Line(uint32_t seconds, uint8_t high_power, uint8_t pa_level,
+                         uint8_t payload, uint8_t baseline)
+{
+  const Sim_Stats_t *sim = Sim_GetStats();
+  double total_us = (double)Sim_NowUs();
+  Energy_Radio_t radio = { high_power, pa_level, payload };
+  Energy_Result_t res;
+
+  Energy_Estimate(&radio, &res);
+  printf("%s,%.2f,%u,%u,%.0f,%u,%u,%u,%.4f,%.4f,%.4f,%.2f,%.3f,%.3f,%.3f,%.3f,%.3f,%.0f\n",
+         BENCH_LOG_MODE, (double)Sim_StackAdvIntervalUs() / 1000.0, (unsigned)high_power,
+         (unsigned)pa_level, Energy_TxDbm(high_power, pa_level), (unsigned)payload,
+         (unsigned)baseline, (unsigned)Sim_StackAdvEvents(),
+         100.0 * (double)sim->active_us / total_us, 100.0 * (double)sim->halt_us / total_us,
+         100.0 * (double)sim->deep_us / total_us, (double)sim->wakeups / seconds,
+         res.event_uc, res.cpu_ua, res.radio_ua, res.sleep_ua, res.avg_ua, res.battery_days);
+  return res.avg_ua;
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t seconds = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 60;
+  uint8_t header = (argc > 2) ? (uint8_t)atoi(argv[2]) : 1;
+  uint8_t fw_high, fw_level, fw_payload, payload;
+  uint8_t i, j, k, is_fw_interval, baseline;
+  double baseline_ua = -1.0, ua;
+
+  if (seconds == 0)
+    seconds = 1;
+
+  if (header)
+    printf("log_mode,adv_interval_ms,tx_high_power,pa_level,tx_dbm,payload_bytes,baseline,"
+           "adv_events,cpu_active_pct,cpu_halt_pct,deep_sleep_pct,wakeups_per_s,"
+           "adv_event_uc,cpu_ua,radio_ua,sleep_ua,avg_ua,battery_days\n");
+
+  for (i = 0; i < N(bench_intervals); i++) {
+    Sim_Init();
+    Sim_StackForceAdvInterval(bench_intervals[i]);
+    Sim_Run(Bench_Entry, (uint64_t)seconds * 1000000);
+    if (Sim_NowUs() < (uint64_t)seconds * 1000000) {
+      fprintf(stderr, "run ended at %.3f s\n", (double)Sim_NowUs() / 1e6);
+      return 1;
+    }
+
+    /* What the firmware asked the stack for */
+    Sim_StackTxPower(&fw_high, &fw_level);
+    Sim_StackAdvData(&fw_payload);
+    is_fw_interval = (Sim_StackAdvIntervalRequested() == bench_intervals[i]);
+
+    for (j = 0; j < N(bench_tx); j++) {
+      for (k = 0; k <= N(bench_payloads); k++) {
+        payload = (k == 0) ? fw_payload : bench_payloads[k - 1];
+        if (k != 0 && payload == fw_payload)
+          continue;
+        baseline = is_fw_interval && k == 0 && bench_tx[j].high_power == fw_high &&
+                   bench_tx[j].pa_level == fw_level;
+        ua = Bench_Line(seconds, bench_tx[j].high_power, bench_tx[j].pa_level, payload, baseline);
+        if (baseline)
+          baseline_ua = ua;
+      }
+    }
+  }
+
+  if (baseline_ua > BUDGET_BASELINE_UA) {
+    fprintf(stderr, "%s: baseline %.2f uA over the %.2f uA budget\n", BENCH_LOG_MODE,
+            baseline_ua, BUDGET_BASELINE_UA);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,198 @@
+/**
+  ******************************************************************************
+  * @file    led_sim.c
+  * @brief   Host check of the LED pattern engine of src/led.c: for each
+  *          pattern, the LED virtual timer programming (LED level, period)
+  *          must be the expected sequence, each edge must come when the
+  *          previous period ends, and no scheduler job may run. Prints the
+  *          wakeups and CPU time per pattern. Exits with 1 if a check fails.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include "BlueNRG1_conf.h"
+#include "SDK_EVAL_Config.h"
+#include "sleep.h"
+#include "scheduler.h"
+#include "led.h"
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* One programming of the LED timer */
+typedef struct {
+  uint8_t  on;
+  uint32_t ms;
+} Led_Period_t;
+
+typedef struct {
+  const char *name;
+  const Led_Pattern_t *base;    /* Played first, not checked */
+  void (*play)(void);
+  const Led_Period_t *expect;   /* Programming from the start of the pattern */
+  uint8_t n_expect;
+  uint8_t cycle;                /* Expected sequence repeated from this index on */
+} Led_Case_t;
+
+/* Private define ------------------------------------------------------------*/
+#define RUN_US              20000000
+#define MAX_PERIODS         64
+
+/* Edge later than the end of the period: interrupt and wakeup latency */
+#define EDGE_LATE_MAX_US    1000
+
+#define N(a)                (uint8_t)(sizeof(a) / sizeof((a)[0]))
+
+/* Private variables ---------------------------------------------------------*/
+static const Led_Period_t idle_expect[] = { {1, 500}, {0, 500} };
+static const Led_Period_t pressed_expect[] = { {1, 100}, {0, 100} };
+
+/* 3 short blinks, the last off merged with the pause, 3 times, then back
+   to the idle blink */
+static const Led_Period_t status_expect[] = {
+  {1, 200}, {0, 300}, {1, 200}, {0, 300}, {1, 200}, {0, 1800},
+  {1, 200}, {0, 300}, {1, 200}, {0, 300}, {1, 200}, {0, 1800},
+  {1, 200}, {0, 300}, {1, 200}, {0, 300}, {1, 200}, {0, 1800},
+  {1, 500}, {0, 500},
+};
+
+/* Long blink, then 2 short ones */
+static const Led_Period_t error_expect[] = {
+  {1, 1000}, {0, 300}, {1, 200}, {0, 300}, {1, 200}, {0, 1800},
+  {1, 1000}, {0, 300}, {1, 200}, {0, 300}, {1, 200}, {0, 1800},
+  {1, 1000}, {0, 300}, {1, 200}, {0, 300}, {1, 200}, {0, 1800},
+  {1, 500}, {0, 500},
+};
+
+static const Led_Period_t progress_0_expect[] = { {1, 50}, {0, 950} };
+static const Led_Period_t progress_40_expect[] = { {1, 410}, {0, 590} };
+static const Led_Period_t progress_100_expect[] = { {1, 950}, {0, 50} };
+
+/* Pauses, a blink without off time and a pause merge into one period each,
+   the last pause with the first one of the next pass */
+static const Led_Step_t merge_steps[] = {
+  { 0, 300, 1 }, { 0, 700, 1 }, { 100, 0, 2 }, { 0, 400, 1 },
+};
+static const Led_Pattern_t merge_pattern = { merge_steps, N(merge_steps), LED_REPEAT_FOREVER };
+static const Led_Period_t merge_expect[] = { {0, 1000}, {1, 200}, {0, 1400} };
+
+static Led_Period_t periods[MAX_PERIODS];
+static uint64_t period_at[MAX_PERIODS];
+static uint8_t n_periods;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Play_Idle(void)        { Led_Play(&led_pattern_idle); }
+static void Play_Pressed(void)     { Led_Play(&led_pattern_pressed); }
+static void Play_Status(void)      { Led_ShowStatus(3); }
+static void Play_Error(void)       { Led_ShowError(2); }
+static void Play_Progress0(void)   { Led_ShowProgress(0); }
+static void Play_Progress40(void)  { Led_ShowProgress(40); }
+static void Play_Progress100(void) { Led_ShowProgress(100); }
+static void Play_Merge(void)       { Led_Play(&merge_pattern); }
+static void Play_Off(void)         { Led_Play(NULL); }
+
+static const Led_Case_t led_cases[] = {
+  { "idle 1 Hz",       NULL,              Play_Idle,        idle_expect,         N(idle_expect),         0 },
+  { "pressed 5 Hz",    NULL,              Play_Pressed,     pressed_expect,      N(pressed_expect),      0 },
+  { "status 3",        &led_pattern_idle, Play_Status,      status_expect,       N(status_expect),       18 },
+  { "error 2",         &led_pattern_idle, Play_Error,       error_expect,        N(error_expect),        18 },
+  { "progress 0 %",    NULL,              Play_Progress0,   progress_0_expect,   N(progress_0_expect),   0 },
+  { "progress 40 %",   NULL,              Play_Progress40,  progress_40_expect,  N(progress_40_expect),  0 },
+  { "progress 100 %",  NULL,              Play_Progress100, progress_100_expect, N(progress_100_expect), 0 },
+  { "merged segments", NULL,              Play_Merge,       merge_expect,        N(merge_expect),        1 },
+  { "off",             &led_pattern_idle, Play_Off,         NULL,                0,                      0 },
+};
+
+static const Led_Case_t *led_case;
+
+/**
+  * @brief  LED timer programming, with the LED level set for the period.
+  */
+static void Led_Observe(uint8_t timerNum, int32_t msRelTimeout)
+{
+  if (timerNum != LED_VTIMER_ID || n_periods >= MAX_PERIODS)
+    return;
+  periods[n_periods].on = (Sim_GpioLevel(LED_PIN) == (LED_ON == Bit_SET));
+  periods[n_periods].ms = (uint32_t)msRelTimeout;
+  period_at[n_periods] = Sim_NowUs();
+  n_periods++;
+}
+
+static void Led_Loop(void)
+{
+  Clock_Init();
+  Sched_Init();
+  Led_Init();
+  if (led_case->base != NULL)
+    Led_Play(led_case->base);
+  n_periods = 0;
+  led_case->play();
+  while (1) {
+    Sim_Consume(SIM_COST_LOOP_US);
+    Sched_RunOnce();
+  }
+}
+
+SleepModes App_SleepMode_Check(SleepModes sleepMode)
+{
+  if (Sched_EventsPending())
+    return SLEEPMODE_RUNNING;
+
+  return sleepMode;
+}
+
+/**
+  * @brief  Run one pattern and check its programming.
+  */
+static void Led_RunCase(const Led_Case_t *c)
+{
+  const Sim_Stats_t *stats = Sim_GetStats();
+  const Led_Period_t *want;
+  uint32_t before = Sim_Failures();
+  uint64_t late;
+  uint8_t i, j;
+
+  led_case = c;
+  Sim_Init();
+  Sim_VTimerSetObserver(Led_Observe);
+  Sim_Run(Led_Loop, RUN_US);
+
+  SIM_CHECK(c->n_expect == 0 || n_periods >= c->n_expect, "%s: %u periods programmed, %u expected",
+            c->name, (unsigned)n_periods, (unsigned)c->n_expect);
+  for (i = 0; c->n_expect != 0 && i < n_periods; i++) {
+    j = (i < c->n_expect) ? i : c->cycle + (i - c->cycle) % (c->n_expect - c->cycle);
+    want = &c->expect[j];
+    SIM_CHECK(periods[i].on == want->on && periods[i].ms == want->ms,
+              "%s: period %u LED %s %u ms, expected %s %u ms", c->name, (unsigned)i,
+              periods[i].on ? "on" : "off", (unsigned)periods[i].ms, want->on ? "on" : "off",
+              (unsigned)want->ms);
+    if (i > 0) {
+      late = period_at[i] - period_at[i - 1] - (uint64_t)periods[i - 1].ms * 1000;
+      SIM_CHECK(period_at[i] >= period_at[i - 1] + (uint64_t)periods[i - 1].ms * 1000 && late <= EDGE_LATE_MAX_US,
+                "%s: edge %u at %.3f s, %.3f s after the previous one", c->name, (unsigned)i,
+                (double)period_at[i] / 1e6, (double)(period_at[i] - period_at[i - 1]) / 1e6);
+    }
+  }
+  SIM_CHECK(c->n_expect != 0 || (n_periods == 0 && Sim_GpioLevel(LED_PIN) == (LED_OFF == Bit_SET)),
+            "%s: LED still blinking", c->name);
+  SIM_CHECK(Sched_GetStats()->timer_runs == 0, "%s: %u scheduler jobs ran", c->name,
+            (unsigned)Sched_GetStats()->timer_runs);
+  SIM_CHECK(Led_GetStats()->timer_errors == 0, "%s: virtual timer refused", c->name);
+
+  printf("%-16s %6u %9.1f %9.1f %8.3f %s\n", c->name, (unsigned)Led_GetStats()->edges,
+         stats->wakeups / (RUN_US / 1e6), stats->irqs / (RUN_US / 1e6),
+         100.0 * stats->active_us / RUN_US, Sim_Failures() != before ? "FAIL" : "ok");
+}
+
+int main(void)
+{
+  uint8_t i;
+
+  printf("%-16s %6s %9s %9s %8s\n", "pattern", "edges", "wakeup/s", "irq/s", "cpu %");
+  for (i = 0; i < N(led_cases); i++)
+    Led_RunCase(&led_cases[i]);
+
+  printf("%s\n", Sim_Failures() ? "FAIL" : "ok");
+  return Sim_Failures() != 0;
+}
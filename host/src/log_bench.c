@@ -0,0 +1,204 @@
+/**
+  ******************************************************************************
+  * @file    log_bench.c
+  * @brief   Host benchmark of the log transport: CPU cycles spent by the
+  *          caller of each log call with the original blocking printf()
+  *          (character by character to the UART, waiting while the TX FIFO
+  *          is full) and with the ring buffer of src/log.c, in text and
+  *          tokenized mode.
+  *
+  *          Usage: log_bench [tokenized capture [text capture]]
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdarg.h>
+#include <stdio.h>
+#include "BlueNRG1_conf.h"
+#include "sleep.h"
+#include "log.h"
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum {
+  BENCH_BLOCKING = 0,     /* printf() retargeted to the UART */
+  BENCH_RING,             /* PRINTF() of src/log.c, text mode */
+  BENCH_TOKENIZED,        /* PRINTF() of src/log.c, LOG_MODE=tokenized */
+} Bench_Backend;
+
+typedef struct {
+  const char *name;
+  void (*run)(Bench_Backend backend);
+} Bench_Scenario_t;
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_DURATION_US   20000000ULL
+
+#define N(a)                (sizeof(a) / sizeof((a)[0]))
+
+/* Private variables ---------------------------------------------------------*/
+static const char *const backend_names[] = { "blocking", "ring", "tokenized" };
+
+static const Bench_Scenario_t *bench_scenario;
+static Bench_Backend bench_backend;
+
+static uint32_t bench_calls;
+static uint64_t bench_cycles;
+static uint64_t bench_cycles_max;
+static uint64_t bench_end_us;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  printf() as retargeted by the SDK: format, then each character
+  *         goes through SdkEvalComIOSendData(), which waits for room in the
+  *         TX FIFO.
+  */
+static int Blocking_Printf(const char *format, ...)
+{
+  char line[LOG_LINE_MAX];
+  va_list args;
+  int len, i;
+
+  va_start(args, format);
+  len = vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+
+  for (i = 0; i < len && i < (int)sizeof(line) - 1; i++) {
+    while (UART_GetFlagStatus(UART_FLAG_TXFF) == SET);
+    UART_SendData(line[i]);
+  }
+  return len;
+}
+
+/**
+  * @brief  Time one log call with the selected backend, in CPU cycles of
+  *         the caller.
+  */
+#define BENCH_LOG(backend, ...) do {                               \
+    uint64_t t0 = Sim_NowUs();                                     \
+    uint64_t cycles;                                               \
+    if ((backend) == BENCH_BLOCKING)                               \
+      Blocking_Printf(__VA_ARGS__);                                \
+    else if ((backend) == BENCH_RING)                              \
+      Log_Printf(__VA_ARGS__);                                     \
+    else                                                           \
+      LOG_TOKEN(__VA_ARGS__);                                      \
+    cycles = (Sim_NowUs() - t0) * SIM_CPU_MHZ;                     \
+    bench_calls++;                                                 \
+    bench_cycles += cycles;                                        \
+    if (cycles > bench_cycles_max)                                 \
+      bench_cycles_max = cycles;                                   \
+  } while (0)
+
+/* The messages of Device_Init() and Start_Beaconing(), back to back */
+static void Scenario_Boot(Bench_Backend backend)
+{
+  BENCH_LOG(backend, "aci_gatt_init() --> SUCCESS\r\n");
+  BENCH_LOG(backend, "aci_gap_init() --> SUCCESS\r\n");
+  BENCH_LOG(backend, "aci_gatt_update_char_value_ext() --> SUCCESS\r\n");
+  BENCH_LOG(backend, "BlueNRG-1 BLE Beacon Application (version: %s)\r\n", "2.1.0");
+  BENCH_LOG(backend, "hci_le_set_scan_resp_data() --> SUCCESS\r\n");
+  BENCH_LOG(backend, "aci_gap_set_discoverable() --> SUCCESS\r\n");
+  BENCH_LOG(backend, "hci_le_set_advertising_data() --> SUCCESS\r\n");
+  BENCH_LOG(backend, "aci_gap_delete_ad_type() --> SUCCESS\r\n");
+  BENCH_LOG(backend, "aci_gap_update_adv_data() --> SUCCESS\r\n");
+}
+
+/* The LED toggle log: "%lu\n" of the time, every 100 ms (button pressed) */
+static void Scenario_Periodic(Bench_Backend backend)
+{
+  uint32_t i;
+
+  for (i = 0; i < 100; i++) {
+    BENCH_LOG(backend, "%lu\n", (unsigned long)(Sim_NowUs() / 1000));
+    Sim_Consume(100000);
+  }
+}
+
+/* More output than the UART can carry: 200 lines of 60 characters in a row */
+static void Scenario_Flood(Bench_Backend backend)
+{
+  uint32_t i;
+
+  for (i = 0; i < 200; i++) {
+    BENCH_LOG(backend, "line %03lu: the quick brown fox jumps over the lazy dog\r\n", (unsigned long)i);
+    Sim_Consume(50);
+  }
+}
+
+static const Bench_Scenario_t scenarios[] = {
+  { "boot messages",      Scenario_Boot },
+  { "periodic %lu, 10 Hz", Scenario_Periodic },
+  { "flood 200 x 60 B",   Scenario_Flood },
+};
+
+static void Bench_Entry(void)
+{
+  Log_Init();
+  bench_scenario->run(bench_backend);
+
+  /* Let the UART drain */
+  while (UART_GetFlagStatus(UART_FLAG_BUSY) == SET || Log_Busy())
+    Sim_Consume(100);
+  bench_end_us = Sim_NowUs();
+  Sim_Stop();
+}
+
+SleepModes App_SleepMode_Check(SleepModes sleepMode)
+{
+  return sleepMode;
+}
+
+/**
+  * @brief  Run one scenario with one backend and print its line of the report.
+  */
+static void Bench_Run(const Bench_Scenario_t *scenario, Bench_Backend backend, FILE *capture)
+{
+  Sim_Init();
+  Sim_UartCapture(capture);
+  bench_scenario = scenario;
+  bench_backend = backend;
+  bench_calls = 0;
+  bench_cycles = 0;
+  bench_cycles_max = 0;
+
+  Sim_Run(Bench_Entry, BENCH_DURATION_US);
+
+  printf("%-20s %-9s %6u %12.0f %12u %14.2f %14.2f %10u %8u\n", scenario->name,
+         backend_names[backend], (unsigned)bench_calls, (double)bench_cycles / bench_calls,
+         (unsigned)bench_cycles_max, (double)bench_cycles / SIM_CPU_MHZ / 1000.0,
+         (double)bench_end_us / 1000.0, (unsigned)Sim_UartTxBytes(),
+         backend == BENCH_BLOCKING ? 0 : (unsigned)Log_GetStats()->dropped);
+}
+
+int main(int argc, char *argv[])
+{
+  FILE *capture[N(backend_names)] = { NULL };
+  size_t i, b;
+
+  /* Optional captures of the UART output, for tools/log_decode.py */
+  if (argc > 1 && (capture[BENCH_TOKENIZED] = fopen(argv[1], "wb")) == NULL) {
+    perror(argv[1]);
+    return 1;
+  }
+  if (argc > 2 && (capture[BENCH_RING] = fopen(argv[2], "wb")) == NULL) {
+    perror(argv[2]);
+    return 1;
+  }
+
+  printf("UART 115200 baud, ring %u bytes, core %u MHz\n\n", LOG_RING_SIZE, SIM_CPU_MHZ);
+  printf("%-20s %-9s %6s %12s %12s %14s %14s %10s %8s\n", "scenario", "backend", "calls",
+         "avg cycles", "max cycles", "caller ms", "drained at ms", "UART bytes", "dropped");
+  for (i = 0; i < N(scenarios); i++) {
+    for (b = 0; b < N(backend_names); b++)
+      Bench_Run(&scenarios[i], (Bench_Backend)b, capture[b]);
+  }
+
+  for (b = 0; b < N(backend_names); b++) {
+    if (capture[b] != NULL)
+      fclose(capture[b]);
+  }
+
+  return 0;
+}
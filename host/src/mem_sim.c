@@ -0,0 +1,194 @@
+/**
+  ******************************************************************************
+  * @file    mem_sim.c
+  * @brief   Host check of the stack painting and high-water mark scan of
+  *          src/mem_monitor.c.
+  *
+  *          Three parts:
+  *          - painting and scanning of a plain memory region, for every
+  *            depth, with used words holding the pattern by chance;
+  *          - the sampler over the simulated CSTACK (sim_cstack): peaks,
+  *            log messages, margin byte, overflow and heap figures;
+  *          - the beacon firmware (src/main.c): a deeper stack use in the
+  *            middle of the run must reach the margin byte of the custom
+  *            advertising frame.
+  *          The run fails (exit code 1) if any check fails.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "scheduler.h"
+#include "log.h"
+#include "adv_data.h"
+#include "mem_monitor.h"
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define REGION_WORDS        64
+#define SENTINEL            0x5A5A5A5AUL
+
+/* Custom frame of main.c: Flags, then length, type, company (2 bytes),
+   frame type, counter (4 bytes), stack margin */
+#define CUSTOM_FRAME_TYPE   0x01
+#define CUSTOM_MARGIN_OFS   (ADV_FLAGS_LEN + 9)
+
+/* Firmware run: stack use added at FW_USE_AT_S, seen by the 10 s sampler */
+#define FW_RUN_S            30
+#define FW_USE_AT_S         5
+#define FW_USE_BYTES        1000
+
+/* Private variables ---------------------------------------------------------*/
+/* Region with a sentinel word on each side */
+static uint32_t region[REGION_WORDS + 2];
+
+/* Custom frame margin byte on air in the firmware run, 0xFFFF if never seen */
+static uint16_t fw_margin = 0xFFFF;
+static uint16_t fw_margin_first = 0xFFFF;
+static uint8_t fw_used;
+
+/* main() of src/main.c */
+int Beacon_Main(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Painting and scanning of a plain region, every depth.
+  */
+static void Mem_RegionChecks(void)
+{
+  uint32_t *bottom = &region[1], *top = &region[1 + REGION_WORDS];
+  uint32_t depth, i, used;
+
+  region[0] = SENTINEL;
+  region[REGION_WORDS + 1] = SENTINEL;
+  Mem_PaintRegion(bottom, top);
+  for (i = 0; i < REGION_WORDS; i++)
+    SIM_CHECK(bottom[i] == MEM_PAINT_PATTERN, "word %u not painted", (unsigned)i);
+  SIM_CHECK(region[0] == SENTINEL && region[REGION_WORDS + 1] == SENTINEL, "paint out of the region");
+  SIM_CHECK(Mem_ScanRegion(bottom, top) == 0, "fresh region not empty");
+
+  for (depth = 0; depth <= REGION_WORDS; depth++) {
+    Mem_PaintRegion(bottom, top);
+    for (i = 0; i < depth; i++)
+      top[-1 - (int)i] = i;
+    /* A used word holding the pattern, above the deepest one */
+    if (depth >= 3)
+      top[-2] = MEM_PAINT_PATTERN;
+    used = Mem_ScanRegion(bottom, top);
+    SIM_CHECK(used == depth * 4, "depth %u words: scan %u bytes", (unsigned)depth, (unsigned)used);
+  }
+
+  /* The deepest word holding the pattern is missed: one word less */
+  Mem_PaintRegion(bottom, top);
+  top[-1] = 1;
+  top[-2] = 2;
+  top[-3] = MEM_PAINT_PATTERN;
+  SIM_CHECK(Mem_ScanRegion(bottom, top) == 8, "deepest word with the pattern");
+  SIM_CHECK(region[0] == SENTINEL && region[REGION_WORDS + 1] == SENTINEL, "scan checks wrote");
+  printf("region of %u words: painting and scan at every depth %s\n", REGION_WORDS,
+         Sim_Failures() ? "FAIL" : "ok");
+}
+
+/**
+  * @brief  Sampler over the simulated CSTACK, run in the simulation.
+  */
+static void Mem_SamplerEntry(void)
+{
+  const Mem_Stats_t *stats = Mem_GetStats();
+  uint32_t messages;
+
+  Log_Init();
+  Sched_Init();
+
+  /* Not on sim_cstack: all of it is painted */
+  Mem_StackPaint();
+  SIM_CHECK(stats->stack_size == SIM_CSTACK_SIZE, "stack size %u", (unsigned)stats->stack_size);
+  SIM_CHECK(sim_cstack[SIM_CSTACK_SIZE / 4 - 1] == MEM_PAINT_PATTERN, "top word not painted");
+
+  Sim_HeapSet(1024, 600);
+  Mem_Sample();
+  SIM_CHECK(stats->stack_peak == 0 && Log_GetStats()->messages == 1, "boot sample");
+  SIM_CHECK(stats->heap_used == 600 && stats->heap_free == 424 + MEM_HEAP_SIZE - 1024,
+            "heap used %u free %u", (unsigned)stats->heap_used, (unsigned)stats->heap_free);
+  SIM_CHECK(Mem_StackMarginByte() == SIM_CSTACK_SIZE / MEM_MARGIN_UNIT, "margin byte at boot %u",
+            Mem_StackMarginByte());
+
+  Sim_CStackUse(300);
+  Mem_Sample();
+  messages = Log_GetStats()->messages;
+  SIM_CHECK(stats->stack_peak == 300 && messages == 2, "peak %u, %u messages",
+            (unsigned)stats->stack_peak, (unsigned)messages);
+  SIM_CHECK(Mem_StackMarginByte() == (SIM_CSTACK_SIZE - 300) / MEM_MARGIN_UNIT, "margin byte %u",
+            Mem_StackMarginByte());
+
+  /* Shallower use: no new peak, nothing logged */
+  Sim_CStackUse(100);
+  Mem_Sample();
+  SIM_CHECK(stats->stack_peak == 300 && Log_GetStats()->messages == messages, "peak lowered");
+
+  Sim_CStackUse(SIM_CSTACK_SIZE);
+  Mem_Sample();
+  SIM_CHECK(stats->overflow && stats->stack_peak == SIM_CSTACK_SIZE && Mem_StackMarginByte() == 0,
+            "overflow not reported");
+  SIM_CHECK(stats->samples == 4, "%u samples", (unsigned)stats->samples);
+
+  printf("sampler over %u bytes of CSTACK: peaks, log, margin byte, overflow, heap %s\n",
+         SIM_CSTACK_SIZE, Sim_Failures() ? "FAIL" : "ok");
+  Sim_HeapSet(0, 0);
+  Sim_Stop();
+}
+
+static void Mem_FirmwareEntry(void)
+{
+  Beacon_Main();
+}
+
+/**
+  * @brief  Stack stub observer: margin byte of the custom frames on air.
+  */
+static void Mem_AdvObserver(const uint8_t *data, uint8_t len)
+{
+  if (len <= CUSTOM_MARGIN_OFS || data[ADV_FLAGS_LEN + 1] != ADV_TYPE_MANUFACTURER ||
+      data[ADV_FLAGS_LEN + 4] != CUSTOM_FRAME_TYPE)
+    return;
+  fw_margin = data[CUSTOM_MARGIN_OFS];
+  if (fw_margin_first == 0xFFFF)
+    fw_margin_first = fw_margin;
+}
+
+/**
+  * @brief  Probe: the deeper stack use of the middle of the run.
+  */
+static void Mem_Probe(uint64_t now_us)
+{
+  if (!fw_used && now_us >= (uint64_t)FW_USE_AT_S * 1000000) {
+    Sim_CStackUse(FW_USE_BYTES);
+    fw_used = 1;
+  }
+}
+
+int main(void)
+{
+  uint8_t expected = (SIM_CSTACK_SIZE - FW_USE_BYTES) / MEM_MARGIN_UNIT;
+
+  Mem_RegionChecks();
+
+  Sim_Init();
+  Sim_Run(Mem_SamplerEntry, 1000000);
+
+  Sim_Init();
+  Sim_StackSetAdvObserver(Mem_AdvObserver);
+  Sim_SetProbe(100000, Mem_Probe);
+  Sim_Run(Mem_FirmwareEntry, (uint64_t)FW_RUN_S * 1000000);
+  SIM_CHECK(fw_margin != 0xFFFF && fw_margin == expected, "margin byte on air %u, expected %u",
+            (unsigned)fw_margin, (unsigned)expected);
+  printf("firmware: margin byte on air %u at boot, %u after %u bytes of stack use (%u samples) %s\n",
+         (unsigned)fw_margin_first, (unsigned)fw_margin, FW_USE_BYTES,
+         (unsigned)Mem_GetStats()->samples, Sim_Failures() ? "FAIL" : "ok");
+
+  printf("%s\n", Sim_Failures() ? "FAIL" : "ok");
+  return Sim_Failures() != 0;
+}
@@ -0,0 +1,259 @@
+/**
+  ******************************************************************************
+  * @file    ota_bench.c
+  * @brief   Image transfer throughput of the OTA service of the firmware
+  *          (src/main.c and src/ota_service.c, built for the profile): the
+  *          firmware boots from the lower OTA bank and advertises, the OTA
+  *          client of sim_ota_client.c connects on the simulated connection
+  *          of sim_stack.c and streams an image to the higher bank, then
+  *          disconnects; the firmware resets into the new image.
+  *          One CSV line per case on stdout: transfer bytes/s, image packets,
+  *          LL packets and NAKs, flash erase and program operations, and the
+  *          acknowledgement overhead (time the client waits for the expected
+  *          sequence number notifications, and their share of the air time).
+  *
+  *          The build profile is the one this program is built with:
+  *          ota_bench_beacon_ota (23 bytes ATT_MTU) or ota_bench_ota_fast
+  *          (data length extension, 220 bytes ATT_MTU). `make host-check`
+  *          concatenates both in bin/host/ota.csv. The cases sweep the
+  *          connection interval, the packets the phone sends per connection
+  *          event, the acknowledgement window and OPT_MBLOCKS; the line of
+  *          the profile settings has baseline=1.
+  *
+  *          Each transfer must complete and be committed (the firmware
+  *          resetting at the end of the connection), the image read back
+  *          from the flash must be the one sent with its OTA tag valid and
+  *          its CRC32 recorded for its boot check, the running image must
+  *          be tagged invalid, each page must be erased
+  *          once and each 16 bytes programmed once, and with the settings of
+  *          the profile the packets of a connection event must fit in its
+  *          memory blocks (no NAK): the run fails (exit code 1) otherwise.
+  *
+  *          Usage: ota_bench_<profile> [image_kb [header]], header 0 to omit
+  *          the CSV header line
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "stack_user_cfg.h"
+#include "OTA_btl.h"
+#include "crc32.h"
+#include "image_verify.h"
+#include "ota_delta.h"
+#include "ota_service.h"
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  uint16_t interval;            /* Connection interval, 1.25 ms units */
+  uint8_t  per_event;           /* Packets the phone sends per connection event */
+  uint8_t  ack_every;           /* Packets per acknowledgement */
+  int8_t   opt_mblocks;         /* OTA_BENCH_PROFILE_MBLOCKS: OPT_MBLOCKS of the firmware */
+} Ota_Case_t;
+
+/* Private define ------------------------------------------------------------*/
+#ifdef OTA_BENCH_PROFILE
+#define BENCH_PROFILE           OTA_BENCH_PROFILE
+#else
+#define BENCH_PROFILE           "default"
+#endif
+
+/* The firmware runs from the lower bank, the image goes to the higher one */
+#define BENCH_RUNNING_BASE      OTA_DELTA_BANK_LOWER
+#define BENCH_RUNNING_SIZE      8192
+#define BENCH_IMAGE_BASE        OTA_DELTA_BANK_HIGHER
+#define BENCH_IMAGE_KB_MAX      (OTA_DELTA_BANK_SIZE / 1024)
+#define BENCH_IMAGE_KB          64
+
+/* Connection interval unit, and the longest transfer */
+#define BENCH_CONN_UNIT_US      1250
+#define BENCH_TIMEOUT_US        600000000ULL
+
+/* Phone default: 6 packets per connection event */
+#define BENCH_PER_EVENT         6
+
+/* Acknowledgement window of the ST OTA client */
+#define BENCH_ACK_EVERY         8
+
+#define OTA_BENCH_PROFILE_MBLOCKS  (-1)
+
+#define N(a)                    (uint8_t)(sizeof(a) / sizeof((a)[0]))
+
+/* Private variables ---------------------------------------------------------*/
+static const Ota_Case_t bench_cases[] = {
+  /* Profile settings, then the connection interval */
+  { 12, BENCH_PER_EVENT, BENCH_ACK_EVERY, OTA_BENCH_PROFILE_MBLOCKS },
+  {  6, BENCH_PER_EVENT, BENCH_ACK_EVERY, OTA_BENCH_PROFILE_MBLOCKS },
+  { 24, BENCH_PER_EVENT, BENCH_ACK_EVERY, OTA_BENCH_PROFILE_MBLOCKS },
+  { 40, BENCH_PER_EVENT, BENCH_ACK_EVERY, OTA_BENCH_PROFILE_MBLOCKS },
+  /* Phone sending fewer or more packets per event */
+  { 12, 2,               BENCH_ACK_EVERY, OTA_BENCH_PROFILE_MBLOCKS },
+  { 12, 12,              BENCH_ACK_EVERY, OTA_BENCH_PROFILE_MBLOCKS },
+  /* Acknowledgement window */
+  { 12, BENCH_PER_EVENT, 1,               OTA_BENCH_PROFILE_MBLOCKS },
+  { 12, BENCH_PER_EVENT, 32,              OTA_BENCH_PROFILE_MBLOCKS },
+  /* Memory blocks over the minimum */
+  { 12, BENCH_PER_EVENT, BENCH_ACK_EVERY, 0 },
+  { 12, BENCH_PER_EVENT, BENCH_ACK_EVERY, 3 },
+  { 12, BENCH_PER_EVENT, BENCH_ACK_EVERY, 6 },
+  { 12, BENCH_PER_EVENT, BENCH_ACK_EVERY, 9 },
+  { 12, BENCH_PER_EVENT, BENCH_ACK_EVERY, 14 },
+  { 12, BENCH_PER_EVENT, BENCH_ACK_EVERY, 21 },
+};
+
+static uint8_t bench_image[BENCH_IMAGE_KB_MAX * 1024];
+static uint8_t bench_running[BENCH_RUNNING_SIZE];
+static int16_t bench_profile_mblocks = -1;   /* OPT_MBLOCKS of the firmware, from the first case */
+
+/* main() of src/main.c */
+int Beacon_Main(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint8_t Bench_OptMblocks(const Ota_Case_t *c)
+{
+  return (c->opt_mblocks == OTA_BENCH_PROFILE_MBLOCKS) ? (uint8_t)bench_profile_mblocks
+                                                       : (uint8_t)c->opt_mblocks;
+}
+
+/**
+  * @brief  Image contents, different for each case so that the flash left
+  *         by the previous one cannot pass the check, with the OTA tag of a
+  *         bootable image.
+  */
+static void Bench_MakeImage(uint8_t *image, uint32_t size, uint32_t seed)
+{
+  uint32_t i, tag = OTA_VALID_TAG;
+
+  for (i = 0; i < size; i++) {
+    seed = seed * 1103515245UL + 12345UL;
+    image[i] = (uint8_t)(seed >> 16);
+  }
+  memcpy(&image[OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET], &tag, sizeof(tag));
+}
+
+/**
+  * @brief  Record of the image check log the OTA service wrote for the
+  *         image: the last one of its bank, not checked yet.
+  */
+static uint8_t Bench_Recorded(const uint8_t *image, uint32_t size)
+{
+  const ImageVerify_Record_t *log =
+    (const ImageVerify_Record_t *)(const void *)Sim_FlashData(IMAGE_VERIFY_LOG_ADDRESS);
+  const ImageVerify_Record_t *rec = NULL;
+  uint8_t i;
+
+  for (i = 0; i < IMAGE_VERIFY_LOG_RECORDS && log[i].address != IMAGE_VERIFY_ERASED; i++) {
+    if (log[i].address == BENCH_IMAGE_BASE)
+      rec = &log[i];
+  }
+  return rec != NULL && rec->size == size && rec->crc == Crc32_Update(0, image, size) &&
+         rec->check == IMAGE_VERIFY_ERASED;
+}
+
+static void Bench_Entry(void)
+{
+  Beacon_Main();
+}
+
+/**
+  * @brief  Transfer of one case, checked and printed.
+  */
+static void Bench_Line(const Ota_Case_t *c, uint32_t size, uint32_t seed, uint8_t baseline)
+{
+  const Sim_ConnStats_t *conn = Sim_StackConnStats();
+  const OtaService_Stats_t *ota = OtaService_GetStats();
+  const Sim_Stats_t *stats = Sim_GetStats();
+  const Sim_OtaClientStats_t *client = Sim_OtaClientGetStats();
+  const uint8_t *flash;
+  uint32_t before = Sim_Failures(), pages, running_tag;
+  double seconds;
+
+  /* The firmware in the lower bank, booted from power on */
+  Bench_MakeImage(bench_image, size, seed);
+  Sim_Init();
+  Sim_SetResetReason(RESET_BLE_POR);
+  Sim_FlashLoad(BENCH_RUNNING_BASE, bench_running, sizeof(bench_running));
+  Sim_FlashSetImage(BENCH_RUNNING_BASE, sizeof(bench_running));
+  Sim_StackForceOptMblocks(c->opt_mblocks);
+  Sim_StackConnect((uint32_t)c->interval * BENCH_CONN_UNIT_US, CONTROLLER_DATA_LENGTH_EXTENSION_ENABLED,
+                   Sim_OtaClientStart(bench_image, size, BENCH_IMAGE_BASE, c->per_event, c->ack_every));
+  Sim_Run(Bench_Entry, BENCH_TIMEOUT_US);
+  if (bench_profile_mblocks < 0)
+    bench_profile_mblocks = Sim_StackOptMblocks();
+
+  flash = Sim_FlashData(BENCH_IMAGE_BASE);
+  memcpy(&running_tag, Sim_FlashData(BENCH_RUNNING_BASE + OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET), sizeof(running_tag));
+  pages = DIV_CEIL(size, N_BYTES_PAGE);
+  if (client->done_us == 0) {
+    Sim_Fail("%u ms, %u per event: transfer not done at %.3f s, %u of %u bytes",
+             (unsigned)(c->interval * BENCH_CONN_UNIT_US / 1000), (unsigned)c->per_event,
+             (double)Sim_NowUs() / 1e6, (unsigned)ota->written, (unsigned)size);
+  } else if (memcmp(flash, bench_image, size) != 0 || ota->errors != 0 || client->errors != 0 ||
+             Sim_FlashErrors() != 0) {
+    Sim_Fail("%u ms, %u per event: image in flash differs, %u OTA errors, "
+             "%u flash errors", (unsigned)(c->interval * BENCH_CONN_UNIT_US / 1000),
+             (unsigned)c->per_event, (unsigned)(ota->errors + client->errors), (unsigned)Sim_FlashErrors());
+  } else if (ota->state != OTA_SERVICE_COMMITTED || running_tag != OTA_INVALID_OLD_TAG ||
+             !Bench_Recorded(bench_image, size) || Sim_StackConnected()) {
+    Sim_Fail("%u ms, %u per event: image not committed (state %u, running tag 0x%08X, "
+             "%s), link %s", (unsigned)(c->interval * BENCH_CONN_UNIT_US / 1000), (unsigned)c->per_event,
+             (unsigned)ota->state, (unsigned)running_tag,
+             Bench_Recorded(bench_image, size) ? "recorded" : "no record", Sim_StackConnected() ? "up" : "down");
+  }
+  if (Sim_FlashErases() != pages || Sim_FlashBursts() != size / OTA_SERVICE_BLOCK_SIZE) {
+    Sim_Fail("%u ms, %u per event: %u erases, %u programs, %u and %u expected",
+             (unsigned)(c->interval * BENCH_CONN_UNIT_US / 1000), (unsigned)c->per_event,
+             (unsigned)Sim_FlashErases(), (unsigned)Sim_FlashBursts(), (unsigned)pages,
+             (unsigned)(size / OTA_SERVICE_BLOCK_SIZE));
+  }
+
+  if (baseline && conn->naks != 0) {
+    Sim_Fail("%u NAKs with OPT_MBLOCKS %u: %u packets of an event do not fit in %u blocks",
+             (unsigned)conn->naks, (unsigned)bench_profile_mblocks, (unsigned)c->per_event,
+             (unsigned)conn->rx_blocks);
+  }
+
+  seconds = (client->done_us > client->start_us) ? (double)(client->done_us - client->start_us) / 1e6 : 0.0;
+  printf("%s,%.2f,%u,%u,%u,%u,%u,%u,%u,%u,%.3f,%.0f,%u,%u,%u,%u,%u,%.1f,%.1f,%u,%u,%.1f,%s\n",
+         BENCH_PROFILE, c->interval * BENCH_CONN_UNIT_US / 1000.0, (unsigned)c->per_event,
+         (unsigned)c->ack_every, (unsigned)conn->att_mtu, (unsigned)conn->ll_octets,
+         (unsigned)Bench_OptMblocks(c), (unsigned)conn->rx_blocks, (unsigned)baseline, (unsigned)size,
+         seconds, seconds > 0 ? size / seconds : 0.0, (unsigned)ota->packets, (unsigned)conn->packets,
+         (unsigned)conn->naks, (unsigned)conn->missed_events, (unsigned)ota->acks,
+         seconds > 0 ? 100.0 * client->wait_us / 1e6 / seconds : 0.0,
+         conn->air_us ? 100.0 * conn->notify_air_us / conn->air_us : 0.0,
+         (unsigned)Sim_FlashErases(), (unsigned)Sim_FlashBursts(),
+         100.0 * stats->active_us / Sim_NowUs(), Sim_Failures() != before ? "FAIL" : "ok");
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t image_kb = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : BENCH_IMAGE_KB;
+  uint8_t header = (argc > 2) ? (uint8_t)atoi(argv[2]) : 1;
+  uint8_t i;
+
+  if (image_kb == 0 || image_kb > BENCH_IMAGE_KB_MAX)
+    image_kb = BENCH_IMAGE_KB;
+  Bench_MakeImage(bench_running, sizeof(bench_running), 0);
+
+  if (header)
+    printf("profile,conn_interval_ms,packets_per_event,ack_every,att_mtu,ll_octets,opt_mblocks,"
+           "rx_blocks,baseline,image_bytes,seconds,bytes_per_s,image_packets,ll_packets,naks,"
+           "missed_events,acks,ack_wait_pct,ack_air_pct,flash_erases,flash_programs,cpu_active_pct,"
+           "result\n");
+
+  for (i = 0; i < N(bench_cases); i++) {
+    /* Sweep point of the profile setting: the baseline line */
+    if (i != 0 && bench_cases[i].opt_mblocks == bench_profile_mblocks)
+      continue;
+    Bench_Line(&bench_cases[i], image_kb * 1024, i + 1, i == 0);
+  }
+
+  return Sim_Failures() != 0;
+}
@@ -0,0 +1,157 @@
+/**
+  ******************************************************************************
+  * @file    prof_sim.c
+  * @brief   Host run of the beacon firmware built with the cycle profiler
+  *          (src/prof.c, PROF_ENABLED) on the simulated MFT.
+  *
+  *          The button is held PROF_HOLD_US to ask for the dump over the log,
+  *          as on the board. The profile is then printed from the counters,
+  *          and the run fails (exit code 1) if:
+  *          - a stack tick or radio interrupt went unprofiled, or the
+  *            radio interrupt handler took less than its RAL_Isr() call;
+  *          - the cycles differ from the CPU cost model of sim.h (one MFT
+  *            count per 1/16 us); the stack ticks are checked up to the
+  *            press, since the UART interrupts of the dump count in the
+  *            ticks they preempt;
+  *          - the dump on the UART misses a site or lost log messages.
+  *
+  *          Usage: prof_sim [seconds]
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 200809L   /* open_memstream() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "scheduler.h"
+#include "button.h"
+#include "log.h"
+#include "prof.h"
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define PROF_PRESS_AT_US        (20 * 1000000ULL)
+#define PROF_HOLD_US            2500000
+
+/* MFT counts of a cost of sim.h */
+#define PROF_CYCLES(us)         ((us) * SIM_MFT_CLOCK_MHZ)
+
+/* Private variables ---------------------------------------------------------*/
+/* Stack ticks and advertising events up to the press */
+static Prof_Stats_t tick_before_dump;
+static uint32_t adv_before_dump;
+static uint8_t snapshot_taken;
+
+/* main() of src/main.c */
+int Beacon_Main(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Prof_Entry(void)
+{
+  Beacon_Main();
+}
+
+/**
+  * @brief  Probe at the press: stack tick counters before the dump.
+  */
+static void Prof_Snapshot(uint64_t now_us)
+{
+  (void)now_us;
+  if (snapshot_taken)
+    return;
+  snapshot_taken = 1;
+  tick_before_dump = *Prof_GetStats(PROF_SITE_STACK_TICK);
+  adv_before_dump = Sim_StackAdvEvents();
+}
+
+/**
+  * @brief  Profile table: one line per site, then its histogram.
+  */
+static void Prof_Print(void)
+{
+  const Prof_Stats_t *stats;
+  uint8_t site, b;
+
+  printf("%-12s %8s %8s %8s %8s %10s\n", "site", "runs", "min", "max", "avg", "avg us");
+  for (site = 0; site < PROF_SITE_COUNT; site++) {
+    stats = Prof_GetStats(site);
+    printf("%-12s %8u %8u %8u %8u %10.2f\n", Prof_SiteName(site), (unsigned)stats->count,
+           (unsigned)stats->min, (unsigned)stats->max,
+           (unsigned)(stats->count ? stats->total / stats->count : 0),
+           stats->count ? (double)stats->total * 1e6 / stats->count / PROF_CLOCK_HZ : 0.0);
+    for (b = 0; b < PROF_BUCKETS; b++) {
+      if (stats->hist[b] != 0)
+        printf("  %6u-%-6u %8u\n", b ? 1U << b : 0U, (2U << b) - 1, (unsigned)stats->hist[b]);
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t seconds = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 30;
+  const Prof_Stats_t *tick = Prof_GetStats(PROF_SITE_STACK_TICK);
+  const Prof_Stats_t *isr = Prof_GetStats(PROF_SITE_RAL_ISR);
+  const Prof_Stats_t *handler = Prof_GetStats(PROF_SITE_BLUE_ISR);
+  const Prof_Stats_t *loop = Prof_GetStats(PROF_SITE_LOOP);
+  char *uart = NULL, line[32];
+  size_t uart_len = 0;
+  FILE *capture;
+  uint8_t site;
+
+  if ((uint64_t)seconds * 1000000 < PROF_PRESS_AT_US + PROF_HOLD_US + 1000000) {
+    fprintf(stderr, "prof_sim: at least %u seconds\n",
+            (unsigned)((PROF_PRESS_AT_US + PROF_HOLD_US) / 1000000 + 1));
+    return 2;
+  }
+
+  capture = open_memstream(&uart, &uart_len);
+  Sim_Init();
+  Sim_UartCapture(capture);
+  Sim_SetProbe(PROF_PRESS_AT_US, Prof_Snapshot);
+  /* The pin reads low (pressed) after reset: release it first */
+  Sim_GpioDrive(BUTTON_PIN, 1, 1000);
+  Sim_GpioDrive(BUTTON_PIN, 0, PROF_PRESS_AT_US);
+  Sim_GpioDrive(BUTTON_PIN, 1, PROF_PRESS_AT_US + PROF_HOLD_US);
+  Sim_Run(Prof_Entry, (uint64_t)seconds * 1000000);
+  Sim_UartCapture(NULL);
+  fclose(capture);
+
+  Prof_Print();
+
+  SIM_CHECK(tick->count == Sim_StackCalls(SIM_API_STACK_TICK), "%u stack ticks, %u profiled",
+            (unsigned)Sim_StackCalls(SIM_API_STACK_TICK), (unsigned)tick->count);
+  SIM_CHECK(isr->count == Sim_StackCalls(SIM_API_RAL_ISR), "%u radio interrupts, %u profiled",
+            (unsigned)Sim_StackCalls(SIM_API_RAL_ISR), (unsigned)isr->count);
+  SIM_CHECK(handler->count == isr->count, "%u radio interrupt handlers, %u RAL_Isr() calls",
+            (unsigned)handler->count, (unsigned)isr->count);
+  /* The pass cut by the end of the run is not recorded */
+  SIM_CHECK(loop->count + 1 >= Sched_GetStats()->loops, "%u loops, %u profiled",
+            (unsigned)Sched_GetStats()->loops, (unsigned)loop->count);
+
+  SIM_CHECK(snapshot_taken, "no stack tick counters at the press");
+  SIM_CHECK(tick_before_dump.min == PROF_CYCLES(SIM_COST_STACK_TICK_US), "stack tick min %u",
+            tick_before_dump.min);
+  /* The tick after an advertising event reports its end to the scheduler */
+  SIM_CHECK(tick_before_dump.max == PROF_CYCLES(SIM_COST_ADV_TICK_US + SIM_COST_RADIO_EVENT_US),
+            "stack tick max %u", tick_before_dump.max);
+  SIM_CHECK(tick_before_dump.hist[Prof_Bucket(PROF_CYCLES(SIM_COST_ADV_TICK_US + SIM_COST_RADIO_EVENT_US))] ==
+            adv_before_dump,
+            "stack ticks after advertising events");
+  SIM_CHECK(isr->min == PROF_CYCLES(SIM_COST_RAL_ISR_US) && isr->max == isr->min, "radio interrupt %u-%u",
+            isr->min, isr->max);
+  SIM_CHECK(handler->min >= isr->min && handler->max >= isr->max, "radio interrupt handler %u-%u",
+            handler->min, handler->max);
+
+  for (site = 0; site < PROF_SITE_COUNT; site++) {
+    snprintf(line, sizeof(line), "prof %s: ", Prof_SiteName(site));
+    SIM_CHECK(uart != NULL && strstr(uart, line) != NULL, "no dump of %s on the UART", Prof_SiteName(site));
+  }
+  SIM_CHECK(Log_GetStats()->dropped == 0, "%u log messages lost", (unsigned)Log_GetStats()->dropped);
+
+  printf("%s\n", Sim_Failures() ? "FAIL" : "ok");
+  free(uart);
+  return Sim_Failures() != 0;
+}
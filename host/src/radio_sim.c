@@ -0,0 +1,152 @@
+/**
+  ******************************************************************************
+  * @file    radio_sim.c
+  * @brief   Host check of the scheduling of the deferrable timer jobs around
+  *          the radio activity (src/scheduler.c).
+  *
+  *          The beacon firmware (src/main.c) runs twice for RADIO_RUN_S, with
+  *          the same button presses: once with the end of radio activity
+  *          events kept back by the stack stub (the scheduler then runs the
+  *          jobs at their deadline, as before), once with them. The aligned
+  *          run must hold jobs off the radio, run as many of them, run the
+  *          CPU in fewer advertising events (less CPU time during the radio
+  *          activity, the peak current of the cell) and wake the core less
+  *          often. The jobs without a slack (the rotation slots, on air
+  *          timing) still run at their deadline.
+  *          One CSV line per run on stdout. The run fails (exit code 1) if a
+  *          check fails.
+  *
+  *          Usage: radio_sim [seconds [header]], header 0 to omit the CSV
+  *          header line
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "BlueNRG1_conf.h"
+#include "scheduler.h"
+#include "button.h"
+#include "energy.h"
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define RADIO_RUN_S             300
+
+/* Button presses: log lines and LED patterns in the aligned jobs */
+#define RADIO_PRESSES           10
+#define RADIO_PRESS_FIRST_US    5000000
+#define RADIO_PRESS_EVERY_US    13001000
+#define RADIO_PRESS_LEN_US      250000
+
+/* Job runs the aligned run may lose at the end of the run, held past it */
+#define RADIO_RUNS_MARGIN       2
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  Sim_RadioStats_t radio;
+  Sched_Stats_t sched;
+  uint32_t wakeups;
+  uint32_t button_events;
+  double avg_ua;
+} Radio_Run_t;
+
+/* Private variables ---------------------------------------------------------*/
+/* main() of src/main.c */
+int Beacon_Main(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Radio_FirmwareEntry(void)
+{
+  Beacon_Main();
+}
+
+static void Radio_Run(uint32_t run_s, uint8_t aligned, Radio_Run_t *run)
+{
+  Energy_Radio_t radio;
+  Energy_Result_t res;
+  uint64_t at;
+  uint8_t i;
+
+  Sim_Init();
+  Sim_StackRadioReports(aligned);
+  for (i = 0; i < RADIO_PRESSES; i++) {
+    at = RADIO_PRESS_FIRST_US + (uint64_t)i * RADIO_PRESS_EVERY_US;
+    Sim_GpioDrive(BUTTON_PIN, 0, at);
+    Sim_GpioDrive(BUTTON_PIN, 1, at + RADIO_PRESS_LEN_US);
+  }
+  Sim_Run(Radio_FirmwareEntry, (uint64_t)run_s * 1000000);
+
+  run->radio = *Sim_StackRadioStats();
+  run->sched = *Sched_GetStats();
+  run->wakeups = Sim_GetStats()->wakeups;
+  run->button_events = Button_GetStats()->accepted;
+
+  Sim_StackTxPower(&radio.tx_high_power, &radio.pa_level);
+  Sim_StackAdvData(&radio.payload_bytes);
+  Energy_Estimate(&radio, &res);
+  run->avg_ua = res.avg_ua;
+}
+
+static void Radio_Line(const char *name, const Radio_Run_t *run)
+{
+  printf("%s,%u,%u,%u,%.3f,%.3f,%.3f,%u,%u,%u,%u,%u,%.3f\n", name,
+         (unsigned)run->radio.events, (unsigned)run->radio.reports,
+         (unsigned)run->radio.peak_windows, (double)run->radio.overlap_us / 1000.0,
+         (double)run->radio.radio_us / 1000.0,
+         100.0 * (double)run->radio.overlap_us / (double)run->radio.radio_us,
+         (unsigned)run->radio.isr_late_max_us, (unsigned)run->wakeups,
+         (unsigned)run->sched.timer_runs, (unsigned)run->sched.timer_deferred,
+         (unsigned)run->sched.timer_overlaps, run->avg_ua);
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t run_s = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : RADIO_RUN_S;
+  uint8_t header = (argc > 2) ? (uint8_t)strtoul(argv[2], NULL, 0) : 1;
+  Radio_Run_t base, aligned;
+
+  if (run_s == 0)
+    run_s = 1;
+
+  Radio_Run(run_s, 0, &base);
+  Radio_Run(run_s, 1, &aligned);
+
+  if (header)
+    printf("run,adv_events,radio_reports,peak_windows,overlap_ms,radio_ms,overlap_pct,"
+           "isr_late_max_us,wakeups,timer_runs,timer_deferred,timer_overlaps,avg_ua\n");
+  Radio_Line("deadline", &base);
+  Radio_Line("aligned", &aligned);
+
+  SIM_CHECK(base.radio.reports == 0 && base.sched.radio_reports == 0 &&
+            base.sched.timer_deferred == 0, "deadline run: %u reports, %u runs deferred",
+            (unsigned)base.sched.radio_reports, (unsigned)base.sched.timer_deferred);
+  SIM_CHECK(aligned.sched.radio_reports == aligned.radio.reports &&
+            aligned.radio.reports + 1 >= aligned.radio.events,
+            "aligned run: %u of %u advertising events reported, %u seen by the scheduler",
+            (unsigned)aligned.radio.reports, (unsigned)aligned.radio.events,
+            (unsigned)aligned.sched.radio_reports);
+  SIM_CHECK(aligned.sched.timer_deferred > 0, "aligned run: no job held off the radio");
+  SIM_CHECK(aligned.sched.timer_runs + RADIO_RUNS_MARGIN >= base.sched.timer_runs,
+            "aligned run: %u job runs, %u at the deadlines", (unsigned)aligned.sched.timer_runs,
+            (unsigned)base.sched.timer_runs);
+  SIM_CHECK(aligned.radio.peak_windows < base.radio.peak_windows &&
+            aligned.radio.overlap_us < base.radio.overlap_us,
+            "CPU in the advertising events: %u events, %.3f ms aligned, %u events, %.3f ms at "
+            "the deadlines", (unsigned)aligned.radio.peak_windows,
+            (double)aligned.radio.overlap_us / 1000.0, (unsigned)base.radio.peak_windows,
+            (double)base.radio.overlap_us / 1000.0);
+  SIM_CHECK(aligned.wakeups < base.wakeups, "wakeups: %u aligned, %u at the deadlines",
+            (unsigned)aligned.wakeups, (unsigned)base.wakeups);
+  SIM_CHECK(base.button_events == 2 * RADIO_PRESSES && aligned.button_events == 2 * RADIO_PRESSES,
+            "button events: %u at the deadlines, %u aligned, expected %u",
+            (unsigned)base.button_events, (unsigned)aligned.button_events, 2 * RADIO_PRESSES);
+
+  fprintf(stderr, "firmware %u s: %u job runs held off the radio, CPU in %u advertising events "
+          "instead of %u, %u wakeups instead of %u %s\n", (unsigned)run_s,
+          (unsigned)aligned.sched.timer_deferred, (unsigned)aligned.radio.peak_windows,
+          (unsigned)base.radio.peak_windows, (unsigned)aligned.wakeups, (unsigned)base.wakeups,
+          Sim_Failures() ? "FAIL" : "ok");
+  return Sim_Failures() != 0;
+}
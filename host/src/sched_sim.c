@@ -0,0 +1,104 @@
+/**
+  ******************************************************************************
+  * @file    sched_sim.c
+  * @brief   Host simulation of the main loop: compares the legacy busy-polling
+  *          loop with the scheduler based one and reports the CPU duty cycle
+  *          and the wakeups per second.
+  *
+  *          Usage: sched_sim [seconds]
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "clock.h"
+#include "sleep.h"
+#include "scheduler.h"
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+/* LED half-period of the demo (1 Hz blink) */
+#define LED_DELAY_MS        500
+
+/* Characters printed on each LED toggle ("%lu\n" of the time) */
+#define LED_PRINTF_CHARS    8
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t legacy_loops;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Led_Toggle(void)
+{
+  Sim_Consume(LED_PRINTF_CHARS * SIM_COST_UART_CHAR_US);
+  Sim_Consume(SIM_COST_GPIO_US);
+}
+
+/**
+  * @brief  The original while(1) of main(): read the button, compare the
+  *         clock, tick the stack, never sleep.
+  */
+static void Legacy_Loop(void)
+{
+  tClockTime lastClock = 0;
+
+  Clock_Init();
+  while (1) {
+    legacy_loops++;
+    Sim_Consume(SIM_COST_GPIO_US + SIM_COST_LOOP_US);
+    if (((uint32_t)lastClock) + LED_DELAY_MS <= (uint32_t)Clock_Time()) {
+      lastClock = lastClock + LED_DELAY_MS;
+      Led_Toggle();
+    }
+    BTLE_StackTick();
+  }
+}
+
+static void Sched_Loop(void)
+{
+  Clock_Init();
+  Sched_Init();
+  Sched_TimerStart(Led_Toggle, LED_DELAY_MS, LED_DELAY_MS);
+  while (1) {
+    Sim_Consume(SIM_COST_LOOP_US);
+    Sched_RunOnce();
+  }
+}
+
+SleepModes App_SleepMode_Check(SleepModes sleepMode)
+{
+  if (Sched_EventsPending())
+    return SLEEPMODE_RUNNING;
+
+  return sleepMode;
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t seconds = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 60;
+  const Sched_Stats_t *stats;
+
+  printf("== legacy polling loop ==\n");
+  Sim_Init();
+  Sim_Run(Legacy_Loop, (uint64_t)seconds * 1000000);
+  Sim_Report(stdout);
+  printf("loop passes          : %u (%.1f /s)\n", (unsigned)legacy_loops,
+         (double)legacy_loops / seconds);
+
+  printf("\n== scheduler ==\n");
+  Sim_Init();
+  Sim_Run(Sched_Loop, (uint64_t)seconds * 1000000);
+  Sim_Report(stdout);
+  stats = Sched_GetStats();
+  printf("loop passes          : %u (%.1f /s)\n", (unsigned)stats->loops,
+         (double)stats->loops / seconds);
+  printf("timer jobs           : %u\n", (unsigned)stats->timer_runs);
+  printf("stack ticks          : %u\n", (unsigned)stats->stack_ticks);
+  printf("scheduler time       : %u ms (simulated %u ms)\n", (unsigned)Sched_Now(),
+         (unsigned)(Sim_NowUs() / 1000));
+
+  return 0;
+}
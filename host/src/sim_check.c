@@ -0,0 +1,33 @@
+/**
+  ******************************************************************************
+  * @file    sim_check.c
+  * @brief   Failed checks of the simulation drivers (SIM_CHECK() of sim.h),
+  *          counted for the whole run. Apart from sim_core.c so that the
+  *          drivers without the simulation (crc_bench) link it alone.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdarg.h>
+#include <stdio.h>
+#include "sim.h"
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t sim_failures;
+
+void Sim_Fail(const char *format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  fprintf(stderr, "FAIL: ");
+  vfprintf(stderr, format, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+  sim_failures++;
+}
+
+uint32_t Sim_Failures(void)
+{
+  return sim_failures;
+}
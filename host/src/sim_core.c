@@ -0,0 +1,366 @@
+/**
+  ******************************************************************************
+  * @file    sim_core.c
+  * @brief   Host simulation core: simulated time, CPU cost accounting and
+  *          interrupt (event) delivery for the native Linux build.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <setjmp.h>
+#include <string.h>
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  uint64_t     at;
+  Sim_Source   src;
+  Sim_Callback cb;
+  void        *arg;
+  uint8_t      used;
+} Sim_Event_t;
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_SYSTICK_PERIOD_US   1000
+
+/* Private variables ---------------------------------------------------------*/
+static Sim_Event_t sim_events[SIM_MAX_EVENTS];
+static uint64_t sim_now;
+static uint64_t sim_end;
+static uint64_t sim_systick_next;
+static uint8_t  sim_systick_on;
+static uint32_t sim_systick_count;
+static uint8_t  sim_irq_masked;
+static uint8_t  sim_in_irq;
+static uint8_t  sim_deep_wakeup;
+static uint8_t  sim_running;
+static jmp_buf  sim_exit;
+static void   (*sim_probe)(uint64_t now_us);
+static uint64_t sim_probe_period;
+static uint64_t sim_probe_next;
+static Sim_Stats_t sim_stats;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Move the simulated time forward, crediting the elapsed time to
+  *         the given bucket and counting SysTick interrupts if it runs.
+  */
+static void Sim_AdvanceSpan(uint64_t to, uint64_t *bucket, uint8_t systick_runs)
+{
+  if (sim_systick_on && systick_runs) {
+    while (sim_systick_next <= to) {
+      sim_systick_count++;
+      sim_stats.systicks++;
+      sim_systick_next += SIM_SYSTICK_PERIOD_US;
+    }
+  }
+
+  *bucket += to - sim_now;
+  sim_now = to;
+}
+
+/**
+  * @brief  Sim_AdvanceSpan() up to the end of the run, stopping at each
+  *         period boundary of the probe.
+  */
+static void Sim_AdvanceTo(uint64_t to, uint64_t *bucket, uint8_t systick_runs)
+{
+  if (to <= sim_now)
+    return;
+  if (to > sim_end)
+    to = sim_end;
+
+  while (sim_probe != NULL && sim_probe_next <= to) {
+    Sim_AdvanceSpan(sim_probe_next, bucket, systick_runs);
+    sim_probe_next += sim_probe_period;
+    sim_probe(sim_now);
+  }
+  Sim_AdvanceSpan(to, bucket, systick_runs);
+
+  if (sim_now >= sim_end)
+    Sim_Stop();
+}
+
+/**
+  * @brief  Index of the earliest pending event, -1 if none.
+  * @param  wake_mask: bit mask of the Sim_Source classes to consider
+  */
+static int Sim_NextEvent(uint32_t wake_mask)
+{
+  int next = -1;
+  int i;
+
+  for (i = 0; i < SIM_MAX_EVENTS; i++) {
+    if (!sim_events[i].used || !(wake_mask & (1UL << sim_events[i].src)))
+      continue;
+    if (next < 0 || sim_events[i].at < sim_events[next].at)
+      next = i;
+  }
+  return next;
+}
+
+/**
+  * @brief  Run the handler of an event, as an interrupt would.
+  */
+static void Sim_Dispatch(int idx)
+{
+  Sim_Callback cb = sim_events[idx].cb;
+  void *arg = sim_events[idx].arg;
+  uint8_t in_irq = sim_in_irq;
+
+  sim_events[idx].used = 0;
+  if (sim_events[idx].src == SIM_SRC_SYSTEM) {
+    /* Not an interrupt: the handler raises one if needed */
+    cb(arg);
+    return;
+  }
+  sim_in_irq = 1;
+  sim_stats.irqs++;
+  cb(arg);
+  sim_in_irq = in_irq;
+}
+
+/**
+  * @brief  Sources deliverable now: all of them, or only the hardware
+  *         beside the CPU while interrupts are masked or one is running.
+  */
+static uint32_t Sim_Deliverable(void)
+{
+  return (sim_irq_masked || sim_in_irq) ? (1UL << SIM_SRC_SYSTEM) : 0xFFFFFFFFUL;
+}
+
+/**
+  * @brief  Deliver every event already due, only the SIM_SRC_SYSTEM ones
+  *         while interrupts are masked or one is running.
+  */
+static void Sim_DispatchDue(void)
+{
+  int idx;
+
+  while ((idx = Sim_NextEvent(Sim_Deliverable())) >= 0 && sim_events[idx].at <= sim_now)
+    Sim_Dispatch(idx);
+}
+
+/**
+  * @brief  Reset the simulation: time 0, no event, SysTick off, peripherals
+  *         in reset state.
+  */
+void Sim_Init(void)
+{
+  memset(sim_events, 0, sizeof(sim_events));
+  memset(&sim_stats, 0, sizeof(sim_stats));
+  sim_now = 0;
+  sim_end = 0;
+  sim_systick_on = 0;
+  sim_systick_count = 0;
+  sim_irq_masked = 0;
+  sim_in_irq = 0;
+  sim_deep_wakeup = 0;
+  sim_running = 0;
+  sim_probe = NULL;
+
+  Sim_HalReset();
+  Sim_GpioReset();
+  Sim_UartReset();
+  Sim_MftReset();
+  Sim_StackReset();
+  Sim_WdgReset();
+  Sim_FlashReset();
+}
+
+/**
+  * @brief  Run entry() (which normally never returns) for duration_us of
+  *         simulated time.
+  */
+void Sim_Run(void (*entry)(void), uint64_t duration_us)
+{
+  sim_end = sim_now + duration_us;
+  sim_running = 1;
+  if (setjmp(sim_exit) == 0)
+    entry();
+  sim_running = 0;
+  sim_in_irq = 0;
+  sim_irq_masked = 0;
+}
+
+/**
+  * @brief  End the current Sim_Run() from anywhere in the firmware.
+  */
+void Sim_Stop(void)
+{
+  if (sim_running)
+    longjmp(sim_exit, 1);
+}
+
+uint64_t Sim_NowUs(void)
+{
+  return sim_now;
+}
+
+/**
+  * @brief  The CPU is busy for us microseconds. Interrupts falling inside
+  *         that window are delivered and delay the interrupted code.
+  */
+void Sim_Consume(uint32_t us)
+{
+  uint64_t remaining = us;
+  uint64_t from;
+  int idx;
+
+  while (remaining > 0) {
+    idx = Sim_NextEvent(Sim_Deliverable());
+    from = sim_now;
+    if (idx < 0 || sim_events[idx].at >= sim_now + remaining) {
+      Sim_AdvanceTo(sim_now + remaining, &sim_stats.active_us, 1);
+      Sim_StackCpuActive(from, sim_now);
+      break;
+    }
+    if (sim_events[idx].at > sim_now) {
+      remaining -= sim_events[idx].at - sim_now;
+      Sim_AdvanceTo(sim_events[idx].at, &sim_stats.active_us, 1);
+      Sim_StackCpuActive(from, sim_now);
+    }
+    Sim_Dispatch(idx);
+  }
+  Sim_DispatchDue();
+}
+
+/**
+  * @brief  Schedule a simulated interrupt.
+  * @retval Handle for Sim_Cancel(), -1 if the event table is full
+  */
+int Sim_Schedule(uint64_t at_us, Sim_Source src, Sim_Callback cb, void *arg)
+{
+  int i;
+
+  for (i = 0; i < SIM_MAX_EVENTS; i++) {
+    if (!sim_events[i].used) {
+      sim_events[i].at = at_us;
+      sim_events[i].src = src;
+      sim_events[i].cb = cb;
+      sim_events[i].arg = arg;
+      sim_events[i].used = 1;
+      return i;
+    }
+  }
+  return -1;
+}
+
+void Sim_Cancel(int handle)
+{
+  if (handle >= 0 && handle < SIM_MAX_EVENTS)
+    sim_events[handle].used = 0;
+}
+
+/**
+  * @brief  Sleep until the next event able to wake the core at this depth.
+  *         Pending interrupts are delivered on wakeup.
+  */
+void Sim_Sleep(Sim_SleepDepth depth)
+{
+  uint32_t wake_mask;
+  uint64_t target, woke;
+  int idx;
+
+  switch (depth) {
+  case SIM_SLEEP_HALT:
+    wake_mask = 0xFFFFFFFFUL;
+    break;
+  case SIM_SLEEP_DEEP:
+    wake_mask = (1UL << SIM_SRC_TIMER) | (1UL << SIM_SRC_IO) | (1UL << SIM_SRC_RADIO);
+    break;
+  default:
+    wake_mask = (1UL << SIM_SRC_IO);
+    break;
+  }
+
+  idx = Sim_NextEvent(wake_mask);
+  target = (idx < 0) ? sim_end : sim_events[idx].at;
+
+  if (depth == SIM_SLEEP_HALT) {
+    if (sim_systick_on && sim_systick_next < target)
+      target = sim_systick_next;
+    Sim_Consume(SIM_COST_HALT_US);
+    Sim_AdvanceTo(target, &sim_stats.halt_us, 1);
+  } else {
+    Sim_Consume(SIM_COST_DEEP_ENTRY_US);
+    Sim_AdvanceTo(target, &sim_stats.deep_us, 0);
+    sim_systick_next = sim_now + SIM_SYSTICK_PERIOD_US;
+    Sim_Consume(SIM_COST_DEEP_EXIT_US);
+  }
+
+  sim_stats.wakeups++;
+
+  /* The wakeup interrupt is taken even if the firmware masked interrupts */
+  if (!sim_in_irq) {
+    woke = sim_now;
+    while ((idx = Sim_NextEvent(0xFFFFFFFFUL)) >= 0 && sim_events[idx].at <= sim_now) {
+      sim_deep_wakeup = (depth != SIM_SLEEP_HALT && sim_events[idx].at <= woke);
+      Sim_Dispatch(idx);
+    }
+    sim_deep_wakeup = 0;
+  }
+}
+
+uint8_t Sim_DeepWakeup(void)
+{
+  return sim_deep_wakeup;
+}
+
+void Sim_SetIrqMask(uint8_t masked)
+{
+  sim_irq_masked = masked;
+  if (!masked)
+    Sim_DispatchDue();
+}
+
+uint8_t Sim_IrqMasked(void)
+{
+  return sim_irq_masked;
+}
+
+uint32_t Sim_SysTickCount(void)
+{
+  return sim_systick_count;
+}
+
+void Sim_SysTickEnable(void)
+{
+  sim_systick_on = 1;
+  sim_systick_next = sim_now + SIM_SYSTICK_PERIOD_US;
+}
+
+/**
+  * @brief  Install the periodic observer, first call one period from now.
+  */
+void Sim_SetProbe(uint64_t period_us, void (*probe)(uint64_t now_us))
+{
+  sim_probe = (period_us != 0) ? probe : NULL;
+  sim_probe_period = period_us;
+  sim_probe_next = sim_now + period_us;
+}
+
+const Sim_Stats_t *Sim_GetStats(void)
+{
+  return &sim_stats;
+}
+
+/**
+  * @brief  Print the CPU duty cycle and wakeup rate of the last run.
+  */
+void Sim_Report(FILE *out)
+{
+  double total_s = (double)sim_now / 1e6;
+  double total_us = (sim_now > 0) ? (double)sim_now : 1.0;
+
+  fprintf(out, "simulated time       : %.3f s\n", total_s);
+  fprintf(out, "CPU active           : %8.4f %%\n", 100.0 * (double)sim_stats.active_us / total_us);
+  fprintf(out, "CPU halted (WFI)     : %8.4f %%\n", 100.0 * (double)sim_stats.halt_us / total_us);
+  fprintf(out, "deep sleep           : %8.4f %%\n", 100.0 * (double)sim_stats.deep_us / total_us);
+  fprintf(out, "wakeups              : %u (%.2f /s)\n", (unsigned)sim_stats.wakeups,
+          total_s > 0 ? sim_stats.wakeups / total_s : 0.0);
+  fprintf(out, "interrupts           : %u (%.2f /s)\n", (unsigned)sim_stats.irqs,
+          total_s > 0 ? sim_stats.irqs / total_s : 0.0);
+  fprintf(out, "SysTick interrupts   : %u\n", (unsigned)sim_stats.systicks);
+}
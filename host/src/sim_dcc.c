@@ -0,0 +1,178 @@
+/**
+  ******************************************************************************
+  * @file    sim_dcc.c
+  * @brief   Host mock of the debug channel used by libdcc: the DCRDR and
+  *          DHCSR registers are backed by memory mapped at their Cortex-M
+  *          address, and a thread plays the debugger. Like OpenOCD with
+  *          "target_request debugmsgs enable", it takes each byte written by
+  *          dbg_write() and prints the messages (hex lines, 8 items per
+  *          line).
+  *
+  *          The time the target spends waiting for the debugger is charged
+  *          per byte to the simulated CPU (dbg_write_u8() is wrapped).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_SCS_PAGE            0xE000E000UL
+#define SIM_DHCSR               (*(volatile uint32_t *)0xE000EDF0UL)
+#define SIM_DCRDR               (*(volatile uint16_t *)0xE000EDF8UL)
+
+/* libdcc requests (first word of a message) */
+#define TARGET_REQ_TRACEMSG     0x00
+#define TARGET_REQ_DEBUGMSG     0x01
+#define TARGET_REQ_DEBUGCHAR    0x02
+
+/* Private variables ---------------------------------------------------------*/
+static pthread_t dcc_thread;
+static volatile int dcc_running;
+static FILE *dcc_out;
+static uint32_t dcc_bytes;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Map the System Control Space page so that the target code can
+  *         access DHCSR/DCRDR. No debugger at start.
+  */
+__attribute__((constructor))
+static void Sim_DccMap(void)
+{
+  void *page = mmap((void *)SIM_SCS_PAGE, 4096, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+  if (page != (void *)SIM_SCS_PAGE) {
+    fprintf(stderr, "sim_dcc: cannot map the debug registers at 0x%08lx\n", SIM_SCS_PAGE);
+    exit(1);
+  }
+}
+
+/**
+  * @brief  Debugger side of one byte: wait for the target busy flag, read
+  *         the data and clear the flag.
+  * @retval 0 if the debugger was detached while waiting
+  */
+static int Sim_DccByte(uint8_t *b)
+{
+  uint16_t v;
+
+  while (!((v = SIM_DCRDR) & 1)) {
+    if (!dcc_running)
+      return 0;
+    sched_yield();
+  }
+  *b = (uint8_t)(v >> 8);
+  SIM_DCRDR = 0;
+  dcc_bytes++;
+  return 1;
+}
+
+static int Sim_DccWord(uint32_t *w)
+{
+  uint8_t b;
+  int i;
+
+  *w = 0;
+  for (i = 0; i < 4; i++) {
+    if (!Sim_DccByte(&b))
+      return 0;
+    *w |= (uint32_t)b << (8 * i);
+  }
+  return 1;
+}
+
+/**
+  * @brief  target_request handling of OpenOCD: hex messages of 1, 2 or 4
+  *         byte items printed 8 per line, ASCII messages as they are.
+  */
+static void *Sim_DccDebugger(void *arg)
+{
+  uint32_t req, w;
+  uint32_t size, length, items, i, j;
+  char c;
+
+  (void)arg;
+  while (dcc_running && Sim_DccWord(&req)) {
+    if ((req & 0xFF) != TARGET_REQ_DEBUGMSG)
+      continue;   /* Trace point counters and single characters: not printed */
+
+    size = (req >> 8) & 0xFF;
+    length = req >> 16;
+    if (size == 0) {
+      for (i = 0; i < length; i += 4) {
+        if (!Sim_DccWord(&w))
+          return NULL;
+        for (j = 0; j < 4 && i + j < length; j++) {
+          c = (char)(w >> (8 * j));
+          fputc(c, dcc_out);
+        }
+      }
+      fputc('\n', dcc_out);
+      continue;
+    }
+
+    items = 0;
+    while (items < length) {
+      if (!Sim_DccWord(&w))
+        return NULL;
+      for (j = 0; j < 4 / size && items < length; j++, items++) {
+        fprintf(dcc_out, "%0*lx ", (int)(2 * size),
+                (unsigned long)((w >> (8 * size * j)) & (size == 4 ? 0xFFFFFFFFUL : (1UL << (8 * size)) - 1)));
+        if (items % 8 == 7 || items == length - 1)
+          fputc('\n', dcc_out);
+      }
+    }
+  }
+  return NULL;
+}
+
+/**
+  * @brief  Connect the mock debugger: C_DEBUGEN is set and the messages are
+  *         printed to out.
+  */
+void Sim_DccAttach(FILE *out)
+{
+  dcc_out = out;
+  dcc_bytes = 0;
+  SIM_DCRDR = 0;
+  dcc_running = 1;
+  SIM_DHCSR |= 1;
+  pthread_create(&dcc_thread, NULL, Sim_DccDebugger, NULL);
+}
+
+void Sim_DccDetach(void)
+{
+  if (!dcc_running)
+    return;
+  /* Let the debugger take what the target has already written */
+  while (SIM_DCRDR & 1)
+    sched_yield();
+  SIM_DHCSR &= ~1UL;
+  dcc_running = 0;
+  pthread_join(dcc_thread, NULL);
+  fflush(dcc_out);
+}
+
+/**
+  * @brief  Bytes read by the debugger since Sim_DccAttach().
+  */
+uint32_t Sim_DccBytes(void)
+{
+  return dcc_bytes;
+}
+
+void __real_dbg_write_u8(const unsigned char *val, long len);
+
+void __wrap_dbg_write_u8(const unsigned char *val, long len)
+{
+  Sim_Consume((uint32_t)(4 + ((len + 3) & ~3L)) * SIM_COST_DCC_BYTE_US);
+  __real_dbg_write_u8(val, len);
+}
@@ -0,0 +1,189 @@
+/**
+  ******************************************************************************
+  * @file    sim_flash.c
+  * @brief   Host stand-in for the BlueNRG-1 flash controller: page erase,
+  *          burst programming of 4 words and single words on a copy of the
+  *          160 KB flash. The CPU runs from flash: it stalls during each
+  *          operation, with the interrupts held until the end. Programming
+  *          can only clear bits; programming bits not erased, or out of the
+  *          flash, is an error.
+  *          The contents are kept across Sim_Init(), as on the device.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "crc32.h"
+#include "sim.h"
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t  flash_data[_MEMORY_FLASH_SIZE_];
+static uint8_t  flash_blank_done;
+static uint32_t flash_erases;
+static uint32_t flash_bursts;
+static uint32_t flash_words;
+static uint32_t flash_errors;
+static uint32_t flash_image_address;
+static uint32_t flash_image_size;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  CPU stalled for us: no interrupt is taken before the end.
+  */
+static void Sim_FlashBusy(uint32_t us)
+{
+  uint8_t masked = Sim_IrqMasked();
+
+  Sim_SetIrqMask(1);
+  Sim_Consume(us);
+  Sim_SetIrqMask(masked);
+}
+
+/**
+  * @brief  Counters back to 0. Erased flash (all ones) at the first reset.
+  */
+void Sim_FlashReset(void)
+{
+  if (!flash_blank_done) {
+    memset(flash_data, 0xFF, sizeof(flash_data));
+    flash_blank_done = 1;
+  }
+  flash_erases = 0;
+  flash_bursts = 0;
+  flash_words = 0;
+  flash_errors = 0;
+}
+
+uint32_t Sim_FlashErases(void)
+{
+  return flash_erases;
+}
+
+uint32_t Sim_FlashBursts(void)
+{
+  return flash_bursts;
+}
+
+uint32_t Sim_FlashWords(void)
+{
+  return flash_words;
+}
+
+/**
+  * @brief  Operations refused since the reset: out of the flash, or
+  *         programming bits not erased.
+  */
+uint32_t Sim_FlashErrors(void)
+{
+  return flash_errors;
+}
+
+/**
+  * @brief  Contents at a flash address, NULL out of the flash.
+  */
+const uint8_t *Sim_FlashData(uint32_t Address)
+{
+  if (Address < _MEMORY_FLASH_BEGIN_ || Address >= _MEMORY_FLASH_BEGIN_ + _MEMORY_FLASH_SIZE_)
+    return NULL;
+  return &flash_data[Address - _MEMORY_FLASH_BEGIN_];
+}
+
+/**
+  * @brief  Image loaded by the debugger: the rest of its pages erased.
+  */
+void Sim_FlashLoad(uint32_t Address, const uint8_t *data, uint32_t len)
+{
+  uint32_t offset = Address - _MEMORY_FLASH_BEGIN_;
+  uint32_t end = (offset + len + N_BYTES_PAGE - 1) / N_BYTES_PAGE * N_BYTES_PAGE;
+
+  if (Sim_FlashData(Address) == NULL || end > _MEMORY_FLASH_SIZE_)
+    return;
+  memset(&flash_data[offset - offset % N_BYTES_PAGE], 0xFF, end - (offset - offset % N_BYTES_PAGE));
+  memcpy(&flash_data[offset], data, len);
+}
+
+/**
+  * @brief  Image the firmware runs from, for image_verify.c (the linker
+  *         symbols of the device). Kept across Sim_Init().
+  */
+void Sim_FlashSetImage(uint32_t Address, uint32_t Size)
+{
+  flash_image_address = Address;
+  flash_image_size = Size;
+}
+
+void Sim_FlashImage(uint32_t *Address, uint32_t *Size)
+{
+  *Address = flash_image_address;
+  *Size = flash_image_size;
+}
+
+/**
+  * @brief  CRC32 of len bytes of flash continuing crc, the CPU busy for
+  *         Crc32_Update(). 0 out of the flash.
+  */
+uint32_t Sim_FlashCrc32(uint32_t crc, uint32_t Address, uint32_t len)
+{
+  const uint8_t *data = Sim_FlashData(Address);
+
+  if (data == NULL || Address - _MEMORY_FLASH_BEGIN_ + len > _MEMORY_FLASH_SIZE_)
+    return 0;
+  Sim_Consume((uint32_t)((uint64_t)len * SIM_COST_CRC_BYTE_CYCLES / SIM_CPU_MHZ));
+  return Crc32_Update(crc, data, len);
+}
+
+void FLASH_ErasePage(uint16_t PageNumber)
+{
+  if ((uint32_t)PageNumber >= _MEMORY_FLASH_SIZE_ / N_BYTES_PAGE) {
+    flash_errors++;
+    return;
+  }
+  Sim_FlashBusy(SIM_COST_FLASH_ERASE_US);
+  memset(&flash_data[(uint32_t)PageNumber * N_BYTES_PAGE], 0xFF, N_BYTES_PAGE);
+  flash_erases++;
+}
+
+void FLASH_ProgramWordBurst(uint32_t Address, uint32_t *Data)
+{
+  uint8_t *dst;
+  const uint8_t *src = (const uint8_t *)Data;
+  uint8_t i, not_erased = 0;
+
+  if (Address % N_BYTES_BURST != 0 || Address < _MEMORY_FLASH_BEGIN_ ||
+      Address + N_BYTES_BURST > _MEMORY_FLASH_BEGIN_ + _MEMORY_FLASH_SIZE_) {
+    flash_errors++;
+    return;
+  }
+  Sim_FlashBusy(SIM_COST_FLASH_BURST_US);
+  flash_bursts++;
+  dst = &flash_data[Address - _MEMORY_FLASH_BEGIN_];
+  for (i = 0; i < N_BYTES_BURST; i++) {
+    not_erased |= src[i] & ~dst[i];
+    dst[i] &= src[i];
+  }
+  if (not_erased)
+    flash_errors++;
+}
+
+void FLASH_ProgramWord(uint32_t Address, uint32_t Data)
+{
+  uint8_t *dst;
+  uint8_t i, not_erased = 0;
+
+  if (Address % 4 != 0 || Address < _MEMORY_FLASH_BEGIN_ ||
+      Address + 4 > _MEMORY_FLASH_BEGIN_ + _MEMORY_FLASH_SIZE_) {
+    flash_errors++;
+    return;
+  }
+  Sim_FlashBusy(SIM_COST_FLASH_WORD_US);
+  flash_words++;
+  dst = &flash_data[Address - _MEMORY_FLASH_BEGIN_];
+  for (i = 0; i < 4; i++) {
+    not_erased |= (uint8_t)(Data >> (8 * i)) & ~dst[i];
+    dst[i] &= (uint8_t)(Data >> (8 * i));
+  }
+  if (not_erased)
+    flash_errors++;
+}
@@ -0,0 +1,220 @@
+/**
+  ******************************************************************************
+  * @file    sim_gpio.c
+  * @brief   Host stand-in for the BlueNRG-1 GPIO block: pin levels, edge
+  *          interrupts delivered to GPIO_Handler() and NVIC enable.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "BlueNRG1_conf.h"
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Interrupt entry/exit overhead of GPIO_Handler() */
+#define SIM_COST_GPIO_IRQ_US    2
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t gpio_level;
+static uint32_t gpio_irq_enable;
+static uint32_t gpio_irq_rising;
+static uint32_t gpio_irq_falling;
+static uint32_t gpio_irq_pending;
+static uint8_t  gpio_nvic_enable;
+static uint32_t gpio_reads;
+static uint32_t gpio_writes;
+static uint8_t  gpio_sleep_loss;
+static uint32_t gpio_wake_pins;
+
+/* Stall injected by Sim_GpioStall() */
+static uint32_t gpio_stall_pins;
+static uint64_t gpio_stall_at;
+static uint32_t gpio_stall_us;
+
+void GPIO_Handler(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Sim_GpioEdge(void *arg)
+{
+  uint32_t pins = (uint32_t)((uintptr_t)arg >> 1);
+  uint32_t old = gpio_level;
+  uint32_t rising, falling;
+
+  if ((uintptr_t)arg & 1)
+    gpio_level |= pins;
+  else
+    gpio_level &= ~pins;
+
+  rising = gpio_level & ~old & gpio_irq_rising;
+  falling = ~gpio_level & old & gpio_irq_falling;
+  if (Sim_DeepWakeup())
+    gpio_wake_pins |= pins;
+  if (gpio_sleep_loss && Sim_DeepWakeup())
+    return;
+  gpio_irq_pending |= (rising | falling) & gpio_irq_enable;
+
+  if (gpio_irq_pending && gpio_nvic_enable) {
+    Sim_Consume(SIM_COST_GPIO_IRQ_US);
+    GPIO_Handler();
+  }
+}
+
+void Sim_GpioDrive(uint32_t GPIO_Pins, uint8_t level, uint64_t at_us)
+{
+  Sim_Schedule(at_us, SIM_SRC_IO, Sim_GpioEdge,
+               (void *)(((uintptr_t)GPIO_Pins << 1) | (level ? 1 : 0)));
+}
+
+/**
+  * @brief  Back to reset state: all pins low, no interrupt configured.
+  */
+void Sim_GpioReset(void)
+{
+  gpio_level = 0;
+  gpio_irq_enable = 0;
+  gpio_irq_rising = 0;
+  gpio_irq_falling = 0;
+  gpio_irq_pending = 0;
+  gpio_nvic_enable = 0;
+  gpio_reads = 0;
+  gpio_writes = 0;
+  gpio_stall_pins = 0;
+  gpio_sleep_loss = 0;
+  gpio_wake_pins = 0;
+}
+
+/**
+  * @brief  Number of GPIO_ReadBit() calls since the reset.
+  */
+uint32_t Sim_GpioReads(void)
+{
+  return gpio_reads;
+}
+
+/**
+  * @brief  Number of GPIO_WriteBit()/GPIO_ToggleBits() calls since the reset.
+  */
+uint32_t Sim_GpioWrites(void)
+{
+  return gpio_writes;
+}
+
+/**
+  * @brief  Level of the pins now, without a register access.
+  */
+uint8_t Sim_GpioLevel(uint32_t GPIO_Pins)
+{
+  return (gpio_level & GPIO_Pins) != 0;
+}
+
+/**
+  * @brief  The first write or toggle of GPIO_Pins at or after at_us keeps
+  *         the CPU busy stall_us longer, as a stuck caller would.
+  */
+void Sim_GpioStall(uint32_t GPIO_Pins, uint64_t at_us, uint32_t stall_us)
+{
+  gpio_stall_pins = GPIO_Pins;
+  gpio_stall_at = at_us;
+  gpio_stall_us = stall_us;
+}
+
+void Sim_GpioSleepLoss(uint8_t enable)
+{
+  gpio_sleep_loss = enable;
+}
+
+uint32_t Sim_GpioWakePins(void)
+{
+  return gpio_wake_pins;
+}
+
+void Sim_GpioWakeClear(void)
+{
+  gpio_wake_pins = 0;
+}
+
+static void Sim_GpioWriteCost(uint32_t GPIO_Pins)
+{
+  gpio_writes++;
+  Sim_Consume(SIM_COST_GPIO_US);
+  if ((GPIO_Pins & gpio_stall_pins) && Sim_NowUs() >= gpio_stall_at) {
+    gpio_stall_pins = 0;
+    Sim_Consume(gpio_stall_us);
+  }
+}
+
+void GPIO_Init(GPIO_InitType* GPIO_InitStruct)
+{
+  /* Inputs idle high (external pull-up on the button) */
+  if (GPIO_InitStruct->GPIO_Mode == GPIO_Input)
+    gpio_level |= GPIO_InitStruct->GPIO_Pin;
+}
+
+BitAction GPIO_ReadBit(uint32_t GPIO_Pins)
+{
+  gpio_reads++;
+  Sim_Consume(SIM_COST_GPIO_US);
+  return (gpio_level & GPIO_Pins) ? Bit_SET : Bit_RESET;
+}
+
+void GPIO_WriteBit(uint32_t GPIO_Pins, BitAction BitVal)
+{
+  Sim_GpioWriteCost(GPIO_Pins);
+  if (BitVal == Bit_SET)
+    gpio_level |= GPIO_Pins;
+  else
+    gpio_level &= ~GPIO_Pins;
+}
+
+void GPIO_ToggleBits(uint32_t GPIO_Pins)
+{
+  Sim_GpioWriteCost(GPIO_Pins);
+  gpio_level ^= GPIO_Pins;
+}
+
+void GPIO_EXTIConfig(GPIO_EXTIConfigType* EXTIConfig)
+{
+  uint32_t pins = EXTIConfig->GPIO_Pin;
+
+  gpio_irq_rising &= ~pins;
+  gpio_irq_falling &= ~pins;
+  if (EXTIConfig->GPIO_Event != GPIO_Event_Low)
+    gpio_irq_rising |= pins;
+  if (EXTIConfig->GPIO_Event != GPIO_Event_High)
+    gpio_irq_falling |= pins;
+}
+
+void GPIO_EXTICmd(uint32_t GPIO_Pins, FunctionalState NewState)
+{
+  if (NewState == ENABLE)
+    gpio_irq_enable |= GPIO_Pins;
+  else
+    gpio_irq_enable &= ~GPIO_Pins;
+}
+
+ITStatus GPIO_GetITPendingBit(uint32_t GPIO_Pins)
+{
+  return (gpio_irq_pending & GPIO_Pins) ? SET : RESET;
+}
+
+void GPIO_ClearITPendingBit(uint32_t GPIO_Pins)
+{
+  gpio_irq_pending &= ~GPIO_Pins;
+}
+
+void NVIC_Init(NVIC_InitType* NVIC_InitStruct)
+{
+  if (NVIC_InitStruct->NVIC_IRQChannel == GPIO_IRQn)
+    gpio_nvic_enable = (NVIC_InitStruct->NVIC_IRQChannelCmd == ENABLE);
+  else if (NVIC_InitStruct->NVIC_IRQChannel == UART_IRQn)
+    Sim_UartNvicCmd(NVIC_InitStruct->NVIC_IRQChannelCmd);
+  else if (NVIC_InitStruct->NVIC_IRQChannel == WDG_IRQn)
+    Sim_WdgNvicCmd(NVIC_InitStruct->NVIC_IRQChannelCmd);
+}
+
+void SysCtrl_PeripheralClockCmd(uint32_t PeriphClock, FunctionalState NewState)
+{
+  (void)PeriphClock;
+  (void)NewState;
+}
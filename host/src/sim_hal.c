@@ -0,0 +1,291 @@
+/**
+  ******************************************************************************
+  * @file    sim_hal.c
+  * @brief   Host stand-ins for the BlueNRG-1 system init, clock, sleep and
+  *          virtual timer services, built on the simulation core.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "SDK_EVAL_Config.h"
+#include "clock.h"
+#include "sleep.h"
+#include "crash.h"
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Number of virtual timers offered by the stack */
+#define SIM_VTIMERS     4
+
+/* Private variables ---------------------------------------------------------*/
+static int sim_vtimer[SIM_VTIMERS] = { -1, -1, -1, -1 };
+static void (*sim_vtimer_observer)(uint8_t timerNum, int32_t msRelTimeout);
+
+/* Counter values at time 0 (Sim_ClockPreset()) */
+static uint32_t sim_systick_base;
+static uint32_t sim_syst_base;
+
+/* CSTACK of the device: the firmware runs on the host stack, this region is
+   only painted and scanned by mem_monitor.c */
+uint32_t sim_cstack[SIM_CSTACK_SIZE / 4];
+
+/* Exception frame of the fault injected by Sim_HardFault() */
+static uint32_t sim_fault_frame[CRASH_FRAME_SIZE / 4];
+
+/* Reset reason register, not cleared by Sim_HalReset() */
+static uint8_t sim_reset_reason = RESET_BLE_POR;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  No virtual timer armed.
+  */
+void Sim_HalReset(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < SIM_VTIMERS; i++)
+    sim_vtimer[i] = -1;
+  sim_vtimer_observer = NULL;
+  sim_systick_base = 0;
+  sim_syst_base = 0;
+}
+
+/**
+  * @brief  Stack use of the device: the top bytes of sim_cstack lose their
+  *         contents as if a call chain had run on them.
+  */
+void Sim_CStackUse(uint32_t bytes)
+{
+  uint32_t words = (bytes > SIM_CSTACK_SIZE ? SIM_CSTACK_SIZE : bytes) / 4;
+  uint32_t i;
+
+  for (i = 0; i < words; i++)
+    sim_cstack[SIM_CSTACK_SIZE / 4 - 1 - i] = 0x20000000UL + i;
+}
+
+/******************************************************************************/
+/*                          System and SDK_EVAL                               */
+/******************************************************************************/
+
+void SystemInit(void)
+{
+}
+
+/**
+  * @brief  A reset ends the run: the caller sees Sim_Run() return.
+  */
+void NVIC_SystemReset(void)
+{
+  fprintf(stderr, "NVIC_SystemReset() at %.3f s\n", (double)Sim_NowUs() / 1e6);
+  sim_reset_reason = RESET_SYSREQ;
+  Sim_Stop();
+}
+
+/**
+  * @brief  Hard fault taken in thread mode on MSP: the exception frame is
+  *         the one given to Sim_HardFault(). The device version, in
+  *         BlueNRG1_it.c, reads it from the stack.
+  */
+void HardFault_Handler(void)
+{
+  Crash_Fault(sim_fault_frame, 0xFFFFFFF9UL, CRASH_CODE_HARD_FAULT);
+}
+
+static void Sim_FaultIrq(void *arg)
+{
+  (void)arg;
+  HardFault_Handler();
+}
+
+/**
+  * @brief  Fault of the firmware at at_us (or its first instant awake),
+  *         with frame as the stacked r0-r3, r12, LR, PC and xPSR.
+  */
+void Sim_HardFault(uint64_t at_us, const uint32_t frame[8])
+{
+  memcpy(sim_fault_frame, frame, sizeof(sim_fault_frame));
+  Sim_Schedule(at_us, SIM_SRC_PERIPH, Sim_FaultIrq, NULL);
+}
+
+void Sim_SetResetReason(uint8_t reason)
+{
+  sim_reset_reason = reason;
+}
+
+uint8_t SysCtrl_GetWakeupResetReason(void)
+{
+  return sim_reset_reason;
+}
+
+void SdkEvalIdentification(void)
+{
+}
+
+/******************************************************************************/
+/*                                 clock.h                                    */
+/******************************************************************************/
+
+void Clock_Init(void)
+{
+  Sim_SysTickEnable();
+}
+
+tClockTime Clock_Time(void)
+{
+  return (tClockTime)(sim_systick_base + Sim_SysTickCount());
+}
+
+void Sim_ClockPreset(uint32_t systick_ms, uint32_t sys_t32)
+{
+  sim_systick_base = systick_ms;
+  sim_syst_base = sys_t32;
+}
+
+void Clock_Wait(uint32_t i)
+{
+  Sim_Consume(i * 1000);
+}
+
+void SysCount_Handler(void)
+{
+  /* The SysTick count is kept by the simulation core */
+}
+
+/******************************************************************************/
+/*                         Virtual timers (sysT32)                            */
+/******************************************************************************/
+
+static void Sim_VTimerExpired(void *arg)
+{
+  uint8_t timerNum = (uint8_t)(uintptr_t)arg;
+
+  sim_vtimer[timerNum] = -1;
+  HAL_VTimerTimeoutCallback(timerNum);
+}
+
+int HAL_VTimerStart_ms(uint8_t timerNum, int32_t msRelTimeout)
+{
+  if (timerNum >= SIM_VTIMERS || msRelTimeout < 0)
+    return 1;
+
+  if (sim_vtimer_observer != NULL)
+    sim_vtimer_observer(timerNum, msRelTimeout);
+  Sim_Cancel(sim_vtimer[timerNum]);
+  sim_vtimer[timerNum] = Sim_Schedule(Sim_NowUs() + (uint64_t)msRelTimeout * 1000,
+                                      SIM_SRC_TIMER, Sim_VTimerExpired,
+                                      (void *)(uintptr_t)timerNum);
+  return (sim_vtimer[timerNum] < 0);
+}
+
+void HAL_VTimer_Stop(uint8_t timerNum)
+{
+  if (timerNum >= SIM_VTIMERS)
+    return;
+
+  Sim_Cancel(sim_vtimer[timerNum]);
+  sim_vtimer[timerNum] = -1;
+}
+
+/**
+  * @brief  Called on each HAL_VTimerStart_ms(), before the timer is armed.
+  */
+void Sim_VTimerSetObserver(void (*observer)(uint8_t timerNum, int32_t msRelTimeout))
+{
+  sim_vtimer_observer = observer;
+}
+
+uint32_t Sim_SysT32At(uint64_t at_us)
+{
+  return sim_syst_base + (uint32_t)(uint64_t)((double)at_us * SIM_SYST_PER_MS / 1000.0);
+}
+
+uint32_t HAL_VTimerGetCurrentTime_sysT32(void)
+{
+  return Sim_SysT32At(Sim_NowUs());
+}
+
+int32_t HAL_VTimerDiff_ms_sysT32(uint32_t sysTime1, uint32_t sysTime2)
+{
+  return (int32_t)((double)(int32_t)(sysTime1 - sysTime2) / SIM_SYST_PER_MS);
+}
+
+uint32_t HAL_VTimerAcc_sysT32_ms(uint32_t sysTime, int32_t msTime)
+{
+  double ticks = (double)msTime * SIM_SYST_PER_MS;
+
+  return sysTime + (uint32_t)(int32_t)(ticks < 0 ? ticks - 0.5 : ticks + 0.5);
+}
+
+/******************************************************************************/
+/*                                 sleep.h                                    */
+/******************************************************************************/
+
+/**
+  * @brief  The deepest mode allowed by the stack: the sleep timer must keep
+  *         running while a virtual timer is armed or the radio advertises.
+  */
+static SleepModes Sim_StackSleepMode(void)
+{
+  uint8_t i;
+
+  if (Sim_StackRadioActive())
+    return SLEEPMODE_WAKETIMER;
+
+  for (i = 0; i < SIM_VTIMERS; i++) {
+    if (sim_vtimer[i] >= 0)
+      return SLEEPMODE_WAKETIMER;
+  }
+  return SLEEPMODE_NOTIMER;
+}
+
+uint8_t BlueNRG_Sleep(SleepModes sleepMode, uint8_t gpioWakeBitMask, uint8_t gpioWakeLevelMask)
+{
+  SleepModes mode;
+
+  (void)gpioWakeBitMask;
+  (void)gpioWakeLevelMask;
+
+  mode = Sim_StackSleepMode();
+  if (sleepMode < mode)
+    mode = sleepMode;
+
+  __disable_irq();
+  sleepMode = App_SleepMode_Check(mode);
+  if (sleepMode < mode)
+    mode = sleepMode;
+
+  Sim_GpioWakeClear();
+  switch (mode) {
+  case SLEEPMODE_RUNNING:
+    Sim_Consume(SIM_COST_SLEEP_CHECK_US);
+    break;
+  case SLEEPMODE_CPU_HALT:
+    Sim_Sleep(SIM_SLEEP_HALT);
+    break;
+  case SLEEPMODE_WAKETIMER:
+    Sim_Sleep(SIM_SLEEP_DEEP);
+    break;
+  default:
+    Sim_Sleep(SIM_SLEEP_IO_ONLY);
+    break;
+  }
+  __enable_irq();
+
+  return 0;
+}
+
+/**
+  * @brief  Wakeup sources of the last BlueNRG_Sleep(): the WAKEUP_IOx bits of
+  *         the IO9..IO13 pins whose edge ended a deep sleep. The sleep timer
+  *         and reset sources are not reported.
+  */
+uint16_t BlueNRG_WakeupSource(void)
+{
+  return (uint16_t)((Sim_GpioWakePins() / GPIO_Pin_9) &
+                    (WAKEUP_IO9 | WAKEUP_IO10 | WAKEUP_IO11 | WAKEUP_IO12 | WAKEUP_IO13));
+}
@@ -0,0 +1,49 @@
+/**
+  ******************************************************************************
+  * @file    sim_libc.c
+  * @brief   CPU cost of the C library calls the firmware makes. The host
+  *          programs are linked with -Wl,--wrap so that the cost of the
+  *          formatting done on the device is charged to the simulated time.
+  *          Heap state of mallinfo(), set by the simulation.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdarg.h>
+#include <stddef.h>
+#include <malloc.h>
+#include "sim.h"
+
+/* Heap of the device, as reported by mallinfo() */
+static uint32_t sim_heap_arena;
+static uint32_t sim_heap_used;
+
+int __real_vsnprintf(char *str, size_t size, const char *format, va_list ap);
+
+int __wrap_vsnprintf(char *str, size_t size, const char *format, va_list ap)
+{
+  int len = __real_vsnprintf(str, size, format, ap);
+
+  Sim_Consume(SIM_COST_FORMAT_BASE_US + (len > 0 ? (uint32_t)len : 0) * SIM_COST_FORMAT_CHAR_US);
+  return len;
+}
+
+/**
+  * @brief  Heap state returned by mallinfo(): arena bytes taken from
+  *         _sbrk(), used of them allocated.
+  */
+void Sim_HeapSet(uint32_t arena, uint32_t used)
+{
+  sim_heap_arena = arena;
+  sim_heap_used = used;
+}
+
+struct mallinfo mallinfo(void)
+{
+  struct mallinfo mi = {0};
+
+  mi.arena = sim_heap_arena;
+  mi.uordblks = sim_heap_used;
+  mi.fordblks = sim_heap_arena - sim_heap_used;
+  return mi;
+}
@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file    sim_mft.c
+  * @brief   Host stand-in for the BlueNRG-1 MFT timers: counter 1 counting
+  *          down on the prescaled system clock, reloaded from CRA on
+  *          underflow, read back from the simulated time.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "sim.h"
+
+/* Private variables ---------------------------------------------------------*/
+MFT_Type sim_mft[2];
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Both timers stopped.
+  */
+void Sim_MftReset(void)
+{
+  memset(sim_mft, 0, sizeof(sim_mft));
+}
+
+/**
+  * @brief  Counter 1 now: start_cnt minus the clocks elapsed, modulo the
+  *         reload period CRA + 1.
+  */
+static uint16_t Sim_MftCounter1(const MFT_Type *mft)
+{
+  uint64_t ticks, period = (uint64_t)mft->cra + 1;
+
+  if (!mft->enabled || mft->clock1 != MFT_PRESCALED_CLK)
+    return mft->start_cnt;
+
+  ticks = (Sim_NowUs() - mft->start_us) * SIM_MFT_CLOCK_MHZ / (mft->prescaler + 1u);
+  ticks %= period;
+  if (ticks <= mft->start_cnt)
+    return (uint16_t)(mft->start_cnt - ticks);
+  return (uint16_t)(mft->start_cnt + period - ticks);
+}
+
+void MFT_StructInit(MFT_InitType* MFT_InitStruct)
+{
+  memset(MFT_InitStruct, 0, sizeof(*MFT_InitStruct));
+}
+
+void MFT_Init(MFT_Type* MFTx, MFT_InitType* MFT_InitStruct)
+{
+  MFTx->start_cnt = Sim_MftCounter1(MFTx);
+  MFTx->start_us = Sim_NowUs();
+  MFTx->clock1 = MFT_InitStruct->MFT_Clock1;
+  MFTx->prescaler = MFT_InitStruct->MFT_Prescaler;
+  MFTx->cra = MFT_InitStruct->MFT_CRA;
+}
+
+void MFT_Cmd(MFT_Type* MFTx, FunctionalState NewState)
+{
+  MFTx->start_cnt = Sim_MftCounter1(MFTx);
+  MFTx->start_us = Sim_NowUs();
+  MFTx->enabled = (NewState == ENABLE);
+}
+
+void MFT_SetCounter1(MFT_Type* MFTx, uint16_t MFT_Cnt1)
+{
+  MFTx->start_cnt = MFT_Cnt1;
+  MFTx->start_us = Sim_NowUs();
+}
+
+uint16_t MFT_GetCounter1(MFT_Type* MFTx)
+{
+  return Sim_MftCounter1(MFTx);
+}
@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * @file    sim_ota_client.c
+  * @brief   OTA client of a phone (ST BLE Sensor app) on the simulated
+  *          connection of sim_stack.c: New Image write, then the image
+  *          packets in sequence, each needs ack packet stopping the stream
+  *          until the Expected Image Sequence Number notification comes.
+  *          The client goes on from the sequence number notified; it gives
+  *          up on a flash error. The characteristics are found by their
+  *          UUIDs (inc/ota_service.h) in the GATT database of the firmware;
+  *          once the last packet is acknowledged the client disconnects.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ota_service.h"
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Phone ATT_MTU and LL payload: recent Android or iOS device */
+#define SIM_OTA_CLIENT_MTU          247
+#define SIM_OTA_CLIENT_LL_OCTETS    251
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t client_uuid_new_image[16] = OTA_SERVICE_UUID_NEW_IMAGE;
+static const uint8_t client_uuid_content[16] = OTA_SERVICE_UUID_CONTENT;
+static const uint8_t client_uuid_expected[16] = OTA_SERVICE_UUID_EXPECTED;
+
+static const uint8_t *client_image;
+static uint32_t client_base;
+static uint8_t  client_ack_every;
+static uint8_t  client_announced;   /* New Image written */
+static uint8_t  client_waiting;     /* Ack requested, not received yet */
+static uint16_t client_next_seq;    /* Next packet to send */
+static uint16_t client_blocks;      /* 16 bytes blocks per packet */
+static uint16_t client_new_image;   /* Value handles found at connection */
+static uint16_t client_content;
+static uint16_t client_expected;
+static uint64_t client_wait_from_us;
+static Sim_OtaClientStats_t client_stats;
+
+static uint16_t Sim_OtaClientNextWrite(uint16_t *handle, uint8_t *value, uint16_t max_len);
+static void Sim_OtaClientNotified(uint16_t handle, const uint8_t *value, uint16_t len);
+
+static Sim_GattClient_t client_gatt = {
+  SIM_OTA_CLIENT_MTU, SIM_OTA_CLIENT_LL_OCTETS, 0, Sim_OtaClientNextWrite, Sim_OtaClientNotified,
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint16_t Sim_OtaClientNextWrite(uint16_t *handle, uint8_t *value, uint16_t max_len)
+{
+  uint32_t offset;
+  uint16_t len, i;
+  uint8_t checksum = 0, needs_ack;
+
+  if (client_stats.start_us == 0) {
+    client_stats.start_us = Sim_NowUs();
+    client_new_image = Sim_StackFindChar(client_uuid_new_image);
+    client_content = Sim_StackFindChar(client_uuid_content);
+    client_expected = Sim_StackFindChar(client_uuid_expected);
+  }
+  if (client_new_image == 0 || client_content == 0 || client_expected == 0)
+    return 0;
+
+  if (!client_announced) {
+    *handle = client_new_image;
+    value[0] = client_ack_every;
+    for (i = 0; i < 4; i++) {
+      value[1 + i] = (uint8_t)(client_stats.size >> (8 * i));
+      value[5 + i] = (uint8_t)(client_base >> (8 * i));
+    }
+    client_announced = 1;
+    client_blocks = (max_len - OTA_SERVICE_PACKET_OVERHEAD) / OTA_SERVICE_BLOCK_SIZE;
+    client_stats.last_seq = (uint16_t)((client_stats.size + client_blocks * OTA_SERVICE_BLOCK_SIZE - 1) /
+                                       (client_blocks * OTA_SERVICE_BLOCK_SIZE) - 1);
+    return OTA_SERVICE_NEW_IMAGE_LEN;
+  }
+  if (client_waiting || client_next_seq > client_stats.last_seq || client_stats.aborted)
+    return 0;
+
+  /* The last packet is padded to whole blocks */
+  offset = (uint32_t)client_next_seq * client_blocks * OTA_SERVICE_BLOCK_SIZE;
+  len = client_blocks * OTA_SERVICE_BLOCK_SIZE;
+  if (offset + len > client_stats.size)
+    len = (uint16_t)((client_stats.size - offset + OTA_SERVICE_BLOCK_SIZE - 1) / OTA_SERVICE_BLOCK_SIZE *
+                     OTA_SERVICE_BLOCK_SIZE);
+  needs_ack = ((client_next_seq + 1) % client_ack_every == 0 || client_next_seq == client_stats.last_seq);
+
+  *handle = client_content;
+  memset(&value[1], 0xFF, len);
+  memcpy(&value[1], &client_image[offset],
+         (offset + len > client_stats.size) ? client_stats.size - offset : len);
+  value[len + 1] = needs_ack;
+  value[len + 2] = (uint8_t)client_next_seq;
+  value[len + 3] = (uint8_t)(client_next_seq >> 8);
+  for (i = 1; i < len + OTA_SERVICE_PACKET_OVERHEAD; i++)
+    checksum ^= value[i];
+  value[0] = checksum;
+
+  client_next_seq++;
+  if (needs_ack) {
+    client_waiting = 1;
+    client_wait_from_us = Sim_NowUs();
+  }
+  return len + OTA_SERVICE_PACKET_OVERHEAD;
+}
+
+static void Sim_OtaClientNotified(uint16_t handle, const uint8_t *value, uint16_t len)
+{
+  uint16_t expected;
+
+  if (handle != client_expected || len != OTA_SERVICE_NOTIFY_LEN)
+    return;
+  expected = value[0] | (uint16_t)(value[1] << 8);
+  if (value[2] != OTA_SERVICE_NO_ERROR)
+    client_stats.errors++;
+  if (client_waiting)
+    client_stats.wait_us += Sim_NowUs() - client_wait_from_us;
+  client_waiting = 0;
+  client_next_seq = expected;
+  if (value[2] == OTA_SERVICE_FLASH_ERROR) {
+    client_stats.aborted = 1;
+    Sim_Stop();
+  } else if (expected > client_stats.last_seq && value[2] == OTA_SERVICE_NO_ERROR) {
+    client_stats.done_us = Sim_NowUs();
+    Sim_StackDisconnect();
+  }
+}
+
+const Sim_GattClient_t *Sim_OtaClientStart(const uint8_t *image, uint32_t size, uint32_t base,
+                                           uint8_t per_event, uint8_t ack_every)
+{
+  client_image = image;
+  client_base = base;
+  client_ack_every = ack_every;
+  client_announced = 0;
+  client_waiting = 0;
+  client_next_seq = 0;
+  client_blocks = 0;
+  client_new_image = 0;
+  client_content = 0;
+  client_expected = 0;
+  memset(&client_stats, 0, sizeof(client_stats));
+  client_stats.size = size;
+  client_gatt.max_per_event = per_event;
+  return &client_gatt;
+}
+
+const Sim_OtaClientStats_t *Sim_OtaClientGetStats(void)
+{
+  return &client_stats;
+}
@@ -0,0 +1,1211 @@
+/**
+  ******************************************************************************
+  * @file    sim_stack.c
+  * @brief   Recording stub of the BlueNRG-1 BLE stack: counts each call of
+  *          the stack API, keeps the advertising payload the application
+  *          set and, while advertising, raises the radio interrupt
+  *          (Blue_Handler()) once per advertising event, at its end. The
+  *          tick after it reports the end of the radio activity with the
+  *          start of the next event, if the application asked for it.
+  *
+  *          The GATT database keeps the characteristics the application
+  *          adds, so that a client finds their handles by UUID
+  *          (Sim_StackFindChar()).
+  *
+  *          A GATT client can also connect (Sim_StackConnect()) at the end
+  *          of a connectable advertising event, which ends the advertising
+  *          until the application starts it again. At each
+  *          connection event it sends its writes without response, each
+  *          one split in LL packets of the negotiated payload (27 bytes
+  *          without data length extension), as long as the event has air
+  *          time left. Received packets wait in the memory blocks of
+  *          BlueNRG_Stack_Initialization() (MEM_BLOCK_SIZE bytes each), the
+  *          blocks of one ATT_MTU packet being kept for notifications, until
+  *          BTLE_StackTick() gives them to the application
+  *          (aci_gatt_attribute_modified_event()). A packet without room is
+  *          NAKed: the client sends it again at the next event. Notifications
+  *          go out in the slave packets of the next event. The tick after
+  *          the connection, or after the end of the link, reports it
+  *          (hci_le_connection_complete_event(),
+  *          hci_disconnection_complete_event()).
+  *
+  *          Commands succeed unless their parameters would be rejected by
+  *          the stack (payload over 31 bytes, command before
+  *          BlueNRG_Stack_Initialization()).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "ble_const.h"
+#include "OTA_btl.h"
+#include "energy.h"
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+/* aci_hal_set_radio_activity_mask() bit and state of the advertising */
+#define SIM_RADIO_MASK_ADV      0x0002
+#define SIM_RADIO_STATE_ADV     0x01
+
+/* Advertising interval unit: 0.625 ms */
+#define SIM_ADV_UNIT_US         625
+
+/* advDelay: random 0-10 ms added to each advertising interval */
+#define SIM_ADV_DELAY_MAX_US    10000
+
+/* LL data packet on air at 1 Mbps: preamble, access address, header and
+   CRC around the payload, 8 us per byte, 150 us between packets */
+#define SIM_LL_OVERHEAD_BYTES   10
+#define SIM_LL_US_PER_BYTE      8
+#define SIM_LL_IFS_US           150
+#define SIM_LL_OCTETS_MIN       27
+#define SIM_LL_OCTETS_DLE       251
+#define SIM_LL_TIME_MIN_US      328
+#define SIM_LL_TIME_DLE_US      2120
+
+/* L2CAP header, and ATT opcode and handle of a write or a notification */
+#define SIM_L2CAP_HEADER        4
+#define SIM_ATT_HEADER          3
+
+/* Largest ATT_MTU of the client */
+#define SIM_ATT_MTU_MAX         247
+
+/* Writes waiting for BTLE_StackTick(), notifications waiting for an event */
+#define SIM_CONN_RX_MAX         64
+#define SIM_CONN_TX_MAX         4
+
+/* Latest start of a connection event after its anchor, the radio
+   interrupt having set it up */
+#define SIM_CONN_LATE_MAX_US    500
+
+/* Handle of the connection */
+#define SIM_CONN_HANDLE         0x0801
+
+/* Handles returned by aci_gap_init() */
+#define SIM_GAP_SERVICE_HANDLE      0x0005
+#define SIM_GAP_DEV_NAME_HANDLE     0x0006
+#define SIM_GAP_APPEARANCE_HANDLE   0x0008
+
+/* First handle of the services of the application, after the GATT and GAP
+   services, and the characteristics they can hold */
+#define SIM_GATT_FIRST_HANDLE       0x000C
+#define SIM_GATT_CHARS_MAX          8
+
+/* Connection complete event: slave role, supervision timeout (10 ms
+   units), and the reason of the end of the link the client gives */
+#define SIM_CONN_ROLE_SLAVE         0x01
+#define SIM_CONN_SUPERVISION        400
+#define SIM_CONN_TERMINATED         0x13
+
+/* Private variables ---------------------------------------------------------*/
+static const char *const stack_api_names[SIM_API_COUNT] = {
+  "BlueNRG_Stack_Initialization",
+  "BTLE_StackTick",
+  "RAL_Isr",
+  "aci_hal_write_config_data",
+  "aci_hal_set_tx_power_level",
+  "aci_hal_set_radio_activity_mask",
+  "aci_gatt_init",
+  "aci_gatt_update_char_value_ext",
+  "aci_gatt_add_service",
+  "aci_gatt_add_char",
+  "aci_gap_init",
+  "aci_gap_set_discoverable",
+  "aci_gap_set_non_discoverable",
+  "aci_gap_delete_ad_type",
+  "aci_gap_update_adv_data",
+  "hci_le_set_advertising_data",
+  "hci_le_set_scan_response_data",
+  "hci_le_set_data_length",
+};
+
+static uint32_t stack_calls[SIM_API_COUNT];
+static uint8_t  stack_ready;
+
+static uint8_t  adv_data[ADV_DATA_MAX_LEN];
+static uint8_t  adv_len;
+static uint8_t  scan_resp_len;
+static uint32_t adv_interval_us;
+static int      adv_event = -1;
+static uint32_t adv_events;
+static uint64_t adv_first_us;
+static uint8_t  adv_tick_pending;
+static uint8_t  adv_connectable;      /* ADV_IND: a client can connect */
+
+/* Radio activity of the next advertising event, ended by adv_event */
+static uint64_t adv_start_us;
+static uint64_t adv_end_us;
+static uint8_t  adv_cpu_overlap;
+static uint16_t radio_mask;
+static uint8_t  radio_reports_on;
+static uint8_t  radio_report_pending;
+static Sim_RadioStats_t radio_stats;
+
+/* Stall injected by Sim_StackStall() */
+static uint64_t tick_stall_at;
+static uint32_t tick_stall_us;
+static uint32_t adv_seed;
+static uint16_t adv_interval_req;     /* Advertising_Interval_Max of the application */
+static uint16_t adv_interval_force;   /* Replaces it when not 0 */
+static void   (*adv_observer)(const uint8_t *data, uint8_t len);
+static uint8_t  tx_high_power;
+static uint8_t  tx_pa_level;
+
+/* GATT database: characteristics of the application */
+typedef struct {
+  uint8_t  uuid[16];
+  uint16_t handle;                    /* Declaration, the value at handle + 1 */
+} Sim_GattChar_t;
+
+static uint16_t gatt_next_handle;
+static uint16_t gatt_service_handle;  /* Last service added */
+static uint16_t gatt_service_end;     /* First handle after its records */
+static Sim_GattChar_t gatt_chars[SIM_GATT_CHARS_MAX];
+static uint8_t  gatt_char_count;
+
+/* Connection */
+typedef struct {
+  uint16_t handle;
+  uint16_t len;
+  uint8_t  value[SIM_ATT_MTU_MAX - SIM_ATT_HEADER];
+} Sim_AttPdu_t;
+
+static const Sim_GattClient_t *conn_client;
+static int      conn_event = -1;
+static uint64_t conn_anchor;
+static uint32_t conn_interval_us;
+static uint16_t conn_server_mtu;
+static uint16_t conn_mblocks;
+static int16_t  conn_opt_force;       /* Sim_StackForceOptMblocks(), -1 if not set */
+static int16_t  conn_opt_mblocks;     /* Memory blocks over MBLOCKS_CALC() of the firmware */
+static uint8_t  conn_dle;
+static uint8_t  conn_ll_request;      /* hci_le_set_data_length(): procedure in the next event */
+static uint8_t  conn_connecting;      /* Sim_StackConnect() waiting for a connectable event */
+static uint8_t  conn_terminate;       /* Sim_StackDisconnect(): link down after the event */
+static uint8_t  conn_up_report;       /* Events for the next tick */
+static uint8_t  conn_down_report;
+static Sim_ConnStats_t conn_stats;
+static Sim_AttPdu_t conn_rx[SIM_CONN_RX_MAX];
+static uint8_t  conn_rx_head;
+static uint8_t  conn_rx_count;
+static uint16_t conn_rx_used;         /* Memory blocks of the waiting writes */
+static Sim_AttPdu_t conn_tx[SIM_CONN_TX_MAX];
+static uint8_t  conn_tx_head;
+static uint8_t  conn_tx_count;
+static Sim_AttPdu_t conn_pending;     /* Write of the client not yet received */
+static uint8_t  conn_pending_valid;
+
+/* Radio configuration table of system_bluenrg1.c, referenced by Beacon_config.h */
+uint8_t hot_table_radio_config[4];
+
+void Blue_Handler(void);
+static void Sim_StackAdvEvent(void *arg);
+static void Sim_StackEstablish(void);
+
+/* Stack defaults of the event callbacks, which the application overrides */
+__attribute__((weak)) void aci_hal_end_of_radio_activity_event(uint8_t Last_State, uint8_t Next_State,
+                                                               uint32_t Next_State_SysTime)
+{
+  (void)Last_State;
+  (void)Next_State;
+  (void)Next_State_SysTime;
+}
+
+__attribute__((weak)) void aci_gatt_attribute_modified_event(uint16_t Connection_Handle,
+                                                             uint16_t Attr_Handle, uint16_t Offset,
+                                                             uint16_t Attr_Data_Length,
+                                                             uint8_t Attr_Data[])
+{
+  (void)Connection_Handle;
+  (void)Attr_Handle;
+  (void)Offset;
+  (void)Attr_Data_Length;
+  (void)Attr_Data;
+}
+
+__attribute__((weak)) void hci_le_connection_complete_event(uint8_t Status, uint16_t Connection_Handle,
+                                                            uint8_t Role, uint8_t Peer_Address_Type,
+                                                            uint8_t Peer_Address[6], uint16_t Conn_Interval,
+                                                            uint16_t Conn_Latency, uint16_t Supervision_Timeout,
+                                                            uint8_t Master_Clock_Accuracy)
+{
+  (void)Status;
+  (void)Connection_Handle;
+  (void)Role;
+  (void)Peer_Address_Type;
+  (void)Peer_Address;
+  (void)Conn_Interval;
+  (void)Conn_Latency;
+  (void)Supervision_Timeout;
+  (void)Master_Clock_Accuracy;
+}
+
+__attribute__((weak)) void hci_disconnection_complete_event(uint8_t Status, uint16_t Connection_Handle,
+                                                            uint8_t Reason)
+{
+  (void)Status;
+  (void)Connection_Handle;
+  (void)Reason;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Count a call and charge its CPU time.
+  */
+static void Sim_StackRecord(Sim_StackApi api, uint32_t cost_us)
+{
+  stack_calls[api]++;
+  Sim_Consume(cost_us);
+}
+
+/**
+  * @brief  advDelay of the next event, from a fixed seed so that runs are
+  *         reproducible.
+  */
+static uint32_t Sim_StackAdvDelay(void)
+{
+  adv_seed = adv_seed * 1103515245UL + 12345UL;
+  return (adv_seed >> 16) % (SIM_ADV_DELAY_MAX_US + 1);
+}
+
+/**
+  * @brief  Radio activity of an advertising event with the payload set now:
+  *         crystal startup, then each channel, as energy.c charges it.
+  */
+static uint32_t Sim_StackAdvEventUs(void)
+{
+  return (uint32_t)(ENERGY_XO_STARTUP_US +
+                    ENERGY_ADV_CHANNELS * (ENERGY_TX_RAMP_US +
+                                           (ENERGY_PDU_OVERHEAD_BYTES + adv_len) * ENERGY_US_PER_BYTE) +
+                    (ENERGY_ADV_CHANNELS - 1) * ENERGY_CHANNEL_GAP_US);
+}
+
+/**
+  * @brief  Schedule the next advertising event to end at end_us.
+  */
+static void Sim_StackAdvNext(uint64_t end_us)
+{
+  uint32_t len = Sim_StackAdvEventUs();
+
+  adv_end_us = end_us;
+  adv_start_us = (end_us > Sim_NowUs() + len) ? end_us - len : Sim_NowUs();
+  adv_cpu_overlap = 0;
+  adv_event = Sim_Schedule(end_us, SIM_SRC_RADIO, Sim_StackAdvEvent, NULL);
+}
+
+/**
+  * @brief  End of an advertising event: its radio interrupt.
+  */
+static void Sim_StackAdvEvent(void *arg)
+{
+  uint32_t late = (uint32_t)(Sim_NowUs() - adv_end_us);
+
+  (void)arg;
+
+  if (adv_events++ == 0)
+    adv_first_us = Sim_NowUs();
+  radio_stats.events++;
+  radio_stats.radio_us += adv_end_us - adv_start_us;
+  if (adv_cpu_overlap)
+    radio_stats.peak_windows++;
+  if (late > radio_stats.isr_late_max_us)
+    radio_stats.isr_late_max_us = late;
+
+  adv_tick_pending = 1;
+  radio_report_pending = 1;
+  if (adv_observer != NULL)
+    adv_observer(adv_data, adv_len);
+  if (conn_connecting && adv_connectable) {
+    /* CONNECT_IND of the client: advertising over */
+    adv_event = -1;
+    Sim_StackEstablish();
+  } else {
+    Sim_StackAdvNext(Sim_NowUs() + adv_interval_us + Sim_StackAdvDelay());
+  }
+  Blue_Handler();
+}
+
+static void Sim_StackAdvStop(void)
+{
+  Sim_Cancel(adv_event);
+  adv_event = -1;
+}
+
+/**
+  * @brief  Remove the AD structures of type ad_type from the payload.
+  * @retval Number of structures removed
+  */
+static uint8_t Sim_StackAdRemove(uint8_t ad_type)
+{
+  uint8_t i = 0, removed = 0;
+  uint8_t size;
+
+  while (i < adv_len) {
+    size = adv_data[i] + 1;
+    if (i + size > adv_len)
+      break;
+    if (adv_data[i] != 0 && adv_data[i + 1] == ad_type) {
+      memmove(&adv_data[i], &adv_data[i + size], adv_len - i - size);
+      adv_len -= size;
+      removed++;
+    } else {
+      i += size;
+    }
+  }
+  return removed;
+}
+
+/**
+  * @brief  Air time of an LL packet carrying payload bytes.
+  */
+static uint32_t Sim_StackAirUs(uint16_t payload)
+{
+  return (uint32_t)(payload + SIM_LL_OVERHEAD_BYTES) * SIM_LL_US_PER_BYTE;
+}
+
+/**
+  * @brief  Memory blocks taken by an ATT PDU of len bytes.
+  */
+static uint16_t Sim_StackBlocks(uint16_t len)
+{
+  return DIV_CEIL(SIM_L2CAP_HEADER + len, MEM_BLOCK_SIZE);
+}
+
+/**
+  * @brief  LL packets of an ATT PDU of len bytes.
+  */
+static uint16_t Sim_StackFragments(uint16_t len)
+{
+  return DIV_CEIL(SIM_L2CAP_HEADER + len, conn_stats.ll_octets);
+}
+
+/**
+  * @brief  Air time of the exchanges sending an ATT PDU of len bytes, the
+  *         slave answering with empty packets.
+  */
+static uint32_t Sim_StackPduAirUs(uint16_t len)
+{
+  uint16_t frags = Sim_StackFragments(len);
+
+  return (uint32_t)(SIM_L2CAP_HEADER + len) * SIM_LL_US_PER_BYTE +
+         frags * (Sim_StackAirUs(0) + 2 * SIM_LL_IFS_US + Sim_StackAirUs(0));
+}
+
+/**
+  * @brief  Slave packet of an exchange: the next notification, if any, to
+  *         the client. A notification fits in one LL packet.
+  * @retval Air time over the one of an empty packet
+  */
+static uint32_t Sim_StackNotify(void)
+{
+  Sim_AttPdu_t *pdu;
+  uint32_t air;
+
+  if (conn_tx_count == 0)
+    return 0;
+
+  pdu = &conn_tx[conn_tx_head];
+  conn_tx_head = (conn_tx_head + 1) % SIM_CONN_TX_MAX;
+  conn_tx_count--;
+  air = Sim_StackAirUs(SIM_L2CAP_HEADER + SIM_ATT_HEADER + pdu->len) - Sim_StackAirUs(0);
+  conn_stats.notifications++;
+  conn_stats.notify_air_us += air;
+  if (conn_client->notified != NULL)
+    conn_client->notified(pdu->handle, pdu->value, pdu->len);
+  return air;
+}
+
+/**
+  * @brief  Connection event: writes of the client while the event has air
+  *         time and the client has some ready, the first one without room
+  *         in the memory blocks NAKed, which closes the event. Slave packets
+  *         carry the waiting notifications. Then the radio interrupt.
+  */
+static void Sim_StackConnEvent(void *arg)
+{
+  uint32_t budget = conn_interval_us - SIM_LL_IFS_US;
+  uint32_t used = 0, air;
+  uint16_t len, blocks, frag;
+  uint8_t sent = 0;
+
+  (void)arg;
+
+  /* Radio interrupt held past the anchor (flash operation): the events
+     until now are missed */
+  if (Sim_NowUs() > conn_anchor + SIM_CONN_LATE_MAX_US) {
+    while (conn_anchor + SIM_CONN_LATE_MAX_US < Sim_NowUs()) {
+      conn_anchor += conn_interval_us;
+      conn_stats.missed_events++;
+    }
+    conn_event = Sim_Schedule(conn_anchor, SIM_SRC_RADIO, Sim_StackConnEvent, NULL);
+    return;
+  }
+  conn_anchor += conn_interval_us;
+  conn_event = Sim_Schedule(conn_anchor, SIM_SRC_RADIO, Sim_StackConnEvent, NULL);
+  conn_stats.events++;
+
+  while (sent < conn_client->max_per_event) {
+    if (!conn_pending_valid) {
+      conn_pending.len = conn_client->next_write(&conn_pending.handle, conn_pending.value,
+                                                 conn_stats.att_mtu - SIM_ATT_HEADER);
+      if (conn_pending.len == 0)
+        break;
+      conn_pending_valid = 1;
+    }
+    len = SIM_ATT_HEADER + conn_pending.len;
+    air = Sim_StackPduAirUs(len);
+    if (used + air > budget)
+      break;
+
+    blocks = Sim_StackBlocks(len);
+    if (conn_rx_used + blocks > conn_stats.rx_blocks || conn_rx_count == SIM_CONN_RX_MAX) {
+      /* First fragment NAKed */
+      conn_stats.packets++;
+      conn_stats.naks++;
+      frag = (SIM_L2CAP_HEADER + len < conn_stats.ll_octets) ? SIM_L2CAP_HEADER + len
+                                                             : conn_stats.ll_octets;
+      used += Sim_StackAirUs(frag) + 2 * SIM_LL_IFS_US + Sim_StackAirUs(0) + Sim_StackNotify();
+      break;
+    }
+    conn_stats.packets += Sim_StackFragments(len);
+    used += air + Sim_StackNotify();
+    conn_rx[(conn_rx_head + conn_rx_count) % SIM_CONN_RX_MAX] = conn_pending;
+    conn_rx_count++;
+    conn_rx_used += blocks;
+    conn_pending_valid = 0;
+    sent++;
+  }
+
+  /* An empty exchange if the client sent nothing, then the notifications
+     left */
+  if (used == 0)
+    used = 2 * (Sim_StackAirUs(0) + SIM_LL_IFS_US) + Sim_StackNotify();
+  while (conn_tx_count != 0 && used < budget)
+    used += 2 * (Sim_StackAirUs(0) + SIM_LL_IFS_US) + Sim_StackNotify();
+  conn_stats.air_us += used;
+
+  /* LL_LENGTH_REQ and LL_LENGTH_RSP exchanged in this event: the client
+     sends its longer packets from the next one */
+  if (conn_ll_request) {
+    conn_ll_request = 0;
+    conn_stats.ll_octets = (conn_client->ll_octets > SIM_LL_OCTETS_DLE) ? SIM_LL_OCTETS_DLE
+                                                                        : conn_client->ll_octets;
+    if (conn_stats.ll_octets < SIM_LL_OCTETS_MIN)
+      conn_stats.ll_octets = SIM_LL_OCTETS_MIN;
+  }
+
+  /* LL_TERMINATE_IND of the client: no event after this one */
+  if (conn_terminate) {
+    Sim_Cancel(conn_event);
+    conn_event = -1;
+    conn_terminate = 0;
+    conn_tx_count = 0;
+    conn_pending_valid = 0;
+    conn_down_report = 1;
+  }
+
+  /* The stack tick after the event costs as much as after advertising */
+  adv_tick_pending = 1;
+  Blue_Handler();
+}
+
+/**
+  * @brief  Writes received since the last tick, to the application.
+  */
+static void Sim_StackDeliver(void)
+{
+  Sim_AttPdu_t pdu;
+
+  while (conn_rx_count != 0) {
+    pdu = conn_rx[conn_rx_head];
+    conn_rx_head = (conn_rx_head + 1) % SIM_CONN_RX_MAX;
+    conn_rx_count--;
+    conn_rx_used -= Sim_StackBlocks(SIM_ATT_HEADER + pdu.len);
+    conn_stats.writes++;
+    Sim_Consume(SIM_COST_GATT_EVENT_US);
+    aci_gatt_attribute_modified_event(SIM_CONN_HANDLE, pdu.handle, 0, pdu.len, pdu.value);
+  }
+}
+
+/**
+  * @brief  Back to reset state: stack not initialized, not advertising.
+  */
+void Sim_StackReset(void)
+{
+  memset(stack_calls, 0, sizeof(stack_calls));
+  stack_ready = 0;
+  adv_len = 0;
+  scan_resp_len = 0;
+  adv_interval_us = 0;
+  adv_event = -1;
+  adv_events = 0;
+  adv_first_us = 0;
+  adv_tick_pending = 0;
+  adv_start_us = 0;
+  adv_end_us = 0;
+  adv_cpu_overlap = 0;
+  radio_mask = 0;
+  radio_reports_on = 1;
+  radio_report_pending = 0;
+  memset(&radio_stats, 0, sizeof(radio_stats));
+  tick_stall_at = UINT64_MAX;
+  tick_stall_us = 0;
+  adv_seed = 1;
+  adv_interval_req = 0;
+  adv_interval_force = 0;
+  adv_observer = NULL;
+  tx_high_power = 0;
+  tx_pa_level = 0;
+  adv_connectable = 0;
+  gatt_next_handle = SIM_GATT_FIRST_HANDLE;
+  gatt_service_handle = 0;
+  gatt_service_end = 0;
+  gatt_char_count = 0;
+  conn_client = NULL;
+  conn_event = -1;
+  conn_server_mtu = DEFAULT_ATT_MTU;
+  conn_mblocks = 0;
+  conn_opt_force = -1;
+  conn_opt_mblocks = 0;
+  conn_dle = 0;
+  conn_connecting = 0;
+  conn_terminate = 0;
+  conn_up_report = 0;
+  conn_down_report = 0;
+  memset(&conn_stats, 0, sizeof(conn_stats));
+  conn_rx_head = 0;
+  conn_rx_count = 0;
+  conn_rx_used = 0;
+  conn_tx_head = 0;
+  conn_tx_count = 0;
+  conn_pending_valid = 0;
+}
+
+uint32_t Sim_StackCalls(Sim_StackApi api)
+{
+  return (api < SIM_API_COUNT) ? stack_calls[api] : 0;
+}
+
+uint32_t Sim_StackCallsTotal(void)
+{
+  uint32_t total = 0;
+  uint8_t i;
+
+  for (i = 0; i < SIM_API_COUNT; i++)
+    total += stack_calls[i];
+  return total;
+}
+
+/**
+  * @brief  Advertising events (radio interrupts) since the reset.
+  */
+uint32_t Sim_StackAdvEvents(void)
+{
+  return adv_events;
+}
+
+/**
+  * @brief  Time of the first advertising event since the reset, 0 if none.
+  */
+uint64_t Sim_StackFirstAdvUs(void)
+{
+  return adv_first_us;
+}
+
+/**
+  * @brief  Non zero while the radio has scheduled work: the sleep timer
+  *         must keep running.
+  */
+uint8_t Sim_StackRadioActive(void)
+{
+  return adv_event >= 0 || conn_event >= 0;
+}
+
+/**
+  * @brief  Report the end of the radio activity (default) or keep it back.
+  *         Set before the run.
+  */
+void Sim_StackRadioReports(uint8_t enable)
+{
+  radio_reports_on = enable;
+}
+
+const Sim_RadioStats_t *Sim_StackRadioStats(void)
+{
+  return &radio_stats;
+}
+
+/**
+  * @brief  CPU running from from_us to to_us: the part inside the radio
+  *         activity of the next advertising event, where both draw current.
+  */
+void Sim_StackCpuActive(uint64_t from_us, uint64_t to_us)
+{
+  if (adv_event < 0 || to_us <= adv_start_us || from_us >= adv_end_us)
+    return;
+  if (from_us < adv_start_us)
+    from_us = adv_start_us;
+  if (to_us > adv_end_us)
+    to_us = adv_end_us;
+  radio_stats.overlap_us += to_us - from_us;
+  adv_cpu_overlap = 1;
+}
+
+/**
+  * @brief  Advertise every interval units of 0.625 ms whatever the
+  *         application asks for, 0 to follow the application. Set before
+  *         the run, for the sweeps of energy_bench.
+  */
+void Sim_StackForceAdvInterval(uint16_t interval)
+{
+  adv_interval_force = interval;
+}
+
+/**
+  * @brief  Advertising interval the application asked for, 0.625 ms units.
+  */
+uint16_t Sim_StackAdvIntervalRequested(void)
+{
+  return adv_interval_req;
+}
+
+/**
+  * @brief  Advertising interval in use, in us (0 when not advertising).
+  */
+uint32_t Sim_StackAdvIntervalUs(void)
+{
+  return Sim_StackRadioActive() ? adv_interval_us : 0;
+}
+
+/**
+  * @brief  Last aci_hal_set_tx_power_level() parameters.
+  */
+void Sim_StackTxPower(uint8_t *high_power, uint8_t *pa_level)
+{
+  *high_power = tx_high_power;
+  *pa_level = tx_pa_level;
+}
+
+/**
+  * @brief  Called on each advertising event with the payload on air, before
+  *         the radio interrupt. NULL to remove it.
+  */
+void Sim_StackSetAdvObserver(void (*observer)(const uint8_t *data, uint8_t len))
+{
+  adv_observer = observer;
+}
+
+/**
+  * @brief  Advertising payload as last set by the application.
+  */
+const uint8_t *Sim_StackAdvData(uint8_t *len)
+{
+  *len = adv_len;
+  return adv_data;
+}
+
+/**
+  * @brief  Queues of the link emptied.
+  */
+static void Sim_StackConnClear(void)
+{
+  Sim_Cancel(conn_event);
+  conn_event = -1;
+  conn_terminate = 0;
+  conn_ll_request = 0;
+  conn_rx_head = 0;
+  conn_rx_count = 0;
+  conn_rx_used = 0;
+  conn_tx_head = 0;
+  conn_tx_count = 0;
+  conn_pending_valid = 0;
+}
+
+/**
+  * @brief  Link up, first connection event one interval from now. The
+  *         ATT_MTU is the smaller of the client's and the one of
+  *         BlueNRG_Stack_Initialization(); the LL payload is 27 bytes until
+  *         hci_le_set_data_length().
+  */
+static void Sim_StackEstablish(void)
+{
+  uint16_t tx_blocks;
+
+  conn_connecting = 0;
+  Sim_StackConnClear();
+  memset(&conn_stats, 0, sizeof(conn_stats));
+  conn_stats.att_mtu = (conn_client->att_mtu < conn_server_mtu) ? conn_client->att_mtu : conn_server_mtu;
+  conn_stats.ll_octets = SIM_LL_OCTETS_MIN;
+  tx_blocks = Sim_StackBlocks(conn_stats.att_mtu) + 1;
+  conn_stats.rx_blocks = (conn_mblocks > tx_blocks) ? conn_mblocks - tx_blocks : 0;
+
+  conn_anchor = Sim_NowUs();
+  conn_event = Sim_Schedule(conn_anchor + conn_interval_us, SIM_SRC_RADIO, Sim_StackConnEvent, NULL);
+  conn_up_report = 1;
+}
+
+/**
+  * @brief  A GATT client connects at the end of the next connectable
+  *         advertising event, the first connection event one interval
+  *         later.
+  */
+void Sim_StackConnect(uint32_t interval_us, uint8_t dle, const Sim_GattClient_t *client)
+{
+  Sim_StackConnClear();
+  conn_client = client;
+  conn_interval_us = interval_us;
+  conn_dle = dle;
+  conn_connecting = 1;
+}
+
+/**
+  * @brief  The client ends the link at the end of the current connection
+  *         event, or of the next one; a connection not made yet is given
+  *         up. Writes received before are still given to the application.
+  */
+void Sim_StackDisconnect(void)
+{
+  conn_connecting = 0;
+  if (conn_event >= 0)
+    conn_terminate = 1;
+}
+
+/**
+  * @brief  Non zero while the link is up.
+  */
+uint8_t Sim_StackConnected(void)
+{
+  return conn_event >= 0;
+}
+
+void Sim_StackForceOptMblocks(int16_t opt)
+{
+  conn_opt_force = opt;
+}
+
+/**
+  * @brief  OPT_MBLOCKS of the firmware, as given to
+  *         BlueNRG_Stack_Initialization() before Sim_StackForceOptMblocks().
+  */
+int16_t Sim_StackOptMblocks(void)
+{
+  return conn_opt_mblocks;
+}
+
+/**
+  * @brief  Value handle of a characteristic added by the application.
+  */
+uint16_t Sim_StackFindChar(const uint8_t uuid[16])
+{
+  uint8_t i;
+
+  for (i = 0; i < gatt_char_count; i++) {
+    if (memcmp(gatt_chars[i].uuid, uuid, sizeof(gatt_chars[i].uuid)) == 0)
+      return gatt_chars[i].handle + 1;
+  }
+  return 0;
+}
+
+const Sim_ConnStats_t *Sim_StackConnStats(void)
+{
+  return &conn_stats;
+}
+
+/**
+  * @brief  Print the calls of each API and the advertising state.
+  */
+void Sim_StackReport(FILE *out)
+{
+  uint8_t i;
+
+  for (i = 0; i < SIM_API_COUNT; i++) {
+    if (stack_calls[i] != 0)
+      fprintf(out, "  %-31s: %u\n", stack_api_names[i], (unsigned)stack_calls[i]);
+  }
+  fprintf(out, "advertising events   : %u, interval %.3f ms\n", (unsigned)adv_events,
+          (double)adv_interval_us / 1000.0);
+  fprintf(out, "advertising data     : %u bytes:", (unsigned)adv_len);
+  for (i = 0; i < adv_len; i++)
+    fprintf(out, " %02X", adv_data[i]);
+  fprintf(out, "\n");
+  fprintf(out, "scan response data   : %u bytes\n", (unsigned)scan_resp_len);
+}
+
+/******************************************************************************/
+/*                                 Stack                                      */
+/******************************************************************************/
+
+tBleStatus BlueNRG_Stack_Initialization(const BlueNRG_Stack_Initialization_t *BlueNRG_Stack_Init_params_p)
+{
+  const BlueNRG_Stack_Initialization_t *p = BlueNRG_Stack_Init_params_p;
+
+  Sim_StackRecord(SIM_API_STACK_INIT, SIM_COST_STACK_INIT_US);
+  if (p == NULL || p->bleStartRamAddress == NULL || p->total_buffer_size == 0 ||
+      p->numOfLinks == 0)
+    return BLE_STATUS_INVALID_PARAMS;
+
+  conn_server_mtu = p->attMtu;
+  conn_opt_mblocks = (int16_t)(p->mblockCount - MBLOCKS_CALC(p->prWriteListSize, p->attMtu, p->numOfLinks));
+  conn_mblocks = p->mblockCount;
+  if (conn_opt_force >= 0)
+    conn_mblocks = (uint16_t)(MBLOCKS_CALC(p->prWriteListSize, p->attMtu, p->numOfLinks) + conn_opt_force);
+  stack_ready = 1;
+  return BLE_STATUS_SUCCESS;
+}
+
+void BTLE_StackTick(void)
+{
+  uint8_t adv = adv_tick_pending;
+  uint8_t report = radio_report_pending;
+
+  /* The first tick after an advertising event completes it; an event
+     ending during this tick is completed by the next one */
+  adv_tick_pending = 0;
+  radio_report_pending = 0;
+  Sim_StackRecord(SIM_API_STACK_TICK, adv ? SIM_COST_ADV_TICK_US : SIM_COST_STACK_TICK_US);
+
+  /* End of the last advertising event, and start of the next one */
+  if (report && radio_reports_on && (radio_mask & SIM_RADIO_MASK_ADV) && adv_event >= 0) {
+    radio_stats.reports++;
+    Sim_Consume(SIM_COST_RADIO_EVENT_US);
+    aci_hal_end_of_radio_activity_event(SIM_RADIO_STATE_ADV, SIM_RADIO_STATE_ADV,
+                                        Sim_SysT32At(adv_start_us));
+  }
+  if (conn_up_report) {
+    uint8_t peer[6] = {0};
+
+    conn_up_report = 0;
+    hci_le_connection_complete_event(BLE_STATUS_SUCCESS, SIM_CONN_HANDLE, SIM_CONN_ROLE_SLAVE, PUBLIC_ADDR,
+                                     peer, (uint16_t)(conn_interval_us / 1250), 0, SIM_CONN_SUPERVISION,
+                                     MASTER_SCA_500ppm);
+  }
+  Sim_StackDeliver();
+  if (conn_down_report) {
+    conn_down_report = 0;
+    hci_disconnection_complete_event(BLE_STATUS_SUCCESS, SIM_CONN_HANDLE, SIM_CONN_TERMINATED);
+  }
+
+  if (Sim_NowUs() >= tick_stall_at) {
+    tick_stall_at = UINT64_MAX;
+    Sim_Consume(tick_stall_us);
+  }
+}
+
+/**
+  * @brief  The first BTLE_StackTick() at or after at_us keeps the CPU busy
+  *         stall_us longer, as a stack stuck in its event processing would.
+  */
+void Sim_StackStall(uint64_t at_us, uint32_t stall_us)
+{
+  tick_stall_at = at_us;
+  tick_stall_us = stall_us;
+}
+
+void RAL_Isr(void)
+{
+  Sim_StackRecord(SIM_API_RAL_ISR, SIM_COST_RAL_ISR_US);
+}
+
+/******************************************************************************/
+/*                                 ACI HAL                                    */
+/******************************************************************************/
+
+tBleStatus aci_hal_write_config_data(uint8_t Offset, uint8_t Length, uint8_t Value[])
+{
+  /* Value may point to the device information page: never read it */
+  (void)Offset;
+  (void)Value;
+
+  Sim_StackRecord(SIM_API_HAL_WRITE_CONFIG, SIM_COST_STACK_CMD_US);
+  if (!stack_ready)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+  return (Length == 0) ? BLE_STATUS_INVALID_PARAMS : BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_hal_set_tx_power_level(uint8_t En_High_Power, uint8_t PA_Level)
+{
+  Sim_StackRecord(SIM_API_HAL_TX_POWER, SIM_COST_STACK_CMD_US);
+  if (!stack_ready)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+  if (En_High_Power > 1 || PA_Level > 7)
+    return BLE_STATUS_INVALID_PARAMS;
+
+  tx_high_power = En_High_Power;
+  tx_pa_level = PA_Level;
+  return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_hal_set_radio_activity_mask(uint16_t Radio_Activity_Mask)
+{
+  Sim_StackRecord(SIM_API_HAL_RADIO_MASK, SIM_COST_STACK_CMD_US);
+  if (!stack_ready)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+
+  radio_mask = Radio_Activity_Mask;
+  return BLE_STATUS_SUCCESS;
+}
+
+/******************************************************************************/
+/*                                 ACI GATT/GAP                               */
+/******************************************************************************/
+
+tBleStatus aci_gatt_init(void)
+{
+  Sim_StackRecord(SIM_API_GATT_INIT, SIM_COST_STACK_CMD_US);
+  return stack_ready ? BLE_STATUS_SUCCESS : BLE_STATUS_COMMAND_DISALLOWED;
+}
+
+/**
+  * @brief  Service of Max_Attribute_Records records, its declaration
+  *         included, after the last one.
+  */
+tBleStatus aci_gatt_add_service(uint8_t Service_UUID_Type, Service_UUID_t *Service_UUID, uint8_t Service_Type,
+                                uint8_t Max_Attribute_Records, uint16_t *Service_Handle)
+{
+  (void)Service_UUID;
+
+  Sim_StackRecord(SIM_API_GATT_ADD_SERVICE, SIM_COST_STACK_CMD_US);
+  if (!stack_ready)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+  if ((Service_UUID_Type != UUID_TYPE_16 && Service_UUID_Type != UUID_TYPE_128) ||
+      (Service_Type != PRIMARY_SERVICE && Service_Type != SECONDARY_SERVICE) || Max_Attribute_Records == 0)
+    return BLE_STATUS_INVALID_PARAMS;
+
+  gatt_service_handle = (gatt_service_end != 0) ? gatt_service_end : gatt_next_handle;
+  gatt_service_end = gatt_service_handle + Max_Attribute_Records;
+  gatt_next_handle = gatt_service_handle + 1;
+  *Service_Handle = gatt_service_handle;
+  return BLE_STATUS_SUCCESS;
+}
+
+/**
+  * @brief  Characteristic in the last service: declaration, value and the
+  *         client configuration if it notifies or indicates.
+  */
+tBleStatus aci_gatt_add_char(uint16_t Service_Handle, uint8_t Char_UUID_Type, Char_UUID_t *Char_UUID,
+                             uint16_t Char_Value_Length, uint8_t Char_Properties, uint8_t Security_Permissions,
+                             uint8_t GATT_Evt_Mask, uint8_t Enc_Key_Size, uint8_t Is_Variable,
+                             uint16_t *Char_Handle)
+{
+  uint16_t records = (Char_Properties & (CHAR_PROP_NOTIFY | CHAR_PROP_INDICATE)) ? 3 : 2;
+  Sim_GattChar_t *c;
+
+  (void)Security_Permissions;
+  (void)GATT_Evt_Mask;
+  (void)Enc_Key_Size;
+  (void)Is_Variable;
+
+  Sim_StackRecord(SIM_API_GATT_ADD_CHAR, SIM_COST_STACK_CMD_US);
+  if (!stack_ready)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+  if (Service_Handle != gatt_service_handle || Service_Handle == 0 ||
+      (Char_UUID_Type != UUID_TYPE_16 && Char_UUID_Type != UUID_TYPE_128) || Char_Value_Length == 0)
+    return BLE_STATUS_INVALID_PARAMS;
+  if (gatt_next_handle + records > gatt_service_end || gatt_char_count == SIM_GATT_CHARS_MAX)
+    return BLE_STATUS_INSUFFICIENT_RESOURCES;
+
+  c = &gatt_chars[gatt_char_count++];
+  memset(c->uuid, 0, sizeof(c->uuid));
+  if (Char_UUID_Type == UUID_TYPE_128)
+    memcpy(c->uuid, Char_UUID->Char_UUID_128, sizeof(c->uuid));
+  else
+    memcpy(c->uuid, &Char_UUID->Char_UUID_16, sizeof(Char_UUID->Char_UUID_16));
+  c->handle = gatt_next_handle;
+  gatt_next_handle += records;
+  *Char_Handle = c->handle;
+  return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gatt_update_char_value_ext(uint16_t Conn_Handle_To_Notify, uint16_t Service_Handle,
+                                          uint16_t Char_Handle, uint8_t Update_Type,
+                                          uint16_t Char_Length, uint16_t Value_Offset,
+                                          uint8_t Value_Length, uint8_t Value[])
+{
+  Sim_AttPdu_t *pdu;
+
+  (void)Service_Handle;
+
+  Sim_StackRecord(SIM_API_GATT_UPDATE_CHAR, SIM_COST_STACK_CMD_US);
+  if (!stack_ready)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+  if (Value_Offset + Value_Length > Char_Length)
+    return BLE_STATUS_INVALID_PARAMS;
+
+  /* Notification to the connected client, in the next connection event */
+  if (conn_event < 0 || Conn_Handle_To_Notify != SIM_CONN_HANDLE || !(Update_Type & 0x01))
+    return BLE_STATUS_SUCCESS;
+  if (conn_tx_count == SIM_CONN_TX_MAX || Value_Length > conn_stats.att_mtu - SIM_ATT_HEADER) {
+    conn_stats.notify_refused++;
+    return BLE_STATUS_INSUFFICIENT_RESOURCES;
+  }
+  pdu = &conn_tx[(conn_tx_head + conn_tx_count) % SIM_CONN_TX_MAX];
+  pdu->handle = Char_Handle + 1;
+  pdu->len = Value_Length;
+  memcpy(pdu->value, Value, Value_Length);
+  conn_tx_count++;
+  return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_init(uint8_t Role, uint8_t privacy_enabled, uint8_t device_name_char_len,
+                        uint16_t *Service_Handle, uint16_t *Dev_Name_Char_Handle,
+                        uint16_t *Appearance_Char_Handle)
+{
+  (void)Role;
+  (void)privacy_enabled;
+  (void)device_name_char_len;
+
+  Sim_StackRecord(SIM_API_GAP_INIT, SIM_COST_STACK_CMD_US);
+  if (!stack_ready)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+
+  *Service_Handle = SIM_GAP_SERVICE_HANDLE;
+  *Dev_Name_Char_Handle = SIM_GAP_DEV_NAME_HANDLE;
+  *Appearance_Char_Handle = SIM_GAP_APPEARANCE_HANDLE;
+  return BLE_STATUS_SUCCESS;
+}
+
+/**
+  * @brief  Start advertising: Flags then the local name (whose first byte is
+  *         its AD type), every Advertising_Interval_Max units.
+  */
+tBleStatus aci_gap_set_discoverable(uint8_t Advertising_Type, uint16_t Advertising_Interval_Min,
+                                    uint16_t Advertising_Interval_Max, uint8_t Own_Address_Type,
+                                    uint8_t Advertising_Filter_Policy, uint8_t Local_Name_Length,
+                                    uint8_t Local_Name[], uint8_t Service_Uuid_length,
+                                    uint8_t Service_Uuid_List[], uint16_t Slave_Conn_Interval_Min,
+                                    uint16_t Slave_Conn_Interval_Max)
+{
+  (void)Own_Address_Type;
+  (void)Advertising_Filter_Policy;
+  (void)Service_Uuid_List;
+  (void)Slave_Conn_Interval_Min;
+  (void)Slave_Conn_Interval_Max;
+
+  Sim_StackRecord(SIM_API_GAP_DISCOVERABLE, SIM_COST_STACK_CMD_US);
+  if (!stack_ready)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+  if (Advertising_Interval_Min > Advertising_Interval_Max || Advertising_Interval_Min < 0x20 ||
+      3 + 1 + Local_Name_Length + (Service_Uuid_length ? Service_Uuid_length + 1 : 0) > ADV_DATA_MAX_LEN)
+    return BLE_STATUS_INVALID_PARAMS;
+
+  adv_data[0] = 2;
+  adv_data[1] = AD_TYPE_FLAGS;
+  adv_data[2] = FLAG_BIT_LE_GENERAL_DISCOVERABLE_MODE | FLAG_BIT_BR_EDR_NOT_SUPPORTED;
+  adv_len = 3;
+  if (Local_Name_Length != 0) {
+    adv_data[adv_len++] = Local_Name_Length;
+    memcpy(&adv_data[adv_len], Local_Name, Local_Name_Length);
+    adv_len += Local_Name_Length;
+  }
+
+  Sim_StackAdvStop();
+  adv_connectable = (Advertising_Type == ADV_IND);
+  adv_interval_req = Advertising_Interval_Max;
+  adv_interval_us = (uint32_t)(adv_interval_force ? adv_interval_force : Advertising_Interval_Max) *
+                    SIM_ADV_UNIT_US;
+  Sim_StackAdvNext(Sim_NowUs() + Sim_StackAdvDelay());
+  return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_set_non_discoverable(void)
+{
+  Sim_StackRecord(SIM_API_GAP_NON_DISCOVERABLE, SIM_COST_STACK_CMD_US);
+  if (!stack_ready)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+
+  Sim_StackAdvStop();
+  return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_delete_ad_type(uint8_t ADType)
+{
+  Sim_StackRecord(SIM_API_GAP_DELETE_AD_TYPE, SIM_COST_STACK_CMD_US);
+  if (!stack_ready)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+
+  /* The stack accepts the command even if the AD type is not present */
+  Sim_StackAdRemove(ADType);
+  return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus aci_gap_update_adv_data(uint8_t AdvDataLen, uint8_t AdvData[])
+{
+  Sim_StackRecord(SIM_API_GAP_UPDATE_ADV_DATA, SIM_COST_STACK_CMD_US);
+  if (!stack_ready)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+  if (adv_len + AdvDataLen > ADV_DATA_MAX_LEN)
+    return BLE_STATUS_INVALID_PARAMS;
+
+  memcpy(&adv_data[adv_len], AdvData, AdvDataLen);
+  adv_len += AdvDataLen;
+  return BLE_STATUS_SUCCESS;
+}
+
+/******************************************************************************/
+/*                                 HCI                                        */
+/******************************************************************************/
+
+tBleStatus hci_le_set_advertising_data(uint8_t Advertising_Data_Length, uint8_t Advertising_Data[])
+{
+  Sim_StackRecord(SIM_API_HCI_ADV_DATA, SIM_COST_STACK_CMD_US);
+  if (!stack_ready)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+  if (Advertising_Data_Length > ADV_DATA_MAX_LEN)
+    return BLE_STATUS_INVALID_PARAMS;
+
+  memcpy(adv_data, Advertising_Data, Advertising_Data_Length);
+  adv_len = Advertising_Data_Length;
+  return BLE_STATUS_SUCCESS;
+}
+
+tBleStatus hci_le_set_scan_response_data(uint8_t Scan_Response_Data_Length,
+                                         uint8_t Scan_Response_Data[])
+{
+  (void)Scan_Response_Data;
+
+  Sim_StackRecord(SIM_API_HCI_SCAN_RESP_DATA, SIM_COST_STACK_CMD_US);
+  if (!stack_ready)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+  if (Scan_Response_Data_Length > ADV_DATA_MAX_LEN)
+    return BLE_STATUS_INVALID_PARAMS;
+
+  scan_resp_len = Scan_Response_Data_Length;
+  return BLE_STATUS_SUCCESS;
+}
+
+/**
+  * @brief  Data length update of the link: only with a controller with data
+  *         length extension, the procedure runs in the next connection
+  *         event.
+  */
+tBleStatus hci_le_set_data_length(uint16_t Connection_Handle, uint16_t TxOctets, uint16_t TxTime)
+{
+  Sim_StackRecord(SIM_API_HCI_DATA_LENGTH, SIM_COST_STACK_CMD_US);
+  if (!stack_ready || !conn_dle || conn_event < 0 || Connection_Handle != SIM_CONN_HANDLE)
+    return BLE_STATUS_COMMAND_DISALLOWED;
+  if (TxOctets < SIM_LL_OCTETS_MIN || TxOctets > SIM_LL_OCTETS_DLE ||
+      TxTime < SIM_LL_TIME_MIN_US || TxTime > SIM_LL_TIME_DLE_US)
+    return BLE_STATUS_INVALID_PARAMS;
+
+  conn_ll_request = 1;
+  return BLE_STATUS_SUCCESS;
+}
+
+/******************************************************************************/
+/*                                 OTA                                        */
+/******************************************************************************/
+
+/**
+  * @brief  The jump to the OTA Service Manager leaves the application: end
+  *         of the run.
+  */
+void OTA_Jump_To_Service_Manager_Application(void)
+{
+  fprintf(stderr, "OTA_Jump_To_Service_Manager_Application() at %.3f s\n",
+          (double)Sim_NowUs() / 1e6);
+  Sim_Stop();
+}
@@ -0,0 +1,196 @@
+/**
+  ******************************************************************************
+  * @file    sim_uart.c
+  * @brief   Host stand-in for the TX side of the BlueNRG-1 UART: a 64 byte
+  *          FIFO drained at 115200 baud, the FIFO level interrupt delivered
+  *          to UART_Handler() and the BUSY/TXFF flags.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "BlueNRG1_conf.h"
+#include "SDK_EVAL_Config.h"
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_UART_FIFO_SIZE      64
+
+/* Interrupt entry/exit overhead of UART_Handler() */
+#define SIM_COST_UART_IRQ_US    2
+
+/* UART register access */
+#define SIM_COST_UART_REG_US    1
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t  uart_fifo[SIM_UART_FIFO_SIZE];
+static uint8_t  uart_fifo_head;
+static uint8_t  uart_fifo_count;
+static uint8_t  uart_shifting;        /* A character is in the shift register */
+static uint8_t  uart_tx_level;        /* TX interrupt when the FIFO drains to this level */
+static uint8_t  uart_it_enable;
+static uint8_t  uart_it_pending;
+static uint8_t  uart_nvic_enable;
+static FILE    *uart_out;
+static uint32_t uart_tx_bytes;
+static uint64_t uart_stall_at;        /* The shift register stops from then on */
+
+void UART_Handler(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Move the next character of the FIFO to the shift register.
+  */
+static void Sim_UartShift(void *arg);
+
+static void Sim_UartStart(void)
+{
+  uint8_t c;
+
+  if (Sim_NowUs() >= uart_stall_at) {
+    /* Stuck with a character in the shift register: BUSY for good */
+    uart_shifting = 1;
+    return;
+  }
+  if (uart_fifo_count == 0) {
+    uart_shifting = 0;
+    return;
+  }
+
+  c = uart_fifo[uart_fifo_head];
+  uart_fifo_head = (uart_fifo_head + 1) % SIM_UART_FIFO_SIZE;
+  uart_fifo_count--;
+  uart_shifting = 1;
+  uart_tx_bytes++;
+  if (uart_out != NULL)
+    fputc(c, uart_out);
+  Sim_Schedule(Sim_NowUs() + SIM_COST_UART_CHAR_US, SIM_SRC_PERIPH, Sim_UartShift, NULL);
+
+  /* The level interrupt is raised when the FIFO drains to the threshold */
+  if (uart_fifo_count == uart_tx_level) {
+    uart_it_pending = 1;
+    if (uart_it_enable && uart_nvic_enable) {
+      Sim_Consume(SIM_COST_UART_IRQ_US);
+      UART_Handler();
+    }
+  }
+}
+
+static void Sim_UartShift(void *arg)
+{
+  (void)arg;
+  Sim_UartStart();
+}
+
+/**
+  * @brief  Back to reset state: FIFO empty, interrupt disabled.
+  */
+void Sim_UartReset(void)
+{
+  uart_fifo_head = 0;
+  uart_fifo_count = 0;
+  uart_shifting = 0;
+  uart_tx_level = SIM_UART_FIFO_SIZE / 2;
+  uart_it_enable = 0;
+  uart_it_pending = 0;
+  uart_nvic_enable = 0;
+  uart_out = NULL;
+  uart_tx_bytes = 0;
+  uart_stall_at = UINT64_MAX;
+}
+
+/**
+  * @brief  Write the transmitted characters to out (NULL to discard them).
+  */
+void Sim_UartCapture(FILE *out)
+{
+  uart_out = out;
+}
+
+/**
+  * @brief  Number of characters transmitted since the reset.
+  */
+uint32_t Sim_UartTxBytes(void)
+{
+  return uart_tx_bytes;
+}
+
+/**
+  * @brief  The UART stops transmitting at at_us (lost clock, flow control):
+  *         the FIFO no longer drains and its interrupt never comes.
+  */
+void Sim_UartStall(uint64_t at_us)
+{
+  uart_stall_at = at_us;
+}
+
+void Sim_UartNvicCmd(FunctionalState NewState)
+{
+  uart_nvic_enable = (NewState == ENABLE);
+}
+
+/**
+  * @brief  SDK_EVAL UART setup: the FIFO always runs at 115200 baud 8N1.
+  */
+void SdkEvalComUartInit(uint32_t baudrate)
+{
+  (void)baudrate;
+}
+
+void UART_SendData(uint16_t Data)
+{
+  Sim_Consume(SIM_COST_UART_REG_US);
+  if (uart_fifo_count == SIM_UART_FIFO_SIZE)
+    return;   /* Lost, as on the real FIFO */
+
+  uart_fifo[(uart_fifo_head + uart_fifo_count) % SIM_UART_FIFO_SIZE] = (uint8_t)Data;
+  uart_fifo_count++;
+  if (uart_fifo_count > uart_tx_level)
+    uart_it_pending = 0;
+  if (!uart_shifting)
+    Sim_UartStart();
+}
+
+FlagStatus UART_GetFlagStatus(uint16_t UART_FLAG)
+{
+  Sim_Consume(SIM_COST_UART_REG_US);
+  switch (UART_FLAG) {
+  case UART_FLAG_TXFF:
+    return uart_fifo_count == SIM_UART_FIFO_SIZE ? SET : RESET;
+  case UART_FLAG_TXFE:
+    return uart_fifo_count == 0 ? SET : RESET;
+  case UART_FLAG_BUSY:
+    return (uart_shifting || uart_fifo_count != 0) ? SET : RESET;
+  case UART_FLAG_RXFE:
+    return SET;
+  default:
+    return RESET;
+  }
+}
+
+void UART_ITConfig(uint16_t UART_IT, FunctionalState NewState)
+{
+  if (UART_IT == UART_IT_TX)
+    uart_it_enable = (NewState == ENABLE);
+}
+
+ITStatus UART_GetITStatus(uint16_t UART_IT)
+{
+  if (UART_IT == UART_IT_TX)
+    return (uart_it_pending && uart_it_enable) ? SET : RESET;
+  return RESET;
+}
+
+void UART_ClearITPendingBit(uint16_t UART_IT)
+{
+  if (UART_IT == UART_IT_TX)
+    uart_it_pending = 0;
+}
+
+void UART_TxFifoIrqLevelConfig(uint8_t UART_TxFifo)
+{
+  static const uint8_t levels[] = { 1, 2, 4, 8, 16, 32, 48 };
+
+  if (UART_TxFifo < sizeof(levels))
+    uart_tx_level = levels[UART_TxFifo];
+}
@@ -0,0 +1,175 @@
+/**
+  ******************************************************************************
+  * @file    sim_wdg.c
+  * @brief   Host stand-in for the BlueNRG-1 watchdog: a counter on the 32 kHz
+  *          clock, reloaded by WDG_SetReload(). When it reaches 0 the
+  *          interrupt is raised, delivered to WDG_Handler() as soon as the
+  *          CPU can take it, and the counter reloads; reaching 0 again with
+  *          the interrupt still pending resets the device (WDG_Enable()).
+  *          The counter runs beside the CPU (SIM_SRC_SYSTEM): it expires
+  *          with interrupts masked or inside a stuck interrupt handler.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include "BlueNRG1_conf.h"
+#include "crash.h"
+#include "supervisor.h"
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Reset value of the load register */
+#define SIM_WDG_LOAD_RESET      0xFFFFFFFFUL
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t wdg_load;
+static uint64_t wdg_loaded_at;
+static int      wdg_event = -1;
+static int      wdg_irq_event = -1;
+static uint8_t  wdg_reset_enable;
+static uint8_t  wdg_it_enable;
+static uint8_t  wdg_it_pending;
+static uint8_t  wdg_nvic_enable;
+static uint32_t wdg_reloads;
+static uint32_t wdg_expiries;
+
+/* Exception frame seen by WDG_Handler(): thread mode, no register known */
+static const uint32_t sim_wdg_frame[CRASH_FRAME_SIZE / 4] = { 0, 0, 0, 0, 0, 0, 0, 0x01000000 };
+
+void WDG_Handler(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint64_t Sim_WdgPeriodUs(void)
+{
+  return ((uint64_t)wdg_load + 1) * 1000000 / SUP_WDG_CLOCK_HZ;
+}
+
+static void Sim_WdgExpired(void *arg);
+
+/**
+  * @brief  Count down from the load value, starting now.
+  */
+static void Sim_WdgArm(void)
+{
+  Sim_Cancel(wdg_event);
+  wdg_loaded_at = Sim_NowUs();
+  wdg_event = Sim_Schedule(wdg_loaded_at + Sim_WdgPeriodUs(), SIM_SRC_SYSTEM, Sim_WdgExpired, NULL);
+}
+
+/**
+  * @brief  Interrupt taken, unless cleared in the meantime.
+  */
+static void Sim_WdgIrq(void *arg)
+{
+  (void)arg;
+
+  wdg_irq_event = -1;
+  if (wdg_it_pending && wdg_it_enable && wdg_nvic_enable)
+    WDG_Handler();
+}
+
+static void Sim_WdgExpired(void *arg)
+{
+  (void)arg;
+
+  wdg_event = -1;
+  wdg_expiries++;
+  if (wdg_it_pending && wdg_reset_enable) {
+    fprintf(stderr, "watchdog reset at %.3f s\n", (double)Sim_NowUs() / 1e6);
+    Sim_SetResetReason(RESET_WDG);
+    Sim_Stop();
+  }
+
+  wdg_it_pending = 1;
+  Sim_WdgArm();
+  if (wdg_it_enable && wdg_nvic_enable && wdg_irq_event < 0)
+    wdg_irq_event = Sim_Schedule(Sim_NowUs(), SIM_SRC_PERIPH, Sim_WdgIrq, NULL);
+}
+
+/**
+  * @brief  Reset state: load register at its maximum, counter stopped until
+  *         the first WDG_SetReload(), no reset, no interrupt.
+  */
+void Sim_WdgReset(void)
+{
+  wdg_load = SIM_WDG_LOAD_RESET;
+  wdg_loaded_at = 0;
+  wdg_event = -1;
+  wdg_irq_event = -1;
+  wdg_reset_enable = 0;
+  wdg_it_enable = 0;
+  wdg_it_pending = 0;
+  wdg_nvic_enable = 0;
+  wdg_reloads = 0;
+  wdg_expiries = 0;
+}
+
+void Sim_WdgNvicCmd(FunctionalState NewState)
+{
+  wdg_nvic_enable = (NewState == ENABLE);
+}
+
+/**
+  * @brief  Number of WDG_SetReload() calls since the reset.
+  */
+uint32_t Sim_WdgReloads(void)
+{
+  return wdg_reloads;
+}
+
+/**
+  * @brief  Number of times the counter reached 0 since the reset.
+  */
+uint32_t Sim_WdgExpiries(void)
+{
+  return wdg_expiries;
+}
+
+/**
+  * @brief  Watchdog interrupt: the interrupted frame is not known on the
+  *         host. The device version, in BlueNRG1_it.c, reads it from the
+  *         stack.
+  */
+void WDG_Handler(void)
+{
+  Sup_WatchdogIrq(sim_wdg_frame, 0xFFFFFFF9UL);
+}
+
+void WDG_SetReload(uint32_t WDG_Reload)
+{
+  wdg_load = WDG_Reload;
+  wdg_reloads++;
+  Sim_WdgArm();
+}
+
+uint32_t WDG_GetCounter(void)
+{
+  uint64_t ticks;
+
+  if (wdg_event < 0)
+    return wdg_load;
+  ticks = (Sim_NowUs() - wdg_loaded_at) * SUP_WDG_CLOCK_HZ / 1000000;
+  return ticks >= wdg_load ? 0 : (uint32_t)(wdg_load - ticks);
+}
+
+void WDG_Enable(void)
+{
+  wdg_reset_enable = 1;
+}
+
+void WDG_ITConfig(FunctionalState NewState)
+{
+  wdg_it_enable = (NewState == ENABLE);
+}
+
+ITStatus WDG_GetITStatus(void)
+{
+  return wdg_it_pending ? SET : RESET;
+}
+
+void WDG_ClearITPendingBit(void)
+{
+  wdg_it_pending = 0;
+}
@@ -0,0 +1,285 @@
+/**
+  ******************************************************************************
+  * @file    sleep_sim.c
+  * @brief   Host check of the sleep manager (src/sleep_mgr.c) and of the
+  *          scheduler time across sleep.
+  *
+  *          Two parts:
+  *          - the registry on its own, with test peripherals: registration
+  *            (twice, registry full), the mode checks, save hooks only for
+  *            deep sleep, in registration order, restore hooks once, in
+  *            reverse, and the wake latency of a sleep;
+  *          - the beacon firmware (src/main.c) for SLEEP_RUN_S, the clocks
+  *            preset to wrap in the middle of it, the GPIO block losing the
+  *            edges that wake the core from deep sleep: Sched_Now() must
+  *            follow the simulated time within SLEEP_DRIFT_MAX_MS (with the
+  *            sleep timer off the ms grid, the ms truncated at each wakeup
+  *            used to cost it 7.5 ms a second), the button presses must all
+  *            be delivered by the read after the wakeup, the pin must not
+  *            be read after the wakeups by the sleep timer, and the wake
+  *            latency of each mode must be within the exit cost of
+  *            host/inc/sim.h.
+  *          One CSV line per sleep mode of the firmware on stdout. The run
+  *          fails (exit code 1) if a check fails.
+  *
+  *          Usage: sleep_sim [seconds [header]], header 0 to omit the CSV
+  *          header line
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "scheduler.h"
+#include "sleep_mgr.h"
+#include "button.h"
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SLEEP_RUN_S             1300
+
+/* Sleep timer and ms clock wraparounds, after the boot */
+#define SLEEP_SYST_WRAP_S       300
+#define SLEEP_CLOCK_WRAP_S      700
+
+#define SLEEP_DRIFT_MAX_MS      2
+#define SLEEP_PROBE_US          10000
+#define SLEEP_PROBE_FROM_US     1000000
+
+/* Button presses while the beacon sleeps between advertising events */
+#define SLEEP_PRESSES           8
+#define SLEEP_PRESS_FIRST_US    20000000
+#define SLEEP_PRESS_EVERY_US    100003000
+#define SLEEP_PRESS_LEN_US      300000
+
+/* Pin reads of the button: the one at init, then for each edge the read
+   after the deep sleep it ended and at most one at the end of the debounce
+   window. None after the timer wakeups */
+#define SLEEP_READS_MAX         (1 + 2 * 2 * SLEEP_PRESSES)
+
+/* Longest wake latency of the timer wakeups: the exit cost, plus the
+   interrupt handlers on the way out. A radio wakeup just before the
+   deadline makes a shorter one */
+#define SLEEP_DEEP_LATENCY_MAX_US   (SIM_COST_DEEP_EXIT_US + 40)
+#define SLEEP_HALT_LATENCY_MAX_US   40
+
+/* Test peripherals of the registry part */
+#define TEST_PERIPHS            3
+
+/* Private variables ---------------------------------------------------------*/
+/* Registry part: hook calls, in order, as "s0 s2 r2 r0 " */
+static char test_calls[128];
+static SleepModes test_limit[TEST_PERIPHS];
+
+/* Firmware part: Sched_Now() against the simulated time */
+static uint8_t probe_started;
+static tClockTime probe_ref_ms;
+static uint64_t probe_ref_us;
+static int32_t drift_min;
+static int32_t drift_max;
+
+/* main() of src/main.c */
+int Beacon_Main(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Test_Call(const char *what, uint8_t n)
+{
+  size_t len = strlen(test_calls);
+
+  snprintf(&test_calls[len], sizeof(test_calls) - len, "%s%u ", what, (unsigned)n);
+}
+
+static SleepModes Test_Check0(void) { return test_limit[0]; }
+static SleepModes Test_Check2(void) { return test_limit[2]; }
+static void Test_Save0(void) { Test_Call("s", 0); }
+static void Test_Save2(void) { Test_Call("s", 2); }
+static void Test_Restore0(void) { Test_Call("r", 0); }
+static void Test_Restore1(void) { Test_Call("r", 1); }
+static void Test_Restore2(void) { Test_Call("r", 2); }
+
+static const SleepMgr_Periph_t test_periphs[TEST_PERIPHS] = {
+  { "test0", Test_Check0, Test_Save0, Test_Restore0 },
+  { "test1", NULL, NULL, Test_Restore1 },
+  { "test2", Test_Check2, Test_Save2, Test_Restore2 },
+};
+
+/* No hook: they fill the registry */
+static SleepMgr_Periph_t test_fillers[SLEEP_MGR_MAX_PERIPHS];
+
+/**
+  * @brief  One check of the registry: mode returned and hooks called.
+  */
+static void Test_Sleep(SleepModes asked, SleepModes expected, const char *calls)
+{
+  SleepModes mode;
+
+  test_calls[0] = '\0';
+  mode = SleepMgr_Check(asked);
+  SleepMgr_Restore();
+  SIM_CHECK(mode == expected, "%s asked, limits %u/%u: %s, expected %s", SleepMgr_ModeName(asked),
+            test_limit[0], test_limit[2], SleepMgr_ModeName(mode), SleepMgr_ModeName(expected));
+  SIM_CHECK(strcmp(test_calls, calls) == 0, "%s asked: hooks \"%s\", expected \"%s\"",
+            SleepMgr_ModeName(asked), test_calls, calls);
+}
+
+static void Sleep_RegistryChecks(void)
+{
+  const SleepMgr_Stats_t *s;
+  uint32_t start = 0xFFFFF000UL;   /* Across the sleep timer wraparound */
+  uint32_t deadline = HAL_VTimerAcc_sysT32_ms(start, 10);
+  uint8_t i;
+
+  SleepMgr_Init();
+  for (i = 0; i < TEST_PERIPHS; i++)
+    SIM_CHECK(SleepMgr_Register(&test_periphs[i]) == 0, "register test%u", (unsigned)i);
+  SIM_CHECK(SleepMgr_Register(&test_periphs[1]) == 0, "register test1 again");
+  for (i = TEST_PERIPHS; i < SLEEP_MGR_MAX_PERIPHS; i++)
+    SIM_CHECK(SleepMgr_Register(&test_fillers[i]) == 0, "register filler %u", (unsigned)i);
+  SIM_CHECK(SleepMgr_Register(&test_fillers[0]) == 1, "registry over %u", SLEEP_MGR_MAX_PERIPHS);
+  SIM_CHECK(SleepMgr_Register(&test_periphs[0]) == 0, "register test0 again in a full registry");
+
+  test_limit[0] = SLEEPMODE_NOTIMER;
+  test_limit[2] = SLEEPMODE_NOTIMER;
+  Test_Sleep(SLEEPMODE_NOTIMER, SLEEPMODE_NOTIMER, "s0 s2 r2 r1 r0 ");
+  Test_Sleep(SLEEPMODE_WAKETIMER, SLEEPMODE_WAKETIMER, "s0 s2 r2 r1 r0 ");
+  Test_Sleep(SLEEPMODE_CPU_HALT, SLEEPMODE_CPU_HALT, "");
+  Test_Sleep(SLEEPMODE_RUNNING, SLEEPMODE_RUNNING, "");
+
+  /* Each check limits the mode, the shallowest wins */
+  test_limit[2] = SLEEPMODE_WAKETIMER;
+  Test_Sleep(SLEEPMODE_NOTIMER, SLEEPMODE_WAKETIMER, "s0 s2 r2 r1 r0 ");
+  test_limit[0] = SLEEPMODE_CPU_HALT;
+  Test_Sleep(SLEEPMODE_NOTIMER, SLEEPMODE_CPU_HALT, "");
+  test_limit[2] = SLEEPMODE_RUNNING;
+  Test_Sleep(SLEEPMODE_WAKETIMER, SLEEPMODE_RUNNING, "");
+  test_limit[0] = SLEEPMODE_NOTIMER;
+  test_limit[2] = SLEEPMODE_NOTIMER;
+
+  /* Restore without a save, and a second restore: nothing */
+  test_calls[0] = '\0';
+  SleepMgr_Restore();
+  SleepMgr_Check(SLEEPMODE_NOTIMER);
+  SleepMgr_Restore();
+  SleepMgr_Restore();
+  SIM_CHECK(strcmp(test_calls, "s0 s2 r2 r1 r0 ") == 0, "restores: \"%s\"", test_calls);
+
+  /* A sleep timed out 62 ticks (151 us) late, then one woken early */
+  SleepMgr_Init();
+  SleepMgr_Enter(start, 10);
+  SleepMgr_Check(SLEEPMODE_WAKETIMER);
+  SIM_CHECK(SleepMgr_Wake(deadline + 62, 1) == SLEEPMODE_WAKETIMER, "mode of the timed sleep");
+  SleepMgr_Restore();
+  SleepMgr_Enter(start, 10);
+  SleepMgr_Check(SLEEPMODE_NOTIMER);
+  SleepMgr_Wake(start + 100, 0);
+  s = SleepMgr_GetStats(SLEEPMODE_WAKETIMER);
+  SIM_CHECK(s->entries == 1 && s->timed == 1 && s->latency_min_us == 151 && s->latency_max_us == 151,
+            "waketimer: %u entries, %u timed, latency %u..%u us", (unsigned)s->entries,
+            (unsigned)s->timed, (unsigned)s->latency_min_us, (unsigned)s->latency_max_us);
+  SIM_CHECK(s->sleep_us == (uint64_t)(deadline + 62 - start) * 625 / 256, "waketimer: %u us slept",
+            (unsigned)s->sleep_us);
+  s = SleepMgr_GetStats(SLEEPMODE_NOTIMER);
+  SIM_CHECK(s->entries == 1 && s->timed == 0 && s->sleep_us == 244, "notimer: %u entries, %u timed",
+            (unsigned)s->entries, (unsigned)s->timed);
+
+  /* No App_SleepMode_Check(): BlueNRG_Sleep() went to CPU halt */
+  SleepMgr_Enter(start, SLEEP_MGR_NO_DEADLINE);
+  SIM_CHECK(SleepMgr_Wake(start + 10, 1) == SLEEPMODE_CPU_HALT, "sleep without a check");
+  SIM_CHECK(SleepMgr_GetStats(SLEEPMODE_CPU_HALT)->timed == 0, "halt without a deadline timed");
+
+  fprintf(stderr, "registry of %u peripherals: checks, save/restore order, latency %s\n",
+          SLEEP_MGR_MAX_PERIPHS, Sim_Failures() ? "FAIL" : "ok");
+}
+
+static void Sleep_FirmwareEntry(void)
+{
+  Beacon_Main();
+}
+
+/**
+  * @brief  Probe: Sched_Now() against the simulated time, from the first
+  *         second on (the scheduler starts during the boot).
+  */
+static void Sleep_Probe(uint64_t now_us)
+{
+  int32_t drift;
+
+  if (now_us < SLEEP_PROBE_FROM_US)
+    return;
+  if (!probe_started) {
+    probe_started = 1;
+    probe_ref_ms = Sched_Now();
+    probe_ref_us = now_us;
+    return;
+  }
+  drift = (int32_t)(Sched_Now() - probe_ref_ms) - (int32_t)((now_us - probe_ref_us) / 1000);
+  if (drift < drift_min)
+    drift_min = drift;
+  if (drift > drift_max)
+    drift_max = drift;
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t run_s = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : SLEEP_RUN_S;
+  uint8_t header = (argc > 2) ? (uint8_t)strtoul(argv[2], NULL, 0) : 1;
+  const Button_Stats_t *button = Button_GetStats();
+  const SleepMgr_Stats_t *s;
+  uint32_t avg;
+  uint8_t i;
+
+  Sleep_RegistryChecks();
+
+  Sim_Init();
+  Sim_ClockPreset((uint32_t)0 - SLEEP_CLOCK_WRAP_S * 1000,
+                  (uint32_t)0 - (uint32_t)(SLEEP_SYST_WRAP_S * 1000 * SIM_SYST_PER_MS));
+  Sim_GpioSleepLoss(1);
+  for (i = 0; i < SLEEP_PRESSES; i++) {
+    Sim_GpioDrive(BUTTON_PIN, 0, SLEEP_PRESS_FIRST_US + (uint64_t)i * SLEEP_PRESS_EVERY_US);
+    Sim_GpioDrive(BUTTON_PIN, 1, SLEEP_PRESS_FIRST_US + (uint64_t)i * SLEEP_PRESS_EVERY_US +
+                                 SLEEP_PRESS_LEN_US);
+  }
+  Sim_SetProbe(SLEEP_PROBE_US, Sleep_Probe);
+  Sim_Run(Sleep_FirmwareEntry, (uint64_t)run_s * 1000000);
+
+  if (header)
+    printf("mode,entries,sleep_ms,timed,latency_min_us,latency_avg_us,latency_max_us\n");
+  for (i = 0; i < SLEEP_MGR_MODES; i++) {
+    s = SleepMgr_GetStats((SleepModes)i);
+    avg = s->timed ? (uint32_t)(s->latency_total_us / s->timed) : 0;
+    printf("%s,%u,%u,%u,%u,%u,%u\n", SleepMgr_ModeName((SleepModes)i), (unsigned)s->entries,
+           (unsigned)(s->sleep_us / 1000), (unsigned)s->timed, (unsigned)s->latency_min_us,
+           (unsigned)avg, (unsigned)s->latency_max_us);
+  }
+
+  SIM_CHECK(drift_min >= -SLEEP_DRIFT_MAX_MS && drift_max <= SLEEP_DRIFT_MAX_MS,
+            "Sched_Now() off the simulated time by %d..%d ms", (int)drift_min, (int)drift_max);
+
+  s = SleepMgr_GetStats(SLEEPMODE_WAKETIMER);
+  SIM_CHECK(s->timed > 0 && s->latency_max_us >= SIM_COST_DEEP_EXIT_US &&
+            s->latency_max_us <= SLEEP_DEEP_LATENCY_MAX_US,
+            "deep sleep wake latency up to %u us over %u, expected %u..%u", (unsigned)s->latency_max_us,
+            (unsigned)s->timed, SIM_COST_DEEP_EXIT_US, SLEEP_DEEP_LATENCY_MAX_US);
+  s = SleepMgr_GetStats(SLEEPMODE_CPU_HALT);
+  SIM_CHECK(s->entries > 0 && s->latency_max_us <= SLEEP_HALT_LATENCY_MAX_US,
+            "CPU halt: %u entries, wake latency up to %u us", (unsigned)s->entries,
+            (unsigned)s->latency_max_us);
+
+  /* Each edge woke the core from deep sleep without an interrupt */
+  SIM_CHECK(button->accepted == 2 * SLEEP_PRESSES && button->wakes == 2 * SLEEP_PRESSES &&
+            button->edges == 0, "button: %u events (%u after a deep sleep), %u edge interrupts, "
+            "expected %u", (unsigned)button->accepted, (unsigned)button->wakes,
+            (unsigned)button->edges, 2 * SLEEP_PRESSES);
+  SIM_CHECK(Sim_GpioReads() <= SLEEP_READS_MAX, "button: %u pin reads over %u deep sleeps, "
+            "expected at most %u", (unsigned)Sim_GpioReads(),
+            (unsigned)SleepMgr_GetStats(SLEEPMODE_WAKETIMER)->entries, SLEEP_READS_MAX);
+
+  fprintf(stderr, "firmware %u s across the clock wraparounds: Sched_Now() off by %d..%d ms, "
+          "%u button events after deep sleep %s\n", (unsigned)run_s, (int)drift_min,
+          (int)drift_max, (unsigned)button->wakes, Sim_Failures() ? "FAIL" : "ok");
+  return Sim_Failures() != 0;
+}
@@ -0,0 +1,266 @@
+/**
+  ******************************************************************************
+  * @file    timer_sim.c
+  * @brief   Host check of the timer jobs of src/scheduler.c across the
+  *          wraparound of the ms clock (2^32 ms, 49.7 days of uptime) and
+  *          of the sleep timer: the device counters are preset to wrap
+  *          WRAP_AFTER_MS into each run. For each case, dozens of periodic
+  *          jobs of various periods run for RUN_US:
+  *
+  *          - no job may run before its deadline, and each one must stay on
+  *            the grid of its first deadline, the wrap included;
+  *          - without stall, each run is at most JITTER_MAX_MS late;
+  *          - after a blocking job of STALL_MS, SCHED_TIMER_SKIP jobs run
+  *            once and skip the missed periods, SCHED_TIMER_CATCH_UP jobs
+  *            run every missed period.
+  *          Prints the runs, skips and lateness (jitter) of each case, then
+  *          the original lastClock/delay loop of main() over the same wrap
+  *          for comparison. Exits with 1 if a check fails.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "clock.h"
+#include "sleep.h"
+#include "scheduler.h"
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  const char *name;
+  Sched_Policy_t policy;
+  uint32_t stall_ms;          /* Blocking job at STALL_AT_MS, 0 for none */
+} Timer_Case_t;
+
+/* Runs of one job, against the grid of its first deadline */
+typedef struct {
+  uint32_t period;
+  tClockTime due;             /* Next expected deadline */
+  uint32_t runs;
+  uint32_t skips;             /* Periods left out */
+  uint32_t early;             /* Runs before their deadline */
+  uint32_t late_max;
+  uint64_t late_sum;
+} Timer_Job_t;
+
+/* Private define ------------------------------------------------------------*/
+#define RUN_US              30000000
+#define WRAP_AFTER_MS       10000
+#define NUM_JOBS            24
+
+/* Job periods: PERIOD_MIN_MS, then PERIOD_STEP_MS more for each job */
+#define PERIOD_MIN_MS       5
+#define PERIOD_STEP_MS      43
+
+/* CPU time of a job */
+#define JOB_US              20
+
+/* Blocking job: the time a blocking printf() of a long log would take */
+#define STALL_AT_MS         (WRAP_AFTER_MS - 1000)
+#define STALL_MS            3000
+
+/* Lateness of a run without stall: the passes of the jobs due before it */
+#define JITTER_MAX_MS       2
+
+/* Original loop of main(): LED half-period */
+#define LEGACY_DELAY_MS     500
+
+#define N(a)                (uint8_t)(sizeof(a) / sizeof((a)[0]))
+
+/* Private variables ---------------------------------------------------------*/
+static const Timer_Case_t timer_cases[] = {
+  { "wrap, skip",          SCHED_TIMER_SKIP,     0 },
+  { "wrap, catch-up",      SCHED_TIMER_CATCH_UP, 0 },
+  { "stall 3 s, skip",     SCHED_TIMER_SKIP,     STALL_MS },
+  { "stall 3 s, catch-up", SCHED_TIMER_CATCH_UP, STALL_MS },
+};
+
+static const Timer_Case_t *timer_case;
+static Timer_Job_t jobs[NUM_JOBS];
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  A run of job n: lateness against its expected deadline, then the
+  *         next one, as the policy of the case places it. A SCHED_TIMER_SKIP
+  *         job is late from the last deadline of its grid.
+  */
+static void Job_Run(uint8_t n)
+{
+  Timer_Job_t *job = &jobs[n];
+  tClockTime now = Sched_Now();
+  int32_t late = (int32_t)(now - job->due);
+  uint32_t missed;
+
+  Sim_Consume(JOB_US);
+  job->runs++;
+  if (late < 0) {
+    job->early++;
+    return;
+  }
+  if (timer_case->policy == SCHED_TIMER_SKIP)
+    late %= (int32_t)job->period;
+  if ((uint32_t)late > job->late_max)
+    job->late_max = (uint32_t)late;
+  job->late_sum += (uint32_t)late;
+
+  job->due += job->period;
+  if (timer_case->policy == SCHED_TIMER_SKIP && SCHED_TIME_REACHED(now, job->due)) {
+    missed = (uint32_t)(now - job->due) / job->period + 1;
+    job->due += missed * job->period;
+    job->skips += missed;
+  }
+}
+
+#define JOB(n) static void Job_##n(void) { Job_Run(n); }
+JOB(0)  JOB(1)  JOB(2)  JOB(3)  JOB(4)  JOB(5)  JOB(6)  JOB(7)
+JOB(8)  JOB(9)  JOB(10) JOB(11) JOB(12) JOB(13) JOB(14) JOB(15)
+JOB(16) JOB(17) JOB(18) JOB(19) JOB(20) JOB(21) JOB(22) JOB(23)
+
+static const Sched_Handler job_handlers[NUM_JOBS] = {
+  Job_0,  Job_1,  Job_2,  Job_3,  Job_4,  Job_5,  Job_6,  Job_7,
+  Job_8,  Job_9,  Job_10, Job_11, Job_12, Job_13, Job_14, Job_15,
+  Job_16, Job_17, Job_18, Job_19, Job_20, Job_21, Job_22, Job_23,
+};
+
+static void Stall_Job(void)
+{
+  Sim_Consume(timer_case->stall_ms * 1000);
+}
+
+static void Timer_Loop(void)
+{
+  uint8_t i, id;
+
+  Clock_Init();
+  Sched_Init();
+  for (i = 0; i < NUM_JOBS; i++) {
+    jobs[i] = (Timer_Job_t){ 0 };
+    jobs[i].period = PERIOD_MIN_MS + PERIOD_STEP_MS * i;
+    jobs[i].due = Sched_Now() + jobs[i].period;
+    id = Sched_TimerStart(job_handlers[i], jobs[i].period, jobs[i].period);
+    SIM_CHECK(id != SCHED_TIMER_INVALID, "%s: job %u not started", timer_case->name, (unsigned)i);
+    Sched_TimerSetPolicy(id, timer_case->policy);
+  }
+  if (timer_case->stall_ms != 0)
+    Sched_TimerStart(Stall_Job, STALL_AT_MS, 0);
+
+  while (1) {
+    Sim_Consume(SIM_COST_LOOP_US);
+    Sched_RunOnce();
+  }
+}
+
+SleepModes App_SleepMode_Check(SleepModes sleepMode)
+{
+  if (Sched_EventsPending())
+    return SLEEPMODE_RUNNING;
+
+  return sleepMode;
+}
+
+/**
+  * @brief  Counters 49.7 days into the uptime: the ms clock and the sleep
+  *         timer both wrap WRAP_AFTER_MS after the start.
+  */
+static void Timer_PresetClocks(void)
+{
+  Sim_ClockPreset((uint32_t)(0 - WRAP_AFTER_MS),
+                  (uint32_t)(0 - (uint32_t)(WRAP_AFTER_MS * SIM_SYST_PER_MS)));
+}
+
+/**
+  * @brief  Run one case and check the runs of each job.
+  */
+static void Timer_RunCase(const Timer_Case_t *c)
+{
+  const Sim_Stats_t *stats = Sim_GetStats();
+  const Timer_Job_t *job;
+  tClockTime start, end;
+  uint32_t before = Sim_Failures();
+  uint32_t runs = 0, skips = 0, late_max = 0, expect, i;
+  uint64_t late_sum = 0;
+
+  timer_case = c;
+  Sim_Init();
+  Timer_PresetClocks();
+  start = Clock_Time();
+  Sim_Run(Timer_Loop, RUN_US);
+  end = Sched_Now();
+
+  SIM_CHECK(end < start, "%s: the clock did not wrap (%u to %u)", c->name, (unsigned)start, (unsigned)end);
+  for (i = 0; i < NUM_JOBS; i++) {
+    job = &jobs[i];
+    /* Deadlines reached by the end, less the ones skipped */
+    expect = (uint32_t)(end - start) / job->period - job->skips;
+    SIM_CHECK(job->early == 0, "%s: job %u (%u ms) ran %u times early", c->name, (unsigned)i,
+              (unsigned)job->period, (unsigned)job->early);
+    SIM_CHECK(job->runs + 1 >= expect && job->runs <= expect, "%s: job %u (%u ms) ran %u times, expected %u",
+              c->name, (unsigned)i, (unsigned)job->period, (unsigned)job->runs, (unsigned)expect);
+    if (c->stall_ms == 0)
+      SIM_CHECK(job->late_max <= JITTER_MAX_MS, "%s: job %u (%u ms) %u ms late", c->name, (unsigned)i,
+                (unsigned)job->period, (unsigned)job->late_max);
+    else if (c->policy == SCHED_TIMER_CATCH_UP)
+      SIM_CHECK(job->skips == 0 && job->late_max <= c->stall_ms + JITTER_MAX_MS,
+                "%s: job %u (%u ms) %u skips, %u ms late", c->name, (unsigned)i, (unsigned)job->period,
+                (unsigned)job->skips, (unsigned)job->late_max);
+    runs += job->runs;
+    skips += job->skips;
+    late_sum += job->late_sum;
+    if (job->late_max > late_max)
+      late_max = job->late_max;
+  }
+  SIM_CHECK(skips == Sched_GetStats()->timer_skips, "%s: %u skips seen, %u counted by the scheduler",
+            c->name, (unsigned)skips, (unsigned)Sched_GetStats()->timer_skips);
+  SIM_CHECK(c->stall_ms != 0 || skips == 0, "%s: %u periods skipped without stall", c->name,
+            (unsigned)skips);
+  SIM_CHECK(c->stall_ms == 0 || c->policy != SCHED_TIMER_SKIP || skips > 0, "%s: no period skipped",
+            c->name);
+
+  printf("%-20s %4u %7u %6u %9u %9.3f %7.3f %s\n", c->name, NUM_JOBS, (unsigned)runs,
+         (unsigned)skips, (unsigned)late_max, runs ? (double)late_sum / runs : 0.0,
+         100.0 * stats->active_us / RUN_US, Sim_Failures() != before ? "FAIL" : "ok");
+}
+
+/**
+  * @brief  The original while(1) of main(), LED toggle only.
+  */
+static uint32_t legacy_runs;
+
+static void Legacy_Loop(void)
+{
+  tClockTime lastClock;
+
+  Clock_Init();
+  lastClock = Clock_Time();
+  while (1) {
+    Sim_Consume(SIM_COST_LOOP_US);
+    if (((uint32_t)lastClock) + LEGACY_DELAY_MS <= (uint32_t)Clock_Time()) {
+      lastClock = lastClock + LEGACY_DELAY_MS;
+      legacy_runs++;
+      Sim_Consume(JOB_US);
+    }
+  }
+}
+
+int main(void)
+{
+  uint8_t i;
+
+  printf("%-20s %4s %7s %6s %9s %9s %7s\n", "case", "jobs", "runs", "skips", "late max",
+         "late avg", "cpu %");
+  for (i = 0; i < N(timer_cases); i++)
+    Timer_RunCase(&timer_cases[i]);
+
+  Sim_Init();
+  Timer_PresetClocks();
+  Sim_Run(Legacy_Loop, RUN_US);
+  printf("\nlastClock/delay loop of main() over the same wrap: %u LED toggles in %u s, %u expected\n",
+         (unsigned)legacy_runs, RUN_US / 1000000, RUN_US / 1000 / LEGACY_DELAY_MS);
+
+  printf("%s\n", Sim_Failures() ? "FAIL" : "ok");
+  return Sim_Failures() != 0;
+}
@@ -0,0 +1,132 @@
+/**
+  ******************************************************************************
+  * @file    trace_sim.c
+  * @brief   Host run of the traced main loop (scheduler, LED job, button)
+  *          with the trace backend this program is linked with:
+  *          trace_sim with src/trace/trace_dcc.c and libdcc, against the mock
+  *          debugger of sim_dcc.c, trace_sim_uart (built with TRACE_SIM_UART)
+  *          with src/trace/trace_uart.c.
+  *          Reports the CPU/sleep budget with and without the trace output
+  *          and saves the output for tools/trace_decode.py.
+  *
+  *          Usage: trace_sim [seconds [output file]]
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "BlueNRG1_conf.h"
+#include "sleep.h"
+#include "scheduler.h"
+#include "button.h"
+#include "log.h"
+#include "trace.h"
+#include "sim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define LED_DELAY_MS        500
+
+/* Button presses: 80 ms long, every 1.7 s */
+#define PRESS_PERIOD_US     1700000
+#define PRESS_LENGTH_US     80000
+
+#ifdef TRACE_SIM_UART
+#define TRACE_BACKEND       "uart"
+#else
+#define TRACE_BACKEND       "dcc"
+#endif
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Led_Toggle(void)
+{
+  TRACE_POINT(TRACE_PT_LED);
+  GPIO_ToggleBits(GPIO_Pin_14);
+}
+
+static void Trace_Loop(void)
+{
+  Clock_Init();
+  Log_Init();
+  TRACE_INIT();
+  Sched_Init();
+  Button_Init(NULL);
+  Sched_TimerStart(Led_Toggle, LED_DELAY_MS, LED_DELAY_MS);
+  while (1) {
+    Sim_Consume(SIM_COST_LOOP_US);
+    Sched_RunOnce();
+  }
+}
+
+/* Same policy as main.c */
+SleepModes App_SleepMode_Check(SleepModes sleepMode)
+{
+  if (Sched_EventsPending())
+    return SLEEPMODE_RUNNING;
+  if (Log_Busy())
+    return SLEEPMODE_CPU_HALT;
+
+  return sleepMode;
+}
+
+/**
+  * @brief  One run, report line.
+  * @param  dcc: debugger attached on the DCC channel, output to out
+  * @param  out: UART (or DCC) output file, NULL to discard
+  */
+static void Run(const char *name, uint32_t seconds, uint8_t dcc, FILE *out)
+{
+  const Sim_Stats_t *sim;
+  const Trace_Stats_t *trace;
+  uint64_t t;
+  double total;
+
+  Sim_Init();
+  Sim_UartCapture(dcc ? NULL : out);
+  if (dcc)
+    Sim_DccAttach(out);
+  for (t = PRESS_PERIOD_US; t < (uint64_t)seconds * 1000000; t += PRESS_PERIOD_US) {
+    Sim_GpioDrive(BUTTON_PIN, 0, t);
+    Sim_GpioDrive(BUTTON_PIN, 1, t + PRESS_LENGTH_US);
+  }
+
+  Sim_Run(Trace_Loop, (uint64_t)seconds * 1000000);
+  if (dcc)
+    Sim_DccDetach();
+
+  sim = Sim_GetStats();
+  trace = Trace_GetStats();
+  total = (double)Sim_NowUs();
+  printf("%-12s %9.4f %9.4f %9.4f %8u %8u %8u %9u %9u\n", name,
+         100.0 * (double)sim->active_us / total, 100.0 * (double)sim->halt_us / total,
+         100.0 * (double)sim->deep_us / total, (unsigned)sim->wakeups,
+         (unsigned)trace->frames, (unsigned)trace->dropped, (unsigned)(trace->words_sent * 4),
+         (unsigned)(dcc ? Sim_DccBytes() : Sim_UartTxBytes()));
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t seconds = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 10;
+  FILE *out = NULL;
+
+  if (argc > 2 && (out = fopen(argv[2], "wb")) == NULL) {
+    perror(argv[2]);
+    return 1;
+  }
+
+  printf("trace backend %s, %u s, LED every %u ms, button press every %.1f s\n\n",
+         TRACE_BACKEND, (unsigned)seconds, LED_DELAY_MS, PRESS_PERIOD_US / 1e6);
+  printf("%-12s %9s %9s %9s %8s %8s %8s %9s %9s\n", "run", "active %", "halt %", "deep %",
+         "wakeups", "frames", "dropped", "sent B", "link B");
+#ifdef TRACE_SIM_UART
+  Run("uart", seconds, 0, out);
+#else
+  Run("no debugger", seconds, 0, NULL);
+  Run("dcc", seconds, 1, out);
+#endif
+
+  if (out != NULL)
+    fclose(out);
+  return 0;
+}
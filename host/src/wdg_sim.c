@@ -0,0 +1,265 @@
+/**
+  ******************************************************************************
+  * @file    wdg_sim.c
+  * @brief   Host check of the watchdog supervisor of src/supervisor.c on the
+  *          firmware (src/main.c), one boot per case, with the crash record
+  *          kept across the resets as in crash_sim:
+  *
+  *          - healthy: every task checks in within its deadline and budget,
+  *            the watchdog is fed and never expires;
+  *          - LED edge 20 ms long: over its budget, the watchdog is no longer
+  *            fed and its interrupt records "led overrun";
+  *          - LED edge stuck: the watchdog interrupt cannot preempt the LED
+  *            timer interrupt, so no record: the second expiry resets the
+  *            device (RESET_WDG);
+  *          - BTLE_StackTick() stuck: "stack_tick hung";
+  *          - UART stuck from the boot on: the log ring stops draining, "log
+  *            late".
+  *          Each failure must reset within SUP_WDG_TIMEOUT_MS of the miss (a
+  *          stuck UART is only seen once its FIFO is full), and the next boot
+  *          must report the task, or the watchdog reset. The crash lines of the
+  *          boots are written to the file given, for tools/crash_decode.py.
+  *          The run fails (exit code 1) if a check fails.
+  *
+  *          Usage: wdg_sim [crash log file]
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 200809L   /* open_memstream() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "button.h"
+#include "crash.h"
+#include "supervisor.h"
+#include "sim.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  const char *name;
+  void (*inject)(void);       /* Fault injected at at_us */
+  uint64_t at_us;
+  Sup_Task_t task;            /* Task to blame, SUP_TASK_NONE for no record */
+  Sup_Miss_t miss;
+  uint64_t detect_us;         /* Longest time from the fault to the miss */
+  uint32_t value_min;         /* Bounds of the recorded ms or us */
+  uint32_t value_max;
+} Wdg_Case_t;
+
+/* Private define ------------------------------------------------------------*/
+#define HEALTHY_RUN_US          12000000
+#define BOOT_RUN_US             2000000
+#define STALL_AT_US             3000000
+#define HANG_US                 10000000
+#define LED_OVERRUN_US          20000
+#define LED_PIN                 GPIO_Pin_14
+
+/* Longest main loop sleep, with margin: the advertising events wake it */
+#define LOOP_GAP_MAX_US         500000
+
+/* Reset after the miss: the watchdog timeout counted from the last feed */
+#define RESET_AFTER_MAX_US      ((uint64_t)SUP_WDG_TIMEOUT_MS * 1000 + LOOP_GAP_MAX_US)
+
+/* No watchdog interrupt taken: reset at the second expiry */
+#define BACKSTOP_MAX_US         ((uint64_t)SUP_WDG_TIMEOUT_MS * 1000)
+
+/* A stuck UART is seen once the boot log lines have filled its 64 byte TX
+   FIFO, and the ring holds data */
+#define UART_FILL_MAX_US        1000000
+
+/* Private variables ---------------------------------------------------------*/
+static FILE *crash_log;
+
+/* main() of src/main.c */
+int Beacon_Main(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Wdg_Entry(void)
+{
+  Beacon_Main();
+}
+
+static void Wdg_ButtonPress(void)
+{
+  Sim_GpioDrive(BUTTON_PIN, 0, STALL_AT_US);
+  Sim_GpioDrive(BUTTON_PIN, 1, STALL_AT_US + 300000);
+}
+
+static void Wdg_LedOverrun(void)
+{
+  Sim_GpioStall(LED_PIN, STALL_AT_US, LED_OVERRUN_US);
+}
+
+static void Wdg_LedHang(void)
+{
+  Sim_GpioStall(LED_PIN, STALL_AT_US, HANG_US);
+}
+
+static void Wdg_StackHang(void)
+{
+  Sim_StackStall(STALL_AT_US, HANG_US);
+}
+
+static void Wdg_UartStuck(void)
+{
+  Sim_UartStall(0);
+}
+
+static const Wdg_Case_t wdg_cases[] = {
+  { "led_overrun", Wdg_LedOverrun, STALL_AT_US, SUP_TASK_LED, SUP_MISS_OVERRUN, LED_OVERRUN_US,
+    LED_OVERRUN_US, LED_OVERRUN_US + 200 },
+  { "led_hang", Wdg_LedHang, STALL_AT_US, SUP_TASK_NONE, SUP_MISS_NONE, BACKSTOP_MAX_US, 0, 0 },
+  { "stack_hang", Wdg_StackHang, STALL_AT_US, SUP_TASK_STACK_TICK, SUP_MISS_HUNG, 0, 1000,
+    SUP_WDG_TIMEOUT_MS },
+  { "uart_stuck", Wdg_UartStuck, 0, SUP_TASK_LOG, SUP_MISS_LATE, UART_FILL_MAX_US, 1,
+    LOOP_GAP_MAX_US / 1000 },
+};
+
+/**
+  * @brief  One boot of the firmware for at most duration_us, inject() called
+  *         after Sim_Init() if not NULL.
+  * @param  uart: UART output (malloc'ed, to be freed)
+  * @retval Simulated time at the end of the run: the reset, if any
+  */
+static uint64_t Wdg_Boot(void (*inject)(void), uint64_t duration_us, char **uart)
+{
+  size_t len = 0;
+  FILE *capture;
+  char *line, *end;
+
+  Sim_Init();
+  if (inject != NULL)
+    inject();
+  *uart = NULL;
+  capture = open_memstream(uart, &len);
+  Sim_UartCapture(capture);
+  Sim_Run(Wdg_Entry, duration_us);
+  Sim_UartCapture(NULL);
+  fclose(capture);
+
+  /* Keep the crash lines for tools/crash_decode.py */
+  for (line = *uart; crash_log != NULL && (line = strstr(line, "crash ")) != NULL; line = end) {
+    end = line + strcspn(line, "\n");
+    fprintf(crash_log, "%.*s\n", (int)(end - line), line);
+  }
+  return Sim_NowUs();
+}
+
+/**
+  * @brief  No fault: fed all along, every task within its deadline and
+  *         budget, the button included.
+  */
+static void Wdg_Healthy(void)
+{
+  const Sup_Stats_t *stats = Sup_GetStats();
+  const Sup_TaskStats_t *task;
+  char *uart;
+  uint64_t end;
+  uint8_t i;
+
+  end = Wdg_Boot(Wdg_ButtonPress, HEALTHY_RUN_US, &uart);
+  free(uart);
+
+  SIM_CHECK(end >= HEALTHY_RUN_US, "healthy: reset at %.3f s", (double)end / 1e6);
+  SIM_CHECK(stats->task == SUP_TASK_NONE, "healthy: task %s %s, %u", Sup_TaskName(stats->task),
+            Sup_MissName(stats->miss), (unsigned)stats->value);
+  SIM_CHECK(Sim_WdgExpiries() == 0, "healthy: watchdog expired %u times", (unsigned)Sim_WdgExpiries());
+  SIM_CHECK(stats->feeds > 0 && Sim_WdgReloads() == stats->feeds + 1,
+            "healthy: %u feeds, %u watchdog reloads", (unsigned)stats->feeds, (unsigned)Sim_WdgReloads());
+  for (i = 0; i < SUP_TASK_COUNT; i++) {
+    task = Sup_GetTaskStats(i);
+    printf("healthy: %-10s %6u runs, worst %5u us\n", Sup_TaskName(i), (unsigned)task->runs,
+           (unsigned)task->worst_us);
+  }
+  printf("healthy: %u feeds in %.0f s, no watchdog expiry %s\n", (unsigned)stats->feeds,
+         HEALTHY_RUN_US / 1e6, Sim_Failures() ? "FAIL" : "ok");
+}
+
+/**
+  * @brief  A fault case: the reset, the record, then its report at the next
+  *         boot.
+  * @param  count: crash records so far, this one's included
+  */
+static void Wdg_Fault(const Wdg_Case_t *c, uint32_t count)
+{
+  char *uart, expect[96];
+  uint64_t end;
+  uint32_t before = Sim_Failures();
+  uint8_t backstop = (c->task == SUP_TASK_NONE);
+
+  end = Wdg_Boot(c->inject, 10 * HANG_US, &uart);
+  SIM_CHECK(end > c->at_us && end <= c->at_us + c->detect_us + RESET_AFTER_MAX_US, "%s: reset at %.3f s",
+            c->name, (double)end / 1e6);
+  if (backstop) {
+    /* The previous record, reported, and the reset reason only */
+    SIM_CHECK(crash_record.magic != CRASH_MAGIC, "%s: a new record", c->name);
+    SIM_CHECK(SysCtrl_GetWakeupResetReason() == RESET_WDG, "%s: not a watchdog reset", c->name);
+  } else {
+    SIM_CHECK(crash_record.magic == CRASH_MAGIC && Crash_RecordValid(&crash_record) &&
+              crash_record.code == CRASH_CODE_WATCHDOG && crash_record.count == count,
+              "%s: no watchdog record", c->name);
+    SIM_CHECK(crash_record.task == c->task && crash_record.miss == c->miss, "%s: task %s %s recorded",
+              c->name, Sup_TaskName(crash_record.task), Sup_MissName(crash_record.miss));
+    SIM_CHECK(crash_record.miss_value >= c->value_min && crash_record.miss_value <= c->value_max,
+              "%s: %u recorded, expected %u to %u", c->name, (unsigned)crash_record.miss_value,
+              (unsigned)c->value_min, (unsigned)c->value_max);
+  }
+  if (!backstop && c->miss != SUP_MISS_HUNG && c->task != SUP_TASK_LOG) {
+    /* The main loop was still running and the UART working: the miss was
+       logged */
+    snprintf(expect, sizeof(expect), "sup: task %s %s", Sup_TaskName(c->task), Sup_MissName(c->miss));
+    SIM_CHECK(uart != NULL && strstr(uart, expect) != NULL, "%s: no \"%s\" on the UART", c->name, expect);
+  }
+  free(uart);
+  if (backstop)
+    printf("%s: no record, watchdog reset %.3f s after the fault %s\n", c->name,
+           (double)(end - c->at_us) / 1e6, Sim_Failures() != before ? "FAIL" : "ok");
+  else
+    printf("%s: task %s %s, %u %s, reset %.3f s after the fault %s\n", c->name,
+           Sup_TaskName(crash_record.task), Sup_MissName(crash_record.miss),
+           (unsigned)crash_record.miss_value, c->miss == SUP_MISS_OVERRUN ? "us" : "ms",
+           (double)(end - c->at_us) / 1e6, Sim_Failures() != before ? "FAIL" : "ok");
+
+  /* Next boot: the task is reported, or the watchdog reset */
+  before = Sim_Failures();
+  end = Wdg_Boot(NULL, BOOT_RUN_US, &uart);
+  if (backstop)
+    snprintf(expect, sizeof(expect), "boot warm, reset 0x%02x", RESET_WDG);
+  else
+    snprintf(expect, sizeof(expect), "crash %u: task %s %s", (unsigned)count, Sup_TaskName(c->task),
+             Sup_MissName(c->miss));
+  SIM_CHECK(end >= BOOT_RUN_US, "%s: reset again at %.3f s", c->name, (double)end / 1e6);
+  SIM_CHECK(uart != NULL && strstr(uart, expect) != NULL, "%s: no \"%s\" on the UART", c->name, expect);
+  SIM_CHECK(uart != NULL && strstr(uart, "boot warm") != NULL, "%s: next boot not warm", c->name);
+  free(uart);
+  printf("%s: next boot reports \"%s\" %s\n", c->name, expect, Sim_Failures() != before ? "FAIL" : "ok");
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t count = 0;
+  uint8_t i;
+
+  crash_log = (argc > 1) ? fopen(argv[1], "w") : NULL;
+  if (argc > 1 && crash_log == NULL) {
+    perror(argv[1]);
+    return 2;
+  }
+
+  memset(&crash_record, 0, sizeof(crash_record));
+  Wdg_Healthy();
+  for (i = 0; i < sizeof(wdg_cases) / sizeof(wdg_cases[0]); i++)
+  {
+    if (wdg_cases[i].task != SUP_TASK_NONE)
+      count++;
+    Wdg_Fault(&wdg_cases[i], count);
+  }
+
+  if (crash_log != NULL)
+    fclose(crash_log);
+  printf("%s\n", Sim_Failures() ? "FAIL" : "ok");
+  return Sim_Failures() != 0;
+}
@@ -10,6 +10,67 @@
  * according the application requests
  */
 
+/* Build profiles, selected by PROFILE= in the Makefile, which also selects
+ * the matching BLE_STACK_CONFIGURATION of stack_user_cfg.h:
+ * - BEACON_PROFILE_BEACON: non-connectable advertising only. No extra memory
+ *   blocks, no data length extension, no security or server database
+ * - BEACON_PROFILE_BEACON_OTA: beacon with the OTA service on one link, with
+ *   the memory blocks and ATT_MTU of the image transfer
+ * - BEACON_PROFILE_CONNECTABLE: one link at full throughput, with bonding
+ * - BEACON_PROFILE_OTA_FAST: beacon with the OTA service for image transfer
+ *   throughput: data length extension and extended OTA packets, so the
+ *   ATT_MTU is OTA_ATT_MTU_SIZE and each image packet carries
+ *   OTA_16_BYTES_BLOCKS_NUMBER blocks of 16 bytes, and the memory blocks to
+ *   hold the packets of a connection event (see bin/host/ota.csv)
+ */
+#define BEACON_PROFILE_BEACON       0
+#define BEACON_PROFILE_BEACON_OTA   1
+#define BEACON_PROFILE_CONNECTABLE  2
+#define BEACON_PROFILE_OTA_FAST     3
+
+#ifndef BEACON_PROFILE
+#define BEACON_PROFILE              BEACON_PROFILE_CONNECTABLE
+#endif
+
+/* Memory blocks added by BEACON_PROFILE_OTA_FAST: with the minimum, the 6
+ * image packets of 212 bytes (7 blocks each) a phone sends in a connection
+ * event wait for BTLE_StackTick() in the memory blocks. With fewer blocks the
+ * last ones are NAKed and sent again at the next event (9 already NAK the
+ * sixth), more are not used. Measured on the firmware and its OTA service,
+ * data length extension requested at the connection (bin/host/ota.csv)
+ */
+#define OTA_FAST_OPT_MBLOCKS        10
+
+#if (BEACON_PROFILE == BEACON_PROFILE_BEACON)
+#define PROFILE_OTA_SERVICE         0
+#define PROFILE_OPT_MBLOCKS         0
+#define PROFILE_BONDING             0
+#elif (BEACON_PROFILE == BEACON_PROFILE_BEACON_OTA)
+#define PROFILE_OTA_SERVICE         1
+#define PROFILE_OPT_MBLOCKS         6
+#define PROFILE_BONDING             0
+#elif (BEACON_PROFILE == BEACON_PROFILE_CONNECTABLE)
+#define PROFILE_OTA_SERVICE         0
+#define PROFILE_OPT_MBLOCKS         6
+#define PROFILE_BONDING             1
+#elif (BEACON_PROFILE == BEACON_PROFILE_OTA_FAST)
+#define PROFILE_OTA_SERVICE         1
+#define PROFILE_OPT_MBLOCKS         OTA_FAST_OPT_MBLOCKS
+#define PROFILE_BONDING             0
+#if (CONTROLLER_DATA_LENGTH_EXTENSION_ENABLED != 1) || (OTA_EXTENDED_PACKET_LEN != 1)
+#error "BEACON_PROFILE_OTA_FAST needs data length extension and OTA_EXTENDED_PACKET_LEN"
+#endif
+#else
+#error "Unknown BEACON_PROFILE"
+#endif
+
+/* OTA service in this application (not the OTA Service Manager one) */
+#if defined (ST_OTA_LOWER_APPLICATION) || defined (ST_OTA_HIGHER_APPLICATION) || PROFILE_OTA_SERVICE
+#define BEACON_OTA_SERVICE          1
+#else
+#define BEACON_OTA_SERVICE          0
+#endif
+
 /* Default number of link */
 #define MIN_NUM_LINK                1
 /* Default number of GAP and GATT services */
@@ -24,11 +85,13 @@
   #define OTA_MAX_ATT_MTU_SIZE    (DEFAULT_ATT_MTU)              /* DEFAULT_ATT_MTU size = 23 bytes */ 
 #endif 
 
-/* Number of services requests from the beacon demo */
-#define NUM_APP_GATT_SERVICES 0
+/* Number of services requests from the beacon demo: the OTA service, if any */
+#define NUM_APP_GATT_SERVICES (BEACON_OTA_SERVICE)
 
-/* Number of attributes requests from the beacon demo */
-#define NUM_APP_GATT_ATTRIBUTES 0
+/* Number of attributes requests from the beacon demo: OTA service declaration,
+ * 4 characteristics (declaration and value) and 1 client configuration
+ */
+#define NUM_APP_GATT_ATTRIBUTES (BEACON_OTA_SERVICE * 10)
 
 /* Number of links needed for the demo: 1
  * Only 1 the default
@@ -42,7 +105,7 @@
 #define NUM_GATT_SERVICES       (DEFAULT_NUM_GATT_SERVICES + NUM_APP_GATT_SERVICES)
 
 /* Array size for the attribute value for OTA service */
-#if defined (ST_OTA_LOWER_APPLICATION) || defined (ST_OTA_HIGHER_APPLICATION)
+#if BEACON_OTA_SERVICE
    
 /**
  * Set the number of 16-bytes units used on an OTA FW data packet for matching OTA client MAX ATT_MTU
@@ -68,7 +131,7 @@
 #define APP_MAX_ATT_SIZE	  MAX_CHAR_LEN(OTA_MAX_ATT_SIZE,  _MAX_ATT_SIZE)
 
 /* Array size for the attribute value for OTA service */
-#if defined (ST_OTA_LOWER_APPLICATION) || defined (ST_OTA_HIGHER_APPLICATION)
+#if BEACON_OTA_SERVICE
 /* OTA service: 4 characteristics (1 notify property): 99 bytes + 
    Image Content characteristic length = 4  + (OTA_16_BYTES_BLOCKS_NUMBER * 16); 4 for sequence number, checksum and needs acks bytes */
 #define OTA_ATT_VALUE_ARRAY_SIZE (99 + (4 + (OTA_16_BYTES_BLOCKS_NUMBER * 16))) 
@@ -79,11 +142,13 @@
 /* Array size for the attribute value */
 #define ATT_VALUE_ARRAY_SIZE    (44 + OTA_ATT_VALUE_ARRAY_SIZE) /* Only GATT & GAP default services, NUM_LINKS = 1 */
 
-/* Flash security database size */
-#define FLASH_SEC_DB_SIZE       (0x400)
+/* Flash security database size: bonding information, none without a
+ * connection
+ */
+#define FLASH_SEC_DB_SIZE       (PROFILE_BONDING ? 0x400 : 0)
 
-/* Flash server database size */
-#define FLASH_SERVER_DB_SIZE    (0x400)
+/* Flash server database size: client configurations of the bonded devices */
+#define FLASH_SERVER_DB_SIZE    (PROFILE_BONDING ? 0x400 : 0)
 
 /* Set supported max value for ATT_MTU enabled by the application */
 #if (CONTROLLER_DATA_LENGTH_EXTENSION_ENABLED == 1) && (OTA_EXTENDED_PACKET_LEN == 1) 
@@ -107,12 +172,24 @@
 #define PREPARE_WRITE_LIST_SIZE PREP_WRITE_X_ATT(MAX_ATT_SIZE) 
 
 /* Additional number of memory blocks  to be added to the minimum */
-#define OPT_MBLOCKS		(6) /* 6:  for reaching the max throughput: ~220kbps (same as BLE stack 1.x) */
+#define OPT_MBLOCKS		(PROFILE_OPT_MBLOCKS) /* 6:  for reaching the max throughput: ~220kbps (same as BLE stack 1.x) */
 
 
 /* Set the number of memory block for packet allocation */
 #define MBLOCKS_COUNT           (MBLOCKS_CALC(PREPARE_WRITE_LIST_SIZE, MAX_ATT_MTU, NUM_LINKS) + OPT_MBLOCKS)
 
+/* RAM of the stack in the connectable profile, the reference of
+ * BEACON_PROFILE_FREED_RAM: default services, ATT_MTU of 23 bytes, 6 extra
+ * memory blocks, data length extension
+ */
+#define CONNECTABLE_BUFFER_SIZE TOTAL_BUFFER_SIZE(MIN_NUM_LINK, DEFAULT_NUM_GATT_ATTRIBUTES, DEFAULT_NUM_GATT_SERVICES, 44, \
+                                                  MBLOCKS_CALC(0, DEFAULT_ATT_MTU, MIN_NUM_LINK) + 6, 1)
+
+/* RAM the profile saves on the stack, for the application buffers (log
+ * ring); negative when the profile takes more than the connectable one
+ */
+#define BEACON_PROFILE_FREED_RAM ((long)CONNECTABLE_BUFFER_SIZE - (long)TOTAL_BUFFER_SIZE(NUM_LINKS,NUM_GATT_ATTRIBUTES,NUM_GATT_SERVICES,ATT_VALUE_ARRAY_SIZE,MBLOCKS_COUNT,CONTROLLER_DATA_LENGTH_EXTENSION_ENABLED))
+
 /* RAM reserved to manage all the data stack according the number of links,
  * number of services, number of attributes and attribute value length
  */
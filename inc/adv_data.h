@@ -0,0 +1,143 @@
+/**
+  ******************************************************************************
+  * @file    adv_data.h
+  * @brief   Compile-time builder of advertising payloads.
+  *
+  *          Each ADV_xxx() macro expands to the bytes of one AD structure,
+  *          length byte included, so a payload is written as a list of
+  *          structures and ADV_DATA_DEFINE() turns it into a const array in
+  *          flash:
+  *
+  *            ADV_DATA_DEFINE(beacon_adv,
+  *              ADV_FLAGS(ADV_FLAGS_GENERAL_NO_BREDR),
+  *              ADV_IBEACON(0x0030, 0, 0, -56, UUID bytes...));
+  *
+  *          The lengths are computed by the compiler, never written by hand,
+  *          and the build fails if a payload is over ADV_DATA_MAX or if a
+  *          fixed-size field (UUID, namespace, ...) has the wrong size.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef ADV_DATA_H
+#define ADV_DATA_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Longest advertising (or scan response) payload */
+#define ADV_DATA_MAX                31
+
+/* AD types, Bluetooth Assigned Numbers */
+#define ADV_TYPE_FLAGS              0x01
+#define ADV_TYPE_UUID16_COMPLETE    0x03
+#define ADV_TYPE_NAME_SHORT         0x08
+#define ADV_TYPE_NAME_COMPLETE      0x09
+#define ADV_TYPE_TX_POWER_LEVEL     0x0A
+#define ADV_TYPE_SERVICE_DATA16     0x16
+#define ADV_TYPE_MANUFACTURER       0xFF
+
+/* Flags AD values */
+#define ADV_FLAGS_LE_LIMITED        0x01
+#define ADV_FLAGS_LE_GENERAL        0x02
+#define ADV_FLAGS_NO_BREDR          0x04
+#define ADV_FLAGS_GENERAL_NO_BREDR  (ADV_FLAGS_LE_GENERAL | ADV_FLAGS_NO_BREDR)
+
+/* iBeacon: manufacturer data type and length of the frame after them */
+#define ADV_IBEACON_TYPE            0x02
+#define ADV_IBEACON_LEN             0x15
+
+/* Eddystone service UUID and frame types */
+#define ADV_EDDYSTONE_UUID          0xFEAA
+#define ADV_EDDYSTONE_FRAME_UID     0x00
+#define ADV_EDDYSTONE_FRAME_URL     0x10
+#define ADV_EDDYSTONE_FRAME_TLM     0x20
+
+/* Size of ADV_FLAGS() */
+#define ADV_FLAGS_LEN               3
+
+/* Field offsets from the first byte of ADV_IBEACON() */
+#define ADV_IBEACON_MAJOR_OFS       22
+#define ADV_IBEACON_MINOR_OFS       24
+#define ADV_IBEACON_POWER_OFS       26
+
+/* Field offsets from the first byte of ADV_EDDYSTONE_TLM() */
+#define ADV_TLM_VBATT_OFS           10
+#define ADV_TLM_TEMP_OFS            12
+#define ADV_TLM_ADV_COUNT_OFS       14
+#define ADV_TLM_SEC_COUNT_OFS       18
+
+/* Eddystone-URL scheme prefixes */
+#define ADV_URL_HTTP_WWW            0x00
+#define ADV_URL_HTTPS_WWW           0x01
+#define ADV_URL_HTTP                0x02
+#define ADV_URL_HTTPS               0x03
+
+/* Exported macro ------------------------------------------------------------*/
+/* Number of bytes of a list of byte expressions, a constant expression */
+#define ADV_BYTES(...)              sizeof((const uint8_t[]){ __VA_ARGS__ })
+
+/* 0, or a build error ("negative size") if cond is false */
+#define ADV_CHECK(cond)             (0 * sizeof(char[(cond) ? 1 : -1]))
+
+/* Little and big endian 16-bit fields */
+#define ADV_LE16(x)                 (uint8_t)((x) & 0xFF), (uint8_t)(((x) >> 8) & 0xFF)
+#define ADV_BE16(x)                 (uint8_t)(((x) >> 8) & 0xFF), (uint8_t)((x) & 0xFF)
+#define ADV_BE32(x)                 ADV_BE16((uint32_t)(x) >> 16), ADV_BE16((uint32_t)(x) & 0xFFFF)
+
+/* One AD structure: length, type, data */
+#define ADV_AD(type, ...)           (uint8_t)(1 + ADV_BYTES(__VA_ARGS__)), (type), __VA_ARGS__
+
+#define ADV_FLAGS(flags)            ADV_AD(ADV_TYPE_FLAGS, (flags))
+#define ADV_NAME_COMPLETE(...)      ADV_AD(ADV_TYPE_NAME_COMPLETE, __VA_ARGS__)
+#define ADV_NAME_SHORT(...)         ADV_AD(ADV_TYPE_NAME_SHORT, __VA_ARGS__)
+#define ADV_TX_POWER_LEVEL(dbm)     ADV_AD(ADV_TYPE_TX_POWER_LEVEL, (uint8_t)(dbm))
+#define ADV_UUID16_COMPLETE(uuid)   ADV_AD(ADV_TYPE_UUID16_COMPLETE, ADV_LE16(uuid))
+
+/* Manufacturer specific data: company identifier, then the data */
+#define ADV_MANUFACTURER(company, ...) \
+  ADV_AD(ADV_TYPE_MANUFACTURER, ADV_LE16(company), __VA_ARGS__)
+
+/* iBeacon layout: 16-byte proximity UUID, major, minor (big endian) and
+   the measured power at 1 m in dBm */
+#define ADV_IBEACON(company, major, minor, power_1m, ...)                   \
+  ADV_MANUFACTURER(company, ADV_IBEACON_TYPE,                             \
+                   (uint8_t)(ADV_IBEACON_LEN + ADV_CHECK(ADV_BYTES(__VA_ARGS__) == 16)), \
+                   __VA_ARGS__, ADV_BE16(major), ADV_BE16(minor), (uint8_t)(power_1m))
+
+/* Eddystone service data: complete 16-bit UUID list then the frame */
+#define ADV_EDDYSTONE(frame_type, ...)                                      \
+  ADV_UUID16_COMPLETE(ADV_EDDYSTONE_UUID),                                \
+  ADV_AD(ADV_TYPE_SERVICE_DATA16, ADV_LE16(ADV_EDDYSTONE_UUID), (frame_type), __VA_ARGS__)
+
+/* Eddystone-UID: TX power at 0 m in dBm, 10-byte namespace then 6-byte
+   instance, two reserved bytes */
+#define ADV_EDDYSTONE_UID(power_0m, ...)                                    \
+  ADV_EDDYSTONE(ADV_EDDYSTONE_FRAME_UID,                                  \
+                (uint8_t)((power_0m) + ADV_CHECK(ADV_BYTES(__VA_ARGS__) == 16)), \
+                __VA_ARGS__, 0x00, 0x00)
+
+/* Eddystone-URL: TX power at 0 m in dBm, ADV_URL_xxx scheme, encoded URL */
+#define ADV_EDDYSTONE_URL(power_0m, scheme, ...)                            \
+  ADV_EDDYSTONE(ADV_EDDYSTONE_FRAME_URL,                                  \
+                (uint8_t)((power_0m) + ADV_CHECK(ADV_BYTES(__VA_ARGS__) <= 17)), \
+                (scheme), __VA_ARGS__)
+
+/* Eddystone-TLM, unencrypted (version 0): battery mV, temperature in 8.8
+   fixed point degrees, advertising PDU count, time since boot in 0.1 s */
+#define ADV_EDDYSTONE_TLM(vbatt_mv, temp_8_8, adv_count, sec_count)         \
+  ADV_EDDYSTONE(ADV_EDDYSTONE_FRAME_TLM, 0x00, ADV_BE16(vbatt_mv),        \
+                ADV_BE16(temp_8_8), ADV_BE32(adv_count), ADV_BE32(sec_count))
+
+/* Const payload in flash, at most ADV_DATA_MAX bytes */
+#define ADV_DATA_DEFINE(name, ...)                                          \
+  static const uint8_t name[] = { __VA_ARGS__ };                           \
+  _Static_assert(sizeof(name) <= ADV_DATA_MAX, #name " is over 31 bytes")
+
+/* Same in RAM, for a payload with fields updated at run time (adv_live.h) */
+#define ADV_DATA_DEFINE_LIVE(name, ...)                                     \
+  static uint8_t name[] = { __VA_ARGS__ };                                 \
+  _Static_assert(sizeof(name) <= ADV_DATA_MAX, #name " is over 31 bytes")
+
+#endif /* ADV_DATA_H */
@@ -0,0 +1,69 @@
+/**
+  ******************************************************************************
+  * @file    adv_live.h
+  * @brief   Live fields of the advertising frames: beacon identifiers and
+  *          telemetry updated at run time.
+  *
+  *          A field is bound to its bytes in a RAM payload (see
+  *          ADV_DATA_DEFINE_LIVE()) of the advertising rotation. A setter
+  *          writes the bytes in place and marks the field dirty only if they
+  *          changed; the dirty frames are sent once, at the end of a window
+  *          of one advertising interval opened by the first change, and only
+  *          if they are on air (adv_rotate.c sends the others on their next
+  *          slot). Several updates in one interval cost one stack command,
+  *          unchanged values none.
+  *
+  *          The setters are called from the main loop, not from interrupts.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef ADV_LIVE_H
+#define ADV_LIVE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+/* Fields, all big endian in the payload */
+typedef enum {
+  ADV_LIVE_MAJOR = 0,      /* iBeacon major, 2 bytes */
+  ADV_LIVE_MINOR,          /* iBeacon minor, 2 bytes */
+  ADV_LIVE_TX_POWER,       /* iBeacon measured power at 1 m, 1 byte */
+  ADV_LIVE_BATTERY,        /* Eddystone-TLM battery voltage in mV, 2 bytes */
+  ADV_LIVE_TEMPERATURE,    /* Eddystone-TLM temperature, 8.8 fixed point, 2 bytes */
+  ADV_LIVE_UPTIME,         /* Eddystone-TLM time since boot in 0.1 s, 4 bytes */
+  ADV_LIVE_COUNTER,        /* Application counter, 4 bytes */
+  ADV_LIVE_STACK_MARGIN,   /* Stack margin, see Mem_StackMarginByte(), 1 byte */
+  ADV_LIVE_FIELDS
+} Adv_LiveField;
+
+typedef struct {
+  uint32_t writes;         /* Setter calls */
+  uint32_t unchanged;      /* Setter calls with the value already in the payload */
+  uint32_t flushes;        /* Coalescing windows closed */
+  uint32_t sent;           /* Frames re-sent to the stack */
+  uint32_t deferred;       /* Frames changed off air, sent by their slot */
+} Adv_Live_Stats_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* Delay of the end of the window allowed to stay off the radio activity:
+   a window of one interval ends at the next advertising event */
+#define ADV_LIVE_FLUSH_SLACK_MS 10
+
+/* Exported functions ------------------------------------------------------- */
+void Adv_LiveInit(uint16_t window_ms);
+void Adv_LiveBind(Adv_LiveField field, uint8_t *payload, uint8_t offset);
+
+void Adv_LiveSetMajor(uint16_t major);
+void Adv_LiveSetMinor(uint16_t minor);
+void Adv_LiveSetTxPower(int8_t dbm);
+void Adv_LiveSetBattery(uint16_t mv);
+void Adv_LiveSetTemperature(int16_t temp_8_8);
+void Adv_LiveSetUptime(uint32_t tenths);
+void Adv_LiveSetCounter(uint32_t counter);
+void Adv_LiveSetStackMargin(uint8_t margin);
+
+const Adv_Live_Stats_t *Adv_LiveGetStats(void);
+
+#endif /* ADV_LIVE_H */
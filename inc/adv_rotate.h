@@ -0,0 +1,67 @@
+/**
+  ******************************************************************************
+  * @file    adv_rotate.h
+  * @brief   Rotation of several advertising frames (iBeacon, Eddystone, ...)
+  *          from one device.
+  *
+  *          The frames are const payloads built with adv_data.h and stay in
+  *          flash: on each rotation slot the payload of the frame scheduled
+  *          for the slot is handed to hci_le_set_advertising_data() by
+  *          pointer, nothing is copied or rebuilt by the application. The
+  *          slots are a scheduler timer job.
+  *
+  *          The weight of a frame is its number of slots per rotation; the
+  *          slots of the frames are interleaved (smooth weighted round
+  *          robin), so with weights 3, 1, 1 the sequence is A B A C A. When
+  *          two consecutive slots carry the same frame the stack is not
+  *          called.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef ADV_ROTATE_H
+#define ADV_ROTATE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+  const uint8_t *data;     /* Payload in flash, from ADV_DATA_DEFINE() */
+  uint8_t len;
+  uint8_t weight;          /* Slots per rotation, 0 to skip the frame */
+} Adv_Frame_t;
+
+typedef struct {
+  const Adv_Frame_t *frames;
+  uint8_t n_frames;
+  uint16_t slot_ms;        /* Time each slot is on air */
+} Adv_Rotation_t;
+
+typedef struct {
+  uint32_t slots;          /* Slots elapsed */
+  uint32_t rotations;      /* Complete sequences */
+  uint32_t updates;        /* hci_le_set_advertising_data() calls, frame changes */
+  uint32_t refreshes;      /* Same, frame on air re-sent by Adv_RotateRefresh() */
+  uint32_t errors;         /* Calls refused by the stack, frame kept */
+} Adv_Rotate_Stats_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define ADV_ROTATE_MAX_FRAMES   8
+
+/* Longest sequence: sum of the weights */
+#define ADV_ROTATE_MAX_SLOTS    32
+
+/* Exported macro ------------------------------------------------------------*/
+/* Adv_Frame_t initializer of a payload array */
+#define ADV_FRAME(payload, weight)  { (payload), sizeof(payload), (weight) }
+
+/* Exported functions ------------------------------------------------------- */
+uint8_t Adv_RotateStart(const Adv_Rotation_t *rotation);
+void Adv_RotateStop(void);
+void Adv_RotateSetSlot(uint16_t slot_ms);
+uint8_t Adv_RotateRefresh(const uint8_t *data);
+uint8_t Adv_RotateCurrent(void);
+const Adv_Rotate_Stats_t *Adv_RotateGetStats(void);
+
+#endif /* ADV_ROTATE_H */
@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file    boot.h
+  * @brief   Boot path selection and boot time breakdown.
+  *
+  *          Boot_Init() reads the reset reason: after a warm reset (system
+  *          reset request, watchdog, lockup) the firmware takes the fast
+  *          boot path, which starts advertising with only what the first
+  *          advertisement needs and hands the rest of the init (and its
+  *          logging) to Boot_Defer(), run from the main loop once the first
+  *          radio event after the advertising start has been served. A cold
+  *          boot runs it in line, as before.
+  *
+  *          Boot_Mark() timestamps each stage from Boot_Init(), right after
+  *          SystemInit(), on the sleep timer, which keeps counting while the
+  *          core sleeps waiting for that first event. The breakdown is
+  *          logged when the deferred init is done (host simulation):
+  *
+  *            boot warm, reset 0x01: first advertisement at 10317 us
+  *            boot verify 0 us, platform 0 us, stack 3000 us, device 239 us, advertising 61 us, first event 7017 us
+  *            boot late init 510 us, after the first event
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef BOOT_H
+#define BOOT_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "scheduler.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+  BOOT_STAGE_VERIFY = 0,      /* Image check, image_verify.c */
+  BOOT_STAGE_PLATFORM,        /* UART, log, clock, GPIO */
+  BOOT_STAGE_STACK,           /* BlueNRG_Stack_Initialization() */
+  BOOT_STAGE_DEVICE,          /* Address, TX power, GATT and GAP init */
+  BOOT_STAGE_ADVERTISING,     /* Advertising enabled */
+  BOOT_STAGE_FIRST_ADV,       /* First radio event served */
+  BOOT_STAGE_LATE,            /* Deferred init done */
+  BOOT_STAGE_COUNT
+} Boot_Stage_t;
+
+typedef struct {
+  uint8_t  reset_reason;              /* SysCtrl_GetWakeupResetReason() */
+  uint8_t  warm;                      /* Reset with the RAM kept */
+  uint8_t  fast;                      /* Fast boot path taken */
+  uint8_t  marked;                    /* Bit mask of the stages reached */
+  uint32_t at_us[BOOT_STAGE_COUNT];   /* End of each stage, since Boot_Init() */
+} Boot_Stats_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* Fast boot path after warm resets, 0 to always boot in full */
+#ifndef BOOT_FAST_ENABLE
+#define BOOT_FAST_ENABLE        1
+#endif
+
+/* Deferred init without a radio event (advertising not started), ms */
+#define BOOT_LATE_TIMEOUT_MS    500
+
+/* Exported functions ------------------------------------------------------- */
+void Boot_Init(void);
+uint8_t Boot_Fast(void);
+void Boot_Mark(Boot_Stage_t stage);
+void Boot_Defer(Sched_Handler late_init);
+void Boot_RadioIrq(void);
+void Boot_Report(void);
+const char *Boot_StageName(Boot_Stage_t stage);
+const Boot_Stats_t *Boot_GetStats(void);
+
+#endif /* BOOT_H */
@@ -0,0 +1,63 @@
+/**
+  ******************************************************************************
+  * @file    button.h
+  * @brief   Interrupt driven push button (IO13, active low).
+  *
+  *          Edges are debounced in GPIO_Handler() by comparing timestamps and
+  *          pushed into a lock-free single-producer (ISR) / single-consumer
+  *          (main loop) queue. The main loop drains the queue when the
+  *          scheduler delivers SCHED_EVT_GPIO. The pin is never sampled while
+  *          the button is idle, but once after a deep sleep that the button
+  *          ended (BlueNRG_WakeupSource()): the edge that wakes the core
+  *          (BUTTON_WAKEUP_IO) raises no GPIO interrupt, the GPIO block was
+  *          powered down.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef BUTTON_H
+#define BUTTON_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "clock.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+  tClockTime timestamp;    /* Sched_Now() when the edge was accepted */
+  uint8_t    pressed;      /* New state of the button */
+} Button_Event_t;
+
+typedef void (*Button_Callback)(const Button_Event_t *evt);
+
+/* Button counters */
+typedef struct {
+  uint32_t edges;          /* Edge interrupts taken */
+  uint32_t accepted;       /* Events queued */
+  uint32_t bounces;        /* Edges rejected by the debounce window */
+  uint32_t settles;        /* Events queued by the end of bounce check */
+  uint32_t wakes;          /* Events queued by the read after a deep sleep */
+  uint32_t dropped;        /* Events lost because the queue was full */
+} Button_Stats_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define BUTTON_PIN              GPIO_Pin_13
+#define BUTTON_WAKEUP_IO        WAKEUP_IO13
+
+/* Edges closer than this to the last accepted one are contact bounce */
+#define BUTTON_DEBOUNCE_MS      20
+
+/* Delay of the end of bounce check allowed to stay off the radio activity */
+#define BUTTON_SETTLE_SLACK_MS  8
+
+/* Event queue depth, must be a power of 2 */
+#define BUTTON_QUEUE_SIZE       8
+
+/* Exported functions ------------------------------------------------------- */
+void Button_Init(Button_Callback callback);
+void Button_IrqHandler(void);
+uint8_t Button_GetEvent(Button_Event_t *evt);
+uint8_t Button_IsPressed(void);
+const Button_Stats_t *Button_GetStats(void);
+
+#endif /* BUTTON_H */
@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file    crash.h
+  * @brief   Post-mortem crash record kept across the reset.
+  *
+  *          HardFault_Handler(), hci_hardware_error_event() and the
+  *          watchdog interrupt (supervisor.h) write the cause, the exception
+  *          frame (r0-r3, r12, LR, PC, xPSR), the stack pointer, the uptime,
+  *          the hardware error code or the supervised task that missed its
+  *          deadline to crash_record, then reset the device at once. crash_record lives in .noinit:
+  *          neither the startup code nor the C library clears it, and the RAM
+  *          keeps its contents across a system reset. A magic word and a
+  *          check word tell a record from the random contents of RAM at
+  *          power on.
+  *
+  *          Crash_BootReport(), called once the log is up, sends the record
+  *          of the last crash (if not sent yet) over the log.
+  *          tools/crash_decode.py symbolizes those lines against the ELF.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CRASH_H
+#define CRASH_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+  CRASH_CODE_NONE = 0,
+  CRASH_CODE_HARD_FAULT,      /* HardFault_Handler(): frame and SP valid */
+  CRASH_CODE_HW_ERROR,        /* hci_hardware_error_event(): LR is its caller, no frame */
+  CRASH_CODE_WATCHDOG,        /* Sup_WatchdogIrq(): frame interrupted, task that missed */
+} Crash_Code_t;
+
+typedef struct {
+  uint32_t magic;             /* CRASH_MAGIC new, CRASH_MAGIC_REPORTED once logged */
+  uint32_t count;             /* Crashes since power on */
+  uint32_t code;              /* Crash_Code_t */
+  uint32_t r0;                /* Exception frame, as stacked by the core */
+  uint32_t r1;
+  uint32_t r2;
+  uint32_t r3;
+  uint32_t r12;
+  uint32_t lr;
+  uint32_t pc;
+  uint32_t xpsr;
+  uint32_t sp;                /* Stack pointer before the exception */
+  uint32_t exc_return;        /* LR on handler entry */
+  uint32_t uptime_ms;         /* Sched_Now() */
+  uint32_t hw_error;          /* Hardware_Code of hci_hardware_error_event() */
+  uint32_t task;              /* Watchdog: Sup_Task_t to blame */
+  uint32_t miss;              /* Watchdog: Sup_Miss_t of that task */
+  uint32_t miss_value;        /* Watchdog: ms or us, see Sup_Miss_t */
+  uint32_t check;             /* ~(sum of the words above) */
+} Crash_Record_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define CRASH_MAGIC             0xC0DEDEADUL
+#define CRASH_MAGIC_REPORTED    0xC0DE600DUL
+
+/* Size of the exception frame stacked by the Cortex-M0, bytes */
+#define CRASH_FRAME_SIZE        32
+
+/* Exported variables --------------------------------------------------------*/
+extern Crash_Record_t crash_record;
+
+/* Exported functions ------------------------------------------------------- */
+/* Crash_Fault() is only called from the assembly of HardFault_Handler(): used keeps it in LTO builds */
+void Crash_Fault(const uint32_t *frame, uint32_t exc_return, uint32_t code) __attribute__((noreturn, used));
+void Crash_HardwareError(uint8_t hw_error, uint32_t caller) __attribute__((noreturn));
+void Crash_Watchdog(const uint32_t *frame, uint32_t exc_return, uint32_t task, uint32_t miss,
+                    uint32_t miss_value) __attribute__((noreturn));
+Crash_Code_t Crash_BootReport(void);
+uint8_t Crash_RecordValid(const Crash_Record_t *rec);
+
+#endif /* CRASH_H */
@@ -0,0 +1,24 @@
+/**
+  ******************************************************************************
+  * @file    crc32.h
+  * @brief   CRC32 of firmware images (IEEE 802.3 polynomial, as zlib and
+  *          the crc32 of Python), chainable: Crc32_Update(0, ...) starts a
+  *          CRC, and the CRC of data split in parts is the one of the whole.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CRC32_H
+#define CRC32_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Reversed polynomial */
+#define CRC32_POLY              0xEDB88320UL
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t Crc32_Update(uint32_t crc, const uint8_t *data, uint32_t len);
+
+#endif /* CRC32_H */
@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file    image_verify.h
+  * @brief   Boot time check of the application image in an OTA bank
+  *          (ST_OTA_LOWER/HIGHER_APPLICATION of BlueNRG1.ld), with the
+  *          verified state cached in flash: the CRC32 of the whole image
+  *          only runs on the first boot of a new image.
+  *
+  *          The state is a log of 16 bytes records in the upper 1 KB of
+  *          the page after the banks (the first part of the NVM area of
+  *          the 2-app memory map). The page also holds the MAC address of
+  *          the module (main.c): it is never erased, records are appended
+  *          and only ever have bits cleared.
+  *
+  *            address, size, crc    written with the image (OTA service,
+  *                                  ImageVerify_Updated()), or by the first
+  *                                  boot of an image loaded by the debugger
+  *            check                 erased until the boot CRC: ~crc when it
+  *                                  matched, 0 when it did not
+  *
+  *          At boot, the last record of the running bank gives the result:
+  *          checked, nothing to do; not checked yet, CRC32 of the bank; no
+  *          record (or another size), CRC32 of the image as linked, then a
+  *          record for it. A full log leaves the check uncached: the CRC
+  *          runs at every boot.
+  *
+  *          A new image that fails its check is not run: ImageVerify_Fallback()
+  *          resets into the image of the other bank when its record shows it
+  *          passed and it still matches its CRC32. With none, the image runs
+  *          on, the failure shown by Led_ShowError(IMAGE_VERIFY_LED_CODE)
+  *          and the OTA service of the OTA profiles left to take a new image.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef IMAGE_VERIFY_H
+#define IMAGE_VERIFY_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+  IMAGE_VERIFY_NO_BANK = 0,   /* Image not in an OTA bank: not checked */
+  IMAGE_VERIFY_CACHED,        /* Checked on an earlier boot */
+  IMAGE_VERIFY_UPDATED,       /* New image: CRC32 matched, check recorded */
+  IMAGE_VERIFY_FIRST,         /* No record: CRC32 of the image as linked recorded */
+  IMAGE_VERIFY_UNCACHED,      /* Log full: CRC32 computed, not recorded */
+  IMAGE_VERIFY_FAILED,        /* CRC32 of the new image wrong, now or on an earlier boot */
+} ImageVerify_Result_t;
+
+typedef struct {
+  uint32_t address;
+  uint32_t size;
+  uint32_t crc;
+  uint32_t check;
+} ImageVerify_Record_t;
+
+typedef struct {
+  uint8_t  result;            /* ImageVerify_Result_t */
+  uint8_t  records;           /* Records in the log */
+  uint32_t address;           /* Running image */
+  uint32_t size;
+  uint32_t crc_bytes;         /* Bytes through the CRC32 at this boot */
+} ImageVerify_Stats_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* Record log: upper half of the page of the MAC address */
+#define IMAGE_VERIFY_LOG_ADDRESS    0x10066C00UL
+#define IMAGE_VERIFY_LOG_RECORDS    64
+
+#define IMAGE_VERIFY_ERASED         0xFFFFFFFFUL
+#define IMAGE_VERIFY_REJECTED       0UL
+
+/* Led_ShowError() code of a failed check, after those of crash.h */
+#define IMAGE_VERIFY_LED_CODE       4
+
+/* Exported functions ------------------------------------------------------- */
+ImageVerify_Result_t ImageVerify_Boot(void);
+void ImageVerify_Fallback(void);
+uint8_t ImageVerify_Updated(uint32_t address, uint32_t size, uint32_t crc);
+void ImageVerify_Report(void);
+const char *ImageVerify_ResultName(ImageVerify_Result_t result);
+const ImageVerify_Stats_t *ImageVerify_GetStats(void);
+
+#endif /* IMAGE_VERIFY_H */
@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file    led.h
+  * @brief   LED pattern engine (IO14): declarative blink sequences played
+  *          from the sleep timer.
+  *
+  *          A pattern is a table of steps, each one count blinks of on_ms
+  *          on then off_ms off, played once, a few times or forever. Each
+  *          edge is programmed on a virtual timer of the sleep timer, which
+  *          keeps counting in deep sleep, and set by its interrupt: the main
+  *          loop only runs when the pattern changes. Consecutive segments at
+  *          the same level take one timer period. A pattern played a given
+  *          number of times (status and error codes) then gives the LED back
+  *          to the last pattern played forever.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef LED_H
+#define LED_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+  uint16_t on_ms;             /* LED on, 0 for a pause */
+  uint16_t off_ms;            /* Then off */
+  uint8_t  count;             /* Blinks of this step */
+} Led_Step_t;
+
+typedef struct {
+  const Led_Step_t *steps;
+  uint8_t num_steps;
+  uint8_t repeat;             /* Passes over the steps, LED_REPEAT_FOREVER to loop */
+} Led_Pattern_t;
+
+/* LED counters */
+typedef struct {
+  uint32_t patterns;          /* Led_Play() calls */
+  uint32_t edges;             /* Timer interrupts served */
+  uint32_t timer_errors;      /* Virtual timer refused: the LED stays as it is */
+} Led_Stats_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define LED_PIN                 GPIO_Pin_14
+
+/* Virtual timer of the edges, SCHED_VTIMER_ID being the scheduler's */
+#define LED_VTIMER_ID           1
+
+#define LED_REPEAT_FOREVER      0
+
+/* Status and error codes: code short blinks, then a pause, shown
+   LED_CODE_REPEAT times. An error code starts with a long blink */
+#define LED_CODE_ON_MS          200
+#define LED_CODE_OFF_MS         300
+#define LED_CODE_PAUSE_MS       1500
+#define LED_CODE_LEAD_MS        1000
+#define LED_CODE_REPEAT         3
+
+/* Progress: the LED is on LED_PROGRESS_MIN_MS of each period at 0 %, all
+   but LED_PROGRESS_MIN_MS at 100 % */
+#define LED_PROGRESS_PERIOD_MS  1000
+#define LED_PROGRESS_MIN_MS     50
+
+/* Longest timer period of consecutive segments at the same level */
+#define LED_SEGMENT_MAX_MS      60000
+
+/* Idle (1 Hz) and button pressed (5 Hz) blinks */
+extern const Led_Pattern_t led_pattern_idle;
+extern const Led_Pattern_t led_pattern_pressed;
+
+/* Exported functions ------------------------------------------------------- */
+void Led_Init(void);
+void Led_Play(const Led_Pattern_t *pattern);
+void Led_ShowStatus(uint8_t code);
+void Led_ShowError(uint8_t code);
+void Led_ShowProgress(uint8_t percent);
+void Led_TimerIrq(void);
+const Led_Stats_t *Led_GetStats(void);
+
+#endif /* LED_H */
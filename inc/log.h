@@ -0,0 +1,111 @@
+/**
+  ******************************************************************************
+  * @file    log.h
+  * @brief   Non-blocking log transport over the UART.
+  *
+  *          PRINTF() formats into a preallocated line buffer and copies the
+  *          text into a ring drained by the UART TX FIFO interrupt, so the
+  *          caller never waits for the UART. When the ring is full the whole
+  *          message is dropped and counted; a "<n lost>" marker is emitted as
+  *          soon as there is room again.
+  *
+  *          Built with LOG_TOKENIZED (make LOG_MODE=tokenized), PRINTF()
+  *          does no formatting at all: the format string goes to the
+  *          .log_fmt section, which is not loaded in flash, and only its
+  *          16-bit offset in that section and the raw arguments are sent.
+  *          tools/log_decode.py rebuilds the text from the ELF file.
+  *
+  *          Log_Printf(), Log_Token() and Log_Write() must be called from the
+  *          main loop (thread mode), not from interrupt handlers.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef LOG_H
+#define LOG_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+  uint32_t messages;       /* Messages queued */
+  uint32_t bytes;          /* Bytes queued */
+  uint32_t dropped;        /* Messages dropped because the ring was full */
+  uint16_t high_water;     /* Maximum ring occupancy in bytes */
+} Log_Stats_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* Ring size in bytes, must be a power of 2. The Makefile profiles that free
+   stack RAM (inc/Beacon_config.h) give it a larger one */
+#define LOG_RING_SIZE_DEFAULT   512
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE           LOG_RING_SIZE_DEFAULT
+#endif
+
+/* Longest formatted message, longer ones are truncated */
+#define LOG_LINE_MAX            96
+
+/* Tokenized frames: id (2 bytes, little endian), payload length (1 byte),
+   payload. Integers are sent as unsigned LEB128 of their 32 or 64-bit
+   value, strings as a length byte and at most LOG_TOKEN_STR_MAX
+   characters. */
+#define LOG_TOKEN_HEADER        3
+#define LOG_TOKEN_STR_MAX       32
+#define LOG_TOKEN_VARINT_MAX    10
+
+/* Argument types, 2 bits per argument in the types word of Log_Token() */
+#define LOG_ARG_INT             0
+#define LOG_ARG_STR             1
+#define LOG_ARG_INT64           2
+
+/* Id of the frame reporting the number of messages dropped */
+#define LOG_TOKEN_LOST          0xFFFF
+
+/* Exported macro ------------------------------------------------------------*/
+/* Type of one argument, float is not supported */
+#define LOG_ARG_TYPE(x)         _Generic((x), char *: LOG_ARG_STR, const char *: LOG_ARG_STR, \
+                                          default: (sizeof(x) > 4 ? LOG_ARG_INT64 : LOG_ARG_INT))
+
+/* Number of arguments after the format */
+#define LOG_NARGS(fmt, ...)     LOG_NARGS_(fmt, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, n, ...) n
+#define LOG_CAT(a, b)           LOG_CAT_(a, b)
+#define LOG_CAT_(a, b)          a##b
+
+#define LOG_ARG_TYPES(fmt, ...) LOG_CAT(LOG_ARG_TYPES_, LOG_NARGS(fmt, ##__VA_ARGS__))(__VA_ARGS__)
+#define LOG_ARG_TYPES_0()       0
+#define LOG_ARG_TYPES_1(a)      LOG_ARG_TYPE(a)
+#define LOG_ARG_TYPES_2(a, ...) (LOG_ARG_TYPE(a) | (LOG_ARG_TYPES_1(__VA_ARGS__) << 2))
+#define LOG_ARG_TYPES_3(a, ...) (LOG_ARG_TYPE(a) | (LOG_ARG_TYPES_2(__VA_ARGS__) << 2))
+#define LOG_ARG_TYPES_4(a, ...) (LOG_ARG_TYPE(a) | (LOG_ARG_TYPES_3(__VA_ARGS__) << 2))
+#define LOG_ARG_TYPES_5(a, ...) (LOG_ARG_TYPE(a) | (LOG_ARG_TYPES_4(__VA_ARGS__) << 2))
+#define LOG_ARG_TYPES_6(a, ...) (LOG_ARG_TYPE(a) | (LOG_ARG_TYPES_5(__VA_ARGS__) << 2))
+
+/* Tokenized log call: fmt must be a string literal, at most 6 arguments.
+   The link places .log_fmt at address 0, so the address of the string is
+   its token. */
+#define LOG_TOKEN(fmt, ...) do {                                                   \
+    static const char log_fmt_[] __attribute__((section(".log_fmt"), used)) = fmt; \
+    Log_Token((uint16_t)(uintptr_t)log_fmt_, LOG_NARGS(fmt, ##__VA_ARGS__),        \
+              LOG_ARG_TYPES(fmt, ##__VA_ARGS__), ##__VA_ARGS__);                   \
+  } while (0)
+
+#ifdef LOG_TOKENIZED
+#define PRINTF(...)             LOG_TOKEN(__VA_ARGS__)
+#else
+#define PRINTF(...)             Log_Printf(__VA_ARGS__)
+#endif
+
+/* Exported functions ------------------------------------------------------- */
+void Log_Init(void);
+int Log_Printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void Log_Token(uint16_t id, uint8_t nargs, uint16_t types, ...);
+uint8_t Log_Write(const uint8_t *data, uint16_t len);
+uint16_t Log_Room(void);
+uint8_t Log_Busy(void);
+void Log_Flush(void);
+void Log_UartIrqHandler(void);
+const Log_Stats_t *Log_GetStats(void);
+
+#endif /* LOG_H */
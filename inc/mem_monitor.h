@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file    mem_monitor.h
+  * @brief   Run time stack and heap use.
+  *
+  *          Mem_StackPaint() fills the free part of CSTACK (the
+  *          _Min_Stack_Size bytes at the top of RAM, see BlueNRG1.ld) with
+  *          MEM_PAINT_PATTERN at boot. The sampler started by
+  *          Mem_MonitorStart() scans it from the bottom: the first word that
+  *          lost the pattern is the deepest the stack has been, interrupts
+  *          (Blue_Handler(), RAL_Isr()) included. A new peak is logged, and
+  *          Mem_StackMarginByte() gives the margin left for the advertising
+  *          payload.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef MEM_MONITOR_H
+#define MEM_MONITOR_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+  uint32_t stack_size;     /* Bytes of CSTACK */
+  uint32_t stack_peak;     /* Deepest stack use seen, bytes */
+  uint32_t heap_used;      /* Bytes allocated by malloc() */
+  uint32_t heap_free;      /* Bytes malloc() can still return */
+  uint32_t samples;
+  uint8_t  overflow;       /* Paint gone down to the bottom word: stack_peak is a lower bound */
+} Mem_Stats_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define MEM_PAINT_PATTERN       0xA5A5A5A5UL
+
+/* Bytes left unpainted under the stack pointer of Mem_StackPaint(): its
+   own frame */
+#define MEM_PAINT_GUARD         64
+
+/* Size of the _sbrk() heap of SDK_EVAL_Com.c (.bss.heap) */
+#ifndef MEM_HEAP_SIZE
+#define MEM_HEAP_SIZE           0x1000
+#endif
+
+/* Delay of a sample allowed to stay off the radio activity */
+#define MEM_SAMPLE_SLACK_MS     500
+
+/* Unit of Mem_StackMarginByte(), bytes */
+#define MEM_MARGIN_UNIT         16
+
+/* Exported functions ------------------------------------------------------- */
+void Mem_PaintRegion(uint32_t *bottom, uint32_t *top);
+uint32_t Mem_ScanRegion(const uint32_t *bottom, const uint32_t *top);
+
+void Mem_StackPaint(void);
+void Mem_MonitorStart(uint32_t period_ms);
+void Mem_Sample(void);
+uint8_t Mem_StackMarginByte(void);
+const Mem_Stats_t *Mem_GetStats(void);
+
+#endif /* MEM_MONITOR_H */
@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * @file    ota_delta.h
+  * @brief   Streaming decoder of delta OTA images: the new application image
+  *          rebuilt from a compressed stream, against the image running in
+  *          the other bank or on its own, and programmed straight into the
+  *          inactive bank of the 2-app scheme of BlueNRG1.ld
+  *          (ST_OTA_LOWER_APPLICATION, ST_OTA_HIGHER_APPLICATION).
+  *
+  *          A delta image is a header, then operations building the new
+  *          image from its start:
+  *
+  *            header   magic, new image size, new image CRC32, old image
+  *                     size, old image CRC32 (LE32 each); old size 0 for a
+  *                     compressed image without base
+  *            op       kind (bits 7-6) and length code (bits 5-0): length
+  *                     less the minimum of the kind, OTA_DELTA_LEN_EXT for a
+  *                     varint (LEB128) holding the rest of the length
+  *              LITERAL  length bytes follow
+  *              OLD      copy from the old image; zigzag varint: source less
+  *                       the old cursor, which moves past the copy
+  *              NEW      copy from the new image; varint: distance back - 1
+  *              FILL     one byte follows, repeated
+  *
+  *          The copies read their source from the flash, where both banks
+  *          are memory mapped: the decoder keeps in RAM only its parsing
+  *          state and the program burst being filled (OtaDelta_t). Each page
+  *          of the inactive bank is erased when the image reaches it. The
+  *          running image must match the old CRC32 of the header before the
+  *          first page is erased, and the new image is checked against its
+  *          CRC32 once its last burst is programmed. Its OTA tag (vector
+  *          table entry OTA_TAG_VECTOR_TABLE_ENTRY_INDEX) is kept aside and
+  *          its word left erased, for the OTA service to program it once the
+  *          image is complete (OtaDelta_Image()).
+  *
+  *          The OTA service hands the image content to OtaDelta_Write() in
+  *          place of programming it when the image starts with
+  *          OTA_DELTA_MAGIC (a full image starts with its initial stack
+  *          pointer, 0x2000xxxx). host/src/delta_tool.c builds delta images
+  *          from two .bin files.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef OTA_DELTA_H
+#define OTA_DELTA_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Application banks of the 2-app scheme: 76 KB each after the 2 KB reset
+   manager */
+#define OTA_DELTA_BANK_LOWER        0x10040800UL
+#define OTA_DELTA_BANK_HIGHER       0x10053800UL
+#define OTA_DELTA_BANK_SIZE         0x13000UL
+
+/* "DLT1" */
+#define OTA_DELTA_MAGIC             0x31544C44UL
+#define OTA_DELTA_HEADER_WORDS      5
+#define OTA_DELTA_HEADER_LEN        (OTA_DELTA_HEADER_WORDS * 4)
+
+/* Operation kinds, bits 7-6 of the op byte */
+#define OTA_DELTA_OP_LITERAL        0
+#define OTA_DELTA_OP_OLD            1
+#define OTA_DELTA_OP_NEW            2
+#define OTA_DELTA_OP_FILL           3
+#define OTA_DELTA_OP_SHIFT          6
+
+/* Length code of a length continued by a varint */
+#define OTA_DELTA_LEN_EXT           0x3F
+
+/* Shortest copy or fill: shorter ones go as literals */
+#define OTA_DELTA_MATCH_MIN         4
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+  OTA_DELTA_MORE = 0,           /* Image not complete yet */
+  OTA_DELTA_DONE,               /* New image programmed and checked */
+  OTA_DELTA_ERR_FORMAT,         /* Bad header or operation out of bounds */
+  OTA_DELTA_ERR_BASE,           /* Running image is not the base of the delta */
+  OTA_DELTA_ERR_FLASH,          /* Burst not programmed as written */
+  OTA_DELTA_ERR_CRC             /* New image does not match its CRC32 */
+} OtaDelta_Status_t;
+
+/* Decoder state */
+typedef struct {
+  uint8_t  state;
+  uint8_t  kind;                /* Operation being decoded */
+  uint8_t  shift;               /* Varint bits read */
+  uint8_t  status;              /* OtaDelta_Status_t */
+  uint32_t header[OTA_DELTA_HEADER_WORDS];
+  uint32_t in;                  /* Delta image bytes read */
+  uint32_t len;                 /* Bytes left in the operation */
+  uint32_t arg;                 /* Varint being read */
+  uint32_t old_pos;             /* Old image cursor */
+  uint32_t out;                 /* New image bytes produced */
+  uint32_t crc;                 /* CRC32 of the bytes programmed */
+  uint32_t new_address;         /* Inactive bank */
+  uint32_t old_address;         /* Running bank */
+  uint32_t tag;                 /* OTA tag of the new image, not programmed */
+  uint32_t burst[4];            /* Next 16 bytes of the new image, one program burst */
+} OtaDelta_t;
+
+/* Decoder counters, since OtaDelta_Start() */
+typedef struct {
+  uint32_t ops;                 /* Operations decoded */
+  uint32_t literal_bytes;       /* New image bytes by operation kind */
+  uint32_t old_bytes;
+  uint32_t new_bytes;
+  uint32_t fill_bytes;
+  uint32_t crc_bytes;           /* Old and new image bytes run through Crc32_Update() */
+  uint32_t pages;               /* Pages erased */
+  uint32_t bursts;              /* Bursts programmed */
+} OtaDelta_Stats_t;
+
+/* Exported functions ------------------------------------------------------- */
+uint8_t OtaDelta_IsDelta(const uint8_t *data, uint16_t len);
+void OtaDelta_Start(uint32_t new_address, uint32_t old_address);
+OtaDelta_Status_t OtaDelta_Write(const uint8_t *data, uint16_t len);
+void OtaDelta_Image(uint32_t *size, uint32_t *crc, uint32_t *tag);
+const OtaDelta_Stats_t *OtaDelta_GetStats(void);
+
+#endif /* OTA_DELTA_H */
@@ -0,0 +1,106 @@
+/**
+  ******************************************************************************
+  * @file    ota_service.h
+  * @brief   OTA service of the application (BEACON_OTA_SERVICE profiles of
+  *          Beacon_config.h): image transfer into the inactive bank of the
+  *          2-app scheme of BlueNRG1.ld (ST_OTA_LOWER_APPLICATION,
+  *          ST_OTA_HIGHER_APPLICATION), the application running from the
+  *          other one. Same UUIDs and packets as the OTA service of the
+  *          BlueNRG-1 DK (BLE_Application/OTA), so the ST OTA clients work
+  *          with it:
+  *
+  *          - the client writes the notification range, image size and base
+  *            address (LE32 each) on the New Image characteristic; the base
+  *            must be the inactive bank, given with its size by the Image
+  *            characteristic;
+  *          - then it streams image packets on the Image Content one:
+  *            checksum, blocks of 16 bytes, needs ack, sequence number (LSB
+  *            first), the checksum being the XOR of the other bytes;
+  *          - each packet in sequence with a good checksum is programmed in
+  *            bursts of 16 bytes, a page being erased when the image reaches
+  *            its start, and each burst is read back;
+  *          - a packet with its needs ack byte set, or refused, is answered
+  *            by an Expected Image Sequence Number notification: next
+  *            sequence number (LSB first), then an error code.
+  *
+  *          Image content starting with OTA_DELTA_MAGIC is a delta image
+  *          against the running image (inc/ota_delta.h): the packets go to
+  *          the decoder, which programs the new image into the inactive bank
+  *          and checks it against the CRC32 of its header.
+  *
+  *          The image is only made bootable once complete: its OTA tag
+  *          (vector table entry OTA_TAG_VECTOR_TABLE_ENTRY_INDEX) stays
+  *          erased until the last packet, then it is programmed if the image
+  *          carries OTA_VALID_TAG there, and the tag of the running image
+  *          set to OTA_INVALID_OLD_TAG. The DK reset manager boots the bank
+  *          with the valid tag at the next reset. The CRC32 of the image is
+  *          recorded before, so that its first boot checks it and falls back
+  *          to the running image if it does not match (inc/image_verify.h).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef OTA_SERVICE_H
+#define OTA_SERVICE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+  OTA_SERVICE_IDLE = 0,         /* No image announced */
+  OTA_SERVICE_RECEIVING,        /* New Image written, image packets coming */
+  OTA_SERVICE_COMMITTED,        /* Image complete and tagged valid: boots at the next reset */
+  OTA_SERVICE_FAILED,           /* Transfer given up: flash error or image without a valid tag */
+} OtaService_State_t;
+
+typedef struct {
+  uint8_t  state;               /* OtaService_State_t */
+  uint32_t image_size;          /* Image announced by the client */
+  uint32_t base_address;
+  uint32_t written;             /* Bytes programmed, or of a delta image decoded */
+  uint32_t packets;             /* Image packets accepted */
+  uint32_t acks;                /* Expected sequence number notifications */
+  uint32_t errors;              /* Writes refused: New Image, sequence, checksum, flash */
+  uint8_t  delta;               /* Delta image (inc/ota_delta.h) */
+  uint8_t  delta_status;        /* OtaDelta_Status_t of the last packet */
+} OtaService_Stats_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* 128-bit UUIDs of the DK OTA service, LSB first as aci_gatt_add_service()
+   and aci_gatt_add_char() take them: b0b1b2b3-b4b5-11e3-baa7-0800200c9a66 */
+#define OTA_SERVICE_UUID(b0, b1, b2, b3, b4, b5) \
+  { 0x66, 0x9a, 0x0c, 0x20, 0x00, 0x08, 0xa7, 0xba, 0xe3, 0x11, (b5), (b4), (b3), (b2), (b1), (b0) }
+#define OTA_SERVICE_UUID_SERVICE    OTA_SERVICE_UUID(0x8a, 0x97, 0xf7, 0xc0, 0x85, 0x06)
+#define OTA_SERVICE_UUID_IMAGE      OTA_SERVICE_UUID(0x12, 0x2e, 0x8c, 0xc0, 0x85, 0x08)
+#define OTA_SERVICE_UUID_NEW_IMAGE  OTA_SERVICE_UUID(0x21, 0x0f, 0x99, 0xf0, 0x85, 0x08)
+#define OTA_SERVICE_UUID_CONTENT    OTA_SERVICE_UUID(0x26, 0x91, 0xaa, 0x80, 0x85, 0x08)
+#define OTA_SERVICE_UUID_EXPECTED   OTA_SERVICE_UUID(0x2b, 0xdc, 0x57, 0x60, 0x85, 0x08)
+
+/* Attribute records: service, 4 characteristics (declaration and value)
+   and the client configuration of the notifications */
+#define OTA_SERVICE_ATTRIBUTES      10
+
+/* Image characteristic: base address and size of the inactive bank */
+#define OTA_SERVICE_IMAGE_LEN       8
+
+/* New Image characteristic: notification range, image size, base address */
+#define OTA_SERVICE_NEW_IMAGE_LEN   9
+
+/* Image packet: checksum, blocks, needs ack, sequence number */
+#define OTA_SERVICE_BLOCK_SIZE      16
+#define OTA_SERVICE_PACKET_OVERHEAD 4
+
+/* Expected Image Sequence Number notification and its error codes */
+#define OTA_SERVICE_NOTIFY_LEN      3
+#define OTA_SERVICE_NO_ERROR        0x00
+#define OTA_SERVICE_SEQUENCE_ERROR  0xF0
+#define OTA_SERVICE_CHECKSUM_ERROR  0x0F
+#define OTA_SERVICE_FLASH_ERROR     0xFF
+
+/* Exported functions ------------------------------------------------------- */
+uint8_t OtaService_Init(uint32_t running_address, uint16_t content_len);
+void OtaService_Write(uint16_t conn_handle, uint16_t attr_handle, uint16_t len, const uint8_t *data);
+const OtaService_Stats_t *OtaService_GetStats(void);
+
+#endif /* OTA_SERVICE_H */
@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @file    prof.h
+  * @brief   Cycle profiler of the hot paths: per-site histograms of the time
+  *          between PROF_BEGIN() and PROF_END().
+  *
+  *          The time base is MFT1 timer 1 running free on the system clock
+  *          (one count per CPU cycle at 16 MHz). Each site keeps the number
+  *          of runs, the minimum, maximum and total cycles and a histogram
+  *          with one bucket per power of 2. Prof_Dump() sends them over the
+  *          log transport, a few lines per main loop pass so the log ring
+  *          never overflows. The same code runs in the host simulation,
+  *          against the simulated MFT (host/src/sim_mft.c).
+  *
+  *          PROF_INIT() registers the MFT with the sleep manager, which
+  *          stops the counter before a deep sleep (the MFT is not kept in
+  *          it); the next PROF_BEGIN(), in the wakeup interrupt or the main
+  *          loop, starts it again. The counter is 16 bits wide: a scope longer than
+  *          PROF_WRAP_CYCLES is folded. Interrupts taken inside a scope
+  *          count in it. A site must be recorded from one context only (main
+  *          loop or one interrupt handler).
+  *
+  *          Without PROF_ENABLED (make CYCLE_PROF=0, the default) the macros
+  *          compile to nothing.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef PROF_H
+#define PROF_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* One bucket per bit of the counter: bucket b holds [2^b, 2^(b+1)) cycles,
+   bucket 0 also holds 0 */
+#define PROF_BUCKETS            16
+#define PROF_WRAP_CYCLES        0x10000UL
+
+/* MFT counter clock: system clock divided by MFT_Prescaler + 1 */
+#ifndef PROF_CLOCK_HZ
+#define PROF_CLOCK_HZ           16000000UL
+#endif
+
+/* Retry delay of a dump waiting for room in the log ring */
+#define PROF_DUMP_RETRY_MS      20
+
+/* Delay of the next dump lines allowed to stay off the radio activity */
+#define PROF_DUMP_SLACK_MS      20
+
+/* Exported types ------------------------------------------------------------*/
+/* Profiled sites, named by prof_site_names[] of prof.c */
+typedef enum {
+  PROF_SITE_LOOP = 0,       /* Sched_RunOnce() pass, sleep excluded */
+  PROF_SITE_STACK_TICK,     /* BTLE_StackTick() */
+  PROF_SITE_RAL_ISR,        /* RAL_Isr() in Blue_Handler() */
+  PROF_SITE_TIMER_JOB,      /* One timer job */
+  PROF_SITE_BLUE_ISR,       /* Blue_Handler(), entry to exit */
+  PROF_SITE_SYSTICK,        /* SysTick_Handler(), entry to exit */
+  PROF_SITE_COUNT
+} Prof_Site_t;
+
+/* Counters of one site */
+typedef struct {
+  uint32_t count;
+  uint16_t min;
+  uint16_t max;
+  uint64_t total;
+  uint32_t hist[PROF_BUCKETS];
+} Prof_Stats_t;
+
+/* Exported macro ------------------------------------------------------------*/
+#ifdef PROF_ENABLED
+#define PROF_INIT()             Prof_Init()
+#define PROF_BEGIN(site)        uint16_t prof_start_##site = Prof_Now()
+#define PROF_END(site)          Prof_Record((site), (uint16_t)(prof_start_##site - Prof_Now()))
+#else
+#define PROF_INIT()             ((void)0)
+#define PROF_BEGIN(site)        ((void)0)
+#define PROF_END(site)          ((void)0)
+#endif
+
+/* Exported functions ------------------------------------------------------- */
+void Prof_Init(void);
+void Prof_Suspend(void);
+uint16_t Prof_Now(void);
+void Prof_Record(Prof_Site_t site, uint16_t cycles);
+void Prof_Reset(void);
+void Prof_Dump(void);
+uint8_t Prof_Bucket(uint16_t cycles);
+const char *Prof_SiteName(Prof_Site_t site);
+const Prof_Stats_t *Prof_GetStats(Prof_Site_t site);
+
+#endif /* PROF_H */
@@ -0,0 +1,37 @@
+/**
+  ******************************************************************************
+  * @file    ramfunc.h
+  * @brief   Placement of hot code in RAM, where it runs without the flash
+  *          wait states.
+  *
+  *          RAMFUNC puts a function in the .ramfunc section, which
+  *          BlueNRG1.ld links at the end of .data (between _sramfunc and
+  *          _eramfunc): the startup copies it from flash with the data,
+  *          before main(), and it is kept in sleep like the data. It costs
+  *          its size twice, once in flash for the copy and once in RAM.
+  *
+  *          RAM and flash are too far apart for a BL: calls between them go
+  *          through the long branch veneers the linker adds (a few cycles
+  *          and 12 bytes each). RAMFUNC suits the short interrupt wrappers
+  *          that do their work in place; code that mostly calls into flash
+  *          (the main loop pass) pays a veneer per call and gains nothing
+  *          for its RAM. tools/mem_report.py lists the RAM code and the
+  *          veneers of the build.
+  *
+  *          The host simulation has one memory: RAMFUNC is empty there.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef RAMFUNC_H
+#define RAMFUNC_H
+
+/* Exported macro ------------------------------------------------------------*/
+/* Not inlined: a copy in a flash caller would defeat the placement */
+#ifndef HOST_SIM
+#define RAMFUNC                 __attribute__((section(".ramfunc"), noinline))
+#else
+#define RAMFUNC
+#endif
+
+#endif /* RAMFUNC_H */
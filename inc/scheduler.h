@@ -0,0 +1,115 @@
+/**
+  ******************************************************************************
+  * @file    scheduler.h
+  * @brief   Cooperative event/timer scheduler for the application main loop.
+  *
+  *          The main loop no longer polls: work is expressed as timer jobs
+  *          (deadline + optional period), events posted from interrupt
+  *          context (GPIO edges, radio activity) and stack tick requests.
+  *          When nothing is due the scheduler puts the core to sleep with
+  *          BlueNRG_Sleep() until the next deadline or the next interrupt.
+  *
+  *          Timer deadlines are absolute tClockTime values compared modulo
+  *          2^32 (SCHED_TIME_REACHED()), so jobs keep their period across the
+  *          49.7 day wraparound of the ms clock. Periodic jobs stay on the
+  *          grid of their first deadline; after a stall the policy of the job
+  *          chooses between running each missed period (one run per main
+  *          loop pass) and skipping to the next period ahead.
+  *
+  *          The stack reports the end of each radio activity and the start
+  *          of the next one (aci_hal_end_of_radio_activity_event()). A job
+  *          given a slack (Sched_TimerSetSlack()) is held while the radio
+  *          is about to transmit or transmitting, and runs in the pass
+  *          after the report, up to slack ms after its deadline. With a
+  *          slack of a radio interval (Sched_SetRadioInterval()) or more,
+  *          it always waits for the next report: it then runs on the
+  *          wakeup of the radio interrupt instead of its own. Never early.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "clock.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*Sched_Handler)(void);
+
+/* Scheduler counters, updated by Sched_RunOnce() */
+typedef struct {
+  uint32_t loops;          /* Main loop passes */
+  uint32_t wakeups;        /* Returns from BlueNRG_Sleep() */
+  uint32_t stack_ticks;    /* BTLE_StackTick() calls */
+  uint32_t timer_runs;     /* Timer jobs executed */
+  uint32_t timer_skips;    /* Periods skipped by SCHED_TIMER_SKIP jobs */
+  uint32_t event_runs;     /* Event handlers executed */
+  uint32_t sleep_ms;       /* Time spent inside BlueNRG_Sleep() */
+  uint32_t radio_reports;  /* End of radio activity events of the stack */
+  uint32_t timer_deferred; /* Runs held past a radio activity (overlaps avoided) */
+  uint32_t timer_overlaps; /* Runs started within SCHED_RADIO_GUARD_MS of a radio activity or in it */
+} Sched_Stats_t;
+
+/* What a periodic job does after missing periods (main loop stalled) */
+typedef enum {
+  SCHED_TIMER_SKIP = 0,    /* Run once, then the next period still ahead */
+  SCHED_TIMER_CATCH_UP     /* Run once per missed period, one per pass */
+} Sched_Policy_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* Size of the static timer job pool, at most 254 */
+#ifndef SCHED_MAX_TIMERS
+#define SCHED_MAX_TIMERS        8
+#endif
+
+/* Number of event slots (one bit each in the pending mask) */
+#define SCHED_MAX_EVENTS        8
+
+/* Virtual timer used to wake up from sleep at the next deadline */
+#define SCHED_VTIMER_ID         0
+
+/* Event slots */
+#define SCHED_EVT_STACK_TICK    0   /* Handled internally: run BTLE_StackTick() */
+#define SCHED_EVT_GPIO          1   /* GPIO edge interrupt */
+#define SCHED_EVT_BOOT          2   /* First radio event after boot (boot.c) */
+
+#define SCHED_EVT_MASK(evt)     (1UL << (evt))
+
+/* Invalid timer identifier returned when the pool is exhausted */
+#define SCHED_TIMER_INVALID     (0xFF)
+
+/* Time before the start of a radio activity kept free of held jobs: radio
+   setup and a short job */
+#define SCHED_RADIO_GUARD_MS    2
+
+/* Random advDelay the stack adds to each advertising interval */
+#define SCHED_RADIO_JITTER_MS   10
+
+/* Exported macro ------------------------------------------------------------*/
+/* Wrap-safe "time t has been reached at now" test for tClockTime values */
+#define SCHED_TIME_REACHED(now, t)   ((int32_t)((uint32_t)(now) - (uint32_t)(t)) >= 0)
+
+/* Exported functions ------------------------------------------------------- */
+void Sched_Init(void);
+
+uint8_t Sched_TimerStart(Sched_Handler job, uint32_t first_ms, uint32_t period_ms);
+void Sched_TimerStop(uint8_t id);
+void Sched_TimerSetPeriod(uint8_t id, uint32_t period_ms);
+void Sched_TimerSetPolicy(uint8_t id, Sched_Policy_t policy);
+void Sched_TimerSetSlack(uint8_t id, uint32_t slack_ms);
+
+void Sched_SetEventHandler(uint8_t evt, Sched_Handler handler);
+void Sched_PostEvent(uint8_t evt);
+void Sched_RequestStackTick(void);
+uint8_t Sched_EventsPending(void);
+
+void Sched_SetWakeupIO(uint8_t io_mask, uint8_t io_level);
+void Sched_SetRadioInterval(uint32_t interval_ms);
+
+tClockTime Sched_Now(void);
+void Sched_RunOnce(void);
+const Sched_Stats_t *Sched_GetStats(void);
+
+#endif /* SCHEDULER_H */
@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    sleep_mgr.h
+  * @brief   Sleep manager: the peripherals in use and their state across
+  *          deep sleep, and the wake latency of each sleep mode.
+  *
+  *          Each module that drives a peripheral registers it once at init,
+  *          with up to three hooks:
+  *
+  *            check    deepest SleepModes the peripheral allows now (UART
+  *                     still sending: CPU halt)
+  *            save     before a deep sleep (WAKETIMER or NOTIMER), with the
+  *                     interrupts masked
+  *            restore  after the deep sleep, from the main loop, before the
+  *                     next pass
+  *
+  *          The register copy of BlueNRG_Sleep() (DK sleep.c, with
+  *          context_switch.o) keeps the configuration of the peripherals; the
+  *          hooks cover what it cannot: a FIFO still sending, a counter that
+  *          stops, a GPIO edge raised while the GPIO block was powered down.
+  *          Saves run in registration order, restores in reverse.
+  *
+  *          App_SleepMode_Check() returns SleepMgr_Check(), which also
+  *          records the mode BlueNRG_Sleep() goes to. The scheduler brackets
+  *          the sleep with SleepMgr_Enter() and SleepMgr_Wake(): the wake
+  *          latency is the time from its deadline to the return of
+  *          BlueNRG_Sleep(), on the wakeups by its virtual timer, per mode.
+  *
+  *          SLEEP_MGR_MAX_MODE caps the sleep depth: make SLEEP_DEBUG=1
+  *          builds stop at CPU halt, which keeps the SWD port up for the
+  *          debugger.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef SLEEP_MGR_H
+#define SLEEP_MGR_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "sleep.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+  const char *name;
+  SleepModes (*check)(void);    /* NULL: any mode */
+  void (*save)(void);           /* NULL: nothing to save */
+  void (*restore)(void);        /* NULL: nothing to restore */
+} SleepMgr_Periph_t;
+
+/* Counters of one sleep mode */
+typedef struct {
+  uint32_t entries;             /* BlueNRG_Sleep() calls that went to this mode (RUNNING: refused) */
+  uint64_t sleep_us;            /* Time from entry to wakeup, sleep timer */
+  uint32_t timed;               /* Wakeups by the scheduler deadline, the latency samples */
+  uint32_t latency_min_us;
+  uint32_t latency_max_us;
+  uint64_t latency_total_us;
+} SleepMgr_Stats_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* Registered peripherals, at most */
+#define SLEEP_MGR_MAX_PERIPHS   6
+
+/* Deepest mode ever entered */
+#ifndef SLEEP_MGR_MAX_MODE
+#define SLEEP_MGR_MAX_MODE      SLEEPMODE_NOTIMER
+#endif
+
+/* Modes of SleepModes, the index of SleepMgr_GetStats() */
+#define SLEEP_MGR_MODES         (SLEEPMODE_NOTIMER + 1)
+
+/* SleepMgr_Enter() without a deadline */
+#define SLEEP_MGR_NO_DEADLINE   (-1)
+
+/* Exported functions ------------------------------------------------------- */
+void SleepMgr_Init(void);
+uint8_t SleepMgr_Register(const SleepMgr_Periph_t *periph);
+
+SleepModes SleepMgr_Check(SleepModes sleepMode);
+void SleepMgr_Enter(uint32_t now_sys, int32_t timeout_ms);
+SleepModes SleepMgr_Wake(uint32_t now_sys, uint8_t deadline);
+void SleepMgr_Restore(void);
+
+void SleepMgr_Report(void);
+const char *SleepMgr_ModeName(SleepModes mode);
+const SleepMgr_Stats_t *SleepMgr_GetStats(SleepModes mode);
+
+#endif /* SLEEP_MGR_H */
@@ -0,0 +1,102 @@
+/**
+  ******************************************************************************
+  * @file    supervisor.h
+  * @brief   Watchdog supervised main loop: per-task liveness and run time
+  *          accounting.
+  *
+  *          Each supervised task (stack tick, LED, button, log drain) checks
+  *          in with Sup_TaskBegin()/Sup_TaskEnd() around its body, which
+  *          timestamp the run and measure its run time on the sleep timer.
+  *          A periodic task must check in again within its deadline; an on
+  *          demand task (button, log drain) must run within its deadline of
+  *          the Sup_TaskPending() that queued its work, usually posted from
+  *          interrupt context, or of the time given to Sup_TaskExpect() (LED
+  *          pattern edges). Deadlines and run time budgets are in the
+  *          task table of supervisor.c.
+  *
+  *          Sup_Check(), at the end of each main loop pass, feeds the
+  *          watchdog only when every started task is within its deadline
+  *          and no run went over its budget. The first miss is latched: the
+  *          watchdog is never fed again and its interrupt, SUP_WDG_TIMEOUT_MS
+  *          after the last feed, writes the task, the kind of miss and the
+  *          interrupted frame to the crash record (crash.h), then resets.
+  *          If the main loop itself is stuck the interrupt names the task
+  *          still running, or else the most overdue one. The hardware reset
+  *          of the second expiry is the backstop when the interrupt cannot
+  *          run.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "clock.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Supervised tasks, named by sup_tasks[] of supervisor.c */
+typedef enum {
+  SUP_TASK_STACK_TICK = 0,    /* BTLE_StackTick() in Sched_RunOnce() */
+  SUP_TASK_LED,               /* LED pattern edge, virtual timer interrupt */
+  SUP_TASK_BUTTON,            /* Button_Process(), after a GPIO edge */
+  SUP_TASK_LOG,               /* Log ring drain in the UART interrupt */
+  SUP_TASK_COUNT,
+  SUP_TASK_NONE = 0xFF
+} Sup_Task_t;
+
+typedef enum {
+  SUP_MISS_NONE = 0,
+  SUP_MISS_LATE,              /* Deadline passed without a check in: ms past it */
+  SUP_MISS_OVERRUN,           /* Run over its budget: run time in us */
+  SUP_MISS_HUNG,              /* Still running at the watchdog interrupt: ms since it began */
+} Sup_Miss_t;
+
+typedef struct {
+  uint32_t runs;              /* Sup_TaskEnd() calls */
+  uint32_t last_us;           /* Run time of the last run */
+  uint32_t worst_us;          /* Longest run */
+  tClockTime last_ms;         /* Sched_Now() at the last check in */
+} Sup_TaskStats_t;
+
+typedef struct {
+  uint32_t feeds;             /* Watchdog reloads */
+  uint8_t  task;              /* Sup_Task_t of the latched miss, SUP_TASK_NONE if none */
+  uint8_t  miss;              /* Sup_Miss_t */
+  uint32_t value;             /* ms or us, see Sup_Miss_t */
+} Sup_Stats_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* Watchdog interrupt this long after the last feed, reset as long again
+   later. Over the longest main loop sleep, and the stack tick deadline */
+#ifndef SUP_WDG_TIMEOUT_MS
+#define SUP_WDG_TIMEOUT_MS      2000
+#endif
+
+/* Watchdog counter clock: the 32 kHz low speed clock */
+#define SUP_WDG_CLOCK_HZ        32768UL
+#define SUP_WDG_RELOAD          ((uint32_t)(SUP_WDG_TIMEOUT_MS * SUP_WDG_CLOCK_HZ / 1000) - 1)
+
+/* Exported functions ------------------------------------------------------- */
+void Sup_Init(void);
+void Sup_Start(void);
+void Sup_TaskStart(Sup_Task_t task);
+
+void Sup_TaskPending(Sup_Task_t task);
+void Sup_TaskExpect(Sup_Task_t task, uint32_t in_ms);
+void Sup_TaskIdle(Sup_Task_t task);
+void Sup_TaskBegin(Sup_Task_t task);
+void Sup_TaskEnd(Sup_Task_t task);
+void Sup_TaskStalled(uint32_t since_sys);
+
+void Sup_Check(void);
+/* Only called from the assembly of WDG_Handler(): used keeps it in LTO builds */
+void Sup_WatchdogIrq(const uint32_t *frame, uint32_t exc_return) __attribute__((noreturn, used));
+
+const char *Sup_TaskName(uint32_t task);
+const char *Sup_MissName(uint32_t miss);
+const Sup_TaskStats_t *Sup_GetTaskStats(Sup_Task_t task);
+const Sup_Stats_t *Sup_GetStats(void);
+
+#endif /* SUPERVISOR_H */
@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    trace.h
+  * @brief   Timestamped trace points and binary records for profiling the
+  *          main loop without the UART.
+  *
+  *          TRACE_POINT() and TRACE_RECORD() only copy a few words to a RAM
+  *          buffer, timestamped with the sleep timer (sysT32, 2.44 us, also
+  *          running in deep sleep). The buffer is sent by TRACE_FLUSH(), which
+  *          the scheduler calls before going to sleep, through the backend
+  *          chosen at link time (make TRACE=dcc|uart, see src/trace/).
+  *          tools/trace_decode.py turns the output into a timeline.
+  *
+  *          Without TRACE_ENABLED (make TRACE=none, the default) the macros
+  *          compile to nothing.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef TRACE_H
+#define TRACE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+/* Trace points: no data. tools/trace_decode.py reads the names from here. */
+typedef enum {
+  TRACE_PT_LOOP = 1,          /* Sched_RunOnce() pass */
+  TRACE_PT_EVENT,             /* Event handlers dispatched */
+  TRACE_PT_TIMER_JOB,         /* Timer job started */
+  TRACE_PT_STACK_TICK,        /* BTLE_StackTick() called */
+  TRACE_PT_STACK_DONE,        /* BTLE_StackTick() returned */
+  TRACE_PT_WAKE,              /* Back from BlueNRG_Sleep() */
+  TRACE_PT_BUTTON,            /* Button edge interrupt */
+  TRACE_PT_LED,               /* LED pattern edge */
+} Trace_Point_t;
+
+/* Binary records: 32-bit words of data */
+typedef enum {
+  TRACE_REC_SLEEP = 0x100,    /* mode, timeout (ms, -1 if none) */
+  TRACE_REC_LOST,             /* frames dropped because the buffer was full */
+} Trace_Record_t;
+
+typedef struct {
+  uint32_t frames;            /* Frames written to the buffer */
+  uint32_t dropped;           /* Frames dropped, buffer full */
+  uint32_t words_sent;        /* Words handed to the backend */
+  uint16_t high_water;        /* Maximum buffer occupancy in words */
+} Trace_Stats_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* Buffer size in 32-bit words, must be a power of 2 */
+#ifndef TRACE_BUF_WORDS
+#define TRACE_BUF_WORDS         256
+#endif
+
+/* Frame: header word, timestamp word, data words.
+   Header: magic (bits 31-24), number of data words (23-16), id (15-0) */
+#define TRACE_MAGIC             0xA5
+#define TRACE_HEADER(id, n)     (((uint32_t)TRACE_MAGIC << 24) | ((uint32_t)(n) << 16) | (uint16_t)(id))
+#define TRACE_MAX_DATA          8
+
+/* Exported macro ------------------------------------------------------------*/
+#ifdef TRACE_ENABLED
+#define TRACE_INIT()                    Trace_Init()
+#define TRACE_POINT(id)                 Trace_Write((id), 0, 0)
+#define TRACE_RECORD(type, data, n)     Trace_Write((type), (data), (n))
+#define TRACE_FLUSH()                   Trace_Flush()
+#else
+#define TRACE_INIT()                    ((void)0)
+#define TRACE_POINT(id)                 ((void)0)
+#define TRACE_RECORD(type, data, n)     ((void)0)
+#define TRACE_FLUSH()                   ((void)0)
+#endif
+
+/* Exported functions ------------------------------------------------------- */
+void Trace_Init(void);
+void Trace_Write(uint16_t id, const uint32_t *data, uint8_t n);
+void Trace_Flush(void);
+const Trace_Stats_t *Trace_GetStats(void);
+
+/* Backend interface, implemented by one of src/trace/trace_*.c */
+void Trace_BackendInit(void);
+uint16_t Trace_BackendWrite(const uint32_t *words, uint16_t n);
+
+#endif /* TRACE_H */
@@ -27,6 +27,14 @@
 #include "ble_const.h"
 #include "bluenrg1_stack.h"
 #include "clock.h"
+#include "scheduler.h"
+#include "button.h"
+#include "log.h"
+#include "prof.h"
+#include "ramfunc.h"
+#include "crash.h"
+#include "boot.h"
+#include "supervisor.h"
 
 /** @addtogroup BlueNRG1_StdPeriph_Examples
   * @{
@@ -59,15 +67,30 @@ void NMI_Handler(void)
 {
 }
 
+#ifndef HOST_SIM
 /**
-  * @brief  This function handles Hard Fault exception.
+  * @brief  This function handles Hard Fault exception: the exception frame
+  *         (on PSP if bit 2 of EXC_RETURN is set, MSP otherwise) and
+  *         EXC_RETURN go to Crash_Fault(), which records them and resets.
+  *         Naked, so that no prologue moves the stack pointer first.
   */
-void HardFault_Handler(void)
+__attribute__((naked)) void HardFault_Handler(void)
 {
-  /* Go to infinite loop when Hard Fault exception occurs */
-  while (1)
-  {}
+  __asm volatile (
+    "  movs r0, #4          \n"
+    "  mov  r1, lr          \n"
+    "  tst  r0, r1          \n"
+    "  mrs  r0, msp         \n"
+    "  beq  1f              \n"
+    "  mrs  r0, psp         \n"
+    "1:                     \n"
+    "  movs r2, %0          \n"
+    "  ldr  r3, =Crash_Fault\n"
+    "  bx   r3              \n"
+    "  .ltorg               \n"
+    : : "i" (CRASH_CODE_HARD_FAULT));
 }
+#endif
 
 /**
   * @brief  This function handles SVCall exception.
@@ -84,15 +107,21 @@ void SVC_Handler(void)
 //}
 
 /**
-  * @brief  This function handles SysTick Handler.
+  * @brief  This function handles SysTick Handler. Runs from RAM.
   */
-void SysTick_Handler(void)
+RAMFUNC void SysTick_Handler(void)
 {
+  PROF_BEGIN(PROF_SITE_SYSTICK);
   SysCount_Handler(); 
+  PROF_END(PROF_SITE_SYSTICK);
 }
 
+/**
+  * @brief  This function handles GPIO interrupt request.
+  */
 void GPIO_Handler(void)
 {
+  Button_IrqHandler();
 }
 /******************************************************************************/
 /*                 BlueNRG-1 Peripherals Interrupt Handlers                   */
@@ -107,12 +136,51 @@ void GPIO_Handler(void)
 */
 void UART_Handler(void)
 {  
+  Log_UartIrqHandler();
 }
 
-void Blue_Handler(void)
+#ifndef HOST_SIM
+/**
+  * @brief  This function handles WDG interrupt request: the watchdog was not
+  *         fed for SUP_WDG_TIMEOUT_MS. The interrupted frame (PSP or MSP, as
+  *         in HardFault_Handler()) and EXC_RETURN go to Sup_WatchdogIrq(),
+  *         which records the task to blame and resets.
+  */
+__attribute__((naked)) void WDG_Handler(void)
 {
+  __asm volatile (
+    "  movs r0, #4              \n"
+    "  mov  r1, lr              \n"
+    "  tst  r0, r1              \n"
+    "  mrs  r0, msp             \n"
+    "  beq  1f                  \n"
+    "  mrs  r0, psp             \n"
+    "1:                         \n"
+    "  ldr  r3, =Sup_WatchdogIrq\n"
+    "  bx   r3                  \n"
+    "  .ltorg                   \n");
+}
+#endif
+
+/**
+  * @brief  Radio interrupt: RAL_Isr() of the stack. Runs from RAM.
+  */
+RAMFUNC void Blue_Handler(void)
+{
+   PROF_BEGIN(PROF_SITE_BLUE_ISR);
+
    // Call RAL_Isr
+   PROF_BEGIN(PROF_SITE_RAL_ISR);
    RAL_Isr();
+   PROF_END(PROF_SITE_RAL_ISR);
+
+   // Let the main loop tick the stack before going back to sleep
+   Sched_RequestStackTick();
+
+   // First advertising event after boot: deferred init of the fast path
+   Boot_RadioIrq();
+
+   PROF_END(PROF_SITE_BLUE_ISR);
 }
 
 /**
@@ -0,0 +1,172 @@
+/**
+  ******************************************************************************
+  * @file    adv_live.c
+  * @brief   Live fields of the advertising frames, written in place and sent
+  *          to the stack once per advertising interval at most.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "scheduler.h"
+#include "adv_rotate.h"
+#include "adv_live.h"
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t live_size[ADV_LIVE_FIELDS] = { 2, 2, 1, 2, 2, 4, 4, 1 };
+
+/* live_dirty and the flush hold one bit per field */
+_Static_assert(ADV_LIVE_FIELDS <= 8, "ADV_LIVE_FIELDS is over the 8 bits of live_dirty");
+
+static uint8_t *live_payload[ADV_LIVE_FIELDS];
+static uint8_t live_offset[ADV_LIVE_FIELDS];
+
+/* One bit per field changed since the last flush */
+static uint8_t live_dirty;
+static uint16_t live_window_ms;
+static uint8_t live_timer = SCHED_TIMER_INVALID;
+static Adv_Live_Stats_t live_stats;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  End of the coalescing window: send each dirty frame once.
+  */
+static void Adv_LiveFlush(void)
+{
+  uint8_t dirty = live_dirty;
+  uint8_t i, j;
+
+  live_timer = SCHED_TIMER_INVALID;
+  live_dirty = 0;
+  live_stats.flushes++;
+
+  for (i = 0; i < ADV_LIVE_FIELDS; i++) {
+    if (!(dirty & (1U << i)))
+      continue;
+    for (j = 0; j < i; j++) {
+      if ((dirty & (1U << j)) && live_payload[j] == live_payload[i])
+        break;
+    }
+    if (j < i)
+      continue;   /* Frame already handled */
+
+    if (Adv_RotateRefresh(live_payload[i]))
+      live_stats.sent++;
+    else
+      live_stats.deferred++;
+  }
+}
+
+/**
+  * @brief  Write a field in its payload, big endian, and open the coalescing
+  *         window if the bytes changed.
+  */
+static void Adv_LiveWrite(Adv_LiveField field, uint32_t value)
+{
+  uint8_t *p;
+  uint8_t i, size, b, changed = 0;
+
+  live_stats.writes++;
+  if (live_payload[field] == NULL)
+    return;
+
+  p = live_payload[field] + live_offset[field];
+  size = live_size[field];
+  for (i = 0; i < size; i++) {
+    b = (uint8_t)(value >> (8 * (size - 1 - i)));
+    if (p[i] != b) {
+      p[i] = b;
+      changed = 1;
+    }
+  }
+  if (!changed) {
+    live_stats.unchanged++;
+    return;
+  }
+
+  live_dirty |= (uint8_t)(1U << field);
+  if (live_timer == SCHED_TIMER_INVALID) {
+    live_timer = Sched_TimerStart(Adv_LiveFlush, live_window_ms, 0);
+    /* No timer free: send now rather than never */
+    if (live_timer == SCHED_TIMER_INVALID)
+      Adv_LiveFlush();
+    else
+      Sched_TimerSetSlack(live_timer, ADV_LIVE_FLUSH_SLACK_MS);
+  }
+}
+
+/**
+  * @brief  Forget the bindings and set the coalescing window, normally the
+  *         advertising interval. Call after Sched_Init().
+  */
+void Adv_LiveInit(uint16_t window_ms)
+{
+  uint8_t i;
+
+  for (i = 0; i < ADV_LIVE_FIELDS; i++)
+    live_payload[i] = NULL;
+  live_dirty = 0;
+  live_window_ms = window_ms;
+  live_timer = SCHED_TIMER_INVALID;
+  live_stats = (Adv_Live_Stats_t){0};
+}
+
+/**
+  * @brief  Bind a field to its bytes in a payload of the rotation. Writes
+  *         to an unbound field are ignored.
+  * @param  payload: RAM payload, as in the rotation table
+  * @param  offset: first byte of the field in the payload
+  */
+void Adv_LiveBind(Adv_LiveField field, uint8_t *payload, uint8_t offset)
+{
+  if (field >= ADV_LIVE_FIELDS)
+    return;
+  live_payload[field] = payload;
+  live_offset[field] = offset;
+}
+
+void Adv_LiveSetMajor(uint16_t major)
+{
+  Adv_LiveWrite(ADV_LIVE_MAJOR, major);
+}
+
+void Adv_LiveSetMinor(uint16_t minor)
+{
+  Adv_LiveWrite(ADV_LIVE_MINOR, minor);
+}
+
+void Adv_LiveSetTxPower(int8_t dbm)
+{
+  Adv_LiveWrite(ADV_LIVE_TX_POWER, (uint8_t)dbm);
+}
+
+void Adv_LiveSetBattery(uint16_t mv)
+{
+  Adv_LiveWrite(ADV_LIVE_BATTERY, mv);
+}
+
+void Adv_LiveSetTemperature(int16_t temp_8_8)
+{
+  Adv_LiveWrite(ADV_LIVE_TEMPERATURE, (uint16_t)temp_8_8);
+}
+
+void Adv_LiveSetUptime(uint32_t tenths)
+{
+  Adv_LiveWrite(ADV_LIVE_UPTIME, tenths);
+}
+
+void Adv_LiveSetCounter(uint32_t counter)
+{
+  Adv_LiveWrite(ADV_LIVE_COUNTER, counter);
+}
+
+void Adv_LiveSetStackMargin(uint8_t margin)
+{
+  Adv_LiveWrite(ADV_LIVE_STACK_MARGIN, margin);
+}
+
+const Adv_Live_Stats_t *Adv_LiveGetStats(void)
+{
+  return &live_stats;
+}
@@ -0,0 +1,202 @@
+/**
+  ******************************************************************************
+  * @file    adv_rotate.c
+  * @brief   Rotation of several advertising frames from one device.
+  *
+  *          The slot sequence is computed once by Adv_RotateStart() from the
+  *          weights, so a slot only reads the next index and, if the frame
+  *          changes, passes its flash payload to the stack.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "bluenrg1_stack.h"
+#include "ble_const.h"
+#include "adv_data.h"
+#include "scheduler.h"
+#include "adv_rotate.h"
+
+/* Private define ------------------------------------------------------------*/
+/* adv_current before the first frame is on air */
+#define ADV_ROTATE_NONE         0xFF
+
+/* Private variables ---------------------------------------------------------*/
+static const Adv_Rotation_t *adv_rot;
+static uint8_t adv_seq[ADV_ROTATE_MAX_SLOTS];
+static uint8_t adv_seq_len;
+static uint8_t adv_pos;
+static uint8_t adv_current = ADV_ROTATE_NONE;
+static uint8_t adv_timer = SCHED_TIMER_INVALID;
+static Adv_Rotate_Stats_t adv_stats;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Interleave the slots of the frames: smooth weighted round robin,
+  *         each slot goes to the frame with the largest credit, which then
+  *         pays back the sum of the weights.
+  * @retval Sequence length, 0 if the weights are all 0 or sum over
+  *         ADV_ROTATE_MAX_SLOTS
+  */
+static uint8_t Adv_RotateBuild(const Adv_Rotation_t *rot)
+{
+  int16_t credit[ADV_ROTATE_MAX_FRAMES] = {0};
+  uint16_t total = 0;
+  uint8_t i, slot, best;
+
+  for (i = 0; i < rot->n_frames; i++)
+    total += rot->frames[i].weight;
+  if (total == 0 || total > ADV_ROTATE_MAX_SLOTS)
+    return 0;
+
+  for (slot = 0; slot < total; slot++) {
+    best = 0;
+    for (i = 0; i < rot->n_frames; i++) {
+      credit[i] += rot->frames[i].weight;
+      if (credit[i] > credit[best])
+        best = i;
+    }
+    credit[best] -= (int16_t)total;
+    adv_seq[slot] = best;
+  }
+  return (uint8_t)total;
+}
+
+/**
+  * @brief  Put a frame on air, unless it is already.
+  */
+static uint8_t Adv_RotateShow(uint8_t idx)
+{
+  const Adv_Frame_t *frame = &adv_rot->frames[idx];
+  uint8_t ret;
+
+  if (idx == adv_current)
+    return BLE_STATUS_SUCCESS;
+
+  /* The stack copies the payload into the controller, the frame stays in flash */
+  ret = hci_le_set_advertising_data(frame->len, (uint8_t *)frame->data);
+  adv_stats.updates++;
+  if (ret != BLE_STATUS_SUCCESS) {
+    /* The previous frame stays on air, the next slot retries */
+    adv_stats.errors++;
+    return ret;
+  }
+  adv_current = idx;
+  return BLE_STATUS_SUCCESS;
+}
+
+/**
+  * @brief  Slot timer job.
+  */
+static void Adv_RotateSlot(void)
+{
+  if (++adv_pos == adv_seq_len) {
+    adv_pos = 0;
+    adv_stats.rotations++;
+  }
+  adv_stats.slots++;
+  Adv_RotateShow(adv_seq[adv_pos]);
+}
+
+/**
+  * @brief  Put the first frame of the rotation on air and start the slots.
+  *         Advertising must be enabled already; the rotation and its frames
+  *         must stay valid until Adv_RotateStop().
+  * @retval BLE_STATUS_SUCCESS, BLE_STATUS_INVALID_PARAMS for a bad rotation,
+  *         BLE_STATUS_INSUFFICIENT_RESOURCES if no timer is free, or the
+  *         error of hci_le_set_advertising_data()
+  */
+uint8_t Adv_RotateStart(const Adv_Rotation_t *rotation)
+{
+  uint8_t i, ret;
+
+  Adv_RotateStop();
+
+  if (rotation == NULL || rotation->n_frames == 0 ||
+      rotation->n_frames > ADV_ROTATE_MAX_FRAMES || rotation->slot_ms == 0)
+    return BLE_STATUS_INVALID_PARAMS;
+  for (i = 0; i < rotation->n_frames; i++) {
+    if (rotation->frames[i].data == NULL || rotation->frames[i].len > ADV_DATA_MAX)
+      return BLE_STATUS_INVALID_PARAMS;
+  }
+  adv_seq_len = Adv_RotateBuild(rotation);
+  if (adv_seq_len == 0)
+    return BLE_STATUS_INVALID_PARAMS;
+
+  adv_rot = rotation;
+  adv_pos = 0;
+  adv_current = ADV_ROTATE_NONE;
+  adv_stats = (Adv_Rotate_Stats_t){0};
+
+  ret = Adv_RotateShow(adv_seq[0]);
+  if (ret != BLE_STATUS_SUCCESS)
+    return ret;
+  adv_stats.slots = 1;
+
+  /* A single frame needs no slots */
+  if (adv_seq_len > 1 && rotation->n_frames > 1) {
+    adv_timer = Sched_TimerStart(Adv_RotateSlot, rotation->slot_ms, rotation->slot_ms);
+    if (adv_timer == SCHED_TIMER_INVALID)
+      return BLE_STATUS_INSUFFICIENT_RESOURCES;
+  }
+  return BLE_STATUS_SUCCESS;
+}
+
+/**
+  * @brief  Stop the slots; the frame on air stays.
+  */
+void Adv_RotateStop(void)
+{
+  if (adv_timer != SCHED_TIMER_INVALID) {
+    Sched_TimerStop(adv_timer);
+    adv_timer = SCHED_TIMER_INVALID;
+  }
+}
+
+/**
+  * @brief  Change the slot duration, from the next slot on.
+  */
+void Adv_RotateSetSlot(uint16_t slot_ms)
+{
+  if (slot_ms != 0)
+    Sched_TimerSetPeriod(adv_timer, slot_ms);
+}
+
+/**
+  * @brief  Re-send a frame whose contents changed, if it is on air. A frame
+  *         off air needs nothing: its slot sends the new contents.
+  * @param  data: payload of the frame, as in the rotation table
+  * @retval 1 if hci_le_set_advertising_data() was called
+  */
+uint8_t Adv_RotateRefresh(const uint8_t *data)
+{
+  const Adv_Frame_t *frame;
+
+  if (adv_rot == NULL || adv_current == ADV_ROTATE_NONE)
+    return 0;
+  frame = &adv_rot->frames[adv_current];
+  if (frame->data != data)
+    return 0;
+
+  adv_stats.refreshes++;
+  if (hci_le_set_advertising_data(frame->len, (uint8_t *)frame->data) != BLE_STATUS_SUCCESS) {
+    /* Unknown contents on air: the next slot sends its frame anyway */
+    adv_stats.errors++;
+    adv_current = ADV_ROTATE_NONE;
+  }
+  return 1;
+}
+
+/**
+  * @brief  Index in the rotation of the frame on air, 0xFF if none.
+  */
+uint8_t Adv_RotateCurrent(void)
+{
+  return adv_current;
+}
+
+const Adv_Rotate_Stats_t *Adv_RotateGetStats(void)
+{
+  return &adv_stats;
+}
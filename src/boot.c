@@ -0,0 +1,192 @@
+/**
+  ******************************************************************************
+  * @file    boot.c
+  * @brief   Cold/warm boot classification, deferred init after the first
+  *          advertisement and boot stage timestamps.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "scheduler.h"
+#include "log.h"
+#include "boot.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BOOT_STAGE_BIT(stage)   (1U << (stage))
+
+/* Private variables ---------------------------------------------------------*/
+static Boot_Stats_t boot_stats;
+static uint32_t boot_t0;
+
+static Sched_Handler boot_late_init;
+static uint8_t boot_timer = SCHED_TIMER_INVALID;
+static volatile uint8_t boot_waiting;
+
+static const char *const boot_stage_names[BOOT_STAGE_COUNT] = {
+  "verify",
+  "platform",
+  "stack",
+  "device",
+  "advertising",
+  "first_event",
+  "late_init",
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Time since Boot_Init() in us, from the sleep timer (sysT32 unit
+  *         2.4414 us = 625/256 us).
+  */
+static uint32_t Boot_NowUs(void)
+{
+  return (uint32_t)((uint64_t)(HAL_VTimerGetCurrentTime_sysT32() - boot_t0) * 625 / 256);
+}
+
+/**
+  * @brief  Duration of a stage: from the end of the stage reached just
+  *         before it in time (the late init runs before the advertising
+  *         start on a cold boot, after the first event on a warm one).
+  *         0 if not reached.
+  */
+static uint32_t Boot_StageUs(Boot_Stage_t stage)
+{
+  uint32_t start = 0;
+  uint8_t s;
+
+  if (!(boot_stats.marked & BOOT_STAGE_BIT(stage)))
+    return 0;
+  for (s = 0; s < BOOT_STAGE_COUNT; s++) {
+    if (s != stage && (boot_stats.marked & BOOT_STAGE_BIT(s)) &&
+        boot_stats.at_us[s] <= boot_stats.at_us[stage] && boot_stats.at_us[s] > start)
+      start = boot_stats.at_us[s];
+  }
+  return boot_stats.at_us[stage] - start;
+}
+
+/**
+  * @brief  Read the reset reason and start the stage clock. Called first
+  *         thing after SystemInit().
+  */
+void Boot_Init(void)
+{
+  boot_t0 = HAL_VTimerGetCurrentTime_sysT32();
+  boot_stats.reset_reason = SysCtrl_GetWakeupResetReason();
+  boot_stats.warm = (boot_stats.reset_reason == RESET_SYSREQ ||
+                     boot_stats.reset_reason == RESET_WDG ||
+                     boot_stats.reset_reason == RESET_LOCKUP);
+  boot_stats.fast = boot_stats.warm && BOOT_FAST_ENABLE;
+  boot_stats.marked = 0;
+  boot_waiting = 0;
+  boot_late_init = NULL;
+  boot_timer = SCHED_TIMER_INVALID;
+}
+
+/**
+  * @brief  Non zero on the fast boot path: only the init the first
+  *         advertisement needs runs before it, without logging.
+  */
+uint8_t Boot_Fast(void)
+{
+  return boot_stats.fast;
+}
+
+void Boot_Mark(Boot_Stage_t stage)
+{
+  boot_stats.at_us[stage] = Boot_NowUs();
+  boot_stats.marked |= BOOT_STAGE_BIT(stage);
+}
+
+/**
+  * @brief  First radio event after the advertising start, or no radio event
+  *         in BOOT_LATE_TIMEOUT_MS: run the deferred init, then log the
+  *         breakdown.
+  */
+static void Boot_Late(void)
+{
+  if (!boot_waiting)
+    return;
+  boot_waiting = 0;
+  Sched_TimerStop(boot_timer);
+  boot_timer = SCHED_TIMER_INVALID;
+
+  if (boot_stats.fast) {
+    if (boot_late_init != NULL)
+      boot_late_init();
+    Boot_Mark(BOOT_STAGE_LATE);
+  }
+  Boot_Report();
+}
+
+static void Boot_LateTimeout(void)
+{
+  /* One-shot: the slot is already free */
+  boot_timer = SCHED_TIMER_INVALID;
+  Boot_Late();
+}
+
+/**
+  * @brief  Init not needed by the first advertisement: run now on a cold
+  *         boot, after the first radio event on the fast path. Called after
+  *         Sched_Init() and before the advertising start.
+  */
+void Boot_Defer(Sched_Handler late_init)
+{
+  boot_late_init = late_init;
+  Sched_SetEventHandler(SCHED_EVT_BOOT, Boot_Late);
+  boot_timer = Sched_TimerStart(Boot_LateTimeout, BOOT_LATE_TIMEOUT_MS, 0);
+  boot_waiting = 1;
+
+  if (!boot_stats.fast) {
+    if (late_init != NULL)
+      late_init();
+    Boot_Mark(BOOT_STAGE_LATE);
+  }
+}
+
+/**
+  * @brief  Radio interrupt hook, from Blue_Handler(): the first one after
+  *         Boot_Mark(BOOT_STAGE_ADVERTISING) ends the advertising event.
+  */
+void Boot_RadioIrq(void)
+{
+  if (boot_waiting && (boot_stats.marked & BOOT_STAGE_BIT(BOOT_STAGE_ADVERTISING)) &&
+      !(boot_stats.marked & BOOT_STAGE_BIT(BOOT_STAGE_FIRST_ADV))) {
+    Boot_Mark(BOOT_STAGE_FIRST_ADV);
+    Sched_PostEvent(SCHED_EVT_BOOT);
+  }
+}
+
+/**
+  * @brief  Boot time breakdown over the log: three lines, see boot.h.
+  */
+void Boot_Report(void)
+{
+  const char *kind = boot_stats.warm ? "warm" : "cold";
+
+  if (boot_stats.marked & BOOT_STAGE_BIT(BOOT_STAGE_FIRST_ADV))
+    PRINTF("boot %s, reset 0x%02x: first advertisement at %u us\r\n", kind,
+           (unsigned)boot_stats.reset_reason, (unsigned)boot_stats.at_us[BOOT_STAGE_FIRST_ADV]);
+  else
+    PRINTF("boot %s, reset 0x%02x: no advertisement in %u ms\r\n", kind,
+           (unsigned)boot_stats.reset_reason, (unsigned)BOOT_LATE_TIMEOUT_MS);
+  PRINTF("boot verify %u us, platform %u us, stack %u us, device %u us, advertising %u us, first event %u us\r\n",
+         (unsigned)Boot_StageUs(BOOT_STAGE_VERIFY), (unsigned)Boot_StageUs(BOOT_STAGE_PLATFORM),
+         (unsigned)Boot_StageUs(BOOT_STAGE_STACK), (unsigned)Boot_StageUs(BOOT_STAGE_DEVICE), (unsigned)Boot_StageUs(BOOT_STAGE_ADVERTISING),
+         (unsigned)Boot_StageUs(BOOT_STAGE_FIRST_ADV));
+  PRINTF("boot late init %u us, %s\r\n", (unsigned)Boot_StageUs(BOOT_STAGE_LATE),
+         boot_stats.fast ? "after the first event" : "before the advertising start");
+}
+
+const char *Boot_StageName(Boot_Stage_t stage)
+{
+  return (stage < BOOT_STAGE_COUNT) ? boot_stage_names[stage] : "?";
+}
+
+const Boot_Stats_t *Boot_GetStats(void)
+{
+  return &boot_stats;
+}
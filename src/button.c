@@ -0,0 +1,271 @@
+/**
+  ******************************************************************************
+  * @file    button.c
+  * @brief   Interrupt driven push button (IO13, active low).
+  *
+  *          The first edge after a quiet period is reported immediately and
+  *          the following edges closer than BUTTON_DEBOUNCE_MS to the
+  *          previous one are treated as bounce. If bounce was seen, the pin is
+  *          read once more when the window closes so that a burst ending in
+  *          the other state is not lost.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "BlueNRG1_conf.h"
+#include "sleep.h"
+#include "sleep_mgr.h"
+#include "scheduler.h"
+#include "trace.h"
+#include "supervisor.h"
+#include "button.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define BUTTON_QUEUE_MASK       (BUTTON_QUEUE_SIZE - 1)
+
+#if (BUTTON_QUEUE_SIZE & BUTTON_QUEUE_MASK) != 0
+#error "BUTTON_QUEUE_SIZE must be a power of 2"
+#endif
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Event queue: button_head is only written by the ISR, button_tail only by the main loop */
+static Button_Event_t button_queue[BUTTON_QUEUE_SIZE];
+static volatile uint8_t button_head;
+static volatile uint8_t button_tail;
+
+/* ISR side debounce state */
+static volatile uint8_t button_state;
+static volatile tClockTime button_last_edge;
+static volatile uint8_t button_bounced;
+
+static uint8_t button_settle_timer = SCHED_TIMER_INVALID;
+static Button_Callback button_callback;
+static Button_Stats_t button_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Button_Process(void);
+static void Button_Settle(void);
+static void Button_SleepRestore(void);
+
+static const SleepMgr_Periph_t button_sleep = { "gpio", NULL, NULL, Button_SleepRestore };
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Queue a new button state. Producer side: ISR, or main loop with
+  *         interrupts disabled.
+  */
+static void Button_Push(uint8_t pressed, tClockTime now)
+{
+  uint8_t head = button_head;
+  uint8_t next = (head + 1) & BUTTON_QUEUE_MASK;
+
+  button_state = pressed;
+  button_last_edge = now;
+
+  if (next == button_tail) {
+    button_stats.dropped++;
+    return;
+  }
+
+  button_queue[head].timestamp = now;
+  button_queue[head].pressed = pressed;
+  /* The event must be in memory before the consumer can see it */
+  __DMB();
+  button_head = next;
+  button_stats.accepted++;
+}
+
+/**
+  * @brief  Wake up from deep sleep on the next change of the button.
+  */
+static void Button_ArmWakeup(uint8_t pressed)
+{
+  if (pressed)
+    Sched_SetWakeupIO(BUTTON_WAKEUP_IO, WAKEUP_IOx_HIGH(BUTTON_WAKEUP_IO));
+  else
+    Sched_SetWakeupIO(BUTTON_WAKEUP_IO, WAKEUP_IOx_LOW(BUTTON_WAKEUP_IO));
+}
+
+/**
+  * @brief  Configure the button pin for both-edges interrupts.
+  * @param  callback: called from the main loop for each button event
+  */
+void Button_Init(Button_Callback callback)
+{
+  GPIO_InitType GPIO_InitStructure;
+  GPIO_EXTIConfigType GPIO_EXTIStructure;
+  NVIC_InitType NVIC_InitStructure;
+
+  button_callback = callback;
+  button_head = 0;
+  button_tail = 0;
+  button_bounced = 0;
+  button_stats = (Button_Stats_t){0};
+
+  /* Configures Button pin as input */
+  GPIO_InitStructure.GPIO_Pin = BUTTON_PIN;
+  GPIO_InitStructure.GPIO_Mode = GPIO_Input;
+  GPIO_InitStructure.GPIO_Pull = DISABLE;
+  GPIO_InitStructure.GPIO_HighPwr = DISABLE;
+  GPIO_Init(&GPIO_InitStructure);
+
+  /* One read at boot to know where we start from */
+  button_state = (GPIO_ReadBit(BUTTON_PIN) == Bit_RESET);
+  button_last_edge = Sched_Now() - BUTTON_DEBOUNCE_MS;
+  Button_ArmWakeup(button_state);
+
+  GPIO_EXTIStructure.GPIO_Pin = BUTTON_PIN;
+  GPIO_EXTIStructure.GPIO_IrqSense = GPIO_IrqSense_Edge;
+  GPIO_EXTIStructure.GPIO_Event = GPIO_Event_Both;
+  GPIO_EXTIConfig(&GPIO_EXTIStructure);
+  GPIO_ClearITPendingBit(BUTTON_PIN);
+  GPIO_EXTICmd(BUTTON_PIN, ENABLE);
+
+  NVIC_InitStructure.NVIC_IRQChannel = GPIO_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = LOW_PRIORITY;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  Sched_SetEventHandler(SCHED_EVT_GPIO, Button_Process);
+  Sup_TaskStart(SUP_TASK_BUTTON);
+  SleepMgr_Register(&button_sleep);
+}
+
+/**
+  * @brief  Button edge interrupt, called from GPIO_Handler().
+  */
+void Button_IrqHandler(void)
+{
+  tClockTime now;
+  uint8_t pressed;
+
+  if (GPIO_GetITPendingBit(BUTTON_PIN) != SET)
+    return;
+  GPIO_ClearITPendingBit(BUTTON_PIN);
+
+  now = Sched_Now();
+  button_stats.edges++;
+  TRACE_POINT(TRACE_PT_BUTTON);
+
+  if ((int32_t)(now - button_last_edge) < BUTTON_DEBOUNCE_MS) {
+    /* The window slides with each bounce until the contact is quiet */
+    button_stats.bounces++;
+    button_bounced = 1;
+    button_last_edge = now;
+  } else {
+    pressed = (GPIO_ReadBit(BUTTON_PIN) == Bit_RESET);
+    if (pressed != button_state)
+      Button_Push(pressed, now);
+    button_last_edge = now;
+  }
+
+  Sup_TaskPending(SUP_TASK_BUTTON);
+  Sched_PostEvent(SCHED_EVT_GPIO);
+}
+
+/**
+  * @brief  Main loop side: deliver the queued events, then schedule the end
+  *         of bounce check if the ISR rejected edges.
+  */
+static void Button_Process(void)
+{
+  Button_Event_t evt;
+
+  Sup_TaskBegin(SUP_TASK_BUTTON);
+  while (Button_GetEvent(&evt)) {
+    Button_ArmWakeup(evt.pressed);
+    if (button_callback != NULL)
+      button_callback(&evt);
+  }
+
+  if (button_bounced) {
+    button_bounced = 0;
+    Sched_TimerStop(button_settle_timer);
+    button_settle_timer = Sched_TimerStart(Button_Settle, BUTTON_DEBOUNCE_MS, 0);
+    Sched_TimerSetSlack(button_settle_timer, BUTTON_SETTLE_SLACK_MS);
+  }
+  Sup_TaskEnd(SUP_TASK_BUTTON);
+}
+
+/**
+  * @brief  End of the debounce window: read the pin once and report the
+  *         state the bounce burst ended in, if it was missed.
+  */
+static void Button_Settle(void)
+{
+  uint8_t pressed;
+  uint32_t primask;
+
+  button_settle_timer = SCHED_TIMER_INVALID;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  pressed = (GPIO_ReadBit(BUTTON_PIN) == Bit_RESET);
+  if (pressed != button_state) {
+    Button_Push(pressed, Sched_Now());
+    button_stats.settles++;
+  }
+  __set_PRIMASK(primask);
+
+  Button_Process();
+}
+
+/**
+  * @brief  Sleep manager restore: when the button IO woke the core from deep
+  *         sleep, read the pin once and report the change the GPIO interrupt
+  *         missed. It goes through the debounce window like an edge. Other
+  *         wakeups leave the pin alone: the edge interrupt reports it.
+  */
+static void Button_SleepRestore(void)
+{
+  uint8_t pressed;
+  uint32_t primask;
+
+  if (!(BlueNRG_WakeupSource() & BUTTON_WAKEUP_IO))
+    return;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  pressed = (GPIO_ReadBit(BUTTON_PIN) == Bit_RESET);
+  if (pressed != button_state) {
+    Button_Push(pressed, Sched_Now());
+    button_stats.wakes++;
+    Sup_TaskPending(SUP_TASK_BUTTON);
+    Sched_PostEvent(SCHED_EVT_GPIO);
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Consumer side of the event queue.
+  * @retval 1 if an event was copied to evt, 0 if the queue is empty
+  */
+uint8_t Button_GetEvent(Button_Event_t *evt)
+{
+  uint8_t tail = button_tail;
+
+  if (tail == button_head)
+    return 0;
+
+  __DMB();
+  *evt = button_queue[tail];
+  button_tail = (tail + 1) & BUTTON_QUEUE_MASK;
+  return 1;
+}
+
+/**
+  * @brief  Last state seen by the ISR, without touching the pin.
+  */
+uint8_t Button_IsPressed(void)
+{
+  return button_state;
+}
+
+const Button_Stats_t *Button_GetStats(void)
+{
+  return &button_stats;
+}
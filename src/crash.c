@@ -0,0 +1,182 @@
+/**
+  ******************************************************************************
+  * @file    crash.c
+  * @brief   Crash record in .noinit RAM: written by the fault paths before
+  *          the reset, reported over the log at the next boot.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "BlueNRG1_conf.h"
+#include "scheduler.h"
+#include "log.h"
+#include "supervisor.h"
+#include "crash.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CRASH_RECORD_WORDS      (offsetof(Crash_Record_t, check) / sizeof(uint32_t))
+
+/* Private variables ---------------------------------------------------------*/
+/* Not cleared at boot, see BlueNRG1.ld */
+Crash_Record_t crash_record __attribute__((section(".noinit")));
+
+static const char *const crash_causes[] = {
+  "none",
+  "hard fault",
+  "hardware error",
+  "watchdog",
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t Crash_Check(const Crash_Record_t *rec)
+{
+  const uint32_t *word = (const uint32_t *)rec;
+  uint32_t sum = 0;
+  uint8_t i;
+
+  for (i = 0; i < CRASH_RECORD_WORDS; i++)
+    sum += word[i];
+  return ~sum;
+}
+
+/**
+  * @brief  Non zero if rec holds a record, reported or not, rather than the
+  *         contents of RAM at power on.
+  */
+uint8_t Crash_RecordValid(const Crash_Record_t *rec)
+{
+  return (rec->magic == CRASH_MAGIC || rec->magic == CRASH_MAGIC_REPORTED) &&
+         rec->check == Crash_Check(rec);
+}
+
+/**
+  * @brief  Fill the record but the frame, then reset. Runs on a stack that
+  *         may be exhausted: no call but Sched_Now().
+  */
+static void Crash_Commit(uint32_t code) __attribute__((noreturn));
+static void Crash_Commit(uint32_t code)
+{
+  crash_record.code = code;
+  crash_record.uptime_ms = Sched_Now();
+  crash_record.magic = CRASH_MAGIC;
+  crash_record.check = Crash_Check(&crash_record);
+
+  NVIC_SystemReset();
+  while (1);
+}
+
+static void Crash_Begin(void)
+{
+  crash_record.count = Crash_RecordValid(&crash_record) ? crash_record.count + 1 : 1;
+}
+
+/**
+  * @brief  Exception frame found by a handler on MSP or PSP.
+  */
+static void Crash_SaveFrame(const uint32_t *frame, uint32_t exc_return)
+{
+  crash_record.r0 = frame[0];
+  crash_record.r1 = frame[1];
+  crash_record.r2 = frame[2];
+  crash_record.r3 = frame[3];
+  crash_record.r12 = frame[4];
+  crash_record.lr = frame[5];
+  crash_record.pc = frame[6];
+  crash_record.xpsr = frame[7];
+  /* Bit 9 of the stacked xPSR: one more padding word to realign SP */
+  crash_record.sp = (uint32_t)(uintptr_t)frame + CRASH_FRAME_SIZE + ((frame[7] & (1UL << 9)) ? 4 : 0);
+  crash_record.exc_return = exc_return;
+}
+
+/**
+  * @brief  Fault handler body, entered from HardFault_Handler() with the
+  *         exception frame it found on MSP or PSP (bit 2 of EXC_RETURN).
+  */
+void Crash_Fault(const uint32_t *frame, uint32_t exc_return, uint32_t code)
+{
+  __disable_irq();
+  Crash_Begin();
+
+  Crash_SaveFrame(frame, exc_return);
+  crash_record.hw_error = 0;
+  crash_record.task = crash_record.miss = crash_record.miss_value = 0;
+
+  Crash_Commit(code);
+}
+
+/**
+  * @brief  Fatal stack error: record its code and the caller of
+  *         hci_hardware_error_event(), then reset.
+  */
+void Crash_HardwareError(uint8_t hw_error, uint32_t caller)
+{
+  uint32_t here;
+
+  __disable_irq();
+  Crash_Begin();
+
+  crash_record.r0 = crash_record.r1 = crash_record.r2 = crash_record.r3 = 0;
+  crash_record.r12 = 0;
+  crash_record.lr = caller;
+  crash_record.pc = 0;
+  crash_record.xpsr = 0;
+  crash_record.sp = (uint32_t)(uintptr_t)&here;
+  crash_record.exc_return = 0;
+  crash_record.hw_error = hw_error;
+  crash_record.task = crash_record.miss = crash_record.miss_value = 0;
+
+  Crash_Commit(CRASH_CODE_HW_ERROR);
+}
+
+/**
+  * @brief  Watchdog interrupt: the frame it interrupted and the supervised
+  *         task to blame, then reset.
+  */
+void Crash_Watchdog(const uint32_t *frame, uint32_t exc_return, uint32_t task, uint32_t miss,
+                    uint32_t miss_value)
+{
+  __disable_irq();
+  Crash_Begin();
+
+  Crash_SaveFrame(frame, exc_return);
+  crash_record.hw_error = 0;
+  crash_record.task = task;
+  crash_record.miss = miss;
+  crash_record.miss_value = miss_value;
+
+  Crash_Commit(CRASH_CODE_WATCHDOG);
+}
+
+/**
+  * @brief  Send the record of the last crash over the log, once.
+  * @retval Cause of the crash reported, CRASH_CODE_NONE if none
+  */
+Crash_Code_t Crash_BootReport(void)
+{
+  Crash_Record_t *rec = &crash_record;
+  uint32_t cause;
+
+  if (!Crash_RecordValid(rec) || rec->magic != CRASH_MAGIC)
+    return CRASH_CODE_NONE;
+
+  cause = rec->code < sizeof(crash_causes) / sizeof(crash_causes[0]) ? rec->code : CRASH_CODE_NONE;
+  PRINTF("crash %u: %s, pc 0x%08x lr 0x%08x, %u ms after boot\r\n", (unsigned)rec->count,
+         crash_causes[cause], (unsigned)rec->pc, (unsigned)rec->lr, (unsigned)rec->uptime_ms);
+  PRINTF("crash %u: r0 0x%08x r1 0x%08x r2 0x%08x r3 0x%08x r12 0x%08x\r\n", (unsigned)rec->count,
+         (unsigned)rec->r0, (unsigned)rec->r1, (unsigned)rec->r2, (unsigned)rec->r3,
+         (unsigned)rec->r12);
+  PRINTF("crash %u: sp 0x%08x xpsr 0x%08x exc_return 0x%08x hw_error 0x%02x\r\n",
+         (unsigned)rec->count, (unsigned)rec->sp, (unsigned)rec->xpsr,
+         (unsigned)rec->exc_return, (unsigned)rec->hw_error);
+  if (cause == CRASH_CODE_WATCHDOG)
+    PRINTF("crash %u: task %s %s, %u %s\r\n", (unsigned)rec->count, Sup_TaskName(rec->task),
+           Sup_MissName(rec->miss), (unsigned)rec->miss_value,
+           rec->miss == SUP_MISS_OVERRUN ? "us" : "ms");
+
+  /* Keep the count for the next crash */
+  rec->magic = CRASH_MAGIC_REPORTED;
+  rec->check = Crash_Check(rec);
+  return (Crash_Code_t)cause;
+}
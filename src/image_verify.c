@@ -0,0 +1,263 @@
+/**
+  ******************************************************************************
+  * @file    image_verify.c
+  * @brief   Boot time CRC32 check of the image in an OTA bank, cached in a
+  *          record log in flash.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "OTA_btl.h"
+#include "crc32.h"
+#include "ota_delta.h"
+#include "log.h"
+#include "image_verify.h"
+
+/* Private define ------------------------------------------------------------*/
+#define IMAGE_VERIFY_RECORD_LEN     sizeof(ImageVerify_Record_t)
+
+#define IMAGE_VERIFY_TAG_END        (OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET + 4)
+
+/* Flash contents at an address, and their CRC32 continuing crc: memory
+   mapped on the device; on the host the flash stand-in, which charges the
+   CPU time of Crc32_Update() */
+#ifndef HOST_SIM
+#define IMAGE_VERIFY_FLASH(address)          ((const uint8_t *)(address))
+#define IMAGE_VERIFY_CRC(crc, address, len)  Crc32_Update(crc, (const uint8_t *)(address), len)
+#else
+#define IMAGE_VERIFY_FLASH(address)          Sim_FlashData(address)
+#define IMAGE_VERIFY_CRC(crc, address, len)  Sim_FlashCrc32(crc, address, len)
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+#ifndef HOST_SIM
+/* Image as linked, BlueNRG1.ld: vector table to the end of the .data copy */
+extern const uint8_t _simage[];
+extern const uint8_t _eimage[];
+#endif
+
+static ImageVerify_Stats_t verify_stats;
+
+static const char *const verify_result_names[] = {
+  "no_bank",
+  "cached",
+  "updated",
+  "first",
+  "uncached",
+  "failed",
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+static const ImageVerify_Record_t *ImageVerify_Record(uint8_t index)
+{
+  return (const ImageVerify_Record_t *)(const void *)IMAGE_VERIFY_FLASH(IMAGE_VERIFY_LOG_ADDRESS +
+                                                                        index * IMAGE_VERIFY_RECORD_LEN);
+}
+
+/**
+  * @brief  Records in the log: they are written in order, the first one
+  *         still erased ends it.
+  */
+static uint8_t ImageVerify_Count(void)
+{
+  uint8_t n = 0;
+
+  while (n < IMAGE_VERIFY_LOG_RECORDS && ImageVerify_Record(n)->address != IMAGE_VERIFY_ERASED)
+    n++;
+  return n;
+}
+
+/**
+  * @brief  Append a record, its check word left erased unless given.
+  * @retval 0 if written, 1 if the log is full
+  */
+static uint8_t ImageVerify_Append(uint32_t address, uint32_t size, uint32_t crc, uint32_t check)
+{
+  uint8_t n = ImageVerify_Count();
+  uint32_t at = IMAGE_VERIFY_LOG_ADDRESS + n * IMAGE_VERIFY_RECORD_LEN;
+
+  if (n == IMAGE_VERIFY_LOG_RECORDS)
+    return 1;
+  FLASH_ProgramWord(at + offsetof(ImageVerify_Record_t, address), address);
+  FLASH_ProgramWord(at + offsetof(ImageVerify_Record_t, size), size);
+  FLASH_ProgramWord(at + offsetof(ImageVerify_Record_t, crc), crc);
+  if (check != IMAGE_VERIFY_ERASED)
+    FLASH_ProgramWord(at + offsetof(ImageVerify_Record_t, check), check);
+  return 0;
+}
+
+static void ImageVerify_Running(uint32_t *address, uint32_t *size)
+{
+#ifndef HOST_SIM
+  *address = (uint32_t)_simage;
+  *size = (uint32_t)(_eimage - _simage);
+#else
+  Sim_FlashImage(address, size);
+#endif
+}
+
+/**
+  * @brief  Check of the running image. Called first thing at boot, before
+  *         the log is up: the result is reported by ImageVerify_Report().
+  */
+ImageVerify_Result_t ImageVerify_Boot(void)
+{
+  const ImageVerify_Record_t *rec = NULL;
+  uint32_t address, size, crc;
+  uint8_t i, index = 0;
+
+  ImageVerify_Running(&address, &size);
+  verify_stats.address = address;
+  verify_stats.size = size;
+  verify_stats.crc_bytes = 0;
+  verify_stats.records = ImageVerify_Count();
+  verify_stats.result = IMAGE_VERIFY_NO_BANK;
+  if ((address != OTA_DELTA_BANK_LOWER && address != OTA_DELTA_BANK_HIGHER) ||
+      size == 0 || size > OTA_DELTA_BANK_SIZE)
+    return IMAGE_VERIFY_NO_BANK;
+
+  for (i = 0; i < verify_stats.records; i++) {
+    if (ImageVerify_Record(i)->address == address) {
+      rec = ImageVerify_Record(i);
+      index = i;
+    }
+  }
+
+  if (rec != NULL && rec->size == size) {
+    if (rec->check == ~rec->crc) {
+      verify_stats.result = IMAGE_VERIFY_CACHED;
+    } else if (rec->check != IMAGE_VERIFY_ERASED) {
+      verify_stats.result = IMAGE_VERIFY_FAILED;
+    } else {
+      /* First boot after an update */
+      verify_stats.crc_bytes = size;
+      crc = IMAGE_VERIFY_CRC(0, address, size);
+      FLASH_ProgramWord(IMAGE_VERIFY_LOG_ADDRESS + index * IMAGE_VERIFY_RECORD_LEN +
+                        offsetof(ImageVerify_Record_t, check),
+                        (crc == rec->crc) ? ~crc : IMAGE_VERIFY_REJECTED);
+      verify_stats.result = (crc == rec->crc) ? IMAGE_VERIFY_UPDATED : IMAGE_VERIFY_FAILED;
+    }
+    return (ImageVerify_Result_t)verify_stats.result;
+  }
+
+  /* Loaded by the debugger: nothing to check against, the CRC32 of this
+     boot is the reference of the next ones */
+  verify_stats.crc_bytes = size;
+  crc = IMAGE_VERIFY_CRC(0, address, size);
+  if (ImageVerify_Append(address, size, crc, ~crc) != 0) {
+    verify_stats.result = IMAGE_VERIFY_UNCACHED;
+  } else {
+    verify_stats.records++;
+    verify_stats.result = IMAGE_VERIFY_FIRST;
+  }
+  return (ImageVerify_Result_t)verify_stats.result;
+}
+
+/**
+  * @brief  Image of the other bank to fall back to: tagged valid or
+  *         invalidated by the update that replaced it (not erased), its last
+  *         record shows it passed its check, and it still matches that
+  *         CRC32 with its tag valid.
+  * @retval Its bank, 0 if none
+  */
+static uint32_t ImageVerify_Previous(void)
+{
+  const ImageVerify_Record_t *rec = NULL;
+  uint32_t address, crc, tag;
+  uint8_t i, n = ImageVerify_Count();
+
+  if (verify_stats.address == OTA_DELTA_BANK_LOWER)
+    address = OTA_DELTA_BANK_HIGHER;
+  else if (verify_stats.address == OTA_DELTA_BANK_HIGHER)
+    address = OTA_DELTA_BANK_LOWER;
+  else
+    return 0;
+  memcpy(&tag, IMAGE_VERIFY_FLASH(address + OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET), sizeof(tag));
+  if (tag != OTA_VALID_TAG && tag != OTA_INVALID_OLD_TAG)
+    return 0;
+
+  for (i = 0; i < n; i++) {
+    if (ImageVerify_Record(i)->address == address)
+      rec = ImageVerify_Record(i);
+  }
+  if (rec == NULL || rec->check != ~rec->crc || rec->size < IMAGE_VERIFY_TAG_END ||
+      rec->size > OTA_DELTA_BANK_SIZE)
+    return 0;
+
+  tag = OTA_VALID_TAG;
+  crc = IMAGE_VERIFY_CRC(0, address, OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET);
+  crc = Crc32_Update(crc, (const uint8_t *)&tag, sizeof(tag));
+  crc = IMAGE_VERIFY_CRC(crc, address + IMAGE_VERIFY_TAG_END, rec->size - IMAGE_VERIFY_TAG_END);
+  return (crc == rec->crc) ? address : 0;
+}
+
+/**
+  * @brief  The running image failed its check: reset into the image it
+  *         replaced, if there is one to fall back to (ImageVerify_Previous()).
+  *         Its tag is made valid again, its first page rewritten from RAM
+  *         as flash bits only clear, then the tag of the running image is
+  *         invalidated, and the reset manager boots the other bank. Returns
+  *         only when there is none: the image runs on, reporting the failed
+  *         check.
+  */
+void ImageVerify_Fallback(void)
+{
+  uint32_t page[N_BYTES_PAGE / 4];
+  uint32_t address = ImageVerify_Previous();
+  uint32_t tag_address = address + OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET;
+  uint16_t i;
+
+  if (address == 0)
+    return;
+  memcpy(page, IMAGE_VERIFY_FLASH(address), sizeof(page));
+  if (page[OTA_TAG_VECTOR_TABLE_ENTRY_INDEX] != OTA_VALID_TAG) {
+    page[OTA_TAG_VECTOR_TABLE_ENTRY_INDEX] = OTA_VALID_TAG;
+    FLASH_ErasePage((uint16_t)((address - _MEMORY_FLASH_BEGIN_) / N_BYTES_PAGE));
+    for (i = 0; i < N_BYTES_PAGE / 4; i += 4)
+      FLASH_ProgramWordBurst(address + i * 4, &page[i]);
+    if (memcmp(IMAGE_VERIFY_FLASH(tag_address), &page[OTA_TAG_VECTOR_TABLE_ENTRY_INDEX], 4) != 0)
+      return;
+  }
+  FLASH_ProgramWord(verify_stats.address + OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET, OTA_INVALID_OLD_TAG);
+  NVIC_SystemReset();
+}
+
+/**
+  * @brief  New image written in a bank, its CRC32 checked against the OTA
+  *         image: the next boot from that bank checks it once.
+  * @retval 0 if recorded, 1 if the log is full (the check then runs at
+  *         every boot)
+  */
+uint8_t ImageVerify_Updated(uint32_t address, uint32_t size, uint32_t crc)
+{
+  return ImageVerify_Append(address, size, crc, IMAGE_VERIFY_ERASED);
+}
+
+/**
+  * @brief  Result of the boot check over the log, once it is up.
+  */
+void ImageVerify_Report(void)
+{
+  if (verify_stats.result == IMAGE_VERIFY_NO_BANK)
+    return;
+  PRINTF("image 0x%08x, %u bytes: check %s, %u bytes of CRC32, %u/%u records\r\n",
+         (unsigned)verify_stats.address, (unsigned)verify_stats.size,
+         ImageVerify_ResultName((ImageVerify_Result_t)verify_stats.result),
+         (unsigned)verify_stats.crc_bytes, (unsigned)verify_stats.records,
+         (unsigned)IMAGE_VERIFY_LOG_RECORDS);
+}
+
+const char *ImageVerify_ResultName(ImageVerify_Result_t result)
+{
+  return ((uint32_t)result < sizeof(verify_result_names) / sizeof(verify_result_names[0])) ?
+         verify_result_names[result] : "?";
+}
+
+const ImageVerify_Stats_t *ImageVerify_GetStats(void)
+{
+  return &verify_stats;
+}
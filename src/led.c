@@ -0,0 +1,276 @@
+/**
+  ******************************************************************************
+  * @file    led.c
+  * @brief   LED pattern engine (IO14): the steps of the pattern are turned
+  *          into segments at one level, each one programmed on the LED
+  *          virtual timer, whose interrupt sets the next one.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "SDK_EVAL_Config.h"
+#include "trace.h"
+#include "supervisor.h"
+#include "led.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Position in a pattern: next half (on, then off) of a blink of a step */
+typedef struct {
+  const Led_Pattern_t *pattern;
+  uint8_t step;
+  uint8_t blink;
+  uint8_t half;
+  uint8_t pass;
+} Led_Cursor_t;
+
+/* Private define ------------------------------------------------------------*/
+#define LED_HALF_ON             0
+#define LED_HALF_OFF            1
+
+/* Private variables ---------------------------------------------------------*/
+static const Led_Step_t led_steps_idle[] = {
+  { 500, 500, 1 },
+};
+
+static const Led_Step_t led_steps_pressed[] = {
+  { 100, 100, 1 },
+};
+
+const Led_Pattern_t led_pattern_idle = { led_steps_idle, 1, LED_REPEAT_FOREVER };
+const Led_Pattern_t led_pattern_pressed = { led_steps_pressed, 1, LED_REPEAT_FOREVER };
+
+/* Patterns built at run time */
+static Led_Step_t led_code_steps[3];
+static Led_Pattern_t led_code;
+static Led_Step_t led_progress_step;
+static Led_Pattern_t led_progress;
+
+/* Engine state, owned by the timer interrupt while a pattern plays */
+static Led_Cursor_t led_cursor;
+static const Led_Pattern_t *led_base;
+static Led_Stats_t led_stats;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Next segment of the pattern at the cursor, the cursor moved past
+  *         it. The pattern must hold at least one segment.
+  * @param  on: LED level of the segment
+  * @param  ms: length of the segment
+  * @retval 0 at the end of the last pass
+  */
+static uint8_t Led_NextSegment(Led_Cursor_t *cur, uint8_t *on, uint32_t *ms)
+{
+  const Led_Step_t *step;
+  uint8_t half;
+
+  for (;;) {
+    if (cur->step >= cur->pattern->num_steps) {
+      cur->step = 0;
+      if (cur->pattern->repeat != LED_REPEAT_FOREVER && ++cur->pass >= cur->pattern->repeat)
+        return 0;
+    }
+    step = &cur->pattern->steps[cur->step];
+    if (cur->blink >= step->count) {
+      cur->step++;
+      cur->blink = 0;
+      cur->half = LED_HALF_ON;
+      continue;
+    }
+
+    half = cur->half;
+    if (half == LED_HALF_ON) {
+      cur->half = LED_HALF_OFF;
+    } else {
+      cur->half = LED_HALF_ON;
+      cur->blink++;
+    }
+    *ms = (half == LED_HALF_ON) ? step->on_ms : step->off_ms;
+    if (*ms != 0) {
+      *on = (half == LED_HALF_ON);
+      return 1;
+    }
+  }
+}
+
+/**
+  * @brief  Next timer period: the next segment and the following ones at
+  *         the same level, up to LED_SEGMENT_MAX_MS.
+  * @retval 0 at the end of the pattern
+  */
+static uint8_t Led_NextPeriod(uint8_t *on, uint32_t *ms)
+{
+  Led_Cursor_t next;
+  uint8_t next_on;
+  uint32_t next_ms;
+
+  if (led_cursor.pattern == NULL || !Led_NextSegment(&led_cursor, on, ms))
+    return 0;
+
+  for (;;) {
+    next = led_cursor;
+    if (!Led_NextSegment(&next, &next_on, &next_ms) || next_on != *on ||
+        *ms + next_ms > LED_SEGMENT_MAX_MS)
+      return 1;
+    led_cursor = next;
+    *ms += next_ms;
+  }
+}
+
+/**
+  * @brief  Set the LED for the next period and program its end. At the end
+  *         of a pattern played a given number of times, back to the last
+  *         pattern played forever, else LED off. Called with interrupts
+  *         masked or from the timer interrupt.
+  */
+static void Led_Advance(void)
+{
+  uint8_t on;
+  uint32_t ms;
+
+  if (!Led_NextPeriod(&on, &ms)) {
+    led_cursor = (Led_Cursor_t){ led_base, 0, 0, LED_HALF_ON, 0 };
+    if (led_base == NULL || !Led_NextPeriod(&on, &ms)) {
+      GPIO_WriteBit(LED_PIN, LED_OFF);
+      Sup_TaskIdle(SUP_TASK_LED);
+      return;
+    }
+  }
+
+  GPIO_WriteBit(LED_PIN, on ? LED_ON : LED_OFF);
+  if (HAL_VTimerStart_ms(LED_VTIMER_ID, (int32_t)ms) != 0) {
+    led_stats.timer_errors++;
+    Sup_TaskIdle(SUP_TASK_LED);
+    return;
+  }
+  Sup_TaskExpect(SUP_TASK_LED, ms);
+}
+
+/**
+  * @brief  Total length of the steps, 0 if the pattern never lights nor
+  *         waits.
+  */
+static uint32_t Led_PatternMs(const Led_Pattern_t *pattern)
+{
+  uint32_t total = 0;
+  uint8_t i;
+
+  for (i = 0; i < pattern->num_steps; i++)
+    total += (uint32_t)(pattern->steps[i].on_ms + pattern->steps[i].off_ms) * pattern->steps[i].count;
+  return total;
+}
+
+/**
+  * @brief  Led_Play() body, interrupts masked.
+  */
+static void Led_PlayLocked(const Led_Pattern_t *pattern)
+{
+  if (pattern != NULL && Led_PatternMs(pattern) == 0)
+    pattern = NULL;
+  if (pattern == NULL || pattern->repeat == LED_REPEAT_FOREVER)
+    led_base = pattern;
+
+  HAL_VTimer_Stop(LED_VTIMER_ID);
+  led_cursor = (Led_Cursor_t){ pattern, 0, 0, LED_HALF_ON, 0 };
+  led_stats.patterns++;
+  Led_Advance();
+}
+
+/**
+  * @brief  A status or error code: an optional long blink, code short ones,
+  *         then a pause, LED_CODE_REPEAT times.
+  */
+static void Led_ShowCode(uint8_t code, uint8_t lead)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint8_t n = 0;
+
+  __disable_irq();
+  if (lead)
+    led_code_steps[n++] = (Led_Step_t){ LED_CODE_LEAD_MS, LED_CODE_OFF_MS, 1 };
+  led_code_steps[n++] = (Led_Step_t){ LED_CODE_ON_MS, LED_CODE_OFF_MS, code };
+  led_code_steps[n++] = (Led_Step_t){ 0, LED_CODE_PAUSE_MS, 1 };
+  led_code = (Led_Pattern_t){ led_code_steps, n, LED_CODE_REPEAT };
+  Led_PlayLocked(&led_code);
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  LED off, no pattern. The pin is set up by main().
+  */
+void Led_Init(void)
+{
+  led_base = NULL;
+  led_cursor = (Led_Cursor_t){0};
+  led_stats = (Led_Stats_t){0};
+  HAL_VTimer_Stop(LED_VTIMER_ID);
+  GPIO_WriteBit(LED_PIN, LED_OFF);
+
+  /* Each programmed edge must come */
+  Sup_TaskStart(SUP_TASK_LED);
+}
+
+/**
+  * @brief  Play a pattern from its start, NULL for LED off. A pattern
+  *         played forever is kept to come back to after the finite ones.
+  */
+void Led_Play(const Led_Pattern_t *pattern)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  Led_PlayLocked(pattern);
+  __set_PRIMASK(primask);
+}
+
+void Led_ShowStatus(uint8_t code)
+{
+  Led_ShowCode(code, 0);
+}
+
+void Led_ShowError(uint8_t code)
+{
+  Led_ShowCode(code, 1);
+}
+
+/**
+  * @brief  Progress in percent as the share of each LED_PROGRESS_PERIOD_MS
+  *         the LED is on, played forever.
+  */
+void Led_ShowProgress(uint8_t percent)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint16_t on_ms;
+
+  if (percent > 100)
+    percent = 100;
+  on_ms = LED_PROGRESS_MIN_MS +
+          (uint16_t)((uint32_t)(LED_PROGRESS_PERIOD_MS - 2 * LED_PROGRESS_MIN_MS) * percent / 100);
+
+  __disable_irq();
+  led_progress_step = (Led_Step_t){ on_ms, LED_PROGRESS_PERIOD_MS - on_ms, 1 };
+  led_progress = (Led_Pattern_t){ &led_progress_step, 1, LED_REPEAT_FOREVER };
+  Led_PlayLocked(&led_progress);
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  LED virtual timer expiry, from HAL_VTimerTimeoutCallback():
+  *         next edge of the pattern.
+  */
+void Led_TimerIrq(void)
+{
+  Sup_TaskBegin(SUP_TASK_LED);
+  TRACE_POINT(TRACE_PT_LED);
+  led_stats.edges++;
+  Led_Advance();
+  Sup_TaskEnd(SUP_TASK_LED);
+}
+
+const Led_Stats_t *Led_GetStats(void)
+{
+  return &led_stats;
+}
@@ -0,0 +1,339 @@
+/**
+  ******************************************************************************
+  * @file    log.c
+  * @brief   Non-blocking log transport over the UART.
+  *
+  *          The ring uses free-running 16-bit indices: log_head is only moved
+  *          by the producer (main loop), log_tail only by the consumer (UART
+  *          interrupt), so no lock is needed between them. The UART TX
+  *          interrupt is enabled only while the ring holds data.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "supervisor.h"
+#include "sleep_mgr.h"
+#include "log.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define LOG_RING_MASK           (LOG_RING_SIZE - 1)
+
+#if (LOG_RING_SIZE & LOG_RING_MASK) != 0 || LOG_RING_SIZE > 32768
+#error "LOG_RING_SIZE must be a power of 2, at most 32768"
+#endif
+
+/* Room kept for the "<n lost>" marker */
+#define LOG_LOST_MARKER_MAX     16
+
+/* Private macro -------------------------------------------------------------*/
+#define LOG_USED()              ((uint16_t)(log_head - log_tail))
+#define LOG_FREE()              ((uint16_t)(LOG_RING_SIZE - LOG_USED()))
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t log_ring[LOG_RING_SIZE];
+static volatile uint16_t log_head;
+static volatile uint16_t log_tail;
+
+static char log_line[LOG_LINE_MAX];
+static uint32_t log_lost;
+static Log_Stats_t log_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+static SleepModes Log_SleepCheck(void);
+
+static const SleepMgr_Periph_t log_sleep = { "uart", Log_SleepCheck, NULL, NULL };
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Move bytes from the ring to the UART TX FIFO until one of them is
+  *         full/empty. Runs in the UART interrupt or with interrupts masked.
+  */
+static void Log_Fill(void)
+{
+  uint16_t tail = log_tail;
+
+  while (tail != log_head && UART_GetFlagStatus(UART_FLAG_TXFF) == RESET) {
+    UART_SendData(log_ring[tail & LOG_RING_MASK]);
+    tail++;
+  }
+  log_tail = tail;
+}
+
+/**
+  * @brief  Start the transmission if the UART is idle.
+  */
+static void Log_Kick(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  Log_Fill();
+  /* The TX interrupt fires when the FIFO drains below its threshold */
+  if (log_tail != log_head) {
+    UART_ITConfig(UART_IT_TX, ENABLE);
+    Sup_TaskPending(SUP_TASK_LOG);
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Copy a message into the ring, all or nothing.
+  */
+static uint8_t Log_Enqueue(const uint8_t *data, uint16_t len)
+{
+  uint16_t head = log_head;
+  uint16_t i;
+
+  if (len > LOG_FREE())
+    return 0;
+
+  for (i = 0; i < len; i++)
+    log_ring[(uint16_t)(head + i) & LOG_RING_MASK] = data[i];
+
+  /* The data must be in memory before the interrupt can see it */
+  __DMB();
+  log_head = head + len;
+
+  if (LOG_USED() > log_stats.high_water)
+    log_stats.high_water = LOG_USED();
+
+  return 1;
+}
+
+/**
+  * @brief  LEB128 encoding of an integer argument: small values, the common
+  *         case, take 1 or 2 bytes instead of 4.
+  * @retval Number of bytes written (at most 10)
+  */
+static uint8_t Log_Varint(uint8_t *p, uint64_t val)
+{
+  uint8_t n = 0;
+
+  while (val >= 0x80) {
+    p[n++] = (uint8_t)val | 0x80;
+    val >>= 7;
+  }
+  p[n++] = (uint8_t)val;
+  return n;
+}
+
+/**
+  * @brief  Queue a message, preceded by the count of the messages dropped
+  *         before it if there are any.
+  * @param  tokenized: the stream is tokenized, the count is sent as a
+  *         LOG_TOKEN_LOST frame instead of text
+  */
+static uint8_t Log_Post(const uint8_t *data, uint16_t len, uint8_t tokenized)
+{
+  char marker[LOG_LOST_MARKER_MAX];
+  int marker_len;
+
+  /* Tell the reader about the dropped messages first */
+  if (log_lost != 0 && LOG_FREE() >= len + LOG_LOST_MARKER_MAX) {
+    if (tokenized) {
+      marker[0] = (char)(LOG_TOKEN_LOST & 0xFF);
+      marker[1] = (char)(LOG_TOKEN_LOST >> 8);
+      marker[2] = (char)Log_Varint((uint8_t *)&marker[LOG_TOKEN_HEADER], log_lost);
+      marker_len = LOG_TOKEN_HEADER + marker[2];
+    } else {
+      marker_len = snprintf(marker, sizeof(marker), "<%lu lost>\r\n", (unsigned long)log_lost);
+    }
+    if (marker_len > 0 && marker_len < (int)sizeof(marker) &&
+        Log_Enqueue((const uint8_t *)marker, (uint16_t)marker_len))
+      log_lost = 0;
+  }
+
+  if (log_lost != 0 || !Log_Enqueue(data, len)) {
+    log_lost++;
+    log_stats.dropped++;
+    return 0;
+  }
+
+  log_stats.messages++;
+  log_stats.bytes += len;
+  Log_Kick();
+  return 1;
+}
+
+/**
+  * @brief  Take over the TX side of the UART configured by
+  *         SdkEvalComUartInit().
+  */
+void Log_Init(void)
+{
+  NVIC_InitType NVIC_InitStructure;
+
+  log_head = 0;
+  log_tail = 0;
+  log_lost = 0;
+  log_stats = (Log_Stats_t){0};
+
+  UART_TxFifoIrqLevelConfig(FIFO_LEV_1_4);
+  UART_ITConfig(UART_IT_TX, DISABLE);
+
+  NVIC_InitStructure.NVIC_IRQChannel = UART_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = LOW_PRIORITY;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  /* The ring must keep draining while it holds data */
+  Sup_TaskStart(SUP_TASK_LOG);
+  SleepMgr_Register(&log_sleep);
+}
+
+/**
+  * @brief  printf() replacement: format and queue, never wait for the UART.
+  * @retval Number of characters queued, 0 if the message was dropped
+  */
+int Log_Printf(const char *format, ...)
+{
+  va_list args;
+  int len;
+
+  va_start(args, format);
+  len = vsnprintf(log_line, sizeof(log_line), format, args);
+  va_end(args);
+
+  if (len < 0)
+    return 0;
+  if (len >= (int)sizeof(log_line))
+    len = sizeof(log_line) - 1;
+
+  return Log_Post((const uint8_t *)log_line, (uint16_t)len, 0) ? len : 0;
+}
+
+/**
+  * @brief  Tokenized log call, used through LOG_TOKEN()/PRINTF().
+  * @param  id: offset of the format string in the .log_fmt section
+  * @param  nargs: number of arguments
+  * @param  types: LOG_ARG_xxx of each argument, 2 bits each, first argument
+  *         in the low bits
+  * @note   The frame is built in the LOG_LINE_MAX line buffer: strings are
+  *         cut, and the arguments that do not fit are left out.
+  */
+void Log_Token(uint16_t id, uint8_t nargs, uint16_t types, ...)
+{
+  va_list args;
+  uint8_t *p = (uint8_t *)log_line + LOG_TOKEN_HEADER;
+  const uint8_t *end = (uint8_t *)log_line + sizeof(log_line);
+  uint8_t arg[LOG_TOKEN_VARINT_MAX];
+  const char *str;
+  size_t len;
+  uint8_t i;
+
+  va_start(args, types);
+  for (i = 0; i < nargs; i++, types >>= 2) {
+    if ((types & 3) == LOG_ARG_STR) {
+      str = va_arg(args, const char *);
+      len = (str != NULL) ? strlen(str) : 0;
+      if (len > LOG_TOKEN_STR_MAX)
+        len = LOG_TOKEN_STR_MAX;
+      if (p == end)
+        break;
+      if (len + 1 > (size_t)(end - p))
+        len = (size_t)(end - p) - 1;
+      *p++ = (uint8_t)len;
+      memcpy(p, str, len);
+      p += len;
+    } else {
+      if ((types & 3) == LOG_ARG_INT64)
+        len = Log_Varint(arg, va_arg(args, uint64_t));
+      else
+        len = Log_Varint(arg, va_arg(args, uint32_t));
+      /* The decoder reads the arguments in order: stop at the first one that does not fit */
+      if (len > (size_t)(end - p))
+        break;
+      memcpy(p, arg, len);
+      p += len;
+    }
+  }
+  va_end(args);
+
+  log_line[0] = (char)(id & 0xFF);
+  log_line[1] = (char)(id >> 8);
+  log_line[2] = (char)(p - (uint8_t *)log_line - LOG_TOKEN_HEADER);
+  Log_Post((const uint8_t *)log_line, (uint16_t)(p - (uint8_t *)log_line), 1);
+}
+
+/**
+  * @brief  Queue raw bytes.
+  * @retval 1 if queued, 0 if dropped because the ring is full
+  */
+uint8_t Log_Write(const uint8_t *data, uint16_t len)
+{
+#ifdef LOG_TOKENIZED
+  return Log_Post(data, len, 1);
+#else
+  return Log_Post(data, len, 0);
+#endif
+}
+
+/**
+  * @brief  Bytes that Log_Write() can queue now without dropping.
+  */
+uint16_t Log_Room(void)
+{
+  /* Keep room for the "<n lost>" marker sent before the data */
+  if (LOG_FREE() < LOG_LOST_MARKER_MAX)
+    return 0;
+  return LOG_FREE() - LOG_LOST_MARKER_MAX;
+}
+
+/**
+  * @brief  Non zero while there is data in the ring or in the UART.
+  */
+uint8_t Log_Busy(void)
+{
+  return (log_head != log_tail) || (UART_GetFlagStatus(UART_FLAG_BUSY) == SET);
+}
+
+/**
+  * @brief  Sleep manager check: the UART stays powered while the ring
+  *         drains, its interrupt wakes the core from CPU halt.
+  */
+static SleepModes Log_SleepCheck(void)
+{
+  return Log_Busy() ? SLEEPMODE_CPU_HALT : SLEEPMODE_NOTIMER;
+}
+
+/**
+  * @brief  Wait until everything queued has left the UART, for the paths
+  *         that reset or stop the device right after logging.
+  */
+void Log_Flush(void)
+{
+  while (Log_Busy()) {
+    if (__get_PRIMASK())
+      Log_Fill();   /* The interrupt cannot run: drain by polling */
+  }
+}
+
+/**
+  * @brief  UART TX FIFO interrupt, called from UART_Handler().
+  */
+void Log_UartIrqHandler(void)
+{
+  if (UART_GetITStatus(UART_IT_TX) != SET)
+    return;
+
+  UART_ClearITPendingBit(UART_IT_TX);
+  Sup_TaskBegin(SUP_TASK_LOG);
+  Log_Fill();
+  Sup_TaskEnd(SUP_TASK_LOG);
+  /* Each refill is progress: the next one is due within the deadline */
+  if (log_tail == log_head)
+    UART_ITConfig(UART_IT_TX, DISABLE);
+  else
+    Sup_TaskPending(SUP_TASK_LOG);
+}
+
+const Log_Stats_t *Log_GetStats(void)
+{
+  return &log_stats;
+}
@@ -223,10 +223,26 @@ NOTEs:
 #include "ble_const.h"
 #include "bluenrg1_stack.h"
 #include "sleep.h"
+#include "sleep_mgr.h"
 #include "SDK_EVAL_Config.h"
 #include "Beacon_config.h"
 #include "OTA_btl.h"
 #include "clock.h"
+#include "adv_data.h"
+#include "adv_rotate.h"
+#include "adv_live.h"
+#include "mem_monitor.h"
+#include "prof.h"
+#include "crash.h"
+#include "boot.h"
+#include "image_verify.h"
+#include "ota_service.h"
+#include "supervisor.h"
+#include "scheduler.h"
+#include "button.h"
+#include "led.h"
+#include "log.h"
+#include "trace.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -234,53 +250,207 @@ NOTEs:
 #define LOCAL_NAME  'B','l','u','e','N','R','G','1'
 
 
+/* Beacon frame, iBeacon layout. Company identifier 0x0030 is
+   STMicroelectronics: to be customized for specific identifier */
+#define BEACON_COMPANY_ID   0x0030
+#define BEACON_UUID         0xE2, 0x0A, 0x39, 0xF4, 0x73, 0xF5, 0x4B, 0xC4, \
+                            0xA1, 0x2F, 0x17, 0xD1, 0xAD, 0x07, 0xA9, 0x61
+#define BEACON_MAJOR        0
+#define BEACON_MINOR        0
+#define BEACON_POWER_1M     (-56)     /* Measured power at 1 m, dBm */
+
+/* Energy knobs: advertising interval in 0.625 ms units (160 = 100 ms) and
+   TX power of aci_hal_set_tx_power_level() (high power mode, PA level 4 = -2 dBm).
+   bin/host/energy_bench estimates the average current they cost. */
+#define ADV_INTERVAL_MIN    160
+#define ADV_INTERVAL_MAX    160
+#define TX_POWER_HIGH       1
+#define TX_POWER_LEVEL      4
+
+/* Advertising type: connectable in the builds with the OTA service
+   (BEACON_OTA_SERVICE of Beacon_config.h), for the OTA client of a phone,
+   non connectable otherwise. The beacon frames are the same */
+#if BEACON_OTA_SERVICE
+#define ADV_TYPE            ADV_IND
+#else
+#define ADV_TYPE            ADV_NONCONN_IND
+#endif
+
+/* Longest LL packet with data length extension, and its air time at 1 Mbps:
+   one 212 bytes image packet (OTA_EXTENDED_PACKET_LEN) per LL packet */
+#define LL_TX_OCTETS_MAX    251
+#define LL_TX_TIME_MAX      2120
+
 /* Set to 1 for enabling Flags AD Type position at the beginning 
    of the advertising packet */
 #define ENABLE_FLAGS_AD_TYPE_AT_BEGINNING 1
 
+/* Set to 1 to rotate the iBeacon, Eddystone and custom frames below
+   (adv_rotate.c), 0 to advertise the iBeacon frame only. Needs the Flags
+   at the beginning: each frame is a complete payload. */
+#define ENABLE_ADV_ROTATION 1
+
+/* Rotation slot: time each frame stays on air, ms */
+#define ADV_SLOT_MS         1000
+
+/* Eddystone frames: namespace (10 bytes), instance (6 bytes), URL and
+   TX power at 0 m (power at 1 m + 41 dBm) */
+#define EDDYSTONE_NAMESPACE 0xE2, 0x0A, 0x39, 0xF4, 0x73, 0xF5, 0x4B, 0xC4, 0xA1, 0x2F
+#define EDDYSTONE_INSTANCE  0x00, 0x00, 0x00, 0x00, 0x00, 0x01
+#define EDDYSTONE_URL       's','t','.','c','o','m'
+#define EDDYSTONE_POWER_0M  (BEACON_POWER_1M + 41)
+
+/* Custom frame: manufacturer data, button press counter, stack margin
+   (Mem_StackMarginByte()) then the firmware version */
+#define CUSTOM_FRAME_TYPE   0x01
+#define CUSTOM_COUNTER_OFS  (ADV_FLAGS_LEN + 5)
+#define CUSTOM_MARGIN_OFS   (ADV_FLAGS_LEN + 9)
+
+/* Live fields: updates are coalesced over one advertising interval (ms),
+   the TLM uptime is refreshed every TELEMETRY_PERIOD_MS */
+#define ADV_LIVE_WINDOW_MS  (ADV_INTERVAL_MAX * 5 / 8)
+#define TELEMETRY_PERIOD_MS 1000
+
+/* The telemetry waits for the end of the next advertising event and runs on
+   its wakeup, off the radio activity */
+#define TELEMETRY_SLACK_MS  250
+
+/* Stack high-water mark and heap sampling period */
+#define MEM_SAMPLE_PERIOD_MS 10000
+
+/* A button press held this long logs the sleep statistics, then dumps the
+   cycle profile (make CYCLE_PROF=1) */
+#define STATS_HOLD_MS       2000
+
+/* Progress lines of the init, left out of the fast boot path: the boot
+   report of boot.c sums it up */
+#define INIT_LOG(...)       do { if (!Boot_Fast()) PRINTF(__VA_ARGS__); } while (0)
+
+#if ENABLE_ADV_ROTATION && !ENABLE_FLAGS_AD_TYPE_AT_BEGINNING
+#error "ENABLE_ADV_ROTATION needs ENABLE_FLAGS_AD_TYPE_AT_BEGINNING"
+#endif
+
+/* A log ring over the default size takes the stack RAM freed by the build
+   profile (PROFILE= of the Makefile) */
+_Static_assert(LOG_RING_SIZE <= LOG_RING_SIZE_DEFAULT ||
+               LOG_RING_SIZE - LOG_RING_SIZE_DEFAULT <= BEACON_PROFILE_FREED_RAM,
+               "LOG_RING_SIZE is over the RAM freed by the build profile");
+
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
+#if ENABLE_FLAGS_AD_TYPE_AT_BEGINNING
+/* Set AD Type Flags at beginning on Advertising packet, followed by the beacon
+   frame. In RAM: major, minor and measured power are live fields */
+ADV_DATA_DEFINE_LIVE(adv_data,
+  ADV_FLAGS(ADV_FLAGS_GENERAL_NO_BREDR),
+  ADV_IBEACON(BEACON_COMPANY_ID, BEACON_MAJOR, BEACON_MINOR, BEACON_POWER_1M, BEACON_UUID));
+#else
+/* The stack puts the Flags first, the beacon frame is added after them */
+ADV_DATA_DEFINE(manuf_data,
+  ADV_IBEACON(BEACON_COMPANY_ID, BEACON_MAJOR, BEACON_MINOR, BEACON_POWER_1M, BEACON_UUID));
+#endif
+
+#if ENABLE_ADV_ROTATION
+ADV_DATA_DEFINE(eddystone_uid_data,
+  ADV_FLAGS(ADV_FLAGS_GENERAL_NO_BREDR),
+  ADV_EDDYSTONE_UID(EDDYSTONE_POWER_0M, EDDYSTONE_NAMESPACE, EDDYSTONE_INSTANCE));
+
+ADV_DATA_DEFINE(eddystone_url_data,
+  ADV_FLAGS(ADV_FLAGS_GENERAL_NO_BREDR),
+  ADV_EDDYSTONE_URL(EDDYSTONE_POWER_0M, ADV_URL_HTTPS_WWW, EDDYSTONE_URL));
+
+/* 3.0 V, 20.0 degrees until set; the PDU count is not maintained */
+ADV_DATA_DEFINE_LIVE(eddystone_tlm_data,
+  ADV_FLAGS(ADV_FLAGS_GENERAL_NO_BREDR),
+  ADV_EDDYSTONE_TLM(3000, 0x1400, 0, 0));
+
+ADV_DATA_DEFINE_LIVE(custom_data,
+  ADV_FLAGS(ADV_FLAGS_GENERAL_NO_BREDR),
+  ADV_MANUFACTURER(BEACON_COMPANY_ID, CUSTOM_FRAME_TYPE, ADV_BE32(0), 0xFF, '1', '.', '1', '.', '0'));
+
+static uint32_t button_presses;
+#endif
+
+#if ENABLE_FLAGS_AD_TYPE_AT_BEGINNING
+/* Weights: the iBeacon frame in 3 slots out of 7. Without rotation the
+   iBeacon frame is the only one, and stays on air. */
+static const Adv_Frame_t adv_frames[] = {
+  ADV_FRAME(adv_data, 3),
+#if ENABLE_ADV_ROTATION
+  ADV_FRAME(eddystone_uid_data, 1),
+  ADV_FRAME(eddystone_url_data, 1),
+  ADV_FRAME(eddystone_tlm_data, 1),
+  ADV_FRAME(custom_data, 1),
+#endif
+};
+
+static const Adv_Rotation_t adv_rotation = {
+  adv_frames, sizeof(adv_frames) / sizeof(adv_frames[0]), ADV_SLOT_MS
+};
+#endif
+
+/* GAP service handles, for the name set by Device_SetName() */
+static uint16_t service_handle;
+static uint16_t dev_name_char_handle;
+
 /* Private function prototypes -----------------------------------------------*/
 /* Private functions ---------------------------------------------------------*/
 
 void Device_Init(void)
 {
   uint8_t ret;
-  uint16_t service_handle;
-  uint16_t dev_name_char_handle;
   uint16_t appearance_char_handle;
   
   /* Set the TX Power to -2 dBm */
-  ret = aci_hal_set_tx_power_level(1,4);
+  ret = aci_hal_set_tx_power_level(TX_POWER_HIGH, TX_POWER_LEVEL);
   if(ret != 0) {
-    printf ("Error in aci_hal_set_tx_power_level() 0x%04xr\n", ret);
+    PRINTF("Error in aci_hal_set_tx_power_level() 0x%04xr\n", ret);
     while(1);
   }
 
   /* Init the GATT */
   ret = aci_gatt_init();
   if (ret != 0) 
-    printf ("Error in aci_gatt_init() 0x%04xr\n", ret);
+    PRINTF("Error in aci_gatt_init() 0x%04xr\n", ret);
   else
-    printf ("aci_gatt_init() --> SUCCESS\r\n");
+    INIT_LOG("aci_gatt_init() --> SUCCESS\r\n");
   
   /* Init the GAP */
   ret = aci_gap_init(0x01, 0x00, 0x08, &service_handle, 
                      &dev_name_char_handle, &appearance_char_handle);
   if (ret != 0)
-    printf ("Error in aci_gap_init() 0x%04x\r\n", ret);
+    PRINTF("Error in aci_gap_init() 0x%04x\r\n", ret);
   else
-    printf ("aci_gap_init() --> SUCCESS\r\n");
+    INIT_LOG("aci_gap_init() --> SUCCESS\r\n");
 
+#if BEACON_OTA_SERVICE
+  /* OTA service: new images go to the bank the image does not run from */
+  ret = OtaService_Init(ImageVerify_GetStats()->address, OTA_MAX_ATT_SIZE);
+  if (ret != 0)
+    PRINTF("Error in OtaService_Init() 0x%04x\r\n", ret);
+  else
+    INIT_LOG("OtaService_Init() --> SUCCESS\r\n");
+#endif
+}
+
+/**
+* @brief  Device name in the GAP Device Name characteristic. Not on air
+*         (non connectable advertising): deferred by the fast boot path.
+* @param  None
+* @retval None
+*/
+static void Device_SetName(void)
+{
+  uint8_t ret;
   uint8_t name[] = {LOCAL_NAME };
 
     /* Set the device name */
   ret = aci_gatt_update_char_value_ext(0,service_handle, dev_name_char_handle,0,sizeof(name),0, sizeof(name), name);
   if (ret != BLE_STATUS_SUCCESS) {
-    printf ("Error in Gatt Update characteristic value 0x%02x\r\n", ret);
-    return ret;
+    PRINTF("Error in Gatt Update characteristic value 0x%02x\r\n", ret);
+    return;
   } else {
-    printf ("aci_gatt_update_char_value_ext() --> SUCCESS\r\n");
+    PRINTF("aci_gatt_update_char_value_ext() --> SUCCESS\r\n");
   }
 
 }
@@ -295,109 +465,237 @@ static void Start_Beaconing(void)
 {  
   uint8_t ret = BLE_STATUS_SUCCESS;
 
-uint8_t local_name[] = { AD_TYPE_COMPLETE_LOCAL_NAME, LOCAL_NAME };
-
-#if ENABLE_FLAGS_AD_TYPE_AT_BEGINNING
-  /* Set AD Type Flags at beginning on Advertising packet  */
-  uint8_t adv_data[] = {
-      /* Advertising data: Flags AD Type */
-      0x02, 
-      0x01, 
-      0x06, 
-      sizeof(local_name),                      /* Length of AD type Complete Local Name */
-      0x09,                   /* AD type Complete Local Name */ 
-      LOCAL_NAME,             /* Local Name */            
-      /* Advertising data: manufacturer specific data */
-      26, //len
-      AD_TYPE_MANUFACTURER_SPECIFIC_DATA,  //manufacturer type
-      0x30, 0x00, //Company identifier code (Default is 0x0030 - STMicroelectronics: To be customized for specific identifier)
-      0x02,       // ID
-      0x15,       //Length of the remaining payload
-      0xE2, 0x0A, 0x39, 0xF4, 0x73, 0xF5, 0x4B, 0xC4, //Location UUID
-      0xA1, 0x2F, 0x17, 0xD1, 0xAD, 0x07, 0xA9, 0x61,
-      0x00, 0x00, // Major number 
-      0x00, 0x00, // Minor number 
-      0xC8        //2's complement of the Tx power (-56dB)};      
-   };
-#else
-   uint8_t manuf_data[] = {
-      26, //len
-      AD_TYPE_MANUFACTURER_SPECIFIC_DATA, //manufacturer type
-      0x30, 0x00, //Company identifier code (Default is 0x0030 - STMicroelectronics: To be customized for specific identifier)
-      0x02,       // ID
-      0x15,       //Length of the remaining payload
-      0xE2, 0x0A, 0x39, 0xF4, 0x73, 0xF5, 0x4B, 0xC4, //Location UUID
-      0xA1, 0x2F, 0x17, 0xD1, 0xAD, 0x07, 0xA9, 0x61,
-      0x00, 0x00, // Major number 
-      0x00, 0x00, // Minor number 
-      0xC8        //2's complement of the Tx power (-56dB)};      
-   };
-#endif
-   
-  /* disable scan response */
-  ret = hci_le_set_scan_response_data(0,NULL);
-  if (ret != BLE_STATUS_SUCCESS)
-  {
-    printf ("Error in hci_le_set_scan_resp_data() 0x%04x\r\n", ret);
-    return;
+  /* disable scan response: empty after any reset, the fast path skips it */
+  if (!Boot_Fast()) {
+    ret = hci_le_set_scan_response_data(0,NULL);
+    if (ret != BLE_STATUS_SUCCESS)
+    {
+      PRINTF("Error in hci_le_set_scan_resp_data() 0x%04x\r\n", ret);
+      return;
+    }
+    else
+      PRINTF("hci_le_set_scan_resp_data() --> SUCCESS\r\n");
   }
-  else
-    printf ("hci_le_set_scan_resp_data() --> SUCCESS\r\n");
 
 
-  /* put device in non connectable mode */
-  ret = aci_gap_set_discoverable(ADV_NONCONN_IND, 160, 160, PUBLIC_ADDR, NO_WHITE_LIST_USE,
-                                sizeof(local_name), local_name, 0, NULL, 0, 0); 
+  /* put device in advertising mode (non connectable without the OTA service):
+     no room for the local name next to the beacon frame, it is only in the
+     GAP Device Name characteristic */
+  ret = aci_gap_set_discoverable(ADV_TYPE, ADV_INTERVAL_MIN, ADV_INTERVAL_MAX, PUBLIC_ADDR, NO_WHITE_LIST_USE,
+                                0, NULL, 0, NULL, 0, 0); 
   if (ret != BLE_STATUS_SUCCESS)
   {
-    printf ("Error in aci_gap_set_discoverable() 0x%04x\r\n", ret);
+    PRINTF("Error in aci_gap_set_discoverable() 0x%04x\r\n", ret);
     return;
   }
   else
-    printf ("aci_gap_set_discoverable() --> SUCCESS\r\n");
+    INIT_LOG("aci_gap_set_discoverable() --> SUCCESS\r\n");
+  Boot_Mark(BOOT_STAGE_ADVERTISING);
+
+  /* Jobs with a slack over it wait for the end of the next advertising event */
+  Sched_SetRadioInterval(ADV_INTERVAL_MAX * 5 / 8);
 
 #if ENABLE_FLAGS_AD_TYPE_AT_BEGINNING
-  /* Set the  ADV data with the Flags AD Type at beginning of the 
-     advertsing packet,  followed by the beacon manufacturer specific data */
-  ret = hci_le_set_advertising_data (sizeof(adv_data), adv_data);
+  /* First frame of the rotation now, then one frame per slot */
+  ret = Adv_RotateStart(&adv_rotation);
   if (ret != BLE_STATUS_SUCCESS)
   {
-    printf ("Error in hci_le_set_advertising_data() 0x%04x\r\n", ret);
+    PRINTF("Error in Adv_RotateStart() 0x%04x\r\n", ret);
     return;
   }
   else
-    printf ("hci_le_set_advertising_data() --> SUCCESS\r\n");
+    INIT_LOG("Adv_RotateStart() --> SUCCESS\r\n");
+
+  /* Fields of the RAM frames updated at run time */
+  Adv_LiveInit(ADV_LIVE_WINDOW_MS);
+  Adv_LiveBind(ADV_LIVE_MAJOR, adv_data, ADV_FLAGS_LEN + ADV_IBEACON_MAJOR_OFS);
+  Adv_LiveBind(ADV_LIVE_MINOR, adv_data, ADV_FLAGS_LEN + ADV_IBEACON_MINOR_OFS);
+  Adv_LiveBind(ADV_LIVE_TX_POWER, adv_data, ADV_FLAGS_LEN + ADV_IBEACON_POWER_OFS);
+#if ENABLE_ADV_ROTATION
+  Adv_LiveBind(ADV_LIVE_BATTERY, eddystone_tlm_data, ADV_FLAGS_LEN + ADV_TLM_VBATT_OFS);
+  Adv_LiveBind(ADV_LIVE_TEMPERATURE, eddystone_tlm_data, ADV_FLAGS_LEN + ADV_TLM_TEMP_OFS);
+  Adv_LiveBind(ADV_LIVE_UPTIME, eddystone_tlm_data, ADV_FLAGS_LEN + ADV_TLM_SEC_COUNT_OFS);
+  Adv_LiveBind(ADV_LIVE_COUNTER, custom_data, CUSTOM_COUNTER_OFS);
+  Adv_LiveBind(ADV_LIVE_STACK_MARGIN, custom_data, CUSTOM_MARGIN_OFS);
+#endif
 #else
   /* Delete the TX power level information */
   ret = aci_gap_delete_ad_type(AD_TYPE_TX_POWER_LEVEL); 
   if (ret != BLE_STATUS_SUCCESS)
   {
-    printf ("Error in aci_gap_delete_ad_type() 0x%04x\r\n", ret);
+    PRINTF("Error in aci_gap_delete_ad_type() 0x%04x\r\n", ret);
     return;
   }
   else
-    printf ("aci_gap_delete_ad_type() --> SUCCESS\r\n");
+    INIT_LOG("aci_gap_delete_ad_type() --> SUCCESS\r\n");
 
   /* Update the ADV data with the BEACON manufacturing data */
-  ret = aci_gap_update_adv_data(27, manuf_data);  
+  ret = aci_gap_update_adv_data(sizeof(manuf_data), (uint8_t *)manuf_data);  
   if (ret != BLE_STATUS_SUCCESS)
   {
-    printf ("Error in aci_gap_update_adv_data() 0x%04x\r\n", ret);
+    PRINTF("Error in aci_gap_update_adv_data() 0x%04x\r\n", ret);
     return;
   }
   else
-    printf ("aci_gap_update_adv_data() --> SUCCESS\r\n");
+    INIT_LOG("aci_gap_update_adv_data() --> SUCCESS\r\n");
+#endif
+}
+
+#if BEACON_OTA_SERVICE
+/**
+* @brief  Advertising again at the end of a connection, the frame rotation
+*         from its first slot. The live fields stay bound.
+* @param  None
+* @retval None
+*/
+static void Restart_Beaconing(void)
+{
+  uint8_t ret;
+
+  ret = aci_gap_set_discoverable(ADV_TYPE, ADV_INTERVAL_MIN, ADV_INTERVAL_MAX, PUBLIC_ADDR, NO_WHITE_LIST_USE,
+                                 0, NULL, 0, NULL, 0, 0);
+  if (ret != BLE_STATUS_SUCCESS)
+  {
+    PRINTF("Error in aci_gap_set_discoverable() 0x%04x\r\n", ret);
+    return;
+  }
+  Sched_SetRadioInterval(ADV_INTERVAL_MAX * 5 / 8);
+
+#if ENABLE_FLAGS_AD_TYPE_AT_BEGINNING
+  ret = Adv_RotateStart(&adv_rotation);
+#else
+  ret = aci_gap_delete_ad_type(AD_TYPE_TX_POWER_LEVEL);
+  if (ret == BLE_STATUS_SUCCESS)
+    ret = aci_gap_update_adv_data(sizeof(manuf_data), (uint8_t *)manuf_data);
+#endif
+  if (ret != BLE_STATUS_SUCCESS)
+    PRINTF("Error in the advertising data 0x%04x\r\n", ret);
+}
+#endif
+
+/* LED blink: 1 Hz when released, 5 Hz when pressed */
+static const Led_Pattern_t *led_blink = &led_pattern_idle;
+
+/* Boot check of the image, reported by the late init */
+static ImageVerify_Result_t image_verify;
+static tClockTime button_pressed_at;
+
+#if ENABLE_ADV_ROTATION
+/**
+* @brief  Telemetry timer job: time since boot in the Eddystone-TLM frame and
+*         stack margin in the custom frame, sent when the frame is on air or
+*         at its next slot
+* @param  None
+* @retval None
+*/
+static void Telemetry_Update(void)
+{
+  Adv_LiveSetUptime(Sched_Now() / 100);
+  Adv_LiveSetStackMargin(Mem_StackMarginByte());
+}
+#endif
+
+/**
+* @brief  Button event, delivered from the main loop by the button module
+* @param  evt: new button state
+* @retval None
+*/
+static void Button_Changed(const Button_Event_t *evt)
+{
+  if (evt->pressed)
+  {
+    if(led_blink != &led_pattern_pressed){
+      PRINTF("Pressed!\n");
+    }
+    led_blink = &led_pattern_pressed;
+    button_pressed_at = evt->timestamp;
+#if ENABLE_ADV_ROTATION
+    Adv_LiveSetCounter(++button_presses);
+#endif
+#if ST_USE_OTA_SERVICE_MANAGER_APPLICATION
+    Led_Play(NULL);
+    OTA_Jump_To_Service_Manager_Application();
+#endif /* ST_USE_OTA_SERVICE_MANAGER_APPLICATION */
+  }else{
+    if(led_blink != &led_pattern_idle){
+      PRINTF("Released!\n");
+    }
+    led_blink = &led_pattern_idle;
+    if (evt->timestamp - button_pressed_at >= STATS_HOLD_MS) {
+      SleepMgr_Report();
+#ifdef PROF_ENABLED
+      Prof_Dump();
 #endif
+    }
+  }
+  Led_Play(led_blink);
 }
 
-tClockTime lastClock = 0;
-uint16_t delay = 500;
+/**
+* @brief  Init the first advertisement does not need: crash report, device
+*         name, memory sampler, button, LED blink and telemetry timer, banner.
+*         Run in line on a cold boot, after the first advertising event on
+*         the fast boot path (boot.c).
+* @param  None
+* @retval None
+*/
+static void App_LateInit(void)
+{
+  Crash_Code_t crash;
+
+  /* Cause and registers of the crash that reset the device, if any */
+  crash = Crash_BootReport();
+  ImageVerify_Report();
+
+  Device_SetName();
+  Mem_MonitorStart(MEM_SAMPLE_PERIOD_MS);
+
+  /* Button edges are debounced in GPIO_Handler() and delivered to Button_Changed() */
+  Button_Init(Button_Changed);
+
+  /* 1 Hz LED blink (5 Hz while the button is pressed), played by the LED
+     timer interrupt. After a crash, its cause as an error code first */
+  Led_Init();
+  if (Button_IsPressed())
+    led_blink = &led_pattern_pressed;
+  Led_Play(led_blink);
+  if (crash != CRASH_CODE_NONE)
+    Led_ShowError(crash);
+  else if (image_verify == IMAGE_VERIFY_FAILED)
+    Led_ShowError(IMAGE_VERIFY_LED_CODE);
+
+#if ENABLE_ADV_ROTATION
+  Sched_TimerSetSlack(Sched_TimerStart(Telemetry_Update, TELEMETRY_PERIOD_MS, TELEMETRY_PERIOD_MS),
+                      TELEMETRY_SLACK_MS);
+#endif
+
+  PRINTF("BlueNRG-1 BLE Beacon Application (version: %s)\r\n", BLE_BEACON_VERSION_STRING);
+}
 
 int main(void) {
   uint8_t ret;
 
+  /* Stack high-water mark: paint the free stack before anything runs on it */
+  Mem_StackPaint();
+
   /* System Init */
   SystemInit();
+
+  /* Reset reason (fast boot path after a warm reset) and boot stage clock */
+  Boot_Init();
+
+  /* CRC32 of the image on its first boot in an OTA bank, then cached */
+  image_verify = ImageVerify_Boot();
+  /* A new image failing it boots the one it replaced, when there is one */
+  if (image_verify == IMAGE_VERIFY_FAILED)
+    ImageVerify_Fallback();
+  Boot_Mark(BOOT_STAGE_VERIFY);
+
+  /* No supervised task yet: the modules start theirs as they init */
+  Sup_Init();
+
+  /* No peripheral in the sleep manager either: they register as they init */
+  SleepMgr_Init();
   
   /* Identify BlueNRG-1 platform */
   SdkEvalIdentification();
@@ -405,6 +703,11 @@ int main(void) {
 
   /* Init the UART peripheral */
   SdkEvalComUartInit(UART_BAUDRATE); 
+
+  /* Logs are queued and sent by the UART interrupt, PRINTF() never waits */
+  Log_Init();
+  TRACE_INIT();
+  PROF_INIT();
   
   //Enable Systick Clock (required for delays and such)
   Clock_Init();
@@ -413,21 +716,23 @@ int main(void) {
   SysCtrl_PeripheralClockCmd(CLOCK_PERIPH_GPIO, ENABLE);
 
   GPIO_InitType GPIO_InitStructure;
-  GPIO_InitStructure.GPIO_Pin = GPIO_Pin_14;
+  GPIO_InitStructure.GPIO_Pin = LED_PIN;
   GPIO_InitStructure.GPIO_Mode = GPIO_Output;
   GPIO_InitStructure.GPIO_Pull = ENABLE;
   GPIO_InitStructure.GPIO_HighPwr = ENABLE;
   GPIO_Init(&GPIO_InitStructure);
 
   /* Put the LEDs off */
-  GPIO_WriteBit(GPIO_Pin_14, LED_ON);
+  GPIO_WriteBit(LED_PIN, LED_ON);
+  Boot_Mark(BOOT_STAGE_PLATFORM);
 
   /* BlueNRG-1 stack init */
   ret = BlueNRG_Stack_Initialization(&BlueNRG_Stack_Init_params);
   if (ret != BLE_STATUS_SUCCESS) {
-    printf("Error in BlueNRG_Stack_Initialization() 0x%02x\r\n", ret);
+    PRINTF("Error in BlueNRG_Stack_Initialization() 0x%02x\r\n", ret);
     while(1);
   }
+  Boot_Mark(BOOT_STAGE_STACK);
   
  //The EMB1061 has a preprogrammed mac address, which is also printed on the QR code
   //If you are using some other module, you may need to change this address or replace this with a byte array
@@ -438,68 +743,37 @@ int main(void) {
 
   // Set the mac address in the BLE stack to the value stored by the manufacturer.
   ret=aci_hal_write_config_data(CONFIG_DATA_PUBADDR_OFFSET,CONFIG_DATA_PUBADDR_LEN, macAddressLocation);
-  if(ret) {printf("Setting address failed.\n");}
+  if(ret) {PRINTF("Setting address failed.\n");}
   
   /* Init the BlueNRG-1 device */
   Device_Init();
+  Boot_Mark(BOOT_STAGE_DEVICE);
 
-    /* Configures Button pin as input */
-  GPIO_InitStructure.GPIO_Pin = GPIO_Pin_13;
-  GPIO_InitStructure.GPIO_Mode = GPIO_Input;
-  GPIO_InitStructure.GPIO_Pull = DISABLE;
-  GPIO_InitStructure.GPIO_HighPwr = DISABLE;
-  GPIO_Init(&GPIO_InitStructure);
+  Sched_Init();
+
+  /* From now on the main loop feeds the watchdog while every task keeps up */
+  Sup_Start();
 
+  /* The rest of the init now on a cold boot, after the first advertising
+     event on a warm one */
+  Boot_Defer(App_LateInit);
 
   /* Start Beacon Non Connectable Mode*/
   Start_Beaconing();
   
-  printf("BlueNRG-1 BLE Beacon Application (version: %s)\r\n", BLE_BEACON_VERSION_STRING); 
-  
   
   while(1) 
   {
-    //printf("%lu\n",(uint32_t)Clock_Time());
-    if (!GPIO_ReadBit(GPIO_Pin_13))
-    {
-      if(delay != 100){
-        printf("Pressed!\n");
-      }
-      delay = 100;
-    }else{
-      if(delay != 500){
-        printf("Released!\n");
-      }
-      delay = 500;
-    }
-
-    //Every 500 ms toggle the LED, making a 1hz flash
-    if(((uint32_t)lastClock)+delay<=(uint32_t)Clock_Time()){
-      lastClock = lastClock+delay;
-      printf("%lu\n",(uint32_t)Clock_Time());
-      GPIO_ToggleBits(GPIO_Pin_14);
-    }
-    /* BlueNRG-1 stack tick */
-    BTLE_StackTick();
-        
-    /* Enable Power Save according the Advertising Interval */
-    // ! NOTE: This can mess with things like UART, systick/timers, and uploading code.
+    /* Run the due events and timer jobs, tick the BlueNRG-1 stack and
+     * sleep until the next deadline. The sleep manager keeps the UART up
+     * while it sends and restores the peripherals after a deep sleep.
+     */
+    // ! NOTE: Deep sleep powers the SWD port down. Build with make SLEEP_DEBUG=1 to stop at CPU halt.
     // ! If you are getting errors like "Failed to initialize GDB server" or something,
     // ! hold the boot button, press reset, then release the boot button
     // ! If you are getting errors like " Error erasing flash with vFlashErase ...",
     // ! When you run the debugger, quickly press and release the reset button right after running
-    //BlueNRG_Sleep(SLEEPMODE_NOTIMER, 0, 0);
-    
-#if ST_USE_OTA_SERVICE_MANAGER_APPLICATION
-    if (SdkEvalPushButtonGetState(USER_BUTTON) == RESET)
-    {
-    	GPIO_WriteBit(GPIO_Pin_14, LED_OFF);
-
-    	OTA_Jump_To_Service_Manager_Application();
-    }else{
-    	GPIO_WriteBit(GPIO_Pin_14, LED_ON);
-    }
-#endif /* ST_USE_OTA_SERVICE_MANAGER_APPLICATION */
+    Sched_RunOnce();
   }
 }
 
@@ -513,18 +787,72 @@ int main(void) {
 
 void hci_hardware_error_event(uint8_t Hardware_Code)
 {
-   NVIC_SystemReset();
+   /* Record the code for the next boot, then reset */
+   Crash_HardwareError(Hardware_Code, (uint32_t)(uintptr_t)__builtin_return_address(0));
+}
+
+
+#if BEACON_OTA_SERVICE
+/* Connection of the OTA client: the stack stops advertising, the frame
+   rotation stops with it. Timer jobs with a slack wait for the connection
+   events instead. */
+void hci_le_connection_complete_event(uint8_t Status, uint16_t Connection_Handle, uint8_t Role,
+                                      uint8_t Peer_Address_Type, uint8_t Peer_Address[6],
+                                      uint16_t Conn_Interval, uint16_t Conn_Latency,
+                                      uint16_t Supervision_Timeout, uint8_t Master_Clock_Accuracy)
+{
+#if (CONTROLLER_DATA_LENGTH_EXTENSION_ENABLED == 1) && (OTA_EXTENDED_PACKET_LEN == 1)
+  uint8_t ret;
+#endif
+
+  if (Status != BLE_STATUS_SUCCESS)
+    return;
+#if ENABLE_FLAGS_AD_TYPE_AT_BEGINNING
+  Adv_RotateStop();
+#endif
+  Sched_SetRadioInterval(Conn_Interval * 5 / 4);
+#if (CONTROLLER_DATA_LENGTH_EXTENSION_ENABLED == 1) && (OTA_EXTENDED_PACKET_LEN == 1)
+  /* The controller starts with 27 bytes LL packets: ask for the longest */
+  ret = hci_le_set_data_length(Connection_Handle, LL_TX_OCTETS_MAX, LL_TX_TIME_MAX);
+  if (ret != BLE_STATUS_SUCCESS)
+    PRINTF("Error in hci_le_set_data_length() 0x%02x\r\n", ret);
+#endif
+  PRINTF("Connected 0x%04x, interval %u.%02u ms\r\n", Connection_Handle, Conn_Interval * 5 / 4,
+         (Conn_Interval * 125) % 100);
+}
+
+/* End of the connection: a new image complete is booted by the reset
+   manager, otherwise the beacon advertises again */
+void hci_disconnection_complete_event(uint8_t Status, uint16_t Connection_Handle, uint8_t Reason)
+{
+  if (Status != BLE_STATUS_SUCCESS)
+    return;
+  PRINTF("Disconnected 0x%04x, reason 0x%02x\r\n", Connection_Handle, Reason);
+  if (OtaService_GetStats()->state == OTA_SERVICE_COMMITTED)
+    NVIC_SystemReset();
+  else
+    Restart_Beaconing();
 }
 
+/* Writes of the OTA client */
+void aci_gatt_attribute_modified_event(uint16_t Connection_Handle, uint16_t Attr_Handle, uint16_t Offset,
+                                       uint16_t Attr_Data_Length, uint8_t Attr_Data[])
+{
+  OtaService_Write(Connection_Handle, Attr_Handle, Attr_Data_Length, Attr_Data);
+}
+#endif
 
 /****************** BlueNRG-1 Sleep Management Callback ********************************/
 
 SleepModes App_SleepMode_Check(SleepModes sleepMode)
 {
-  if(SdkEvalComIOTxFifoNotEmpty() || SdkEvalComUARTBusy())
-    return SLEEPMODE_RUNNING;
-  
-  return SLEEPMODE_NOTIMER;
+  /* Work posted by an interrupt after the scheduler decided to sleep */
+  if(Sched_EventsPending())
+    sleepMode = SLEEPMODE_RUNNING;
+
+  /* Then the peripherals in use (UART sending, ...), which save their
+     state for a deep sleep */
+  return SleepMgr_Check(sleepMode);
 }
 
 /***************************************************************************************/
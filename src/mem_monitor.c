@@ -0,0 +1,118 @@
+/**
+  ******************************************************************************
+  * @file    mem_monitor.c
+  * @brief   Stack painting at boot and high-water mark sampling of CSTACK,
+  *          heap use from the C library allocator.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <malloc.h>
+#include "scheduler.h"
+#include "log.h"
+#include "mem_monitor.h"
+
+/* Private variables ---------------------------------------------------------*/
+/* CSTACK bounds, from BlueNRG1.ld */
+extern uint32_t _sstack;
+extern uint32_t _estack;
+
+static Mem_Stats_t mem_stats;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Fill [bottom, top) with MEM_PAINT_PATTERN.
+  */
+void Mem_PaintRegion(uint32_t *bottom, uint32_t *top)
+{
+  while (bottom < top)
+    *bottom++ = MEM_PAINT_PATTERN;
+}
+
+/**
+  * @brief  Bytes used at the top of a painted region growing down: from the
+  *         first word without the pattern, scanning up from the bottom, to
+  *         the top. A used word holding the pattern by chance is only missed
+  *         if it is the deepest one.
+  */
+uint32_t Mem_ScanRegion(const uint32_t *bottom, const uint32_t *top)
+{
+  const uint32_t *p = bottom;
+
+  while (p < top && *p == MEM_PAINT_PATTERN)
+    p++;
+  return (uint32_t)((top - p) * sizeof(uint32_t));
+}
+
+/**
+  * @brief  Paint CSTACK under the current stack pointer, MEM_PAINT_GUARD
+  *         bytes apart. Called first thing in main(), before the interrupts
+  *         and the stack run.
+  */
+void Mem_StackPaint(void)
+{
+  volatile uint32_t here;
+  uintptr_t top = ((uintptr_t)&here - MEM_PAINT_GUARD) & ~(uintptr_t)3;
+
+  /* Not on CSTACK (host simulation): paint all of it */
+  if (top <= (uintptr_t)&_sstack || top > (uintptr_t)&_estack)
+    top = (uintptr_t)&_estack;
+  Mem_PaintRegion(&_sstack, (uint32_t *)top);
+
+  mem_stats = (Mem_Stats_t){0};
+  mem_stats.stack_size = (uint32_t)((uintptr_t)&_estack - (uintptr_t)&_sstack);
+}
+
+/**
+  * @brief  Sampler timer job: stack high-water mark and heap use. A new
+  *         stack peak is logged.
+  */
+void Mem_Sample(void)
+{
+  uint32_t used = Mem_ScanRegion(&_sstack, &_estack);
+  struct mallinfo heap = mallinfo();
+
+  mem_stats.samples++;
+  mem_stats.heap_used = (uint32_t)heap.uordblks;
+  mem_stats.heap_free = (uint32_t)heap.fordblks +
+                        (heap.arena < MEM_HEAP_SIZE ? MEM_HEAP_SIZE - (uint32_t)heap.arena : 0);
+
+  if (used <= mem_stats.stack_peak && mem_stats.samples > 1)
+    return;
+
+  mem_stats.stack_peak = used;
+  mem_stats.overflow = (used == mem_stats.stack_size);
+  PRINTF("stack peak %u of %u bytes%s, heap %u free\r\n", (unsigned)used,
+         (unsigned)mem_stats.stack_size, mem_stats.overflow ? " (overflow)" : "",
+         (unsigned)mem_stats.heap_free);
+}
+
+/**
+  * @brief  Sample now, then every period_ms, after an advertising event.
+  */
+void Mem_MonitorStart(uint32_t period_ms)
+{
+  Mem_Sample();
+  Sched_TimerSetSlack(Sched_TimerStart(Mem_Sample, period_ms, period_ms), MEM_SAMPLE_SLACK_MS);
+}
+
+/**
+  * @brief  Stack margin for the advertising payload: bytes of CSTACK never
+  *         used, in MEM_MARGIN_UNIT units up to 255, 0 after an overflow.
+  */
+uint8_t Mem_StackMarginByte(void)
+{
+  uint32_t margin;
+
+  if (mem_stats.overflow)
+    return 0;
+  margin = (mem_stats.stack_size - mem_stats.stack_peak) / MEM_MARGIN_UNIT;
+  return (uint8_t)(margin > 255 ? 255 : margin);
+}
+
+const Mem_Stats_t *Mem_GetStats(void)
+{
+  return &mem_stats;
+}
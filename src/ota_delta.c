@@ -0,0 +1,335 @@
+/**
+  ******************************************************************************
+  * @file    ota_delta.c
+  * @brief   Streaming decoder of delta OTA images, programming the new image
+  *          into the inactive bank burst by burst.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "OTA_btl.h"
+#include "crc32.h"
+#include "supervisor.h"
+#include "ota_delta.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Header words */
+#define OTA_DELTA_H_MAGIC       0
+#define OTA_DELTA_H_NEW_SIZE    1
+#define OTA_DELTA_H_NEW_CRC     2
+#define OTA_DELTA_H_OLD_SIZE    3
+#define OTA_DELTA_H_OLD_CRC     4
+
+/* Parser states */
+#define OTA_DELTA_S_HEADER      0
+#define OTA_DELTA_S_OP          1
+#define OTA_DELTA_S_LEN         2     /* Varint of a long length */
+#define OTA_DELTA_S_ARG         3     /* Source of a copy, byte of a fill */
+#define OTA_DELTA_S_LITERAL     4
+#define OTA_DELTA_S_END         5
+
+/* FLASH_ProgramWordBurst(): 4 words */
+#define OTA_DELTA_BURST_LEN     16
+
+/* Burst holding the OTA tag, and the tag word in it */
+#define OTA_DELTA_TAG_BURST     (OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET - \
+                                 OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET % OTA_DELTA_BURST_LEN)
+#define OTA_DELTA_TAG_WORD      ((OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET % OTA_DELTA_BURST_LEN) / 4)
+
+/* Flash contents at an address: memory mapped on the device, the copy of the
+   flash stand-in in the host simulation */
+#ifndef HOST_SIM
+#define OTA_DELTA_FLASH(address)    ((const uint8_t *)(address))
+#else
+#define OTA_DELTA_FLASH(address)    Sim_FlashData(address)
+#endif
+
+/* CPU time of the decoder, real on the device, charged to the simulated CPU
+   on the host from the counters (cost model of host/inc/sim.h) */
+#ifdef HOST_SIM
+#define OTA_DELTA_CYCLES(stats)     ((stats)->ops * SIM_COST_DELTA_OP_CYCLES + \
+                                     ((stats)->literal_bytes + (stats)->old_bytes + (stats)->new_bytes + \
+                                      (stats)->fill_bytes) * SIM_COST_DELTA_BYTE_CYCLES + \
+                                     (stats)->crc_bytes * SIM_COST_CRC_BYTE_CYCLES)
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static OtaDelta_t delta;
+static OtaDelta_Stats_t delta_stats;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Program the burst holding the last byte produced, erasing its
+  *         page first if the burst opens it. The last burst of the image is
+  *         padded with erased bytes.
+  */
+static OtaDelta_Status_t OtaDelta_Flush(void)
+{
+  uint8_t *burst = (uint8_t *)delta.burst;
+  uint32_t used = (delta.out - 1) % OTA_DELTA_BURST_LEN + 1;
+  uint32_t address = delta.new_address + delta.out - used;
+  uint32_t erase_sys;
+
+  memset(&burst[used], 0xFF, OTA_DELTA_BURST_LEN - used);
+  delta.crc = Crc32_Update(delta.crc, burst, used);
+  delta_stats.crc_bytes += used;
+  if (address - delta.new_address == OTA_DELTA_TAG_BURST) {
+    delta.tag = delta.burst[OTA_DELTA_TAG_WORD];
+    delta.burst[OTA_DELTA_TAG_WORD] = OTA_IN_PROGRESS_TAG;
+  }
+
+  if (address % N_BYTES_PAGE == 0) {
+    /* The CPU stalls for the erase, inside the stack tick */
+    erase_sys = HAL_VTimerGetCurrentTime_sysT32();
+    FLASH_ErasePage((uint16_t)((address - _MEMORY_FLASH_BEGIN_) / N_BYTES_PAGE));
+    Sup_TaskStalled(erase_sys);
+    delta_stats.pages++;
+  }
+  FLASH_ProgramWordBurst(address, delta.burst);
+  delta_stats.bursts++;
+  if (memcmp(OTA_DELTA_FLASH(address), burst, OTA_DELTA_BURST_LEN) != 0)
+    return OTA_DELTA_ERR_FLASH;
+
+  if (delta.out < delta.header[OTA_DELTA_H_NEW_SIZE])
+    return OTA_DELTA_MORE;
+  return (delta.crc == delta.header[OTA_DELTA_H_NEW_CRC]) ? OTA_DELTA_DONE : OTA_DELTA_ERR_CRC;
+}
+
+/**
+  * @brief  Next byte of the new image.
+  */
+static OtaDelta_Status_t OtaDelta_Put(uint8_t byte)
+{
+  ((uint8_t *)delta.burst)[delta.out % OTA_DELTA_BURST_LEN] = byte;
+  delta.out++;
+  if (delta.out % OTA_DELTA_BURST_LEN != 0 && delta.out != delta.header[OTA_DELTA_H_NEW_SIZE])
+    return OTA_DELTA_MORE;
+  return OtaDelta_Flush();
+}
+
+/**
+  * @brief  Byte of the new image already produced: in the burst being
+  *         filled, the OTA tag kept aside, or programmed.
+  */
+static uint8_t OtaDelta_NewByte(uint32_t offset)
+{
+  uint32_t flushed = delta.out - delta.out % OTA_DELTA_BURST_LEN;
+
+  if (offset >= flushed)
+    return ((const uint8_t *)delta.burst)[offset - flushed];
+  if (offset - OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET < sizeof(delta.tag))
+    return (uint8_t)(delta.tag >> (8 * (offset - OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET)));
+  return *OTA_DELTA_FLASH(delta.new_address + offset);
+}
+
+/**
+  * @brief  Header complete: sizes within a bank, and the running image the
+  *         one the delta was built against.
+  */
+static OtaDelta_Status_t OtaDelta_Header(void)
+{
+  uint32_t old_size = delta.header[OTA_DELTA_H_OLD_SIZE];
+
+  if (delta.header[OTA_DELTA_H_MAGIC] != OTA_DELTA_MAGIC || delta.header[OTA_DELTA_H_NEW_SIZE] == 0 ||
+      delta.header[OTA_DELTA_H_NEW_SIZE] > OTA_DELTA_BANK_SIZE || old_size > OTA_DELTA_BANK_SIZE)
+    return OTA_DELTA_ERR_FORMAT;
+
+  delta_stats.crc_bytes += old_size;
+  if (old_size != 0 &&
+      Crc32_Update(0, OTA_DELTA_FLASH(delta.old_address), old_size) != delta.header[OTA_DELTA_H_OLD_CRC])
+    return OTA_DELTA_ERR_BASE;
+
+  delta.state = OTA_DELTA_S_OP;
+  return OTA_DELTA_MORE;
+}
+
+/**
+  * @brief  Varint byte into delta.arg.
+  * @retval 1 when complete, 0 for more, -1 past 32 bits
+  */
+static int8_t OtaDelta_Varint(uint8_t byte)
+{
+  if (delta.shift > 28 || (delta.shift == 28 && (byte & 0x70)))
+    return -1;
+  delta.arg |= (uint32_t)(byte & 0x7F) << delta.shift;
+  delta.shift += 7;
+  return (byte & 0x80) ? 0 : 1;
+}
+
+/**
+  * @brief  Length of the operation known: its data or source next.
+  */
+static OtaDelta_Status_t OtaDelta_Operation(void)
+{
+  if (delta.len > delta.header[OTA_DELTA_H_NEW_SIZE] - delta.out)
+    return OTA_DELTA_ERR_FORMAT;
+  delta.arg = 0;
+  delta.shift = 0;
+  delta.state = (delta.kind == OTA_DELTA_OP_LITERAL) ? OTA_DELTA_S_LITERAL : OTA_DELTA_S_ARG;
+  return OTA_DELTA_MORE;
+}
+
+/**
+  * @brief  Copy or fill of delta.len bytes, the source or byte in arg.
+  */
+static OtaDelta_Status_t OtaDelta_Run(uint32_t arg)
+{
+  OtaDelta_Status_t status = OTA_DELTA_MORE;
+  const uint8_t *src;
+  uint32_t from, len = delta.len;
+
+  switch (delta.kind) {
+  case OTA_DELTA_OP_OLD:
+    /* Zigzag: source less the cursor */
+    from = delta.old_pos + ((arg >> 1) ^ (0 - (arg & 1)));
+    if (from > delta.header[OTA_DELTA_H_OLD_SIZE] || len > delta.header[OTA_DELTA_H_OLD_SIZE] - from)
+      return OTA_DELTA_ERR_FORMAT;
+    delta.old_pos = from + len;
+    delta_stats.old_bytes += len;
+    src = OTA_DELTA_FLASH(delta.old_address + from);
+    while (len-- > 0 && status == OTA_DELTA_MORE)
+      status = OtaDelta_Put(*src++);
+    break;
+  case OTA_DELTA_OP_NEW:
+    /* Overlapping copies repeat the pattern */
+    if (arg >= delta.out)
+      return OTA_DELTA_ERR_FORMAT;
+    from = delta.out - arg - 1;
+    delta_stats.new_bytes += len;
+    while (len-- > 0 && status == OTA_DELTA_MORE)
+      status = OtaDelta_Put(OtaDelta_NewByte(from++));
+    break;
+  default:
+    delta_stats.fill_bytes += len;
+    while (len-- > 0 && status == OTA_DELTA_MORE)
+      status = OtaDelta_Put((uint8_t)arg);
+    break;
+  }
+  delta.state = OTA_DELTA_S_OP;
+  return status;
+}
+
+/**
+  * @brief  Next byte of the delta image.
+  */
+static OtaDelta_Status_t OtaDelta_Byte(uint8_t byte)
+{
+  int8_t varint;
+
+  switch (delta.state) {
+  case OTA_DELTA_S_HEADER:
+    delta.header[(delta.in - 1) / 4] |= (uint32_t)byte << (8 * ((delta.in - 1) % 4));
+    return (delta.in == OTA_DELTA_HEADER_LEN) ? OtaDelta_Header() : OTA_DELTA_MORE;
+
+  case OTA_DELTA_S_OP:
+    delta_stats.ops++;
+    delta.kind = byte >> OTA_DELTA_OP_SHIFT;
+    delta.len = (byte & OTA_DELTA_LEN_EXT) +
+                ((delta.kind == OTA_DELTA_OP_LITERAL) ? 1 : OTA_DELTA_MATCH_MIN);
+    if ((byte & OTA_DELTA_LEN_EXT) != OTA_DELTA_LEN_EXT)
+      return OtaDelta_Operation();
+    delta.arg = 0;
+    delta.shift = 0;
+    delta.state = OTA_DELTA_S_LEN;
+    return OTA_DELTA_MORE;
+
+  case OTA_DELTA_S_LEN:
+    varint = OtaDelta_Varint(byte);
+    if (varint <= 0)
+      return (varint < 0) ? OTA_DELTA_ERR_FORMAT : OTA_DELTA_MORE;
+    if (delta.arg > OTA_DELTA_BANK_SIZE)
+      return OTA_DELTA_ERR_FORMAT;
+    delta.len += delta.arg;
+    return OtaDelta_Operation();
+
+  case OTA_DELTA_S_ARG:
+    if (delta.kind == OTA_DELTA_OP_FILL)
+      return OtaDelta_Run(byte);
+    varint = OtaDelta_Varint(byte);
+    if (varint <= 0)
+      return (varint < 0) ? OTA_DELTA_ERR_FORMAT : OTA_DELTA_MORE;
+    return OtaDelta_Run(delta.arg);
+
+  case OTA_DELTA_S_LITERAL:
+    delta_stats.literal_bytes++;
+    if (--delta.len == 0)
+      delta.state = OTA_DELTA_S_OP;
+    return OtaDelta_Put(byte);
+
+  default:
+    return (OtaDelta_Status_t)delta.status;
+  }
+}
+
+/**
+  * @brief  Whether image content starts with a delta image header.
+  */
+uint8_t OtaDelta_IsDelta(const uint8_t *data, uint16_t len)
+{
+  return len >= 4 && (data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) |
+                      ((uint32_t)data[3] << 24)) == OTA_DELTA_MAGIC;
+}
+
+/**
+  * @brief  New transfer: the new image goes to the bank at new_address
+  *         (page aligned), the old one runs from old_address.
+  */
+void OtaDelta_Start(uint32_t new_address, uint32_t old_address)
+{
+  memset(&delta, 0, sizeof(delta));
+  memset(&delta_stats, 0, sizeof(delta_stats));
+  delta.new_address = new_address;
+  delta.old_address = old_address;
+  delta.tag = OTA_IN_PROGRESS_TAG;
+  delta.state = OTA_DELTA_S_HEADER;
+  delta.status = OTA_DELTA_MORE;
+  if (new_address % N_BYTES_PAGE != 0) {
+    delta.state = OTA_DELTA_S_END;
+    delta.status = OTA_DELTA_ERR_FORMAT;
+  }
+}
+
+/**
+  * @brief  Next bytes of the delta image, in any split. Bytes after the end
+  *         of the image (padding of the last OTA packet) are ignored.
+  * @retval OTA_DELTA_MORE until the new image is programmed and checked,
+  *         then OTA_DELTA_DONE; an error stops the decoder for good
+  */
+OtaDelta_Status_t OtaDelta_Write(const uint8_t *data, uint16_t len)
+{
+#ifdef HOST_SIM
+  uint32_t cycles = OTA_DELTA_CYCLES(&delta_stats);
+#endif
+  uint16_t i;
+
+  for (i = 0; i < len && delta.status == OTA_DELTA_MORE; i++) {
+    delta.in++;
+    delta.status = OtaDelta_Byte(data[i]);
+  }
+  if (delta.status != OTA_DELTA_MORE)
+    delta.state = OTA_DELTA_S_END;
+#ifdef HOST_SIM
+  Sim_Consume((OTA_DELTA_CYCLES(&delta_stats) - cycles) / SIM_CPU_MHZ);
+#endif
+  return (OtaDelta_Status_t)delta.status;
+}
+
+/**
+  * @brief  New image of a transfer: size and CRC32 of the header, and the
+  *         OTA tag kept aside (OTA_IN_PROGRESS_TAG until its burst).
+  */
+void OtaDelta_Image(uint32_t *size, uint32_t *crc, uint32_t *tag)
+{
+  *size = delta.header[OTA_DELTA_H_NEW_SIZE];
+  *crc = delta.header[OTA_DELTA_H_NEW_CRC];
+  *tag = delta.tag;
+}
+
+const OtaDelta_Stats_t *OtaDelta_GetStats(void)
+{
+  return &delta_stats;
+}
@@ -0,0 +1,349 @@
+/**
+  ******************************************************************************
+  * @file    ota_service.c
+  * @brief   OTA service of the application: GATT service of the DK OTA
+  *          protocol, image packets programmed into the inactive bank.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "ble_const.h"
+#include "OTA_btl.h"
+#include "crc32.h"
+#include "image_verify.h"
+#include "ota_delta.h"
+#include "log.h"
+#include "supervisor.h"
+#include "ota_service.h"
+
+/* Private define ------------------------------------------------------------*/
+/* FLASH_ProgramWordBurst(): 4 words, one block of an image packet */
+#define OTA_SERVICE_BURST_WORDS     (OTA_SERVICE_BLOCK_SIZE / 4)
+
+/* Burst holding the OTA tag, and the tag word in it */
+#define OTA_SERVICE_TAG_BURST       (OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET - \
+                                     OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET % OTA_SERVICE_BLOCK_SIZE)
+#define OTA_SERVICE_TAG_WORD        ((OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET % OTA_SERVICE_BLOCK_SIZE) / 4)
+
+/* Update_Type of aci_gatt_update_char_value_ext() */
+#define OTA_SERVICE_UPDATE_LOCAL    0x00
+#define OTA_SERVICE_UPDATE_NOTIFY   0x01
+
+/* Encryption key size of the characteristics, unused without security */
+#define OTA_SERVICE_KEY_SIZE        16
+
+/* Flash contents at an address: memory mapped on the device, the copy of the
+   flash stand-in in the host simulation */
+#ifndef HOST_SIM
+#define OTA_SERVICE_FLASH(address)  ((const uint8_t *)(address))
+#else
+#define OTA_SERVICE_FLASH(address)  Sim_FlashData(address)
+#endif
+
+/* CPU time of the packet checksum and copy, and of the image CRC32: real
+   on the device, charged to the simulated CPU on the host (cost model of
+   host/inc/sim.h) */
+#ifndef HOST_SIM
+#define OTA_SERVICE_CPU(bytes, cycles)
+#else
+#define OTA_SERVICE_CPU(bytes, cycles)  Sim_Consume((uint32_t)(bytes) * (cycles) / SIM_CPU_MHZ)
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t ota_uuid_service[16] = OTA_SERVICE_UUID_SERVICE;
+static const uint8_t ota_uuid_image[16] = OTA_SERVICE_UUID_IMAGE;
+static const uint8_t ota_uuid_new_image[16] = OTA_SERVICE_UUID_NEW_IMAGE;
+static const uint8_t ota_uuid_content[16] = OTA_SERVICE_UUID_CONTENT;
+static const uint8_t ota_uuid_expected[16] = OTA_SERVICE_UUID_EXPECTED;
+
+static uint16_t ota_service_handle;
+static uint16_t ota_image_handle;
+static uint16_t ota_new_image_handle;
+static uint16_t ota_content_handle;
+static uint16_t ota_expected_handle;
+
+static uint32_t ota_running;        /* Bank of the running image, 0 if not in a bank */
+static uint32_t ota_bank;           /* Inactive bank, 0 if none */
+static uint16_t ota_conn_handle;
+static uint16_t ota_next_seq;
+static uint32_t ota_tag;            /* OTA tag of the image, programmed last */
+static uint32_t ota_crc;            /* CRC32 of the image, for its boot check */
+static OtaService_Stats_t ota_stats;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t OtaService_Le32(const uint8_t *p)
+{
+  return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void OtaService_SetLe32(uint8_t *p, uint32_t v)
+{
+  uint8_t i;
+
+  for (i = 0; i < 4; i++)
+    p[i] = (uint8_t)(v >> (8 * i));
+}
+
+/**
+  * @brief  Characteristic of 128-bit UUID uuid in the service.
+  */
+static uint8_t OtaService_AddChar(const uint8_t *uuid, uint16_t len, uint8_t props, uint8_t evt_mask,
+                                  uint8_t variable, uint16_t *handle)
+{
+  Char_UUID_t char_uuid;
+
+  memcpy(char_uuid.Char_UUID_128, uuid, sizeof(char_uuid.Char_UUID_128));
+  return aci_gatt_add_char(ota_service_handle, UUID_TYPE_128, &char_uuid, len, props, ATTR_PERMISSION_NONE,
+                           evt_mask, OTA_SERVICE_KEY_SIZE, variable, handle);
+}
+
+/**
+  * @brief  Expected Image Sequence Number notification.
+  */
+static void OtaService_Notify(uint8_t error)
+{
+  uint8_t value[OTA_SERVICE_NOTIFY_LEN] = { (uint8_t)ota_next_seq, (uint8_t)(ota_next_seq >> 8), error };
+
+  aci_gatt_update_char_value_ext(ota_conn_handle, ota_service_handle, ota_expected_handle,
+                                 OTA_SERVICE_UPDATE_NOTIFY, OTA_SERVICE_NOTIFY_LEN, 0,
+                                 OTA_SERVICE_NOTIFY_LEN, value);
+}
+
+/**
+  * @brief  New Image write: the transfer starts over. The image must fit in
+  *         the inactive bank.
+  */
+static void OtaService_NewImage(const uint8_t *data)
+{
+  uint32_t size = OtaService_Le32(&data[1]);
+  uint32_t base = OtaService_Le32(&data[5]);
+
+  ota_next_seq = 0;
+  ota_stats.written = 0;
+  ota_stats.delta = 0;
+  ota_stats.delta_status = OTA_DELTA_MORE;
+  if (ota_bank == 0 || base != ota_bank || size == 0 || size > OTA_DELTA_BANK_SIZE) {
+    PRINTF("OTA: image 0x%08x, %u bytes refused\r\n", (unsigned)base, (unsigned)size);
+    ota_stats.errors++;
+    ota_stats.state = OTA_SERVICE_FAILED;
+    OtaService_Notify(OTA_SERVICE_FLASH_ERROR);
+    return;
+  }
+  ota_stats.state = OTA_SERVICE_RECEIVING;
+  ota_stats.image_size = size;
+  ota_stats.base_address = base;
+  ota_tag = OTA_IN_PROGRESS_TAG;
+  ota_crc = 0;
+  PRINTF("OTA: image 0x%08x, %u bytes\r\n", (unsigned)base, (unsigned)size);
+}
+
+/**
+  * @brief  Program the blocks of an image packet from the next image
+  *         address, erasing each page the image enters. The OTA tag is kept
+  *         aside, its word left erased; the CRC32 covers the image as sent.
+  * @retval OTA_SERVICE_NO_ERROR or OTA_SERVICE_FLASH_ERROR
+  */
+static uint8_t OtaService_Program(const uint8_t *blocks, uint16_t len)
+{
+  uint32_t burst[OTA_SERVICE_BURST_WORDS];
+  uint32_t address, erase_sys, used;
+  uint16_t i;
+
+  for (i = 0; i < len && ota_stats.written < ota_stats.image_size; i += OTA_SERVICE_BLOCK_SIZE) {
+    address = ota_stats.base_address + ota_stats.written;
+    if (address % N_BYTES_PAGE == 0) {
+      /* The CPU stalls for the erase, inside the stack tick */
+      erase_sys = HAL_VTimerGetCurrentTime_sysT32();
+      FLASH_ErasePage((uint16_t)((address - _MEMORY_FLASH_BEGIN_) / N_BYTES_PAGE));
+      Sup_TaskStalled(erase_sys);
+    }
+    memcpy(burst, &blocks[i], OTA_SERVICE_BLOCK_SIZE);
+    used = ota_stats.image_size - ota_stats.written;
+    if (used > OTA_SERVICE_BLOCK_SIZE)
+      used = OTA_SERVICE_BLOCK_SIZE;
+    ota_crc = Crc32_Update(ota_crc, (const uint8_t *)burst, used);
+    OTA_SERVICE_CPU(used, SIM_COST_CRC_BYTE_CYCLES);
+    if (ota_stats.written == OTA_SERVICE_TAG_BURST) {
+      ota_tag = burst[OTA_SERVICE_TAG_WORD];
+      burst[OTA_SERVICE_TAG_WORD] = OTA_IN_PROGRESS_TAG;
+    }
+    FLASH_ProgramWordBurst(address, burst);
+    if (memcmp(OTA_SERVICE_FLASH(address), burst, OTA_SERVICE_BLOCK_SIZE) != 0)
+      return OTA_SERVICE_FLASH_ERROR;
+    ota_stats.written += OTA_SERVICE_BLOCK_SIZE;
+  }
+  return OTA_SERVICE_NO_ERROR;
+}
+
+/**
+  * @brief  Blocks of an image packet to the delta decoder, started at the
+  *         first one against the running image. Padding after the announced
+  *         size is left out.
+  * @retval OTA_SERVICE_NO_ERROR or OTA_SERVICE_FLASH_ERROR
+  */
+static uint8_t OtaService_Delta(const uint8_t *blocks, uint16_t len)
+{
+  if (!ota_stats.delta) {
+    ota_stats.delta = 1;
+    OtaDelta_Start(ota_stats.base_address, ota_running);
+  }
+  if (len > ota_stats.image_size - ota_stats.written)
+    len = (uint16_t)(ota_stats.image_size - ota_stats.written);
+
+  ota_stats.delta_status = OtaDelta_Write(blocks, len);
+  ota_stats.written += len;
+  if (ota_stats.delta_status == OTA_DELTA_DONE ||
+      (ota_stats.delta_status == OTA_DELTA_MORE && ota_stats.written < ota_stats.image_size))
+    return OTA_SERVICE_NO_ERROR;
+  PRINTF("OTA: delta image refused (%d)\r\n", (int)ota_stats.delta_status);
+  return OTA_SERVICE_FLASH_ERROR;
+}
+
+/**
+  * @brief  Image complete: bootable if it carries a valid tag, the running
+  *         image then no longer. Its CRC32 is recorded first, for the check
+  *         of its first boot (ImageVerify_Updated()). A delta image gives
+  *         its tag, size and CRC32.
+  * @retval OTA_SERVICE_NO_ERROR or OTA_SERVICE_FLASH_ERROR
+  */
+static uint8_t OtaService_Commit(void)
+{
+  uint32_t tag_address = ota_stats.base_address + OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET;
+  uint32_t tag = OTA_VALID_TAG;
+  uint32_t size = ota_stats.image_size, crc = ota_crc;
+
+  if (ota_stats.delta)
+    OtaDelta_Image(&size, &crc, &ota_tag);
+  if (ota_tag != OTA_VALID_TAG) {
+    PRINTF("OTA: image without a valid tag (0x%08x)\r\n", (unsigned)ota_tag);
+    return OTA_SERVICE_FLASH_ERROR;
+  }
+  if (ImageVerify_Updated(ota_stats.base_address, size, crc) != 0)
+    PRINTF("OTA: image check log full, checked at every boot\r\n");
+  FLASH_ProgramWord(tag_address, tag);
+  if (memcmp(OTA_SERVICE_FLASH(tag_address), &tag, sizeof(tag)) != 0)
+    return OTA_SERVICE_FLASH_ERROR;
+  FLASH_ProgramWord(ota_running + OTA_TAG_VECTOR_TABLE_ENTRY_OFFSET, OTA_INVALID_OLD_TAG);
+
+  ota_stats.state = OTA_SERVICE_COMMITTED;
+  PRINTF("OTA: image 0x%08x, %u bytes committed\r\n", (unsigned)ota_stats.base_address, (unsigned)size);
+  return OTA_SERVICE_NO_ERROR;
+}
+
+/**
+  * @brief  Image packet: checksum, blocks, needs ack, sequence number.
+  */
+static void OtaService_Content(const uint8_t *data, uint16_t len)
+{
+  uint8_t checksum = 0, error;
+  uint16_t seq, i;
+
+  OTA_SERVICE_CPU(len, SIM_COST_OTA_BYTE_CYCLES);
+  if (len < OTA_SERVICE_PACKET_OVERHEAD + OTA_SERVICE_BLOCK_SIZE ||
+      (len - OTA_SERVICE_PACKET_OVERHEAD) % OTA_SERVICE_BLOCK_SIZE != 0)
+    return;
+  for (i = 0; i < len; i++)
+    checksum ^= data[i];
+  seq = data[len - 2] | (uint16_t)(data[len - 1] << 8);
+
+  if (checksum != 0)
+    error = OTA_SERVICE_CHECKSUM_ERROR;
+  else if (seq != ota_next_seq || ota_stats.state != OTA_SERVICE_RECEIVING)
+    error = OTA_SERVICE_SEQUENCE_ERROR;
+  else if (ota_stats.delta ||
+           (ota_stats.written == 0 && OtaDelta_IsDelta(&data[1], len - OTA_SERVICE_PACKET_OVERHEAD)))
+    error = OtaService_Delta(&data[1], len - OTA_SERVICE_PACKET_OVERHEAD);
+  else
+    error = OtaService_Program(&data[1], len - OTA_SERVICE_PACKET_OVERHEAD);
+  if (error == OTA_SERVICE_NO_ERROR && ota_stats.written >= ota_stats.image_size)
+    error = OtaService_Commit();
+  if (error != OTA_SERVICE_NO_ERROR) {
+    ota_stats.errors++;
+    if (error == OTA_SERVICE_FLASH_ERROR)
+      ota_stats.state = OTA_SERVICE_FAILED;
+    OtaService_Notify(error);
+    return;
+  }
+
+  ota_next_seq++;
+  ota_stats.packets++;
+  if (data[len - 3]) {
+    ota_stats.acks++;
+    OtaService_Notify(OTA_SERVICE_NO_ERROR);
+  }
+}
+
+/**
+  * @brief  Add the OTA service to the GATT database, the image going to the
+  *         bank the running image is not in.
+  * @param  running_address: start of the running image
+  * @param  content_len: longest image packet, 4 bytes and the blocks of
+  *         one ATT_MTU
+  * @retval BLE_STATUS_SUCCESS or the error of the stack
+  */
+uint8_t OtaService_Init(uint32_t running_address, uint16_t content_len)
+{
+  Service_UUID_t service_uuid;
+  uint8_t image[OTA_SERVICE_IMAGE_LEN] = {0};
+  uint8_t ret;
+
+  memset(&ota_stats, 0, sizeof(ota_stats));
+  ota_running = running_address;
+  if (running_address == OTA_DELTA_BANK_LOWER)
+    ota_bank = OTA_DELTA_BANK_HIGHER;
+  else if (running_address == OTA_DELTA_BANK_HIGHER)
+    ota_bank = OTA_DELTA_BANK_LOWER;
+  else
+    ota_bank = 0;
+
+  memcpy(service_uuid.Service_UUID_128, ota_uuid_service, sizeof(service_uuid.Service_UUID_128));
+  ret = aci_gatt_add_service(UUID_TYPE_128, &service_uuid, PRIMARY_SERVICE, OTA_SERVICE_ATTRIBUTES,
+                             &ota_service_handle);
+  if (ret == BLE_STATUS_SUCCESS)
+    ret = OtaService_AddChar(ota_uuid_image, OTA_SERVICE_IMAGE_LEN, CHAR_PROP_READ,
+                             GATT_DONT_NOTIFY_EVENTS, CHAR_VALUE_LEN_CONSTANT, &ota_image_handle);
+  if (ret == BLE_STATUS_SUCCESS)
+    ret = OtaService_AddChar(ota_uuid_new_image, OTA_SERVICE_NEW_IMAGE_LEN,
+                             CHAR_PROP_READ | CHAR_PROP_WRITE | CHAR_PROP_WRITE_WITHOUT_RESP,
+                             GATT_NOTIFY_ATTRIBUTE_WRITE, CHAR_VALUE_LEN_CONSTANT, &ota_new_image_handle);
+  if (ret == BLE_STATUS_SUCCESS)
+    ret = OtaService_AddChar(ota_uuid_content, content_len,
+                             CHAR_PROP_READ | CHAR_PROP_WRITE | CHAR_PROP_WRITE_WITHOUT_RESP,
+                             GATT_NOTIFY_ATTRIBUTE_WRITE, CHAR_VALUE_LEN_VARIABLE, &ota_content_handle);
+  if (ret == BLE_STATUS_SUCCESS)
+    ret = OtaService_AddChar(ota_uuid_expected, OTA_SERVICE_NOTIFY_LEN, CHAR_PROP_NOTIFY | CHAR_PROP_READ,
+                             GATT_DONT_NOTIFY_EVENTS, CHAR_VALUE_LEN_CONSTANT, &ota_expected_handle);
+  if (ret != BLE_STATUS_SUCCESS)
+    return ret;
+
+  /* Where the client sends the image */
+  if (ota_bank != 0) {
+    OtaService_SetLe32(&image[0], ota_bank);
+    OtaService_SetLe32(&image[4], OTA_DELTA_BANK_SIZE);
+  }
+  return aci_gatt_update_char_value_ext(0, ota_service_handle, ota_image_handle, OTA_SERVICE_UPDATE_LOCAL,
+                                        OTA_SERVICE_IMAGE_LEN, 0, OTA_SERVICE_IMAGE_LEN, image);
+}
+
+/**
+  * @brief  Write of a characteristic, from aci_gatt_attribute_modified_event().
+  *         Handles of the service are those of the characteristic
+  *         declarations, the value being at handle + 1.
+  */
+void OtaService_Write(uint16_t conn_handle, uint16_t attr_handle, uint16_t len, const uint8_t *data)
+{
+  ota_conn_handle = conn_handle;
+  if (attr_handle == ota_content_handle + 1)
+    OtaService_Content(data, len);
+  else if (attr_handle == ota_new_image_handle + 1 && len == OTA_SERVICE_NEW_IMAGE_LEN)
+    OtaService_NewImage(data);
+}
+
+const OtaService_Stats_t *OtaService_GetStats(void)
+{
+  return &ota_stats;
+}
@@ -0,0 +1,220 @@
+/**
+  ******************************************************************************
+  * @file    prof.c
+  * @brief   Cycle profiler: MFT1 time base, per-site histograms and their
+  *          dump over the log transport.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "BlueNRG1_conf.h"
+#include "scheduler.h"
+#include "log.h"
+#include "sleep_mgr.h"
+#include "prof.h"
+
+#ifdef PROF_ENABLED
+
+/* Private define ------------------------------------------------------------*/
+/* Dump cursor: site, then line of the site (summary, then one per bucket) */
+#define PROF_DUMP_IDLE          0xFF
+#define PROF_DUMP_SUMMARY       0xFF
+
+/* Private variables ---------------------------------------------------------*/
+static Prof_Stats_t prof_stats[PROF_SITE_COUNT];
+
+static const char *const prof_site_names[PROF_SITE_COUNT] = {
+  "loop",
+  "stack_tick",
+  "ral_isr",
+  "timer_job",
+  "blue_isr",
+  "systick",
+};
+
+static volatile uint8_t prof_running;
+
+static uint8_t prof_dump_site = PROF_DUMP_IDLE;
+static uint8_t prof_dump_line;
+
+static const SleepMgr_Periph_t prof_sleep = { "mft", NULL, Prof_Suspend, NULL };
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Start MFT1 timer 1 counting down from 0xFFFF on the undivided
+  *         system clock, reloading 0xFFFF on underflow (mode 3, independent
+  *         timers). Timer 2 is left stopped.
+  */
+static void Prof_Start(void)
+{
+  MFT_InitType mft;
+
+  SysCtrl_PeripheralClockCmd(CLOCK_PERIPH_MTFX1, ENABLE);
+
+  MFT_StructInit(&mft);
+  mft.MFT_Mode = MFT_MODE_3;
+  mft.MFT_Prescaler = 0;
+  mft.MFT_Clock1 = MFT_PRESCALED_CLK;
+  mft.MFT_Clock2 = MFT_NO_CLK;
+  mft.MFT_CRA = 0xFFFF;
+  mft.MFT_CRB = 0xFFFF;
+  MFT_Init(MFT1, &mft);
+  MFT_SetCounter1(MFT1, 0xFFFF);
+  MFT_Cmd(MFT1, ENABLE);
+  prof_running = 1;
+}
+
+/**
+  * @brief  Register the MFT with the sleep manager: the time base stops
+  *         before each deep sleep.
+  */
+void Prof_Init(void)
+{
+  SleepMgr_Register(&prof_sleep);
+}
+
+/**
+  * @brief  Stop the time base before a deep sleep.
+  */
+void Prof_Suspend(void)
+{
+  if (!prof_running)
+    return;
+  prof_running = 0;
+  MFT_Cmd(MFT1, DISABLE);
+}
+
+/**
+  * @brief  Profiler time base, counting down. Started on first use after
+  *         boot or sleep.
+  */
+uint16_t Prof_Now(void)
+{
+  if (!prof_running)
+    Prof_Start();
+  return MFT_GetCounter1(MFT1);
+}
+
+/**
+  * @brief  Histogram bucket of a scope: position of its highest set bit.
+  */
+uint8_t Prof_Bucket(uint16_t cycles)
+{
+  uint8_t bucket = 0;
+
+  while (cycles > 1) {
+    cycles >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+/**
+  * @brief  Account one run of a site.
+  */
+void Prof_Record(Prof_Site_t site, uint16_t cycles)
+{
+  Prof_Stats_t *stats = &prof_stats[site];
+
+  if (stats->count == 0 || cycles < stats->min)
+    stats->min = cycles;
+  if (cycles > stats->max)
+    stats->max = cycles;
+  stats->count++;
+  stats->total += cycles;
+  stats->hist[Prof_Bucket(cycles)]++;
+}
+
+/**
+  * @brief  Clear the counters of all the sites.
+  */
+void Prof_Reset(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < PROF_SITE_COUNT; i++)
+    prof_stats[i] = (Prof_Stats_t){0};
+}
+
+/**
+  * @brief  Next line of the dump, 0 when it is over.
+  */
+static uint8_t Prof_DumpLine(void)
+{
+  const Prof_Stats_t *stats;
+  uint8_t b;
+
+  while (prof_dump_site < PROF_SITE_COUNT) {
+    stats = &prof_stats[prof_dump_site];
+
+    if (prof_dump_line == PROF_DUMP_SUMMARY) {
+      prof_dump_line = 0;
+      PRINTF("prof %s: %u runs, min %u max %u avg %u cycles\r\n", prof_site_names[prof_dump_site],
+             (unsigned)stats->count, (unsigned)stats->min, (unsigned)stats->max,
+             (unsigned)(stats->count ? stats->total / stats->count : 0));
+      return 1;
+    }
+
+    for (b = prof_dump_line; b < PROF_BUCKETS; b++) {
+      if (stats->hist[b] != 0)
+        break;
+    }
+    if (b < PROF_BUCKETS) {
+      prof_dump_line = b + 1;
+      PRINTF("prof %s %u-%u: %u\r\n", prof_site_names[prof_dump_site],
+             b ? 1U << b : 0U, (2U << b) - 1, (unsigned)stats->hist[b]);
+      return 1;
+    }
+
+    prof_dump_site++;
+    prof_dump_line = PROF_DUMP_SUMMARY;
+  }
+  prof_dump_site = PROF_DUMP_IDLE;
+  return 0;
+}
+
+/**
+  * @brief  Dump timer job: lines while the log ring has room for them,
+  *         the rest at the next run.
+  */
+static void Prof_DumpNext(void)
+{
+  uint8_t timer;
+
+  while (Log_Room() >= LOG_LINE_MAX) {
+    if (!Prof_DumpLine())
+      return;
+  }
+  timer = Sched_TimerStart(Prof_DumpNext, PROF_DUMP_RETRY_MS, 0);
+  if (timer == SCHED_TIMER_INVALID)
+    prof_dump_site = PROF_DUMP_IDLE;
+  Sched_TimerSetSlack(timer, PROF_DUMP_SLACK_MS);
+}
+
+/**
+  * @brief  Send the counters of every site over the log transport: a
+  *         summary line, then one line per non empty bucket with its range
+  *         in cycles. Ignored while a dump is in progress.
+  */
+void Prof_Dump(void)
+{
+  if (prof_dump_site != PROF_DUMP_IDLE)
+    return;
+
+  prof_dump_site = 0;
+  prof_dump_line = PROF_DUMP_SUMMARY;
+  Prof_DumpNext();
+}
+
+const char *Prof_SiteName(Prof_Site_t site)
+{
+  return prof_site_names[site];
+}
+
+const Prof_Stats_t *Prof_GetStats(Prof_Site_t site)
+{
+  return &prof_stats[site];
+}
+
+#endif /* PROF_ENABLED */
@@ -0,0 +1,671 @@
+/**
+  ******************************************************************************
+  * @file    scheduler.c
+  * @brief   Cooperative event/timer scheduler for the application main loop.
+  *
+  *          Each call to Sched_RunOnce() dispatches the events posted from
+  *          interrupt context, runs the timer jobs whose deadline has been
+  *          reached, ticks the BLE stack and then sleeps until the next
+  *          deadline. The sleep depth is negotiated by BlueNRG_Sleep() with
+  *          the stack and App_SleepMode_Check(), which asks the sleep manager
+  *          (sleep_mgr.h) for the peripherals in use.
+  *
+  *          Armed jobs are kept in a list ordered by deadline, linked through
+  *          the slots of the static pool: the next deadline and the due jobs
+  *          are at its head, and a pass with nothing due costs one compare.
+  *          Free slots form a second list, so starting a job takes no scan of
+  *          the pool; only its insertion walks the armed jobs.
+  *
+  *          Due jobs with a slack that are held for the radio stay in the
+  *          list at their deadline, on their grid: the passes skip them
+  *          until the stack reports the end of the radio activity.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "sleep.h"
+#include "trace.h"
+#include "prof.h"
+#include "sleep_mgr.h"
+#include "supervisor.h"
+#include "led.h"
+#include "scheduler.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  Sched_Handler job;       /* NULL when the slot is free */
+  tClockTime    deadline;  /* Absolute expiry time (ms) */
+  uint32_t      period;    /* Reload value in ms, 0 for one-shot jobs */
+  uint32_t      ran;       /* sched_stats.loops of the last run */
+  uint8_t       next;      /* Next slot of the armed or free list */
+  uint8_t       prev;      /* Previous slot of the armed list */
+  uint8_t       policy;    /* Sched_Policy_t */
+  uint32_t      slack;     /* Delay allowed to stay off the radio activity, ms */
+  uint8_t       hold;      /* SCHED_HOLD_xxx, jobs with a slack */
+  uint8_t       radio_seq; /* sched_radio_seq when the job came due */
+} Sched_Timer_t;
+
+/* Private define ------------------------------------------------------------*/
+/* Returned by Sched_NextTimeout() when no timer job is armed */
+#define SCHED_NO_TIMEOUT        (-1)
+
+/* The sleep timer reference moves forward after this long, well inside the
+   range of HAL_VTimerDiff_ms_sysT32() (2^31 ticks, 1.45 h) */
+#define SCHED_ANCHOR_MAX_MS     600000
+
+/* End of a slot list */
+#define SCHED_NIL               SCHED_TIMER_INVALID
+
+/* Radio activity reported by the stack: advertising, slave connection
+   events */
+#define SCHED_RADIO_ACTIVITY_MASK   0x0006
+#define SCHED_RADIO_STATE_IDLE      0x00
+
+/* A radio activity not reported this long after its start is not coming
+   (advertising stopped): the held jobs go */
+#define SCHED_RADIO_END_MAX_MS  10
+
+/* Hold state of a job with a slack */
+#define SCHED_HOLD_NONE         0   /* Not due */
+#define SCHED_HOLD_DUE          1   /* Due, radio_seq taken */
+#define SCHED_HOLD_HELD         2   /* Held at least once */
+
+#if SCHED_MAX_TIMERS >= SCHED_TIMER_INVALID
+#error "SCHED_MAX_TIMERS must be below SCHED_TIMER_INVALID"
+#endif
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static Sched_Timer_t sched_timers[SCHED_MAX_TIMERS];
+static uint8_t sched_armed;      /* Earliest deadline first */
+static uint8_t sched_free;
+static Sched_Handler sched_handlers[SCHED_MAX_EVENTS];
+static volatile uint32_t sched_events;
+
+/* Correction of Clock_Time() for the time spent in deep sleep, during which SysTick is stopped */
+static volatile tClockTime sched_sleep_offset;
+
+/* Sleep timer reference: the scheduler time was sched_anchor_ms at
+   sched_anchor_sys exactly. Each wakeup sets the time from it, so the ms
+   truncated at each sleep do not add up */
+static tClockTime sched_anchor_ms;
+static uint32_t sched_anchor_sys;
+
+/* While sleeping (and in the wakeup ISRs) the time base is the sleep timer */
+static volatile uint8_t sched_sleeping;
+static tClockTime sched_sleep_start;
+static uint32_t sched_sleep_start_sys;
+
+/* Set by the scheduler virtual timer: the sleep ended at the deadline */
+static volatile uint8_t sched_deadline_hit;
+
+/* Start of the next radio activity, from the last report of the stack */
+static tClockTime sched_radio_next;
+static uint8_t sched_radio_valid;
+static uint8_t sched_radio_seq;          /* Reports, modulo 256 */
+static uint32_t sched_radio_interval;
+
+static uint8_t sched_wake_io_mask;
+static uint8_t sched_wake_io_level;
+
+static Sched_Stats_t sched_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Insert an armed slot in the deadline list, after the jobs due at
+  *         the same time.
+  */
+static void Sched_TimerLink(uint8_t id)
+{
+  Sched_Timer_t *t = &sched_timers[id];
+  uint8_t prev = SCHED_NIL;
+  uint8_t next = sched_armed;
+
+  while (next != SCHED_NIL && SCHED_TIME_REACHED(t->deadline, sched_timers[next].deadline)) {
+    prev = next;
+    next = sched_timers[next].next;
+  }
+
+  t->prev = prev;
+  t->next = next;
+  if (next != SCHED_NIL)
+    sched_timers[next].prev = id;
+  if (prev != SCHED_NIL)
+    sched_timers[prev].next = id;
+  else
+    sched_armed = id;
+}
+
+static void Sched_TimerUnlink(uint8_t id)
+{
+  Sched_Timer_t *t = &sched_timers[id];
+
+  if (t->next != SCHED_NIL)
+    sched_timers[t->next].prev = t->prev;
+  if (t->prev != SCHED_NIL)
+    sched_timers[t->prev].next = t->next;
+  else
+    sched_armed = t->next;
+}
+
+/**
+  * @brief  Back to the free list, unlinked from the armed one.
+  */
+static void Sched_TimerFree(uint8_t id)
+{
+  sched_timers[id].job = NULL;
+  sched_timers[id].next = sched_free;
+  sched_free = id;
+}
+
+/**
+  * @brief  Next deadline of a periodic job that just came due: one period
+  *         on, or with SCHED_TIMER_SKIP the first period still ahead of now.
+  *         The deadlines stay on the grid of the first one.
+  */
+static void Sched_TimerReload(Sched_Timer_t *t, tClockTime now)
+{
+  uint32_t missed;
+
+  t->deadline += t->period;
+  if (t->policy == SCHED_TIMER_SKIP && SCHED_TIME_REACHED(now, t->deadline)) {
+    missed = (uint32_t)(now - t->deadline) / t->period + 1;
+    t->deadline += missed * t->period;
+    sched_stats.timer_skips += missed;
+  }
+}
+
+/**
+  * @brief  The radio is about to start its next activity or in it, as far
+  *         as the last report of the stack tells.
+  */
+static uint8_t Sched_RadioBusy(tClockTime at)
+{
+  return sched_radio_valid && SCHED_TIME_REACHED(at, sched_radio_next - SCHED_RADIO_GUARD_MS) &&
+         !SCHED_TIME_REACHED(at, sched_radio_next + SCHED_RADIO_END_MAX_MS);
+}
+
+/**
+  * @brief  Keep a due job with a slack back: until the next report of the
+  *         stack if its slack covers a radio interval, else while the radio
+  *         is busy. Never past the slack.
+  */
+static uint8_t Sched_TimerHeld(Sched_Timer_t *t, tClockTime now)
+{
+  if (t->slack == 0 || !sched_radio_valid)
+    return 0;
+  if (t->hold == SCHED_HOLD_NONE) {
+    t->hold = SCHED_HOLD_DUE;
+    t->radio_seq = sched_radio_seq;
+  }
+
+  /* A report since it came due: this is the gap after the radio activity */
+  if (t->radio_seq != sched_radio_seq || SCHED_TIME_REACHED(now, t->deadline + t->slack) ||
+      SCHED_TIME_REACHED(now, sched_radio_next + SCHED_RADIO_END_MAX_MS))
+    return 0;
+  if (!Sched_RadioBusy(now) &&
+      (sched_radio_interval == 0 || t->slack < sched_radio_interval + SCHED_RADIO_JITTER_MS))
+    return 0;
+
+  t->hold = SCHED_HOLD_HELD;
+  return 1;
+}
+
+/**
+  * @brief  A job not due yet will be held at its deadline: no wakeup for
+  *         it, the end of the radio activity wakes the core first.
+  */
+static uint8_t Sched_TimerDefers(const Sched_Timer_t *t)
+{
+  if (t->slack == 0 || !sched_radio_valid)
+    return 0;
+  if (sched_radio_interval != 0 && t->slack >= sched_radio_interval + SCHED_RADIO_JITTER_MS)
+    return 1;
+  return Sched_RadioBusy(t->deadline);
+}
+
+/**
+  * @brief  Milliseconds until the closest timer deadline, or the end of
+  *         the slack of the jobs held for the radio, whose report is the
+  *         expected wakeup.
+  * @param  now: current scheduler time
+  * @retval 0 if a job is due, SCHED_NO_TIMEOUT if no job is armed
+  */
+static int32_t Sched_NextTimeout(tClockTime now)
+{
+  Sched_Timer_t *t;
+  tClockTime wake = 0, at;
+  uint8_t found = 0;
+  uint8_t held;
+  uint8_t i;
+  int32_t delta;
+
+  for (i = sched_armed; i != SCHED_NIL; i = t->next) {
+    t = &sched_timers[i];
+    held = SCHED_TIME_REACHED(now, t->deadline) ? Sched_TimerHeld(t, now) : Sched_TimerDefers(t);
+    at = held ? t->deadline + t->slack : t->deadline;
+    if (!found || SCHED_TIME_REACHED(wake, at))
+      wake = at;
+    found = 1;
+    /* The later jobs are not due before this deadline */
+    if (!held)
+      break;
+  }
+  if (!found)
+    return SCHED_NO_TIMEOUT;
+
+  delta = (int32_t)(wake - now);
+  return (delta <= 0) ? 0 : delta;
+}
+
+/**
+  * @brief  Scheduler time from the sleep timer.
+  */
+static tClockTime Sched_SleepTimerNow(uint32_t now_sys)
+{
+  return sched_anchor_ms + HAL_VTimerDiff_ms_sysT32(now_sys, sched_anchor_sys);
+}
+
+/**
+  * @brief  Set Clock_Time() right again on wakeup. After a deep sleep
+  *         SysTick starts over from the register copy, behind by the sleep
+  *         and the phase of its ms; in CPU halt it kept counting. Either way
+  *         the correction only moves forward, so Sched_Now() never goes back.
+  */
+static void Sched_ClockRearm(uint32_t now_sys)
+{
+  tClockTime offset;
+  int32_t elapsed;
+
+  offset = Sched_SleepTimerNow(now_sys) - Clock_Time();
+  if ((int32_t)(offset - sched_sleep_offset) > 0)
+    sched_sleep_offset = offset;
+
+  /* Whole ms: HAL_VTimerAcc_sysT32_ms() rounds to a tick, once per move */
+  elapsed = HAL_VTimerDiff_ms_sysT32(now_sys, sched_anchor_sys);
+  if (elapsed > SCHED_ANCHOR_MAX_MS) {
+    sched_anchor_ms += elapsed;
+    sched_anchor_sys = HAL_VTimerAcc_sysT32_ms(sched_anchor_sys, elapsed);
+  }
+}
+
+/**
+  * @brief  Sleep until the next timer deadline or the next interrupt.
+  *         The sleep timer measures the time spent sleeping, since SysTick
+  *         does not run while the core is powered down.
+  */
+static void Sched_Idle(void)
+{
+  int32_t timeout;
+  int32_t slept;
+  uint32_t now_sys;
+  SleepModes mode = SLEEPMODE_NOTIMER;
+#ifdef TRACE_ENABLED
+  uint32_t trace_rec[2];
+#endif
+
+  if (sched_events != 0)
+    return;
+
+  /* Send the trace of this pass while there is nothing else to do */
+  TRACE_FLUSH();
+
+  sched_sleep_start = Sched_Now();
+  timeout = Sched_NextTimeout(sched_sleep_start);
+  if (timeout == 0)
+    return;
+
+  sched_sleep_start_sys = HAL_VTimerGetCurrentTime_sysT32();
+  sched_deadline_hit = 0;
+  if (timeout != SCHED_NO_TIMEOUT) {
+    mode = SLEEPMODE_WAKETIMER;
+    if (HAL_VTimerStart_ms(SCHED_VTIMER_ID, timeout) != 0) {
+      /* No virtual timer available: stay in CPU halt, SysTick wakes us up */
+      mode = SLEEPMODE_CPU_HALT;
+    }
+  }
+
+  sched_sleeping = 1;
+
+#ifdef TRACE_ENABLED
+  trace_rec[0] = mode;
+  trace_rec[1] = (uint32_t)timeout;
+  TRACE_RECORD(TRACE_REC_SLEEP, trace_rec, 2);
+#endif
+
+  SleepMgr_Enter(sched_sleep_start_sys, (mode == SLEEPMODE_WAKETIMER) ? timeout : SLEEP_MGR_NO_DEADLINE);
+  BlueNRG_Sleep(mode, sched_wake_io_mask, sched_wake_io_level);
+  TRACE_POINT(TRACE_PT_WAKE);
+
+  now_sys = HAL_VTimerGetCurrentTime_sysT32();
+  SleepMgr_Wake(now_sys, sched_deadline_hit);
+  Sched_ClockRearm(now_sys);
+  sched_sleeping = 0;
+
+  if (mode == SLEEPMODE_WAKETIMER)
+    HAL_VTimer_Stop(SCHED_VTIMER_ID);
+
+  /* The peripherals once the time is right: their restore may timestamp */
+  SleepMgr_Restore();
+
+  slept = HAL_VTimerDiff_ms_sysT32(now_sys, sched_sleep_start_sys);
+  sched_stats.wakeups++;
+  sched_stats.sleep_ms += (slept > 0) ? (uint32_t)slept : 0;
+}
+
+/**
+  * @brief  Initialize the scheduler: no job, no event, no wakeup IO.
+  */
+void Sched_Init(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < SCHED_MAX_TIMERS; i++) {
+    sched_timers[i].job = NULL;
+    sched_timers[i].next = (i + 1 < SCHED_MAX_TIMERS) ? i + 1 : SCHED_NIL;
+  }
+  sched_armed = SCHED_NIL;
+  sched_free = 0;
+  for (i = 0; i < SCHED_MAX_EVENTS; i++)
+    sched_handlers[i] = NULL;
+
+  sched_events = 0;
+  sched_sleep_offset = 0;
+  sched_anchor_ms = Clock_Time();
+  sched_anchor_sys = HAL_VTimerGetCurrentTime_sysT32();
+  sched_sleeping = 0;
+  sched_wake_io_mask = 0;
+  sched_wake_io_level = 0;
+  sched_radio_valid = 0;
+  sched_radio_seq = 0;
+  sched_radio_interval = 0;
+  sched_stats = (Sched_Stats_t){0};
+
+  /* After the stack init: the end of each radio activity, for the jobs
+     with a slack */
+  aci_hal_set_radio_activity_mask(SCHED_RADIO_ACTIVITY_MASK);
+
+  /* Each pass ticks the stack: the supervisor expects one within its deadline */
+  Sup_TaskStart(SUP_TASK_STACK_TICK);
+}
+
+/**
+  * @brief  Arm a timer job, SCHED_TIMER_SKIP if periodic.
+  * @param  job: function called from the main loop on expiry
+  * @param  first_ms: delay before the first run
+  * @param  period_ms: reload period, 0 for a one-shot job
+  * @retval Timer identifier or SCHED_TIMER_INVALID if the pool is full
+  */
+uint8_t Sched_TimerStart(Sched_Handler job, uint32_t first_ms, uint32_t period_ms)
+{
+  Sched_Timer_t *t;
+  uint8_t id = sched_free;
+
+  if (id == SCHED_NIL)
+    return SCHED_TIMER_INVALID;
+
+  t = &sched_timers[id];
+  sched_free = t->next;
+  t->deadline = Sched_Now() + first_ms;
+  t->period = period_ms;
+  t->ran = sched_stats.loops - 1;
+  t->policy = SCHED_TIMER_SKIP;
+  t->slack = 0;
+  t->hold = SCHED_HOLD_NONE;
+  t->job = job;
+  Sched_TimerLink(id);
+  return id;
+}
+
+/**
+  * @brief  Release a timer job. No effect on a free slot (one-shot job
+  *         already run).
+  */
+void Sched_TimerStop(uint8_t id)
+{
+  if (id >= SCHED_MAX_TIMERS || sched_timers[id].job == NULL)
+    return;
+
+  Sched_TimerUnlink(id);
+  Sched_TimerFree(id);
+}
+
+/**
+  * @brief  Change the period of a running job. The new period is applied
+  *         from the last expiry, so the next deadline moves accordingly.
+  */
+void Sched_TimerSetPeriod(uint8_t id, uint32_t period_ms)
+{
+  if (id >= SCHED_MAX_TIMERS || sched_timers[id].job == NULL)
+    return;
+
+  Sched_TimerUnlink(id);
+  sched_timers[id].deadline += period_ms - sched_timers[id].period;
+  sched_timers[id].period = period_ms;
+  Sched_TimerLink(id);
+}
+
+/**
+  * @brief  Choose what a periodic job does after missing periods.
+  */
+void Sched_TimerSetPolicy(uint8_t id, Sched_Policy_t policy)
+{
+  if (id < SCHED_MAX_TIMERS && sched_timers[id].job != NULL)
+    sched_timers[id].policy = (uint8_t)policy;
+}
+
+/**
+  * @brief  Let a job run up to slack_ms after its deadline to stay off the
+  *         radio activity. 0 (default) runs it on time.
+  */
+void Sched_TimerSetSlack(uint8_t id, uint32_t slack_ms)
+{
+  if (id < SCHED_MAX_TIMERS && sched_timers[id].job != NULL)
+    sched_timers[id].slack = slack_ms;
+}
+
+/**
+  * @brief  Register the main loop handler of an event slot.
+  */
+void Sched_SetEventHandler(uint8_t evt, Sched_Handler handler)
+{
+  if (evt < SCHED_MAX_EVENTS)
+    sched_handlers[evt] = handler;
+}
+
+/**
+  * @brief  Post an event. Safe to call from interrupt context.
+  */
+void Sched_PostEvent(uint8_t evt)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  sched_events |= SCHED_EVT_MASK(evt);
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Ask for one more main loop pass (and so one more BTLE_StackTick())
+  *         before going to sleep. Safe to call from interrupt context.
+  */
+void Sched_RequestStackTick(void)
+{
+  Sched_PostEvent(SCHED_EVT_STACK_TICK);
+}
+
+/**
+  * @brief  Non zero when work is waiting for the main loop. Used by
+  *         App_SleepMode_Check() to close the check-then-sleep race.
+  */
+uint8_t Sched_EventsPending(void)
+{
+  return sched_events != 0;
+}
+
+/**
+  * @brief  Configure the IOs allowed to wake the device from deep sleep.
+  * @param  io_mask: WAKEUP_IOx bit mask
+  * @param  io_level: wakeup level of each IO in io_mask
+  */
+void Sched_SetWakeupIO(uint8_t io_mask, uint8_t io_level)
+{
+  sched_wake_io_mask = io_mask;
+  sched_wake_io_level = io_level;
+}
+
+/**
+  * @brief  Interval of the radio activity (advertising or connection
+  *         interval), 0 if none: jobs with at least this slack, plus
+  *         SCHED_RADIO_JITTER_MS, wait for the next report of the stack.
+  */
+void Sched_SetRadioInterval(uint32_t interval_ms)
+{
+  sched_radio_interval = interval_ms;
+}
+
+/**
+  * @brief  Scheduler time base in ms: Clock_Time() corrected by the time
+  *         spent in deep sleep. Also valid in the interrupts taken on wakeup,
+  *         before the correction is updated.
+  */
+tClockTime Sched_Now(void)
+{
+  tClockTime now;
+
+  if (sched_sleeping) {
+    now = Sched_SleepTimerNow(HAL_VTimerGetCurrentTime_sysT32());
+    return SCHED_TIME_REACHED(now, sched_sleep_start) ? now : sched_sleep_start;
+  }
+
+  return Clock_Time() + sched_sleep_offset;
+}
+
+/**
+  * @brief  One main loop pass: events, due timers, stack tick, then sleep.
+  */
+void Sched_RunOnce(void)
+{
+  uint32_t pending;
+  uint32_t primask;
+  tClockTime now;
+  Sched_Handler job;
+  uint8_t i;
+
+  PROF_BEGIN(PROF_SITE_LOOP);
+
+  sched_stats.loops++;
+  TRACE_POINT(TRACE_PT_LOOP);
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  pending = sched_events;
+  sched_events = 0;
+  __set_PRIMASK(primask);
+
+  for (i = 0; i < SCHED_MAX_EVENTS; i++) {
+    if ((pending & SCHED_EVT_MASK(i)) && sched_handlers[i] != NULL) {
+      TRACE_POINT(TRACE_PT_EVENT);
+      sched_handlers[i]();
+      sched_stats.event_runs++;
+    }
+  }
+
+  /* Due jobs from the head of the list, each one at most once per pass: a
+     SCHED_TIMER_CATCH_UP job still behind is back at the head. The time is
+     read again after each job, which may have been long. Jobs held for
+     the radio are passed over */
+  i = sched_armed;
+  while (i != SCHED_NIL && sched_timers[i].ran != sched_stats.loops) {
+    now = Sched_Now();
+    if (!SCHED_TIME_REACHED(now, sched_timers[i].deadline))
+      break;
+    if (Sched_TimerHeld(&sched_timers[i], now)) {
+      i = sched_timers[i].next;
+      continue;
+    }
+    if (sched_timers[i].hold == SCHED_HOLD_HELD)
+      sched_stats.timer_deferred++;
+    sched_timers[i].hold = SCHED_HOLD_NONE;
+    if (Sched_RadioBusy(now))
+      sched_stats.timer_overlaps++;
+
+    job = sched_timers[i].job;
+    sched_timers[i].ran = sched_stats.loops;
+    Sched_TimerUnlink(i);
+    if (sched_timers[i].period != 0) {
+      Sched_TimerReload(&sched_timers[i], now);
+      Sched_TimerLink(i);
+    } else {
+      /* One-shot: the slot is free, the job may re-arm itself */
+      Sched_TimerFree(i);
+    }
+
+    TRACE_POINT(TRACE_PT_TIMER_JOB);
+    {
+      PROF_BEGIN(PROF_SITE_TIMER_JOB);
+      job();
+      PROF_END(PROF_SITE_TIMER_JOB);
+    }
+    sched_stats.timer_runs++;
+    i = sched_armed;
+  }
+
+  /* BlueNRG-1 stack tick */
+  TRACE_POINT(TRACE_PT_STACK_TICK);
+  PROF_BEGIN(PROF_SITE_STACK_TICK);
+  Sup_TaskBegin(SUP_TASK_STACK_TICK);
+  BTLE_StackTick();
+  Sup_TaskEnd(SUP_TASK_STACK_TICK);
+  PROF_END(PROF_SITE_STACK_TICK);
+  TRACE_POINT(TRACE_PT_STACK_DONE);
+  sched_stats.stack_ticks++;
+
+  /* Feed the watchdog if every supervised task keeps up */
+  Sup_Check();
+
+  PROF_END(PROF_SITE_LOOP);
+  Sched_Idle();
+}
+
+/**
+  * @brief  Scheduler counters.
+  */
+const Sched_Stats_t *Sched_GetStats(void)
+{
+  return &sched_stats;
+}
+
+/**
+  * @brief  End of a radio activity, from BTLE_StackTick(): start of the
+  *         next one, in sleep timer units. The jobs held for it run in the
+  *         next pass.
+  */
+void aci_hal_end_of_radio_activity_event(uint8_t Last_State, uint8_t Next_State,
+                                         uint32_t Next_State_SysTime)
+{
+  (void)Last_State;
+
+  sched_radio_valid = (Next_State != SCHED_RADIO_STATE_IDLE);
+  sched_radio_next = Sched_SleepTimerNow(Next_State_SysTime);
+  sched_radio_seq++;
+  sched_stats.radio_reports++;
+}
+
+/**
+  * @brief  Virtual timer expiry. The wakeup itself is all the scheduler
+  *         needs: the next Sched_RunOnce() pass runs the due jobs. The LED
+  *         timer sets the next edge of the pattern.
+  */
+void HAL_VTimerTimeoutCallback(uint8_t timerNum)
+{
+  if (timerNum == SCHED_VTIMER_ID)
+    sched_deadline_hit = 1;
+  else if (timerNum == LED_VTIMER_ID)
+    Led_TimerIrq();
+}
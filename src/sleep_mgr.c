@@ -0,0 +1,201 @@
+/**
+  ******************************************************************************
+  * @file    sleep_mgr.c
+  * @brief   Sleep manager: registry of the peripherals in use, their checks
+  *          and save/restore hooks around deep sleep, and wake latency per
+  *          sleep mode.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "bluenrg1_stack.h"
+#include "log.h"
+#include "sleep_mgr.h"
+
+/* Private define ------------------------------------------------------------*/
+/* sysT32 ticks to us: 2.4414 us (625/256) a tick at the nominal 32 kHz */
+#define SLEEP_MGR_TICKS_US(ticks)   ((uint64_t)(ticks) * 625 / 256)
+
+/* Private variables ---------------------------------------------------------*/
+static const SleepMgr_Periph_t *sleep_periphs[SLEEP_MGR_MAX_PERIPHS];
+static uint8_t sleep_periph_count;
+
+/* Sleep in progress, from SleepMgr_Enter() to SleepMgr_Wake() */
+static SleepModes sleep_mode;
+static uint32_t sleep_start_sys;
+static uint32_t sleep_deadline_sys;
+static uint8_t sleep_has_deadline;
+
+/* Save hooks run: the restore hooks are due */
+static uint8_t sleep_saved;
+
+static SleepMgr_Stats_t sleep_stats[SLEEP_MGR_MODES];
+
+static const char *const sleep_mode_names[SLEEP_MGR_MODES] = {
+  "running",
+  "halt",
+  "waketimer",
+  "notimer",
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Empty registry, counters cleared.
+  */
+void SleepMgr_Init(void)
+{
+  uint8_t i;
+
+  sleep_periph_count = 0;
+  sleep_saved = 0;
+  sleep_mode = SLEEPMODE_RUNNING;
+  for (i = 0; i < SLEEP_MGR_MODES; i++)
+    sleep_stats[i] = (SleepMgr_Stats_t){0};
+}
+
+/**
+  * @brief  Add a peripheral to the registry, from the init of the module
+  *         that drives it. Registering it again has no effect.
+  * @retval 0 if registered, 1 if the registry is full
+  */
+uint8_t SleepMgr_Register(const SleepMgr_Periph_t *periph)
+{
+  uint8_t i;
+
+  for (i = 0; i < sleep_periph_count; i++) {
+    if (sleep_periphs[i] == periph)
+      return 0;
+  }
+  if (sleep_periph_count == SLEEP_MGR_MAX_PERIPHS)
+    return 1;
+  sleep_periphs[sleep_periph_count++] = periph;
+  return 0;
+}
+
+/**
+  * @brief  Deepest mode allowed by the registered peripherals, at most
+  *         sleepMode and SLEEP_MGR_MAX_MODE. Called by App_SleepMode_Check()
+  *         with the interrupts masked: the mode returned is the one entered,
+  *         and for a deep one the save hooks have run.
+  */
+SleepModes SleepMgr_Check(SleepModes sleepMode)
+{
+  SleepModes mode;
+  uint8_t i;
+
+  if (sleepMode > SLEEP_MGR_MAX_MODE)
+    sleepMode = SLEEP_MGR_MAX_MODE;
+  for (i = 0; i < sleep_periph_count && sleepMode > SLEEPMODE_RUNNING; i++) {
+    if (sleep_periphs[i]->check == NULL)
+      continue;
+    mode = sleep_periphs[i]->check();
+    if (mode < sleepMode)
+      sleepMode = mode;
+  }
+
+  sleep_mode = sleepMode;
+  if (sleepMode >= SLEEPMODE_WAKETIMER && !sleep_saved) {
+    for (i = 0; i < sleep_periph_count; i++) {
+      if (sleep_periphs[i]->save != NULL)
+        sleep_periphs[i]->save();
+    }
+    sleep_saved = 1;
+  }
+  return sleepMode;
+}
+
+/**
+  * @brief  Start of a sleep, just before BlueNRG_Sleep().
+  * @param  now_sys: sleep timer now
+  * @param  timeout_ms: scheduler deadline, ms from now, or
+  *         SLEEP_MGR_NO_DEADLINE
+  */
+void SleepMgr_Enter(uint32_t now_sys, int32_t timeout_ms)
+{
+  sleep_start_sys = now_sys;
+  sleep_has_deadline = (timeout_ms >= 0);
+  if (sleep_has_deadline)
+    sleep_deadline_sys = HAL_VTimerAcc_sysT32_ms(now_sys, timeout_ms);
+  /* BlueNRG_Sleep() halts without calling App_SleepMode_Check() when the
+     stack only allows CPU halt */
+  sleep_mode = SLEEPMODE_CPU_HALT;
+}
+
+/**
+  * @brief  End of the sleep, on return from BlueNRG_Sleep().
+  * @param  now_sys: sleep timer now
+  * @param  deadline: non zero if the scheduler virtual timer woke the core
+  * @retval Mode the sleep went to
+  */
+SleepModes SleepMgr_Wake(uint32_t now_sys, uint8_t deadline)
+{
+  SleepMgr_Stats_t *s = &sleep_stats[sleep_mode];
+  int32_t late;
+  uint32_t latency;
+
+  s->entries++;
+  s->sleep_us += SLEEP_MGR_TICKS_US(now_sys - sleep_start_sys);
+
+  if (deadline && sleep_has_deadline) {
+    late = (int32_t)(now_sys - sleep_deadline_sys);
+    latency = (late > 0) ? (uint32_t)SLEEP_MGR_TICKS_US(late) : 0;
+    s->timed++;
+    s->latency_total_us += latency;
+    if (s->timed == 1 || latency < s->latency_min_us)
+      s->latency_min_us = latency;
+    if (latency > s->latency_max_us)
+      s->latency_max_us = latency;
+  }
+  return sleep_mode;
+}
+
+/**
+  * @brief  Restore hooks, newest registration first, if the save hooks ran.
+  *         From the main loop, once the scheduler time is right again.
+  */
+void SleepMgr_Restore(void)
+{
+  uint8_t i;
+
+  if (!sleep_saved)
+    return;
+  sleep_saved = 0;
+  for (i = sleep_periph_count; i-- > 0;) {
+    if (sleep_periphs[i]->restore != NULL)
+      sleep_periphs[i]->restore();
+  }
+}
+
+/**
+  * @brief  One log line per mode entered.
+  */
+void SleepMgr_Report(void)
+{
+  const SleepMgr_Stats_t *s;
+  uint8_t i;
+
+  for (i = 0; i < SLEEP_MGR_MODES; i++) {
+    s = &sleep_stats[i];
+    if (s->entries == 0)
+      continue;
+    /* Two lines: a tokenized PRINTF() takes at most 6 arguments */
+    PRINTF("sleep %s: %u entries, %u ms\r\n", sleep_mode_names[i], (unsigned)s->entries,
+           (unsigned)(s->sleep_us / 1000));
+    PRINTF("sleep %s: wake latency min/avg/max %u/%u/%u us over %u\r\n", sleep_mode_names[i],
+           (unsigned)s->latency_min_us,
+           (unsigned)(s->timed ? s->latency_total_us / s->timed : 0),
+           (unsigned)s->latency_max_us, (unsigned)s->timed);
+  }
+}
+
+const char *SleepMgr_ModeName(SleepModes mode)
+{
+  return ((uint32_t)mode < SLEEP_MGR_MODES) ? sleep_mode_names[mode] : "?";
+}
+
+const SleepMgr_Stats_t *SleepMgr_GetStats(SleepModes mode)
+{
+  return ((uint32_t)mode < SLEEP_MGR_MODES) ? &sleep_stats[mode] : NULL;
+}
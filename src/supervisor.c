@@ -0,0 +1,370 @@
+/**
+  ******************************************************************************
+  * @file    supervisor.c
+  * @brief   Task liveness and run time accounting, watchdog fed by the main
+  *          loop only while every supervised task keeps up.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "scheduler.h"
+#include "log.h"
+#include "crash.h"
+#include "supervisor.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  const char *name;
+  uint8_t  periodic;          /* Deadline from the last check in, else from Sup_TaskPending() */
+  uint32_t deadline_ms;
+  uint32_t budget_us;         /* Longest run allowed */
+} Sup_TaskDef_t;
+
+typedef struct {
+  uint8_t  started;
+  uint8_t  armed;             /* A check in is due by due */
+  uint8_t  running;
+  uint8_t  outer;             /* Task running when this one began (nesting) */
+  tClockTime due;
+  uint32_t begin_sys;         /* Sleep timer at Sup_TaskBegin() */
+} Sup_TaskState_t;
+
+/* Private variables ---------------------------------------------------------*/
+static const Sup_TaskDef_t sup_tasks[SUP_TASK_COUNT] = {
+  /* One pass per radio event or LED toggle at least, Sup_Check() included */
+  { "stack_tick", 1, 1000, 10000 },
+  /* Edges of the LED pattern engine, in the virtual timer interrupt: due
+     when programmed (Sup_TaskExpect()), late this long after */
+  { "led",        0, 100,  2000 },
+  /* Edges are delivered on the next main loop pass */
+  { "button",     0, 100,  2000 },
+  /* One TX FIFO refill each 32 characters, 2.8 ms at 115200 baud */
+  { "log",        0, 100,  500 },
+};
+
+static const char *const sup_miss_names[] = {
+  "none",
+  "late",
+  "overrun",
+  "hung",
+};
+
+static Sup_TaskState_t sup_state[SUP_TASK_COUNT];
+static Sup_TaskStats_t sup_task_stats[SUP_TASK_COUNT];
+static Sup_Stats_t sup_stats = { 0, SUP_TASK_NONE, SUP_MISS_NONE, 0 };
+static volatile uint8_t sup_current = SUP_TASK_NONE;
+static uint8_t sup_started;
+static uint8_t sup_logged;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Time since a sleep timer reading, in us (sysT32 unit 625/256 us).
+  */
+static uint32_t Sup_ElapsedUs(uint32_t since_sys)
+{
+  return (uint32_t)((uint64_t)(HAL_VTimerGetCurrentTime_sysT32() - since_sys) * 625 / 256);
+}
+
+/**
+  * @brief  Keep the first miss: from now on the watchdog is not fed.
+  *         Called with interrupts masked.
+  */
+static void Sup_Latch(uint8_t task, Sup_Miss_t miss, uint32_t value)
+{
+  if (sup_stats.task != SUP_TASK_NONE)
+    return;
+  sup_stats.task = task;
+  sup_stats.miss = miss;
+  sup_stats.value = value;
+}
+
+/**
+  * @brief  No task started, watchdog not armed. Called first thing after
+  *         Boot_Init(), before the modules start their tasks.
+  */
+void Sup_Init(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < SUP_TASK_COUNT; i++) {
+    sup_state[i] = (Sup_TaskState_t){0};
+    sup_task_stats[i] = (Sup_TaskStats_t){0};
+  }
+  sup_stats = (Sup_Stats_t){0};
+  sup_stats.task = SUP_TASK_NONE;
+  sup_current = SUP_TASK_NONE;
+  sup_started = 0;
+  sup_logged = 0;
+}
+
+/**
+  * @brief  Arm the watchdog, interrupt then reset. Once enabled, it cannot
+  *         be stopped before the next reset.
+  */
+void Sup_Start(void)
+{
+  NVIC_InitType NVIC_InitStructure;
+
+  SysCtrl_PeripheralClockCmd(CLOCK_PERIPH_WDG, ENABLE);
+  WDG_SetReload(SUP_WDG_RELOAD);
+  WDG_ITConfig(ENABLE);
+
+  NVIC_InitStructure.NVIC_IRQChannel = WDG_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = CRITICAL_PRIORITY;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  WDG_Enable();
+  sup_started = 1;
+}
+
+/**
+  * @brief  Supervise a task from now on: a periodic one must check in
+  *         within its deadline.
+  */
+void Sup_TaskStart(Sup_Task_t task)
+{
+  uint32_t primask;
+
+  if (task >= SUP_TASK_COUNT)
+    return;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  sup_state[task].started = 1;
+  sup_state[task].running = 0;
+  sup_state[task].armed = sup_tasks[task].periodic;
+  sup_state[task].due = Sched_Now() + sup_tasks[task].deadline_ms;
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Work queued for an on demand task: it must run within its
+  *         deadline. A deadline already running is kept. Safe to call from
+  *         interrupt context.
+  */
+void Sup_TaskPending(Sup_Task_t task)
+{
+  uint32_t primask;
+
+  if (task >= SUP_TASK_COUNT || !sup_state[task].started)
+    return;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if (!sup_state[task].armed) {
+    sup_state[task].due = Sched_Now() + sup_tasks[task].deadline_ms;
+    sup_state[task].armed = 1;
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Next run of an on demand task due in in_ms, late after its
+  *         deadline on top: a timer interrupt programmed now. Replaces a
+  *         deadline already running.
+  */
+void Sup_TaskExpect(Sup_Task_t task, uint32_t in_ms)
+{
+  uint32_t primask;
+
+  if (task >= SUP_TASK_COUNT || !sup_state[task].started)
+    return;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  sup_state[task].due = Sched_Now() + in_ms + sup_tasks[task].deadline_ms;
+  sup_state[task].armed = 1;
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  No work queued for an on demand task any more: nothing is due.
+  */
+void Sup_TaskIdle(Sup_Task_t task)
+{
+  uint32_t primask;
+
+  if (task >= SUP_TASK_COUNT)
+    return;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  sup_state[task].armed = 0;
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Check in, start of the run. An on demand task takes the work
+  *         queued so far: what is posted during the run arms a new deadline.
+  */
+void Sup_TaskBegin(Sup_Task_t task)
+{
+  uint32_t primask;
+
+  if (task >= SUP_TASK_COUNT || !sup_state[task].started)
+    return;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if (!sup_tasks[task].periodic)
+    sup_state[task].armed = 0;
+  sup_state[task].running = 1;
+  sup_state[task].outer = sup_current;
+  sup_current = task;
+  sup_state[task].begin_sys = HAL_VTimerGetCurrentTime_sysT32();
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  End of the run: run time against the budget, next deadline of a
+  *         periodic task.
+  */
+void Sup_TaskEnd(Sup_Task_t task)
+{
+  Sup_TaskStats_t *stats;
+  uint32_t primask;
+  uint32_t run_us;
+
+  if (task >= SUP_TASK_COUNT || !sup_state[task].running)
+    return;
+
+  stats = &sup_task_stats[task];
+  primask = __get_PRIMASK();
+  __disable_irq();
+  run_us = Sup_ElapsedUs(sup_state[task].begin_sys);
+  sup_state[task].running = 0;
+  sup_current = sup_state[task].outer;
+
+  stats->runs++;
+  stats->last_us = run_us;
+  if (run_us > stats->worst_us)
+    stats->worst_us = run_us;
+  stats->last_ms = Sched_Now();
+
+  if (sup_tasks[task].periodic) {
+    sup_state[task].due = stats->last_ms + sup_tasks[task].deadline_ms;
+    sup_state[task].armed = 1;
+  }
+  if (run_us > sup_tasks[task].budget_us)
+    Sup_Latch(task, SUP_MISS_OVERRUN, run_us);
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  The running task stalled the CPU on purpose since the sleep timer
+  *         reading since_sys (flash page erase of the OTA service): that
+  *         time is not counted against its budget.
+  */
+void Sup_TaskStalled(uint32_t since_sys)
+{
+  uint32_t primask;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if (sup_current < SUP_TASK_COUNT)
+    sup_state[sup_current].begin_sys += HAL_VTimerGetCurrentTime_sysT32() - since_sys;
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  End of a main loop pass: feed the watchdog if every task keeps
+  *         up, else log the miss once and let the watchdog expire.
+  */
+void Sup_Check(void)
+{
+  tClockTime now;
+  int32_t late;
+  uint32_t primask;
+  uint8_t i;
+
+  if (!sup_started)
+    return;
+
+  now = Sched_Now();
+  for (i = 0; i < SUP_TASK_COUNT && sup_stats.task == SUP_TASK_NONE; i++) {
+    primask = __get_PRIMASK();
+    __disable_irq();
+    late = (int32_t)(now - sup_state[i].due);
+    if (sup_state[i].armed && late > 0)
+      Sup_Latch(i, SUP_MISS_LATE, (uint32_t)late);
+    __set_PRIMASK(primask);
+  }
+
+  if (sup_stats.task != SUP_TASK_NONE) {
+    if (!sup_logged) {
+      sup_logged = 1;
+      PRINTF("sup: task %s %s, %u %s, watchdog not fed\r\n", Sup_TaskName(sup_stats.task),
+             Sup_MissName(sup_stats.miss), (unsigned)sup_stats.value,
+             sup_stats.miss == SUP_MISS_OVERRUN ? "us" : "ms");
+    }
+    return;
+  }
+
+  WDG_SetReload(SUP_WDG_RELOAD);
+  sup_stats.feeds++;
+}
+
+/**
+  * @brief  Watchdog interrupt body, entered from WDG_Handler() with the
+  *         interrupted exception frame: record the task to blame, then reset.
+  *         The latched miss if any, else the task still running (the main
+  *         loop is stuck in it), else the most overdue one.
+  */
+void Sup_WatchdogIrq(const uint32_t *frame, uint32_t exc_return)
+{
+  uint32_t task = sup_stats.task;
+  uint32_t miss = sup_stats.miss;
+  uint32_t value = sup_stats.value;
+  int32_t late, worst = 0;
+  tClockTime now;
+  uint8_t i;
+
+  __disable_irq();
+  if (task == SUP_TASK_NONE && sup_current != SUP_TASK_NONE) {
+    task = sup_current;
+    miss = SUP_MISS_HUNG;
+    value = Sup_ElapsedUs(sup_state[task].begin_sys) / 1000;
+  } else if (task == SUP_TASK_NONE) {
+    now = Sched_Now();
+    miss = SUP_MISS_NONE;
+    value = 0;
+    for (i = 0; i < SUP_TASK_COUNT; i++) {
+      late = (int32_t)(now - sup_state[i].due);
+      if (sup_state[i].armed && late > worst) {
+        worst = late;
+        task = i;
+        miss = SUP_MISS_LATE;
+        value = (uint32_t)late;
+      }
+    }
+  }
+
+  Crash_Watchdog(frame, exc_return, task, miss, value);
+}
+
+const char *Sup_TaskName(uint32_t task)
+{
+  if (task == SUP_TASK_NONE)
+    return "none";
+  return (task < SUP_TASK_COUNT) ? sup_tasks[task].name : "?";
+}
+
+const char *Sup_MissName(uint32_t miss)
+{
+  return (miss < sizeof(sup_miss_names) / sizeof(sup_miss_names[0])) ? sup_miss_names[miss] : "?";
+}
+
+const Sup_TaskStats_t *Sup_GetTaskStats(Sup_Task_t task)
+{
+  return (task < SUP_TASK_COUNT) ? &sup_task_stats[task] : NULL;
+}
+
+const Sup_Stats_t *Sup_GetStats(void)
+{
+  return &sup_stats;
+}
@@ -0,0 +1,129 @@
+/**
+  ******************************************************************************
+  * @file    trace.c
+  * @brief   Trace buffer shared by the trace backends.
+  *
+  *          Frames are written whole, with interrupts masked, from the main
+  *          loop or from interrupt handlers. Only Trace_Flush(), from the
+  *          main loop, moves trace_tail.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "trace.h"
+
+#ifdef TRACE_ENABLED
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define TRACE_BUF_MASK          (TRACE_BUF_WORDS - 1)
+
+#if (TRACE_BUF_WORDS & TRACE_BUF_MASK) != 0 || TRACE_BUF_WORDS > 32768
+#error "TRACE_BUF_WORDS must be a power of 2, at most 32768"
+#endif
+
+/* Private macro -------------------------------------------------------------*/
+#define TRACE_USED()            ((uint16_t)(trace_head - trace_tail))
+#define TRACE_FREE()            ((uint16_t)(TRACE_BUF_WORDS - TRACE_USED()))
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t trace_buf[TRACE_BUF_WORDS];
+static volatile uint16_t trace_head;
+static volatile uint16_t trace_tail;
+static uint32_t trace_lost;
+static Trace_Stats_t trace_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Copy a frame to the buffer. Interrupts must be masked.
+  * @retval 1 if written, 0 if the buffer is full
+  */
+static uint8_t Trace_Put(uint16_t id, const uint32_t *data, uint8_t n)
+{
+  uint16_t head = trace_head;
+  uint8_t i;
+
+  if (TRACE_FREE() < 2 + n)
+    return 0;
+
+  trace_buf[head++ & TRACE_BUF_MASK] = TRACE_HEADER(id, n);
+  trace_buf[head++ & TRACE_BUF_MASK] = HAL_VTimerGetCurrentTime_sysT32();
+  for (i = 0; i < n; i++)
+    trace_buf[head++ & TRACE_BUF_MASK] = data[i];
+  trace_head = head;
+
+  trace_stats.frames++;
+  if (TRACE_USED() > trace_stats.high_water)
+    trace_stats.high_water = TRACE_USED();
+  return 1;
+}
+
+void Trace_Init(void)
+{
+  trace_head = 0;
+  trace_tail = 0;
+  trace_lost = 0;
+  trace_stats = (Trace_Stats_t){0};
+  Trace_BackendInit();
+}
+
+/**
+  * @brief  Timestamp and buffer a trace point (n = 0) or a record.
+  *         Safe to call from interrupt context.
+  * @param  id: Trace_Point_t or Trace_Record_t
+  * @param  data: n words of data
+  * @param  n: at most TRACE_MAX_DATA
+  */
+void Trace_Write(uint16_t id, const uint32_t *data, uint8_t n)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  if (n > TRACE_MAX_DATA)
+    n = TRACE_MAX_DATA;
+
+  __disable_irq();
+  /* The count of lost frames goes first, as soon as it fits */
+  if (trace_lost != 0 && TRACE_FREE() >= 3 + 2 + n && Trace_Put(TRACE_REC_LOST, &trace_lost, 1))
+    trace_lost = 0;
+  if (trace_lost != 0 || !Trace_Put(id, data, n)) {
+    trace_lost++;
+    trace_stats.dropped++;
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Hand the buffered words to the backend, as far as it accepts
+  *         them. Main loop only.
+  */
+void Trace_Flush(void)
+{
+  uint16_t tail = trace_tail;
+  uint16_t head = trace_head;
+  uint16_t n, sent;
+
+  while (tail != head) {
+    /* Contiguous part of the buffer */
+    n = (uint16_t)(head - tail);
+    if (n > TRACE_BUF_WORDS - (tail & TRACE_BUF_MASK))
+      n = TRACE_BUF_WORDS - (tail & TRACE_BUF_MASK);
+
+    sent = Trace_BackendWrite(&trace_buf[tail & TRACE_BUF_MASK], n);
+    tail += sent;
+    trace_stats.words_sent += sent;
+    if (sent < n)
+      break;
+  }
+  trace_tail = tail;
+}
+
+const Trace_Stats_t *Trace_GetStats(void)
+{
+  return &trace_stats;
+}
+
+#endif /* TRACE_ENABLED */
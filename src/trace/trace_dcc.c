@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file    trace_dcc.c
+  * @brief   Trace backend over the debug channel (make TRACE=dcc), with the
+  *          libdcc of OpenOCD: the words are written to the DCRDR register,
+  *          which the debugger reads over SWD. Nothing goes out on the UART.
+  *
+  *          In OpenOCD:  target_request debugmsgs enable
+  *          and run with -l <file>: each Trace_Flush() gives lines of hex
+  *          bytes that tools/trace_decode.py reads. The frames are sent with
+  *          dbg_write_u8() (4 bytes per DCC word, as dbg_write_u32()).
+  *
+  *          dbg_write() waits for the debugger to take each byte. Nothing is
+  *          sent while no debugger is connected (C_DEBUGEN clear), or when the
+  *          debugger has not taken the previous byte within
+  *          TRACE_DCC_TIMEOUT_MS (debug messages not enabled in OpenOCD):
+  *          the words stay in the trace buffer.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "BlueNRG1_conf.h"
+#include "bluenrg1_stack.h"
+#include "dcc_stdio.h"
+#include "trace.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Debug Halting Control and Status Register, and the DCC register of libdcc */
+#define TRACE_DHCSR             (*(volatile uint32_t *)0xE000EDF0)
+#define TRACE_DCRDR             (*(volatile uint16_t *)0xE000EDF8)
+#define TRACE_DHCSR_C_DEBUGEN   0x00000001
+#define TRACE_DCRDR_BUSY        0x0001
+
+/* Trace words per libdcc message */
+#define TRACE_DCC_CHUNK         32
+
+/* OpenOCD polls the target every few ms */
+#define TRACE_DCC_TIMEOUT_MS    10
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Wait for the debugger to take the last byte written.
+  * @retval 0 if no debugger is reading the channel
+  */
+static uint8_t Trace_DccReady(void)
+{
+  uint32_t start;
+
+  if (!(TRACE_DHCSR & TRACE_DHCSR_C_DEBUGEN))
+    return 0;
+
+  start = HAL_VTimerGetCurrentTime_sysT32();
+  while (TRACE_DCRDR & TRACE_DCRDR_BUSY) {
+    if (HAL_VTimerDiff_ms_sysT32(HAL_VTimerGetCurrentTime_sysT32(), start) >= TRACE_DCC_TIMEOUT_MS)
+      return 0;
+  }
+  return 1;
+}
+
+void Trace_BackendInit(void)
+{
+}
+
+/**
+  * @brief  Send words to the debugger.
+  * @retval Number of words sent, 0 if no debugger reads the channel
+  */
+uint16_t Trace_BackendWrite(const uint32_t *words, uint16_t n)
+{
+  uint16_t sent = 0;
+  uint16_t chunk;
+
+  while (sent < n) {
+    if (!Trace_DccReady())
+      break;
+    chunk = (n - sent > TRACE_DCC_CHUNK) ? TRACE_DCC_CHUNK : n - sent;
+    dbg_write_u8((const unsigned char *)&words[sent], chunk * sizeof(uint32_t));
+    sent += chunk;
+  }
+  return sent;
+}
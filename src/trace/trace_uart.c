@@ -0,0 +1,36 @@
+/**
+  ******************************************************************************
+  * @file    trace_uart.c
+  * @brief   Trace backend over the UART (make TRACE=uart): the frames go to
+  *          the log ring, interleaved with the text. tools/trace_decode.py
+  *          --raw finds them by their header (TRACE_MAGIC is not ASCII); a
+  *          frame cut by PRINTF() output is skipped.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "BlueNRG1_conf.h"
+#include "log.h"
+#include "trace.h"
+
+/* Private functions ---------------------------------------------------------*/
+
+void Trace_BackendInit(void)
+{
+}
+
+/**
+  * @brief  Queue as many words as the log ring can take now, the rest waits
+  *         in the trace buffer.
+  * @retval Number of words queued
+  */
+uint16_t Trace_BackendWrite(const uint32_t *words, uint16_t n)
+{
+  uint16_t room = Log_Room() / sizeof(uint32_t);
+
+  if (n > room)
+    n = room;
+  if (n == 0 || !Log_Write((const uint8_t *)words, n * sizeof(uint32_t)))
+    return 0;
+  return n;
+}
@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+"""Symbolizer of the crash records reported at boot (src/crash.c).
+
+Reads the "crash <n>: ..." lines of a log (text, or the output of
+log_decode.py for a tokenized build), and prints each crash with PC and LR
+resolved to function+offset from the symbol table of the ELF file the
+firmware was built with, and to file:line with addr2line when it is found
+(arm-none-eabi-addr2line for an ARM ELF). A watchdog record also names the
+supervised task that missed (src/supervisor.c).
+
+Usage:
+    crash_decode.py bin/BLE_Beacon.elf uart.log
+    log_decode.py bin/BLE_Beacon.elf capture.bin | crash_decode.py bin/BLE_Beacon.elf
+
+--expect SYMBOL exits with 1 unless a crash PC is in SYMBOL (CI check).
+"""
+
+import argparse
+import re
+import shutil
+import struct
+import subprocess
+import sys
+
+SHT_SYMTAB = 2
+STT_FUNC = 2
+EM_ARM = 40
+
+CRASH_LINE = re.compile(r"crash (\d+): (.*)")
+REGISTER = re.compile(r"\b(r0|r1|r2|r3|r12|pc|lr|sp|xpsr|exc_return|hw_error) 0x([0-9a-fA-F]+)")
+CAUSE = re.compile(r"^([a-z][a-z ]*), pc ")
+UPTIME = re.compile(r"(\d+) ms after boot")
+TASK = re.compile(r"^task (\w+) (late|overrun|hung), (\d+) (us|ms)")
+
+EXC_RETURN = {
+    0xFFFFFFF1: "handler mode, MSP",
+    0xFFFFFFF9: "thread mode, MSP",
+    0xFFFFFFFD: "thread mode, PSP",
+}
+EXCEPTIONS = {0: "thread mode", 2: "NMI", 3: "HardFault", 11: "SVCall", 14: "PendSV", 15: "SysTick"}
+HW_ERRORS = {1: "radio state error", 2: "timer overrun error", 3: "internal queue overflow error"}
+MISSES = {
+    "late": "missed its deadline by",
+    "overrun": "ran over its budget:",
+    "hung": "still running at the watchdog interrupt, for",
+}
+
+
+class ElfError(Exception):
+    pass
+
+
+def elf_functions(path):
+    """Return (machine, [(start, end, name)]) of the functions of an ELF file,
+    sorted, Thumb bit cleared."""
+    with open(path, "rb") as f:
+        image = f.read()
+    if image[:4] != b"\x7fELF" or image[5] != 1:
+        raise ElfError("%s: not a little endian ELF file" % path)
+    is64 = image[4] == 2
+    machine, = struct.unpack_from("<H", image, 0x12)
+    if is64:
+        shoff, = struct.unpack_from("<Q", image, 0x28)
+        shentsize, shnum = struct.unpack_from("<HH", image, 0x3A)
+        header, sym, symsize = "<IIQQQQIIQQ", "<IBBHQQ", 24
+    else:
+        shoff, = struct.unpack_from("<I", image, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", image, 0x2E)
+        header, sym, symsize = "<IIIIIIIIII", "<IIIBBH", 16
+    raw = [struct.unpack_from(header, image, shoff + i * shentsize) for i in range(shnum)]
+
+    funcs = []
+    for _, stype, _, _, offset, size, link, _, _, _ in raw:
+        if stype != SHT_SYMTAB:
+            continue
+        strtab = image[raw[link][4]:raw[link][4] + raw[link][5]]
+        for off in range(offset, offset + size, symsize):
+            if is64:
+                name, info, _, _, value, ssize = struct.unpack_from(sym, image, off)
+            else:
+                name, value, ssize, info, _, _ = struct.unpack_from(sym, image, off)
+            if info & 0xF != STT_FUNC or value == 0:
+                continue
+            start = value & ~1
+            funcs.append((start, start + max(ssize, 1),
+                          strtab[name:strtab.index(b"\0", name)].decode(errors="replace")))
+    if not funcs:
+        raise ElfError("%s: no function symbols (stripped?)" % path)
+    return machine, sorted(funcs)
+
+
+def symbolize(funcs, addr):
+    """function+offset of addr, None if outside every function."""
+    for start, end, name in funcs:
+        if start <= addr < end:
+            return name, addr - start
+    return None
+
+
+def addr2line_tool(machine, override):
+    if override:
+        return override if override != "none" else None
+    return shutil.which("arm-none-eabi-addr2line" if machine == EM_ARM else "addr2line")
+
+
+def source_lines(tool, elf, addrs):
+    """{addr: "file:line"} from addr2line, empty without the tool."""
+    if tool is None or not addrs:
+        return {}
+    try:
+        out = subprocess.run([tool, "-e", elf] + ["0x%x" % a for a in addrs],
+                             stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                             universal_newlines=True, check=True).stdout.split("\n")
+    except (OSError, subprocess.CalledProcessError):
+        return {}
+    return {a: line for a, line in zip(addrs, out) if line and not line.startswith("??")}
+
+
+def parse_log(stream):
+    """Crash records of the log, by crash number, in order of appearance."""
+    crashes = {}
+    for line in stream:
+        m = CRASH_LINE.search(line)
+        if not m:
+            continue
+        rec = crashes.setdefault(int(m.group(1)), {})
+        body = m.group(2)
+        cause, uptime, task = CAUSE.search(body), UPTIME.search(body), TASK.search(body)
+        if cause:
+            rec["cause"] = cause.group(1)
+        if uptime:
+            rec["uptime"] = int(uptime.group(1))
+        if task:
+            rec["task"] = (task.group(1), task.group(2), int(task.group(3)), task.group(4))
+        for reg, value in REGISTER.findall(body):
+            rec[reg] = int(value, 16)
+    return crashes
+
+
+def describe(num, rec, funcs, lines, out):
+    """Print one crash, return the function of its PC (None if unknown)."""
+    out.write("crash %d: %s, %s ms after boot\n"
+              % (num, rec.get("cause", "?"), rec.get("uptime", "?")))
+    pc_func = None
+    for reg, label in (("pc", "at"), ("lr", "called from")):
+        value = rec.get(reg)
+        if value is None or value == 0:
+            continue
+        if value in EXC_RETURN or value >= 0xFFFFFFF0:
+            out.write("  %-3s 0x%08x  exception return (%s)\n"
+                      % (reg, value, EXC_RETURN.get(value, "invalid")))
+            continue
+        addr = value & ~1
+        if reg == "lr":
+            addr -= 1              # inside the call instruction
+        sym = symbolize(funcs, addr)
+        where = "%s+0x%x" % (sym[0], sym[1] + (value & ~1) - addr) if sym else "?"
+        if reg == "pc" and sym:
+            pc_func = sym[0]
+        source = lines.get(addr)
+        out.write("  %-3s 0x%08x  %-8s %s%s\n" % (reg, value, label, where,
+                                                 "  (%s)" % source if source else ""))
+
+    if "xpsr" in rec and rec.get("cause") != "hardware error":
+        ipsr = rec["xpsr"] & 0x3F
+        active = EXCEPTIONS.get(ipsr, "IRQ %d" % (ipsr - 16) if ipsr >= 16 else "exception %d" % ipsr)
+        out.write("  xpsr 0x%08x  %s %s%s\n"
+                  % (rec["xpsr"], "interrupted in" if rec.get("cause") == "watchdog" else "fault in", active,
+                     "" if rec["xpsr"] & (1 << 24) else ", T bit clear: call through a bad pointer"))
+    if "exc_return" in rec and rec["exc_return"] in EXC_RETURN:
+        out.write("  exc_return 0x%08x  %s\n" % (rec["exc_return"], EXC_RETURN[rec["exc_return"]]))
+    if rec.get("hw_error"):
+        out.write("  hw_error 0x%02x  %s\n"
+                  % (rec["hw_error"], HW_ERRORS.get(rec["hw_error"], "unknown code")))
+    if "task" in rec:
+        name, miss, value, unit = rec["task"]
+        out.write("  task %s %s %d %s\n" % (name, MISSES[miss], value, unit))
+    if "sp" in rec:
+        out.write("  sp  0x%08x\n" % rec["sp"])
+    regs = ["%s 0x%08x" % (r, rec[r]) for r in ("r0", "r1", "r2", "r3", "r12") if r in rec]
+    if regs and rec.get("cause") != "hardware error":
+        out.write("  %s\n" % "  ".join(regs))
+    return pc_func
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("elf", help="ELF file of the firmware (bin/$(PROJECT).elf)")
+    parser.add_argument("log", nargs="?", default="-", help="log text, - for stdin")
+    parser.add_argument("--addr2line", help="addr2line program, 'none' to skip source lines")
+    parser.add_argument("--expect", metavar="SYMBOL", help="exit with 1 unless a crash PC is in SYMBOL")
+    args = parser.parse_args()
+
+    try:
+        machine, funcs = elf_functions(args.elf)
+    except (OSError, ElfError) as e:
+        sys.exit("crash_decode: %s" % e)
+
+    stream = sys.stdin if args.log == "-" else open(args.log, errors="replace")
+    with stream:
+        crashes = parse_log(stream)
+    if not crashes:
+        print("no crash record in the log")
+        sys.exit(1 if args.expect else 0)
+
+    addrs = []
+    for rec in crashes.values():
+        if rec.get("pc"):
+            addrs.append(rec["pc"] & ~1)
+        if rec.get("lr") and rec["lr"] < 0xFFFFFFF0:
+            addrs.append((rec["lr"] & ~1) - 1)
+    lines = source_lines(addr2line_tool(machine, args.addr2line), args.elf, addrs)
+
+    pc_funcs = [describe(num, rec, funcs, lines, sys.stdout) for num, rec in crashes.items()]
+    if args.expect and args.expect not in pc_funcs:
+        sys.exit("crash_decode: no crash PC in %s" % args.expect)
+
+
+if __name__ == "__main__":
+    main()
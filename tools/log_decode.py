@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+"""Decoder of the tokenized log stream (LOG_MODE=tokenized, see inc/log.h).
+
+The format strings are read from the .log_fmt section of the ELF file the
+firmware was built with; each frame of the stream is rebuilt as text:
+
+    id (2 bytes, little endian) | payload length (1 byte) | payload
+
+Integer arguments are unsigned LEB128, strings a length byte and the
+characters.
+
+Usage:
+    log_decode.py bin/BLE_Beacon.elf capture.bin
+    stty -F /dev/ttyUSB0 115200 raw && log_decode.py bin/BLE_Beacon.elf /dev/ttyUSB0
+    log_decode.py --stats --text-elf text.elf bin/BLE_Beacon.elf capture.bin
+
+--stats prints the log bandwidth saved against the text output, and the
+size of the format strings kept out of flash. With --text-elf (the same
+firmware built with LOG_MODE=text), the flash image sizes are compared.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+LOG_TOKEN_LOST = 0xFFFF
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+# printf conversion: flags, width, precision, length modifier, conversion
+FORMAT_SPEC = re.compile(r"%([-+ #0]*)(\d*|\*)(?:\.(\d+))?(hh|h|ll|l|j|z|t|L)?([diouxXcspeEfgG%])")
+
+
+class ElfError(Exception):
+    pass
+
+
+def elf_sections(path):
+    """Return {name: (flags, type, data)} of the sections of an ELF file."""
+    with open(path, "rb") as f:
+        image = f.read()
+    if image[:4] != b"\x7fELF":
+        raise ElfError("%s: not an ELF file" % path)
+    is64 = image[4] == 2
+    if image[5] != 1:
+        raise ElfError("%s: big endian ELF not supported" % path)
+
+    if is64:
+        shoff, = struct.unpack_from("<Q", image, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", image, 0x3A)
+        header = "<IIQQQQIIQQ"
+    else:
+        shoff, = struct.unpack_from("<I", image, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", image, 0x2E)
+        header = "<IIIIIIIIII"
+
+    raw = []
+    for i in range(shnum):
+        name, stype, flags, _addr, offset, size = struct.unpack_from(header, image, shoff + i * shentsize)[:6]
+        raw.append((name, stype, flags, offset, size))
+
+    strtab = raw[shstrndx]
+    names = image[strtab[3]:strtab[3] + strtab[4]]
+    sections = {}
+    for name, stype, flags, offset, size in raw:
+        sname = names[name:names.index(b"\0", name)].decode()
+        data = b"" if stype == SHT_NOBITS else image[offset:offset + size]
+        sections[sname] = (flags, stype, size, data)
+    return sections
+
+
+def flash_size(sections):
+    """Bytes of the loaded image: allocated sections with contents."""
+    return sum(size for flags, stype, size, _ in sections.values()
+               if flags & SHF_ALLOC and stype != SHT_NOBITS)
+
+
+def format_table(sections):
+    """Return {token: format string} from the .log_fmt section."""
+    if ".log_fmt" not in sections:
+        raise ElfError("no .log_fmt section: was the firmware built with LOG_MODE=tokenized?")
+    data = sections[".log_fmt"][3]
+    table = {}
+    start = None
+    for i, c in enumerate(data):
+        if c == 0:
+            if start is not None:
+                table[start] = data[start:i].decode("latin-1")
+            start = None
+        elif start is None:
+            start = i
+    return table
+
+
+def varint(payload, pos):
+    value = shift = 0
+    while True:
+        if pos >= len(payload):
+            raise IndexError
+        byte = payload[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            return value, pos
+
+
+def signed(value):
+    """Sign of an integer sent as the raw 32 or 64-bit value."""
+    if value < (1 << 32):
+        return value - (1 << 32) if value & (1 << 31) else value
+    return value - (1 << 64) if value & (1 << 63) else value
+
+
+def render(fmt, payload):
+    """printf() on the host, the arguments coming from the payload."""
+    pos = 0
+    out = []
+    last = 0
+    for m in FORMAT_SPEC.finditer(fmt):
+        out.append(fmt[last:m.start()])
+        last = m.end()
+        flags, width, precision, _length, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        spec = "%" + flags + width + ("." + precision if precision else "")
+        try:
+            if conv == "s":
+                n = payload[pos]
+                text = payload[pos + 1:pos + 1 + n].decode("latin-1")
+                pos += 1 + n
+                out.append((spec + "s") % text)
+                continue
+            value, pos = varint(payload, pos)
+        except IndexError:
+            out.append("<?>")
+            continue
+        if conv in "di":
+            out.append((spec + "d") % signed(value))
+        elif conv == "u":
+            out.append((spec + "d") % value)
+        elif conv == "c":
+            out.append((spec + "c") % chr(value & 0xFF))
+        elif conv == "p":
+            out.append((spec + "s") % ("0x%08x" % value))
+        elif conv in "eEfgG":
+            out.append((spec + conv) % struct.unpack("<d", struct.pack("<Q", value))[0])
+        else:
+            out.append((spec + conv) % value)
+    out.append(fmt[last:])
+    return "".join(out)
+
+
+def decode(table, stream, out, stats):
+    pending = b""
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            break
+        pending += chunk
+        while len(pending) >= 3 and len(pending) >= 3 + pending[2]:
+            token = pending[0] | pending[1] << 8
+            payload = pending[3:3 + pending[2]]
+            pending = pending[3 + pending[2]:]
+            if token == LOG_TOKEN_LOST:
+                text = "<%d lost>\r\n" % varint(payload, 0)[0]
+            elif token in table:
+                text = render(table[token], payload)
+            else:
+                text = "<unknown token 0x%04x, %d bytes>\n" % (token, len(payload))
+            out.write(text.replace("\r\n", "\n"))
+            out.flush()
+            stats["frames"] += 1
+            stats["stream"] += 3 + len(payload)
+            stats["text"] += len(text)
+    stats["trailing"] = len(pending)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("elf", help="ELF file of the firmware (bin/$(PROJECT).elf)")
+    parser.add_argument("capture", nargs="?", default="-",
+                        help="tokenized stream: file or serial device, - for stdin")
+    parser.add_argument("--stats", action="store_true", help="print bandwidth and flash savings")
+    parser.add_argument("--text-elf", help="same firmware built with LOG_MODE=text, for --stats")
+    args = parser.parse_args()
+
+    try:
+        sections = elf_sections(args.elf)
+        table = format_table(sections)
+        text_sections = elf_sections(args.text_elf) if args.text_elf else None
+    except (OSError, ElfError) as e:
+        sys.exit("log_decode: %s" % e)
+
+    stats = {"frames": 0, "stream": 0, "text": 0, "trailing": 0}
+    stream = sys.stdin.buffer if args.capture == "-" else open(args.capture, "rb", buffering=0)
+    try:
+        decode(table, stream, sys.stdout, stats)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if stream is not sys.stdin.buffer:
+            stream.close()
+
+    if not args.stats:
+        return
+    err = sys.stderr
+    err.write("\nformat strings     : %d, %d bytes kept out of flash\n"
+              % (len(table), sum(len(s) + 1 for s in table.values())))
+    if text_sections is not None:
+        tok, txt = flash_size(sections), flash_size(text_sections)
+        err.write("flash image        : %d bytes tokenized, %d bytes text, %d bytes saved\n"
+                  % (tok, txt, txt - tok))
+    if stats["frames"]:
+        err.write("log frames         : %d\n" % stats["frames"])
+        err.write("log bandwidth      : %d bytes tokenized, %d bytes as text, %.1f%% saved\n"
+                  % (stats["stream"], stats["text"], 100.0 * (1 - stats["stream"] / stats["text"])))
+    if stats["trailing"]:
+        err.write("incomplete frame   : %d bytes at the end of the stream\n" % stats["trailing"])
+
+
+if __name__ == "__main__":
+    main()
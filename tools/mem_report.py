@@ -0,0 +1,762 @@
+#!/usr/bin/env python3
+"""Memory budget report of the firmware, checked after each build.
+
+Reads what the build already produces:
+
+  - the linker map (BLE_Beacon.map): RAM and flash of each module, free RAM
+    between the static data and the stack reserved by _Min_Stack_Size;
+  - the -fstack-usage files (obj/*.su) and the ELF file: frame of each
+    function and call graph (Thumb BL/B decoded from the ELF, calls through
+    function pointers from tools/stack_calls.txt), worst-case stack depth of
+    main() plus the interrupt handlers of the vector table;
+  - inc/Beacon_config.h, compiled with the host compiler: RAM taken in
+    dyn_alloc_a by each parameter of TOTAL_BUFFER_SIZE(), and how far each
+    one can grow before the free RAM budget is used up;
+  - the ELF file again: the functions placed in RAM by RAMFUNC
+    (inc/ramfunc.h), each one taking its size in RAM and in flash, and the
+    long branch veneers between RAM and flash code, next to the cycles the
+    profiler (make CYCLE_PROF=1) measured on the device for them, from a
+    log with its dump (--prof).
+
+Usage:
+    mem_report.py --map BLE_Beacon.map --su obj --elf bin/BLE_Beacon.elf
+    mem_report.py --map BLE_Beacon.map --ram-free-min 512 --stack-margin 256
+    mem_report.py --map BLE_Beacon.map --elf bin/BLE_Beacon.elf --prof uart.log
+
+Exit code 1 if a budget is exceeded: free RAM under --ram-free-min, free
+flash under --flash-free-min, or worst-case stack depth over _Min_Stack_Size
+minus --stack-margin.
+"""
+
+import argparse
+import glob
+import os
+import re
+import struct
+import subprocess
+import sys
+import tempfile
+
+SHT_SYMTAB = 2
+SHT_NOBITS = 8
+SHF_EXECINSTR = 0x4
+STT_FUNC = 2
+
+# Hardware stacking of an exception on the Cortex-M0 (8 words), plus the
+# alignment word
+EXC_FRAME = 36
+
+MAP_REGION = re.compile(r"^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+MAP_SYMBOL = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+(\w+) = ")
+MAP_OUTPUT = re.compile(r"^(\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(?:\s+load address 0x([0-9a-fA-F]+))?)?\s*$")
+MAP_INPUT = re.compile(r"^ (\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+?))?\s*$")
+MAP_INPUT_CONT = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+?)\s*$")
+
+# Long branch stub of the linker, named after its target
+VENEER = re.compile(r"^__(\w+)_veneer$")
+
+# Profiler dump line of a site (src/prof.c)
+PROF_SUMMARY = re.compile(r"prof (\w+): (\d+) runs, min (\d+) max (\d+) avg (\d+) cycles")
+
+# Profiler site timing each RAM function, entry to exit
+RAMFUNC_SITES = {"Blue_Handler": "blue_isr", "SysTick_Handler": "systick"}
+
+class ReportError(Exception):
+    pass
+
+
+# --------------------------------------------------------------------------
+# Linker map
+# --------------------------------------------------------------------------
+
+def module_name(path):
+    """Module of an input section: object file, or archive for libraries."""
+    path = path.replace("\\", "/")
+    m = re.match(r"(.*)\((.*)\)$", path)
+    if m:
+        return os.path.basename(m.group(1))
+    return os.path.basename(path)
+
+
+def parse_map(path):
+    """Return (regions, symbols, outputs) of a GNU ld map file.
+
+    regions: {name: (origin, length)}
+    symbols: {name: value} of the linker script assignments
+    outputs: list of {name, addr, size, load, inputs: [(module, size)]}
+    """
+    with open(path, errors="replace") as f:
+        lines = f.read().splitlines()
+
+    regions, symbols, outputs = {}, {}, []
+    state = None
+    pending_out = pending_in = None
+    out = None
+    for line in lines:
+        if line.startswith("Memory Configuration"):
+            state = "regions"
+            continue
+        if line.startswith("Linker script and memory map"):
+            state = "map"
+            continue
+        if line.startswith("Cross Reference Table"):
+            break
+        if state == "regions":
+            m = MAP_REGION.match(line)
+            if m and m.group(1) not in ("Name", "*default*"):
+                regions[m.group(1)] = (int(m.group(2), 16), int(m.group(3), 16))
+            continue
+        if state != "map":
+            continue
+
+        m = MAP_SYMBOL.match(line)
+        if m:
+            symbols[m.group(2)] = int(m.group(1), 16)
+            continue
+
+        if pending_out is not None:
+            m = re.match(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(?:\s+load address 0x([0-9a-fA-F]+))?", line)
+            if m:
+                out = {"name": pending_out, "addr": int(m.group(1), 16), "size": int(m.group(2), 16),
+                       "load": int(m.group(3), 16) if m.group(3) else None, "inputs": []}
+                outputs.append(out)
+            pending_out = None
+            continue
+        if pending_in is not None:
+            m = MAP_INPUT_CONT.match(line)
+            if m and out is not None:
+                out["inputs"].append((module_name(m.group(3)), int(m.group(2), 16)))
+            pending_in = None
+            continue
+
+        if line and not line[0].isspace():
+            if line.startswith("/DISCARD/") or line.startswith("LOAD ") or \
+               line.startswith("START GROUP") or line.startswith("END GROUP") or \
+               line.startswith("OUTPUT("):
+                out = None
+                continue
+            m = MAP_OUTPUT.match(line)
+            if not m:
+                continue
+            if m.group(2) is None:
+                pending_out = m.group(1)
+                continue
+            out = {"name": m.group(1), "addr": int(m.group(2), 16), "size": int(m.group(3), 16),
+                   "load": int(m.group(4), 16) if m.group(4) else None, "inputs": []}
+            outputs.append(out)
+            continue
+
+        if out is None or line.startswith(" *(") or line.startswith(" *fill*"):
+            continue
+        m = MAP_INPUT.match(line)
+        if not m or m.group(1).startswith("*"):
+            continue
+        if m.group(2) is None:
+            pending_in = m.group(1)
+            continue
+        if m.group(4) == "linker stubs":
+            continue
+        out["inputs"].append((module_name(m.group(4)), int(m.group(3), 16)))
+
+    if not regions or not outputs:
+        raise ReportError("%s: not a GNU ld map file" % path)
+    return regions, symbols, outputs
+
+
+def region_of(regions, addr, size):
+    for name, (origin, length) in regions.items():
+        if length and origin <= addr and addr + max(size, 1) <= origin + length:
+            return name
+    return None
+
+
+def memory_usage(regions, symbols, outputs):
+    """RAM and flash use of the sections and modules."""
+    ram_region = next((r for r in regions if "RAM" in r), None)
+    flash_region = next((r for r in regions if r.endswith("FLASH")), None)
+    if ram_region is None or flash_region is None:
+        raise ReportError("no RAM or FLASH region in the map")
+
+    modules = {}
+    usage = {"ram_end": regions[ram_region][0], "flash_end": regions[flash_region][0],
+             "stack_start": None, "nvm": 0}
+
+    def add(module, key, size):
+        entry = modules.setdefault(module, {"code": 0, "data": 0, "bss": 0})
+        entry[key] += size
+
+    for out in outputs:
+        name, addr, size = out["name"], out["addr"], out["size"]
+        if name == "CSTACK":
+            usage["stack_start"] = addr
+            continue
+        region = region_of(regions, addr, size)
+        if region is None or size == 0:
+            continue
+        if region == ram_region:
+            usage["ram_end"] = max(usage["ram_end"], addr + size)
+            # Initialized data also has its copy in flash
+            initialized = out["load"] is not None and "noinit" not in name and "bss" not in name
+            if initialized:
+                usage["flash_end"] = max(usage["flash_end"], out["load"] + size)
+            for module, isize in out["inputs"]:
+                add(module, "data" if initialized else "bss", isize)
+        elif region == flash_region:
+            usage["flash_end"] = max(usage["flash_end"], addr + size)
+            for module, isize in out["inputs"]:
+                add(module, "code", isize)
+        else:
+            usage["nvm"] += size
+
+    ram_origin, ram_length = regions[ram_region]
+    flash_origin, flash_length = regions[flash_region]
+    stack_size = symbols.get("_Min_Stack_Size", 0)
+    if usage["stack_start"] is None:
+        usage["stack_start"] = ram_origin + ram_length - stack_size
+    usage.update({
+        "ram_size": ram_length, "ram_used": usage["ram_end"] - ram_origin,
+        "ram_free": usage["stack_start"] - usage["ram_end"], "stack_size": stack_size,
+        "flash_size": flash_length, "flash_used": usage["flash_end"] - flash_origin,
+    })
+    usage["flash_free"] = flash_length - usage["flash_used"]
+    return usage, modules
+
+
+def report_memory(usage, modules, out, top):
+    out.write("RAM   : %6d of %6d bytes static, %5d bytes stack (_Min_Stack_Size), %6d free\n"
+              % (usage["ram_used"], usage["ram_size"], usage["stack_size"], usage["ram_free"]))
+    out.write("flash : %6d of %6d bytes, %6d free (%d bytes reserved for the stack NVM)\n\n"
+              % (usage["flash_used"], usage["flash_size"], usage["flash_free"], usage["nvm"]))
+
+    out.write("%-28s %8s %8s %8s %8s %8s\n" % ("module", "code", "data", "bss", "flash", "RAM"))
+    rows = sorted(modules.items(), key=lambda kv: -(kv[1]["code"] + 2 * (kv[1]["data"] + kv[1]["bss"])))
+    for name, m in rows[:top]:
+        out.write("%-28s %8d %8d %8d %8d %8d\n" % (name[:28], m["code"], m["data"], m["bss"],
+                                                   m["code"] + m["data"], m["data"] + m["bss"]))
+    if len(rows) > top:
+        rest = [m for _, m in rows[top:]]
+        out.write("%-28s %8d %8d %8d %8d %8d\n" % ("(%d others)" % len(rest),
+                  sum(m["code"] for m in rest), sum(m["data"] for m in rest),
+                  sum(m["bss"] for m in rest), sum(m["code"] + m["data"] for m in rest),
+                  sum(m["data"] + m["bss"] for m in rest)))
+
+
+# --------------------------------------------------------------------------
+# Stack usage
+# --------------------------------------------------------------------------
+
+def parse_su(directory):
+    """Return {function: (bytes, qualifiers)} of the .su files of a directory.
+
+    Static functions with the same name in two files keep the largest frame.
+    """
+    frames = {}
+    for path in sorted(glob.glob(os.path.join(directory, "*.su"))):
+        with open(path, errors="replace") as f:
+            for line in f:
+                fields = line.rstrip("\n").split("\t")
+                if len(fields) < 3:
+                    continue
+                func = fields[0].rsplit(":", 1)[-1]
+                size = int(fields[1])
+                if func not in frames or frames[func][0] < size:
+                    frames[func] = (size, fields[2])
+    return frames
+
+
+def elf_read(path):
+    """Return (sections, symbols) of a 32-bit little endian ELF file.
+
+    sections: list of (name, addr, flags, type, data)
+    symbols: list of (name, value, size, type, section index)
+    """
+    with open(path, "rb") as f:
+        image = f.read()
+    if image[:4] != b"\x7fELF" or image[4] != 1 or image[5] != 1:
+        raise ReportError("%s: not a 32-bit little endian ELF file" % path)
+
+    shoff, = struct.unpack_from("<I", image, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", image, 0x2E)
+    raw = [struct.unpack_from("<IIIIIIIIII", image, shoff + i * shentsize) for i in range(shnum)]
+    names = image[raw[shstrndx][4]:raw[shstrndx][4] + raw[shstrndx][5]]
+
+    def cstr(table, off):
+        return table[off:table.index(b"\0", off)].decode(errors="replace")
+
+    sections = []
+    for name, stype, flags, addr, offset, size, _, _, _, _ in raw:
+        data = b"" if stype == SHT_NOBITS else image[offset:offset + size]
+        sections.append((cstr(names, name), addr, flags, stype, data))
+
+    symbols = []
+    for i, (_, stype, _, _, offset, size, link, _, _, entsize) in enumerate(raw):
+        if stype != SHT_SYMTAB:
+            continue
+        strtab = image[raw[link][4]:raw[link][4] + raw[link][5]]
+        for off in range(offset, offset + size, entsize or 16):
+            name, value, ssize, info, _, shndx = struct.unpack_from("<IIIBBH", image, off)
+            symbols.append((cstr(strtab, name), value, ssize, info & 0xF, shndx))
+    return sections, symbols
+
+
+def thumb_calls(code, base, start, end, data_ranges):
+    """Direct calls (BL, and B out of the function: tail calls) and indirect
+    calls (BLX/BX through a register other than LR) of a Thumb function."""
+    calls, indirect = set(), False
+    pc = start
+    while pc + 2 <= end:
+        if any(lo <= pc < hi for lo, hi in data_ranges):
+            pc += 2
+            continue
+        hw, = struct.unpack_from("<H", code, pc - base)
+        if (hw & 0xF800) in (0xE800, 0xF000, 0xF800):
+            if pc + 4 > end:
+                break
+            hw2, = struct.unpack_from("<H", code, pc + 2 - base)
+            if (hw & 0xF800) == 0xF000 and (hw2 & 0xD000) == 0xD000:
+                s = (hw >> 10) & 1
+                i1 = ~((hw2 >> 13) & 1 ^ s) & 1
+                i2 = ~((hw2 >> 11) & 1 ^ s) & 1
+                imm = (s << 24) | (i1 << 23) | (i2 << 22) | ((hw & 0x3FF) << 12) | ((hw2 & 0x7FF) << 1)
+                if s:
+                    imm -= 1 << 25
+                calls.add(pc + 4 + imm)
+            pc += 4
+            continue
+        if (hw & 0xF800) == 0xE000:
+            imm = (hw & 0x7FF) << 1
+            if imm & 0x800:
+                imm -= 0x1000
+            target = pc + 4 + imm
+            if not start <= target < end:
+                calls.add(target)
+        elif (hw & 0xFF00) == 0x4700 and ((hw >> 3) & 0xF) != 14:
+            indirect = True
+        pc += 2
+    return calls, indirect
+
+
+def veneer_target(name):
+    m = VENEER.match(name)
+    return m.group(1) if m else name
+
+
+def call_graph(elf_path):
+    """Return (graph, indirect, vectors) of the Thumb code of an ELF file.
+
+    graph: {function: set of callees}, indirect: functions calling through
+    a pointer, vectors: handler names of the vector table (.intvec)
+    """
+    sections, symbols = elf_read(elf_path)
+
+    # Mapping symbols: $d starts a literal pool, $t code again
+    mapping = {}
+    for name, value, _, _, shndx in symbols:
+        if name in ("$t", "$d", "$a") or name.startswith(("$t.", "$d.")):
+            mapping.setdefault(shndx, []).append((value & ~1, name[1]))
+    data_ranges = {}
+    for shndx, marks in mapping.items():
+        marks.sort()
+        ranges = []
+        for i, (addr, kind) in enumerate(marks):
+            if kind == "d":
+                nxt = marks[i + 1][0] if i + 1 < len(marks) else 1 << 32
+                ranges.append((addr, nxt))
+        data_ranges[shndx] = ranges
+
+    funcs = {}
+    for name, value, size, stype, shndx in symbols:
+        if stype == STT_FUNC and size and shndx < len(sections):
+            funcs[value & ~1] = (name, size, shndx)
+
+    graph, indirect = {}, set()
+    for addr, (name, size, shndx) in funcs.items():
+        sname, base, flags, _, code = sections[shndx]
+        if not flags & SHF_EXECINSTR:
+            continue
+        ranges = [r for r in data_ranges.get(shndx, []) if r[0] < addr + size and r[1] > addr]
+        targets, ind = thumb_calls(code, base, addr, addr + size, ranges)
+        # A call through a veneer is a call to its target
+        graph.setdefault(name, set()).update(veneer_target(funcs[t][0]) for t in targets if t in funcs)
+        if ind:
+            indirect.add(name)
+
+    vectors = []
+    for sname, base, _, _, data in sections:
+        if sname == ".intvec":
+            for off in range(4, len(data) - 3, 4):
+                target, = struct.unpack_from("<I", data, off)
+                name = funcs.get(target & ~1, (None,))[0]
+                if name and name not in vectors:
+                    vectors.append(name)
+    return graph, indirect, vectors
+
+
+def parse_calls(path):
+    """Calls through function pointers: 'caller: callee callee ...' lines."""
+    extra = {}
+    if not path or not os.path.exists(path):
+        return extra
+    with open(path) as f:
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            if ":" not in line:
+                continue
+            caller, callees = line.split(":", 1)
+            extra.setdefault(caller.strip(), set()).update(callees.split())
+    return extra
+
+
+def worst_chains(graph, frames, roots, unknown_frame):
+    """Worst-case depth of each root: {root: (bytes, chain)}, plus the
+    functions reached without a frame size and the recursive ones."""
+    memo, missing, recursive = {}, set(), set()
+
+    def depth(func, active):
+        if func in memo:
+            return memo[func]
+        if func in active:
+            recursive.add(func)
+            return 0, []
+        if func in frames:
+            frame = frames[func][0]
+        else:
+            frame = unknown_frame
+            missing.add(func)
+        active.add(func)
+        best = (0, [])
+        for callee in sorted(graph.get(func, ())):
+            d = depth(callee, active)
+            if d[0] > best[0]:
+                best = d
+        active.discard(func)
+        memo[func] = (frame + best[0], [(func, frame)] + best[1])
+        return memo[func]
+
+    sys.setrecursionlimit(10000)
+    return {root: depth(root, set()) for root in roots}, missing, recursive
+
+
+def report_stack(args, usage, out):
+    """Stack section of the report; return the worst-case depth or None."""
+    if args.no_stack:
+        out.write("stack not checked: %s\n" % args.no_stack)
+        return None
+    frames = parse_su(args.su) if args.su else {}
+    if not frames:
+        out.write("no .su files in %s: build with -fstack-usage\n" % args.su)
+        return None
+
+    if not args.elf or not os.path.exists(args.elf):
+        big = sorted(frames.items(), key=lambda kv: -kv[1][0])[:args.top]
+        out.write("no ELF file, call graph unknown; largest frames:\n")
+        for func, (size, qual) in big:
+            out.write("  %-40s %6d %s\n" % (func, size, qual))
+        return None
+
+    graph, indirect, vectors = call_graph(args.elf)
+    extra = parse_calls(args.calls)
+    for caller, callees in extra.items():
+        graph.setdefault(caller, set()).update(callees)
+    # Reset_Handler runs main(), in thread mode
+    handlers = [v for v in vectors if v not in ("main", "Reset_Handler")] or \
+               sorted(f for f in graph if f.endswith("_Handler") and f != "Reset_Handler")
+    roots = ["main"] + handlers
+    chains, missing, recursive = worst_chains(graph, frames, roots, args.unknown_frame)
+
+    main_depth, main_chain = chains["main"]
+    isr = sorted(((chains[h][0], h) for h in handlers), reverse=True)[:args.isr_levels]
+    worst = main_depth + sum(d + EXC_FRAME for d, _ in isr)
+
+    out.write("main() chain          : %5d bytes\n" % main_depth)
+    for func, frame in main_chain:
+        out.write("  %-40s %6d%s\n" % (func, frame, "  (dynamic)" if "dynamic" in frames.get(func, (0, ""))[1] else ""))
+    for d, h in isr:
+        out.write("%-22s: %5d bytes + %d exception frame\n" % (h + " chain", d, EXC_FRAME))
+        for func, frame in chains[h][1]:
+            out.write("  %-40s %6d\n" % (func, frame))
+    out.write("worst case            : %5d of %d bytes (_Min_Stack_Size), margin %d\n"
+              % (worst, usage["stack_size"], usage["stack_size"] - worst))
+
+    # Library code is only listed as missing frames
+    unresolved = sorted(f for f in indirect if f not in extra and f in frames)
+    if unresolved:
+        out.write("calls through pointers not in %s: %s\n" % (args.calls, " ".join(unresolved)))
+    if missing:
+        out.write("no frame size (library code, counted %d bytes): %s\n"
+                  % (args.unknown_frame, " ".join(sorted(missing)[:20]) + (" ..." if len(missing) > 20 else "")))
+    if recursive:
+        out.write("recursion, counted once: %s\n" % " ".join(sorted(recursive)))
+    return worst
+
+
+# --------------------------------------------------------------------------
+# RAM code
+# --------------------------------------------------------------------------
+
+def parse_prof(path):
+    """Return {site: (runs, min, max, avg)} of the last profiler dump of a
+    log (text lines, or the output of tools/log_decode.py)."""
+    sites = {}
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = PROF_SUMMARY.search(line)
+            if m:
+                sites[m.group(1)] = tuple(int(m.group(i)) for i in range(2, 6))
+    return sites
+
+
+def ram_code(elf_path, regions):
+    """Return (functions, veneers) of an ELF file: [(name, size)] of the
+    functions linked in RAM, [(target, size, from_ram)] of the veneers."""
+    ram_region = next((r for r in regions if "RAM" in r), None)
+    if ram_region is None:
+        raise ReportError("no RAM region in the map")
+    origin, length = regions[ram_region]
+    _, symbols = elf_read(elf_path)
+
+    funcs, veneers = [], []
+    for name, value, size, stype, _ in symbols:
+        if stype != STT_FUNC or not size:
+            continue
+        in_ram = origin <= (value & ~1) < origin + length
+        if VENEER.match(name):
+            veneers.append((veneer_target(name), size, in_ram))
+        elif in_ram:
+            funcs.append((name, size))
+    return sorted(set(funcs)), sorted(set(veneers))
+
+
+def report_ram_code(args, regions, symbols, out):
+    funcs, veneers = ram_code(args.elf, regions)
+    prof = parse_prof(args.prof) if args.prof else {}
+    if not funcs:
+        out.write("no RAMFUNC code\n")
+        return
+
+    out.write("%-28s %6s %6s  %s\n" % ("function", "RAM", "flash",
+                                       "cycles, entry to exit" if args.prof else ""))
+    for name, size in funcs:
+        site = RAMFUNC_SITES.get(name)
+        cycles = ""
+        if site in prof:
+            runs, lo, hi, avg = prof[site]
+            cycles = "%s: %d runs, min %d max %d avg %d" % (site, runs, lo, hi, avg)
+        elif args.prof:
+            cycles = "%s: not in %s" % (site, args.prof) if site else "no profiler site"
+        out.write("%-28s %6d %6d  %s\n" % (name[:28], size, size, cycles))
+
+    # The section size includes the alignment and the veneers of RAM code
+    section = symbols.get("_eramfunc", 0) - symbols.get("_sramfunc", 0)
+    from_ram = [v for v in veneers if v[2]]
+    into_ram = [v for v in veneers if not v[2]]
+    out.write(".ramfunc              : %5d bytes of RAM, as many of flash for the copy\n" % section)
+    out.write("veneers from RAM      : %5d bytes, %d (%s)\n" % (
+        sum(v[1] for v in from_ram), len(from_ram), " ".join(v[0] for v in from_ram) or "none"))
+    out.write("veneers into RAM      : %5d bytes of flash, %d (%s)\n" % (
+        sum(v[1] for v in into_ram), len(into_ram), " ".join(v[0] for v in into_ram) or "none"))
+
+
+# --------------------------------------------------------------------------
+# Stack configuration macros
+# --------------------------------------------------------------------------
+
+CONFIG_PROGRAM = r"""
+#include <stdio.h>
+#include "Beacon_config.h"
+#include "log.h"
+
+uint8_t hot_table_radio_config[1];
+
+static long size(long l, long a, long s, long v, long m, long d)
+{
+  return TOTAL_BUFFER_SIZE(l, a, s, v, m, d);
+}
+
+int main(void)
+{
+  long p[6] = { NUM_LINKS, NUM_GATT_ATTRIBUTES, NUM_GATT_SERVICES, ATT_VALUE_ARRAY_SIZE,
+                MBLOCKS_COUNT, CONTROLLER_DATA_LENGTH_EXTENSION_ENABLED };
+  long q[6];
+  int i, j;
+
+  printf("total %ld\n", size(p[0], p[1], p[2], p[3], p[4], p[5]));
+  printf("fixed %ld\n", size(0, 0, 0, 0, 0, 0));
+  printf("opt %ld\n", (long)OPT_MBLOCKS);
+  printf("mtu %ld\n", (long)MAX_ATT_MTU);
+  printf("flash %ld\n", (long)TOTAL_FLASH_BUFFER_SIZE(FLASH_SEC_DB_SIZE, FLASH_SERVER_DB_SIZE));
+  printf("log_ring %ld\n", (long)LOG_RING_SIZE);
+#ifdef BEACON_PROFILE_FREED_RAM
+  printf("freed %ld\n", (long)BEACON_PROFILE_FREED_RAM);
+#endif
+  for (i = 0; i < 6; i++) {
+    for (j = 0; j < 6; j++)
+      q[j] = p[j];
+    q[i] = p[i] + 1;
+    printf("param %ld %ld\n", p[i], size(q[0], q[1], q[2], q[3], q[4], q[5]));
+  }
+  return 0;
+}
+"""
+
+# Rows of the parameter table, in the order of the param lines
+CONFIG_PARAMS = ["NUM_LINKS", "NUM_GATT_ATTRIBUTES", "NUM_GATT_SERVICES", "ATT_VALUE_ARRAY_SIZE",
+                 "MBLOCKS_COUNT", "DATA_LENGTH_EXTENSION"]
+
+
+def config_costs(args, defines):
+    """Evaluate TOTAL_BUFFER_SIZE() of inc/Beacon_config.h with the host
+    compiler and extra defines. Return {"total", "fixed", "opt", "mtu",
+    "flash", "log_ring", "freed", "params": [(value, size with value+1)]}."""
+    tmp = tempfile.mkdtemp(prefix="mem_report")
+    src, exe = os.path.join(tmp, "config.c"), os.path.join(tmp, "config")
+    with open(src, "w") as f:
+        f.write(CONFIG_PROGRAM)
+    cmd = [args.cc] + args.cflags.split() + defines.split() + ["-o", exe, src]
+    try:
+        subprocess.run(cmd, check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        text = subprocess.run([exe], check=True, stdout=subprocess.PIPE).stdout.decode()
+    except (OSError, subprocess.CalledProcessError) as e:
+        raise ReportError("cannot evaluate the configuration (%s): %s" % (
+            " ".join(cmd), getattr(e, "stderr", b"").decode(errors="replace").strip() if getattr(e, "stderr", None) else e))
+    finally:
+        for path in (src, exe):
+            if os.path.exists(path):
+                os.remove(path)
+        os.rmdir(tmp)
+
+    res = {"params": [], "freed": None}
+    for line in text.splitlines():
+        fields = line.split()
+        if fields[0] == "param":
+            res["params"].append((int(fields[1]), int(fields[2])))
+        else:
+            res[fields[0]] = int(fields[1])
+    return res
+
+
+def report_config(args, usage, symbols_dyn, out):
+    profiles = [p.split("=", 1) if "=" in p else (p, "") for p in args.profile]
+    try:
+        cfg = config_costs(args, profiles[0][1] if profiles else "")
+        others = [(name, config_costs(args, defines)) for name, defines in profiles]
+    except ReportError as e:
+        # Not a budget: the report goes on without this section
+        out.write("%s\n" % e)
+        return
+    total, free = cfg["total"], usage["ram_free"] - args.ram_free_min
+    if profiles:
+        out.write("profile               : %s\n" % profiles[0][0])
+    out.write("TOTAL_BUFFER_SIZE()   : %5d bytes" % total)
+    if symbols_dyn is not None:
+        out.write(", dyn_alloc_a in the map %d" % symbols_dyn)
+    out.write("\nfixed part            : %5d bytes\n" % cfg["fixed"])
+    out.write("%-28s %6s %8s %8s %7s %10s\n" % ("parameter", "value", "bytes", "per unit", "% RAM",
+                                               "max value"))
+
+    # Per unit cost, then the bytes of each parameter from a linear model
+    for name, (value, plus_one) in zip(CONFIG_PARAMS, cfg["params"]):
+        unit = plus_one - total
+        rows = [(name, value)]
+        if name == "MBLOCKS_COUNT":
+            rows = [("MBLOCKS_CALC()", value - cfg["opt"]), ("OPT_MBLOCKS", cfg["opt"])]
+        for rname, rvalue in rows:
+            cost = unit * rvalue
+            grow = "" if unit <= 0 else str(rvalue + max(free, 0) // unit)
+            if name == "DATA_LENGTH_EXTENSION":
+                grow = "fits" if value or unit <= free else "no room"
+            out.write("%-28s %6d %8d %8d %6.1f%% %10s\n" % (rname, rvalue, cost, unit,
+                                                         100.0 * cost / usage["ram_size"], grow))
+    out.write("max value: largest setting that keeps --ram-free-min (%d bytes) free\n" % args.ram_free_min)
+
+    if len(others) > 1:
+        out.write("\n%-14s %6s %6s %6s %6s %8s %4s %8s %8s %8s %8s\n" % (
+            "profile", "links", "attrs", "servs", "mtu", "mblocks", "dle", "stack", "freed",
+            "log ring", "flash db"))
+        for name, c in others:
+            p = [v for v, _ in c["params"]]
+            freed = c["freed"] if c["freed"] is not None else 0
+            out.write("%-14s %6d %6d %6d %6d %5d+%-2d %4d %8d %8d %8d %8d\n" % (
+                name, p[0], p[1], p[2], c["mtu"], p[4] - c["opt"], c["opt"], p[5], c["total"],
+                freed, c["log_ring"], c["flash"]))
+        out.write("freed: stack RAM saved against the connectable profile, log ring: "
+                  "application buffer it pays for\n")
+
+
+def dyn_alloc_size(path):
+    """Size of dyn_alloc_a in the map: the input section defining it."""
+    with open(path, errors="replace") as f:
+        lines = f.read().splitlines()
+    for i, line in enumerate(lines):
+        if re.match(r"^\s+0x[0-9a-fA-F]+\s+dyn_alloc_a\s*$", line):
+            for prev in reversed(lines[max(0, i - 3):i]):
+                m = re.match(r"^ ?\S*\s+0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+)\s+\S+", prev)
+                if m:
+                    return int(m.group(1), 16)
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--map", default="BLE_Beacon.map", help="linker map file")
+    parser.add_argument("--su", help="directory of the -fstack-usage files (obj)")
+    parser.add_argument("--elf", help="ELF file, for the call graph")
+    parser.add_argument("--no-stack", metavar="REASON",
+                        help="skip the stack part, the build has no stack usage data")
+    parser.add_argument("--calls", default=os.path.join(os.path.dirname(__file__), "stack_calls.txt"),
+                        help="calls through function pointers")
+    parser.add_argument("--cc", help="host C compiler, to evaluate inc/Beacon_config.h")
+    parser.add_argument("--cflags", default="", help="include paths and defines for --cc")
+    parser.add_argument("--profile", action="append", default=[], metavar="NAME=DEFINES",
+                        help="build profile and its defines, the first one is the current one")
+    parser.add_argument("--ram-free-min", type=int, default=0, help="bytes of RAM left free")
+    parser.add_argument("--flash-free-min", type=int, default=0, help="bytes of flash left free")
+    parser.add_argument("--stack-margin", type=int, default=0,
+                        help="bytes of _Min_Stack_Size left over the worst case")
+    parser.add_argument("--isr-levels", type=int, default=1,
+                        help="interrupt handlers stacked over main() at once")
+    parser.add_argument("--unknown-frame", type=int, default=0,
+                        help="frame assumed for functions without stack usage data")
+    parser.add_argument("--prof", help="log with a profiler dump, for the cycles of the RAM code")
+    parser.add_argument("--top", type=int, default=15, help="modules and frames listed")
+    args = parser.parse_args()
+    out = sys.stdout
+
+    try:
+        regions, symbols, outputs = parse_map(args.map)
+        usage, modules = memory_usage(regions, symbols, outputs)
+        out.write("== memory (%s)\n" % args.map)
+        report_memory(usage, modules, out, args.top)
+
+        out.write("\n== stack\n")
+        worst = report_stack(args, usage, out)
+
+        if args.elf and os.path.exists(args.elf):
+            out.write("\n== RAM code (inc/ramfunc.h)\n")
+            report_ram_code(args, regions, symbols, out)
+
+        if args.cc:
+            out.write("\n== stack configuration (inc/Beacon_config.h)\n")
+            report_config(args, usage, dyn_alloc_size(args.map), out)
+    except (OSError, ReportError) as e:
+        sys.exit("mem_report: %s" % e)
+
+    failures = []
+    if usage["ram_free"] < args.ram_free_min:
+        failures.append("free RAM %d bytes, budget %d" % (usage["ram_free"], args.ram_free_min))
+    if usage["flash_free"] < args.flash_free_min:
+        failures.append("free flash %d bytes, budget %d" % (usage["flash_free"], args.flash_free_min))
+    if worst is not None and worst > usage["stack_size"] - args.stack_margin:
+        failures.append("worst-case stack %d bytes, budget %d (_Min_Stack_Size %d - margin %d)"
+                        % (worst, usage["stack_size"] - args.stack_margin, usage["stack_size"],
+                           args.stack_margin))
+    out.write("\n")
+    for failure in failures:
+        out.write("OVER BUDGET: %s\n" % failure)
+    if failures:
+        sys.exit(1)
+    out.write("memory budgets ok%s\n" % (" (stack not checked)" if args.no_stack else ""))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Decoder of the trace frames of inc/trace.h: timeline and timing summary.
+
+Input, one of:
+  - the OpenOCD log of a TRACE=dcc firmware (openocd -l <file>, with
+    "target_request debugmsgs enable"): lines of hex bytes
+  - --raw: a binary capture of the UART of a TRACE=uart firmware; the
+    frames are found between the text of PRINTF()
+
+Each frame is a header word (magic 0xA5, number of data words, id), the
+sleep timer timestamp (sysT32, 2.4414 us) and the data words, little endian.
+The names of the trace points and records are read from inc/trace.h.
+
+Usage:
+    trace_decode.py openocd.log
+    trace_decode.py --raw uart.bin --summary
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+TRACE_MAGIC = 0xA5
+SYST_US = 1000.0 / 409.6
+SLEEP_MODES = {0: "RUNNING", 1: "CPU_HALT", 2: "WAKETIMER", 3: "NOTIMER"}
+
+HEX_LINE = re.compile(r"^(?:.*: )?((?:[0-9a-f]{2} )*[0-9a-f]{2}) ?$")
+
+# Intervals reported by --summary: (from, to, label)
+SPANS = [
+    ("WAKE", "SLEEP", "awake (wake to sleep)"),
+    ("SLEEP", "WAKE", "asleep"),
+    ("STACK_TICK", "STACK_DONE", "BTLE_StackTick()"),
+    ("LOOP", "LOOP", "loop period"),
+]
+
+
+def trace_names(header):
+    """Return {id: name} from the Trace_Point_t and Trace_Record_t enums."""
+    names = {}
+    with open(header) as f:
+        text = f.read()
+    for body in re.findall(r"typedef enum \{(.*?)\}", text, re.S):
+        value = -1
+        for name, init in re.findall(r"TRACE_(?:PT|REC)_(\w+)\s*(?:=\s*(\w+))?\s*,", body):
+            value = int(init, 0) if init else value + 1
+            names[value] = name
+    return names
+
+
+def read_openocd(path):
+    data = bytearray()
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = HEX_LINE.match(line.strip())
+            if m:
+                data += bytes(int(x, 16) for x in m.group(1).split())
+    return bytes(data)
+
+
+def frames(data, raw):
+    """Yield (id, timestamp, data words) of each frame of the stream."""
+    pos = 0
+    while pos + 8 <= len(data):
+        header, stamp = struct.unpack_from("<II", data, pos)
+        n = (header >> 16) & 0xFF
+        if header >> 24 != TRACE_MAGIC or n > 8 or pos + 8 + 4 * n > len(data):
+            if not raw:
+                sys.stderr.write("trace_decode: lost sync at byte %d\n" % pos)
+            pos += 1
+            continue
+        words = struct.unpack_from("<%dI" % n, data, pos + 8)
+        pos += 8 + 4 * n
+        yield header & 0xFFFF, stamp, words
+
+
+def describe(name, words):
+    if name == "SLEEP" and len(words) == 2:
+        timeout = struct.unpack("<i", struct.pack("<I", words[1]))[0]
+        return "mode=%s timeout=%s" % (SLEEP_MODES.get(words[0], words[0]),
+                                       "none" if timeout < 0 else "%d ms" % timeout)
+    if name == "LOST" and words:
+        return "%d frames lost" % words[0]
+    return " ".join("0x%08x" % w for w in words)
+
+
+def main():
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("input", help="OpenOCD log, or UART capture with --raw")
+    parser.add_argument("--raw", action="store_true", help="binary UART capture")
+    parser.add_argument("--header", default=os.path.join(root, "inc", "trace.h"),
+                        help="trace.h with the point and record names")
+    parser.add_argument("--summary", action="store_true", help="only print the timing summary")
+    args = parser.parse_args()
+
+    names = trace_names(args.header)
+    if args.raw:
+        with open(args.input, "rb") as f:
+            data = f.read()
+    else:
+        data = read_openocd(args.input)
+
+    counts = {}
+    last = {}
+    spans = {label: [] for _, _, label in SPANS}
+    t0 = prev = None
+    base = 0
+    last_stamp = None
+    for ident, stamp, words in frames(data, args.raw):
+        # 32-bit sleep timer: unwrap
+        if last_stamp is not None and stamp < last_stamp and last_stamp - stamp > 1 << 31:
+            base += 1 << 32
+        last_stamp = stamp
+        t = (base + stamp) * SYST_US
+        if t0 is None:
+            t0 = prev = t
+        name = names.get(ident, "0x%04x" % ident)
+        counts[name] = counts.get(name, 0) + 1
+        if name == "LOST":
+            last.clear()
+        for start, end, label in SPANS:
+            if name == end and start in last:
+                spans[label].append(t - last[start])
+        last[name] = t
+        if not args.summary:
+            print("%12.3f ms %+10.3f  %-12s %s" % ((t - t0) / 1000.0, (t - prev) / 1000.0, name,
+                                                   describe(name, words)))
+        prev = t
+
+    if t0 is None:
+        sys.exit("trace_decode: no trace frame found")
+
+    print("\n%-24s %8s" % ("trace point", "count"))
+    for name, n in sorted(counts.items(), key=lambda x: -x[1]):
+        print("%-24s %8d" % (name, n))
+    print("\n%-24s %8s %12s %12s %12s" % ("interval", "count", "min us", "avg us", "max us"))
+    for _, _, label in SPANS:
+        values = spans[label]
+        if values:
+            print("%-24s %8d %12.1f %12.1f %12.1f" % (label, len(values), min(values),
+                                                       sum(values) / len(values), max(values)))
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except BrokenPipeError:
+        sys.stderr.close()